@@ -0,0 +1,109 @@
+#include "autolang.h"
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../driver/driver.h"
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../typeChecker/typechecker.h"
+#include "../runtime/compiler.h"
+
+struct al_program{
+    struct Entry{
+        al_phase phase;
+        int line, col;
+        std::string message;
+    };
+    std::vector<Entry> diagnostics;
+    CompiledProgram compiled;
+};
+
+static void addDiagnostics(al_program* program, al_phase phase, const std::vector<std::string>& errors){
+    for(const auto& error : errors){
+        al_program::Entry entry;
+        entry.phase = phase;
+        splitDiagnostic(error, entry.line, entry.col, entry.message);
+        program->diagnostics.push_back(std::move(entry));
+    }
+}
+
+uint32_t al_api_version(void){
+    return AL_API_VERSION;
+}
+
+al_status al_compile(const char* source, size_t length, al_program** out){
+    if(!out) return AL_INVALID_ARGUMENT;
+    *out = nullptr;
+    if(!source && length > 0) return AL_INVALID_ARGUMENT;
+
+    // nothing may leave a C entry point as an exception
+    try{
+        std::unique_ptr<al_program> program(new al_program());
+        std::string input(source ? source : "", length);
+
+        Lexer lexer(input);
+        Parser parser(lexer);
+        auto ast = parser.parseProgram();
+        addDiagnostics(program.get(), AL_PHASE_LEX, lexer.getErrors());
+        addDiagnostics(program.get(), AL_PHASE_PARSE, parser.getErrors());
+
+        if(program->diagnostics.empty()){
+            TypeChecker checker;
+            if(!checker.checkProgram(ast.get())){
+                addDiagnostics(program.get(), AL_PHASE_TYPECHECK, checker.getErrors());
+            }
+        }
+        if(program->diagnostics.empty()){
+            Compiler compiler;
+            program->compiled = compiler.compileProgram(ast.get());
+            addDiagnostics(program.get(), AL_PHASE_COMPILE, compiler.getErrors());
+            // the resolved map points into the AST that is freed on return
+            for(auto& block : program->compiled.blocks) block.layout.resolved.clear();
+        }
+        if(!program->diagnostics.empty()) program->compiled = CompiledProgram();
+
+        al_status status = program->diagnostics.empty() ? AL_OK : AL_HAS_ERRORS;
+        *out = program.release();
+        return status;
+    }
+    catch(const std::bad_alloc&){
+        return AL_OUT_OF_MEMORY;
+    }
+    catch(...){
+        return AL_INTERNAL_ERROR;
+    }
+}
+
+size_t al_diagnostic_count(const al_program* program){
+    return program ? program->diagnostics.size() : 0;
+}
+
+int al_diagnostic_get(const al_program* program, size_t index, al_diagnostic* out){
+    if(!program || !out || index >= program->diagnostics.size()) return -1;
+    const auto& entry = program->diagnostics[index];
+    out->phase = entry.phase;
+    out->line = entry.line;
+    out->col = entry.col;
+    out->message = entry.message.c_str();
+    return 0;
+}
+
+size_t al_block_count(const al_program* program){
+    return program ? program->compiled.blocks.size() : 0;
+}
+
+const char* al_block_name(const al_program* program, size_t index){
+    if(!program || index >= program->compiled.blocks.size()) return nullptr;
+    return program->compiled.blocks[index].name.c_str();
+}
+
+size_t al_block_instruction_count(const al_program* program, size_t index){
+    if(!program || index >= program->compiled.blocks.size()) return 0;
+    return program->compiled.blocks[index].code.size();
+}
+
+void al_program_free(al_program* program){
+    delete program;
+}
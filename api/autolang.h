@@ -0,0 +1,79 @@
+#ifndef AUTOLANG_H
+#define AUTOLANG_H
+
+/*
+ * C API of libautolang (build/libautolang.a, build/libautolang.so).
+ *
+ * Compiles an in-memory AutoLang source buffer in process: lexing, parsing,
+ * type checking and bytecode generation. The result is one opaque handle that
+ * owns everything (program and diagnostics); al_program_free() releases it.
+ * Strings returned by the library stay valid until the handle is freed.
+ * Handles are independent, different threads may compile at the same time.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define AL_API __attribute__((visibility("default")))
+#else
+#define AL_API
+#endif
+
+/* bumped whenever a declaration of this header changes incompatibly */
+#define AL_API_VERSION 1
+
+typedef struct al_program al_program;
+
+typedef enum al_status{
+    AL_OK = 0,
+    AL_HAS_ERRORS = 1,        /* compiled, but diagnostics were reported */
+    AL_INVALID_ARGUMENT = 2,
+    AL_OUT_OF_MEMORY = 3,
+    AL_INTERNAL_ERROR = 4
+} al_status;
+
+typedef enum al_phase{
+    AL_PHASE_LEX = 0,
+    AL_PHASE_PARSE = 1,
+    AL_PHASE_TYPECHECK = 2,
+    AL_PHASE_COMPILE = 3
+} al_phase;
+
+typedef struct al_diagnostic{
+    al_phase phase;
+    int line;                 /* 0 when the message has no position */
+    int col;
+    const char* message;      /* without the "Line X, Col Y:" prefix */
+} al_diagnostic;
+
+/* AL_API_VERSION the library was built with */
+AL_API uint32_t al_api_version(void);
+
+/*
+ * Compiles length bytes of source (no terminating zero needed).
+ * *out receives a handle for AL_OK and AL_HAS_ERRORS, NULL otherwise.
+ */
+AL_API al_status al_compile(const char* source, size_t length, al_program** out);
+
+/* diagnostics of every phase, in the order they were reported */
+AL_API size_t al_diagnostic_count(const al_program* program);
+AL_API int al_diagnostic_get(const al_program* program, size_t index, al_diagnostic* out); /* 0 on success */
+
+/* the control blocks of a program without errors, in source order */
+AL_API size_t al_block_count(const al_program* program);
+AL_API const char* al_block_name(const al_program* program, size_t index);
+AL_API size_t al_block_instruction_count(const al_program* program, size_t index);
+
+/* releases the handle and everything it owns, NULL is fine */
+AL_API void al_program_free(al_program* program);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUTOLANG_H */
@@ -0,0 +1,72 @@
+/*
+ * In-process compile latency of small snippets through the libautolang C API.
+ * Written in C on purpose: it only sees api/autolang.h and the library.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../api/autolang.h"
+
+static const char* SNIPPETS[] = {
+    "control a {\n    int x;\n    set x (x + 1);\n}\n",
+    "control brake {\n    float speed;\n    bool pressed;\n    float cmd;\n"
+    "    if (pressed == true) {\n        set cmd (speed - 10.0);\n    }\n}\n",
+    "control bad {\n    int x;\n    set x true;\n}\n",
+};
+#define SNIPPET_COUNT (sizeof(SNIPPETS) / sizeof(SNIPPETS[0]))
+
+static double nowNs(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compareDouble(const void* a, const void* b){
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char* argv[]){
+    long runs = argc > 1 ? atol(argv[1]) : 20000;
+    if(runs <= 0) runs = 20000;
+    double* samples = malloc(sizeof(double) * runs);
+    if(!samples) return 1;
+
+    printf("libautolang api version %u, %ld compiles per snippet\n", al_api_version(), runs);
+    printf("%-8s %-8s %-8s %-10s %-10s %-10s %s\n", "snippet", "bytes", "status", "p50 ns", "p99 ns", "max ns", "compiles/sec");
+
+    for(size_t s = 0; s < SNIPPET_COUNT; s++){
+        size_t length = strlen(SNIPPETS[s]);
+        al_status status = AL_OK;
+        double total = 0;
+        for(long r = 0; r < runs; r++){
+            al_program* program = NULL;
+            double start = nowNs();
+            status = al_compile(SNIPPETS[s], length, &program);
+            al_program_free(program);
+            samples[r] = nowNs() - start;
+            total += samples[r];
+        }
+        qsort(samples, runs, sizeof(double), compareDouble);
+        printf("%-8zu %-8zu %-8s %-10.0f %-10.0f %-10.0f %.0f\n", s, length,
+               status == AL_OK ? "ok" : status == AL_HAS_ERRORS ? "errors" : "failed",
+               samples[runs / 2], samples[(size_t)(runs * 0.99)], samples[runs - 1], runs / (total / 1e9));
+    }
+
+    /* diagnostics of the broken snippet, to show the API */
+    al_program* program = NULL;
+    if(al_compile(SNIPPETS[2], strlen(SNIPPETS[2]), &program) == AL_HAS_ERRORS){
+        for(size_t i = 0; i < al_diagnostic_count(program); i++){
+            al_diagnostic d;
+            if(al_diagnostic_get(program, i, &d) == 0){
+                printf("diagnostic phase %d line %d col %d: %s\n", d.phase, d.line, d.col, d.message);
+            }
+        }
+    }
+    al_program_free(program);
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include "chainProgram.h"
+#include <sstream>
+
+std::string makeChainProgram(const ChainOptions& options){
+    std::ostringstream src;
+    for(int i = 0; i < options.blocks; i++){
+        std::string acc = "acc" + std::to_string(i);
+        std::string n = "n" + std::to_string(i);
+        std::string in = i > 0 ? "s" + std::to_string(i - 1) : options.accumulate ? "speed" : "1.5";
+        src << "control b" << i << " {\n"
+            << "    float s" << i << ";\n";
+        if(i > 0) src << "    float s" << i - 1 << ";\n";
+        else if(options.accumulate) src << "    float speed;\n";
+        src << "    float " << acc << ";\n";
+        if(options.counter){
+            src << "    int " << n << ";\n"
+                << "    set " << n << " (" << n << " + 1);\n";
+        }
+        if(options.accumulate) src << "    set " << acc << " (" << acc << " + " << in << ");\n";
+        else src << "    set " << acc << " " << in << ";\n";
+        for(int w = 0; w < options.work; w++){
+            src << "    set " << acc << " (" << acc << " + " << w % 7 + 1 << ".25);\n"
+                << "    if (" << acc << " > 1000.0) {\n"
+                << "        set " << acc << " (" << acc << " - 1000.0);\n"
+                << "    }\n";
+        }
+        src << "    set s" << i << " " << acc << ";\n"
+            << "}\n";
+    }
+    return src.str();
+}
@@ -0,0 +1,22 @@
+#ifndef BENCH_CHAIN_PROGRAM_H
+#define BENCH_CHAIN_PROGRAM_H
+
+#include <string>
+
+// The chain program the runtime benchmarks share: block i reads the signal s<i-1> of
+// block i-1 into an accumulator, does work rounds of `acc + k; if over 1000, wrap`,
+// and exports the result as s<i>. Top level names are signals, so only s<i> is shared,
+// acc<i> and n<i> stay private to their block.
+struct ChainOptions{
+    int blocks = 64;
+    int work = 4;
+    // also count the runs of every block in an int n<i>
+    bool counter = false;
+    // add the incoming signal to the accumulator instead of starting from it,
+    // block 0 then reads a float speed input instead of the constant 1.5
+    bool accumulate = false;
+};
+
+std::string makeChainProgram(const ChainOptions& options);
+
+#endif // BENCH_CHAIN_PROGRAM_H
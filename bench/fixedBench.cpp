@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../runtime/compiler.h"
+#include "../runtime/interpreter.h"
+
+// Float versus fixed point evaluation of the same program.
+// Every block is straight line float logic (if bodies are empty), so each
+// instruction of a block runs once per tick and ops/sec is exact.
+// Inputs change every tick, the outputs of both modes are compared at the end.
+
+static std::string makeProgram(int blocks){
+    std::ostringstream src;
+    for(int i = 0; i < blocks; i++){
+        src << "control b" << i << " {\n"
+            << "    float speed;\n"
+            << "    float target;\n"
+            << "    int gear;\n"
+            << "    float err" << i << ";\n"
+            << "    float out" << i << ";\n"
+            << "    set err" << i << " (speed - 5.0) - target + " << i % 9 << ".25;\n"
+            << "    set out" << i << " speed + gear - 2.5 - (target - 0.75);\n"
+            << "    if (err" << i << " > out" << i << ") {\n    }\n"
+            << "    if (gear + 1.5 > speed - target) {\n    }\n"
+            << "    set out" << i << " out" << i << " + err" << i << " - 12.5;\n"
+            << "}\n";
+    }
+    return src.str();
+}
+
+struct ModeResult{
+    double seconds = 0;
+    uint64_t opsPerTick = 0;
+    std::vector<double> outputs;
+};
+
+static bool runMode(const std::string& source, int fracBits, uint64_t ticks, ModeResult& result){
+    Compiler::setDefaultFixedPoint(fracBits);
+    CompiledProgram program;
+    std::vector<std::string> errors;
+    if(!compileSource(source, program, errors)){
+        for(const auto& err : errors) std::cerr << err << "\n";
+        return false;
+    }
+    for(const auto& block : program.blocks) result.opsPerTick += block.code.size();
+
+    FrameStore frames(program);
+
+    // speed, target and gear are shared by every block, so they are fed once into
+    // their bus cell (slotData), a slot at offset 0 of that cell gives writeSlot the type
+    auto input = [&](const char* name, FrameSlot& at){
+        int slot = program.findTopLevelSlot(0, name);
+        at = program.blocks[0].layout.slots[slot];
+        at.offset = 0;
+        return frames.slotData(0, slot);
+    };
+    FrameSlot speedAt, targetAt, gearAt;
+    uint8_t* speedCell = input("speed", speedAt);
+    uint8_t* targetCell = input("target", targetAt);
+    uint8_t* gearCell = input("gear", gearAt);
+
+    auto start = std::chrono::steady_clock::now();
+    for(uint64_t t = 0; t < ticks; t++){
+        writeSlot(speedCell, speedAt, 40.0 + (t % 400) * 0.1, program.fracBits);
+        writeSlot(targetCell, targetAt, 50.0 - (t % 160) * 0.25, program.fracBits);
+        writeSlot(gearCell, gearAt, 1 + t % 6, program.fracBits);
+        runProgram(program, frames);
+    }
+    auto end = std::chrono::steady_clock::now();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+
+    for(size_t b = 0; b < program.blocks.size(); b++){
+        for(const auto& slot : program.blocks[b].layout.slots){
+            if(slot.scope == 0 && slot.name.rfind("out", 0) == 0){
+                result.outputs.push_back(readSlot(frames.frame(b), slot, program.fracBits));
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]){
+    int blocks = argc > 1 ? std::atoi(argv[1]) : 64;
+    uint64_t ticks = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200000;
+    std::vector<std::string> formats;
+    for(int i = 3; i < argc; i++) formats.push_back(argv[i]);
+    if(formats.empty()) formats = {"Q15.16", "Q23.8"};
+
+    std::string source = makeProgram(blocks);
+    ModeResult reference;
+    if(!runMode(source, FIXED_POINT_OFF, ticks, reference)) return 1;
+
+    std::cout << "fixed point vs float: " << blocks << " blocks, " << ticks << " ticks\n";
+    std::cout << std::left << std::setw(10) << "mode"
+              << std::setw(16) << "ticks/sec"
+              << std::setw(16) << "ops/sec"
+              << std::setw(12) << "ns/tick"
+              << std::setw(14) << "max |error|"
+              << "speedup\n";
+
+    auto report = [&](const std::string& name, const ModeResult& r){
+        double tps = ticks / r.seconds;
+        double maxError = 0.0;
+        for(size_t i = 0; i < r.outputs.size() && i < reference.outputs.size(); i++){
+            maxError = std::max(maxError, std::fabs(r.outputs[i] - reference.outputs[i]));
+        }
+        std::cout << std::left << std::setw(10) << name
+                  << std::setw(16) << static_cast<uint64_t>(tps)
+                  << std::setw(16) << static_cast<uint64_t>(tps * r.opsPerTick)
+                  << std::setw(12) << static_cast<uint64_t>(1e9 / tps)
+                  << std::setw(14) << maxError
+                  << std::fixed << std::setprecision(2) << reference.seconds / r.seconds << "x\n"
+                  << std::defaultfloat;
+    };
+    report("float", reference);
+
+    for(const auto& format : formats){
+        int fracBits;
+        if(!parseQFormat(format, fracBits)){
+            std::cerr << "ERROR :: bad fixed point format '" << format << "'\n";
+            return 1;
+        }
+        ModeResult r;
+        if(!runMode(source, fracBits, ticks, r)) return 1;
+        report(qFormatName(fracBits), r);
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chainProgram.h"
+#include "../runtime/compiler.h"
+#include "../runtime/fleet.h"
+#include "../runtime/interpreter.h"
+
+// Throughput of the fleet runtime in vehicle-ticks/sec from 1 to N threads.
+// Every vehicle starts from its own speed, so no two vehicles compute the same values;
+// a few vehicles are checked against runProgram() on a FrameStore of their own.
+
+// every block counts its runs and adds up what it reads, block 0 from the speed of its vehicle
+static std::string makeProgram(int blocks, int work){
+    ChainOptions options;
+    options.blocks = blocks;
+    options.work = work;
+    options.counter = true;
+    options.accumulate = true;
+    return makeChainProgram(options);
+}
+
+static double speedOf(size_t vehicle){
+    return 10.0 + vehicle % 97 * 0.5;
+}
+
+int main(int argc, char* argv[]){
+    size_t vehicles = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16384;
+    int blocks = argc > 2 ? std::atoi(argv[2]) : 16;
+    int work = argc > 3 ? std::atoi(argv[3]) : 4;
+    uint64_t ticks = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 100;
+    int maxThreads = argc > 5 ? std::atoi(argv[5]) : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    size_t chunk = argc > 6 ? std::strtoull(argv[6], nullptr, 10) : 0;
+
+    CompiledProgram program;
+    std::vector<std::string> errors;
+    if(!compileSource(makeProgram(blocks, work), program, errors)){
+        for(const auto& err : errors) std::cerr << err << "\n";
+        return 1;
+    }
+    // speed is only declared by b0, a slot of its frame and not a signal
+    int speedSlot = program.findTopLevelSlot(0, "speed");
+
+    std::cout << "fleet: " << vehicles << " vehicles, " << blocks << " blocks, " << ticks << " ticks, "
+              << std::thread::hardware_concurrency() << " hardware threads\n";
+    std::cout << std::left << std::setw(9) << "threads"
+              << std::setw(12) << "chunk"
+              << std::setw(11) << "state KB"
+              << std::setw(11) << "huge"
+              << std::setw(20) << "vehicle-ticks/sec"
+              << std::setw(12) << "per core"
+              << std::setw(12) << "efficiency"
+              << "stolen\n";
+
+    // the reference: a few vehicles run alone on a FrameStore
+    std::vector<size_t> checked = {0, vehicles / 2, vehicles - 1};
+    std::vector<std::vector<uint8_t>> expected;
+    for(size_t v : checked){
+        FrameStore frames(program);
+        writeSlot(frames.frame(0), program.blocks[0].layout.slots[speedSlot], speedOf(v));
+        for(uint64_t t = 0; t < ticks; t++) runProgram(program, frames);
+        expected.emplace_back(frames.data(), frames.data() + frames.bytes());
+    }
+
+    double single = 0;
+    int failed = 0;
+    for(int threads = 1; threads <= maxThreads; threads = threads < maxThreads && threads * 2 > maxThreads ? maxThreads : threads * 2){
+        FleetRuntime fleet(program, vehicles, threads, chunk);
+        const FrameSlot& slot = program.blocks[0].layout.slots[speedSlot];
+        for(size_t v = 0; v < vehicles; v++) writeSlot(fleet.frame(v, 0), slot, speedOf(v));
+
+        auto start = std::chrono::steady_clock::now();
+        fleet.run(ticks);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        uint64_t ran = 0, stolen = 0;
+        for(size_t w = 0; w < fleet.threads(); w++){
+            ran += fleet.chunksRun(w);
+            stolen += fleet.chunksStolen(w);
+        }
+        double rate = vehicles * ticks / seconds;
+        if(threads == 1) single = rate;
+        std::cout << std::left << std::fixed << std::setprecision(1)
+                  << std::setw(9) << threads
+                  << std::setw(12) << fleet.chunkSize()
+                  << std::setw(11) << fleet.stateBytes() * vehicles / 1024.0
+                  << std::setw(11) << (std::to_string(fleet.hugePageWorkers()) + "/" + std::to_string(fleet.threads()))
+                  << std::setprecision(0)
+                  << std::setw(20) << rate
+                  << std::setw(12) << rate / threads
+                  << std::setprecision(2) << std::setw(12) << rate / threads / single
+                  << std::setprecision(1) << (ran ? 100.0 * stolen / ran : 0.0) << "%" << std::defaultfloat;
+
+        for(size_t i = 0; i < checked.size(); i++){
+            if(std::memcmp(fleet.state(checked[i]), expected[i].data(), expected[i].size()) != 0){
+                std::cout << "  VEHICLE " << checked[i] << " DIFFERS FROM runProgram";
+                failed = 1;
+            }
+        }
+        std::cout << "\n";
+    }
+    return failed;
+}
@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../parser/astPrinter/astPrinter.h"
+#include "../typeChecker/typechecker.h"
+
+// Times every front end phase separately on a fixed corpus:
+//   lex       Lexer::getNextToken() until EOF
+//   parse     Parser::parseProgram() (includes the lexing it pulls)
+//   typecheck TypeChecker::checkProgram() on an already parsed AST
+//   print     printProgram() on an already parsed AST, output discarded
+// Results are written one JSON object per line so two runs can be compared.
+
+struct CorpusEntry{
+    std::string name;
+    std::string source;
+};
+
+struct Result{
+    std::string corpus;
+    std::string phase;
+    size_t bytes = 0;
+    size_t tokens = 0;
+    double medianNs = 0;
+    double p99Ns = 0;
+};
+
+// a stream buffer that swallows everything, so print measures formatting and not the terminal
+class NullBuffer : public std::streambuf{
+    protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+static std::string readFile(const std::string& path){
+    std::ifstream file(path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// deterministic mid sized program: same text on every machine and every run
+static std::string syntheticProgram(int blocks){
+    std::ostringstream src;
+    uint32_t state = 12345;
+    auto next = [&](){ state = state * 1103515245u + 12345u; return (state >> 16) & 0x7fff; };
+    for(int b = 0; b < blocks; b++){
+        src << "control block" << b << " {\n"
+            << "    float speed;\n    int gear;\n    bool alert;\n    float target" << b << ";\n"
+            << "    # comment line to exercise skipWhiteSpaceorComments\n"
+            << "    set speed (" << next() % 200 << ".5 + " << next() % 50 << ".25);\n"
+            << "    set gear " << next() % 6 << ";\n";
+        int depth = 1 + next() % 4;
+        for(int d = 0; d < depth; d++){
+            src << std::string(4 * (d + 1), ' ') << "if (speed > " << next() % 150 << ".0) {\n"
+                << std::string(4 * (d + 2), ' ') << "set speed (speed - " << next() % 10 << ".5);\n"
+                << std::string(4 * (d + 2), ' ') << "set gear (gear + 1);\n";
+        }
+        src << std::string(4 * (depth + 1), ' ') << "set alert true;\n";
+        for(int d = depth; d > 0; d--){
+            src << std::string(4 * d, ' ') << "}\n";
+        }
+        src << "}\n";
+    }
+    return src.str();
+}
+
+template <typename F>
+static std::vector<double> timeRuns(int runs, F&& body){
+    std::vector<double> samples;
+    for(int r = 0; r < runs; r++){
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples;
+}
+
+static double percentile(const std::vector<double>& sorted, double p){
+    if(sorted.empty()) return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5))];
+}
+
+static void benchEntry(const CorpusEntry& entry, int runs, std::vector<Result>& results){
+    // tokens are counted once, outside of the timed loops
+    size_t tokens = 0;
+    {
+        Lexer lexer(entry.source);
+        while(lexer.getNextToken().type != TokenType::EOF_TOKEN) tokens++;
+    }
+
+    auto record = [&](const std::string& phase, const std::vector<double>& samples){
+        Result r;
+        r.corpus = entry.name;
+        r.phase = phase;
+        r.bytes = entry.source.size();
+        r.tokens = tokens;
+        r.medianNs = percentile(samples, 0.5);
+        r.p99Ns = percentile(samples, 0.99);
+        results.push_back(r);
+    };
+
+    size_t sink = 0;
+    record("lex", timeRuns(runs, [&](){
+        Lexer lexer(entry.source);
+        while(lexer.getNextToken().type != TokenType::EOF_TOKEN) sink++;
+    }));
+
+    record("parse", timeRuns(runs, [&](){
+        Lexer lexer(entry.source);
+        Parser parser(lexer);
+        auto program = parser.parseProgram();
+        sink += program->controlBlocks.size();
+    }));
+
+    Lexer lexer(entry.source);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+
+    NullBuffer nullBuffer;
+    std::streambuf* saved = std::cout.rdbuf(&nullBuffer);
+
+    record("typecheck", timeRuns(runs, [&](){
+        TypeChecker checker;
+        sink += checker.checkProgram(program.get());
+    }));
+
+    record("print", timeRuns(runs, [&](){
+        printProgram(program.get());
+    }));
+
+    std::cout.rdbuf(saved);
+    if(sink == 0) std::cerr << "";
+}
+
+static std::string toJson(const Result& r){
+    double seconds = r.medianNs / 1e9;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1)
+        << "{\"corpus\": \"" << r.corpus << "\", \"phase\": \"" << r.phase << "\""
+        << ", \"bytes\": " << r.bytes << ", \"tokens\": " << r.tokens
+        << ", \"median_ns\": " << r.medianNs << ", \"p99_ns\": " << r.p99Ns
+        << std::setprecision(3)
+        << ", \"mb_per_s\": " << (seconds > 0 ? r.bytes / seconds / 1e6 : 0.0)
+        << ", \"tokens_per_s\": " << (seconds > 0 ? r.tokens / seconds : 0.0) << "}";
+    return out.str();
+}
+
+// reads back what toJson() wrote: corpus/phase -> median_ns
+static std::map<std::string, double> loadMedians(const std::string& path){
+    std::map<std::string, double> medians;
+    std::ifstream in(path);
+    std::string line;
+    auto field = [](const std::string& line, const std::string& key){
+        size_t at = line.find("\"" + key + "\": ");
+        if(at == std::string::npos) return std::string();
+        at += key.size() + 4;
+        if(line[at] == '"'){
+            size_t end = line.find('"', at + 1);
+            return line.substr(at + 1, end - at - 1);
+        }
+        size_t end = line.find_first_of(",}", at);
+        return line.substr(at, end - at);
+    };
+    while(std::getline(in, line)){
+        std::string corpus = field(line, "corpus");
+        std::string phase = field(line, "phase");
+        std::string median = field(line, "median_ns");
+        if(corpus.empty() || phase.empty() || median.empty()) continue;
+        medians[corpus + "/" + phase] = std::atof(median.c_str());
+    }
+    return medians;
+}
+
+static void usage(const char* prog){
+    std::cerr << "Usage: " << prog << " [--runs <n>] [--json <out>] [--compare <baseline.json>] [--threshold <percent>] [files...]\n"
+              << "  without files the fixed corpus (examples/ and a generated program) is used\n";
+}
+
+int main(int argc, char* argv[]){
+    int runs = 21;
+    std::string jsonPath;
+    std::string baselinePath;
+    double threshold = 10.0;
+    std::vector<std::string> files;
+
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--runs" && hasValue) runs = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--json" && hasValue) jsonPath = argv[++i];
+        else if(arg == "--compare" && hasValue) baselinePath = argv[++i];
+        else if(arg == "--threshold" && hasValue) threshold = std::atof(argv[++i]);
+        else if(!arg.empty() && arg[0] == '-'){
+            usage(argv[0]);
+            return 1;
+        }
+        else files.push_back(arg);
+    }
+
+    std::vector<CorpusEntry> corpus;
+    if(files.empty()){
+        corpus.push_back({"example", readFile("examples/example.alang")});
+        corpus.push_back({"complexExamle", readFile("examples/complexExamle.alang")});
+        corpus.push_back({"synthetic-2000", syntheticProgram(2000)});
+    }
+    for(const auto& path : files){
+        corpus.push_back({path, readFile(path)});
+    }
+
+    std::vector<Result> results;
+    for(const auto& entry : corpus){
+        if(entry.source.empty()){
+            std::cerr << "WARNING :: empty corpus entry " << entry.name << " (run from the repository root)\n";
+            continue;
+        }
+        benchEntry(entry, runs, results);
+    }
+
+    std::cout << std::left << std::setw(18) << "corpus"
+              << std::setw(11) << "phase"
+              << std::setw(14) << "median us"
+              << std::setw(14) << "p99 us"
+              << std::setw(12) << "MB/s"
+              << "Mtokens/s\n";
+    for(const auto& r : results){
+        double seconds = r.medianNs / 1e9;
+        std::cout << std::left << std::setw(18) << r.corpus.substr(0, 17)
+                  << std::setw(11) << r.phase
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(14) << r.medianNs / 1e3
+                  << std::setw(14) << r.p99Ns / 1e3
+                  << std::setw(12) << (seconds > 0 ? r.bytes / seconds / 1e6 : 0.0)
+                  << (seconds > 0 ? r.tokens / seconds / 1e6 : 0.0) << "\n"
+                  << std::defaultfloat;
+    }
+
+    if(!jsonPath.empty()){
+        std::ofstream out(jsonPath);
+        for(const auto& r : results) out << toJson(r) << "\n";
+        std::cout << "results written to " << jsonPath << "\n";
+    }
+
+    if(!baselinePath.empty()){
+        auto baseline = loadMedians(baselinePath);
+        bool regressed = false;
+        std::cout << "\ncompared to " << baselinePath << " (threshold " << threshold << "%)\n";
+        for(const auto& r : results){
+            auto it = baseline.find(r.corpus + "/" + r.phase);
+            if(it == baseline.end() || it->second <= 0) continue;
+            double change = (r.medianNs - it->second) / it->second * 100.0;
+            bool bad = change > threshold;
+            regressed |= bad;
+            std::cout << std::left << std::setw(18) << r.corpus.substr(0, 17)
+                      << std::setw(11) << r.phase
+                      << std::showpos << std::fixed << std::setprecision(1) << change << "%"
+                      << std::noshowpos << std::defaultfloat
+                      << (bad ? "  REGRESSION" : "") << "\n";
+        }
+        if(regressed) return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../driver/driver.h"
+#include "../image/image.h"
+#include "../runtime/compiler.h"
+#include "../runtime/interpreter.h"
+
+// Startup time: from a source file to the first tick having run, compiling the source
+// (what autolangreplay does) versus mapping a precompiled .alc image.
+// The page cache is warm in every case, so this is the cost of the work, not of the disk.
+
+static std::string makeProgram(int blocks){
+    std::ostringstream src;
+    for(int i = 0; i < blocks; i++){
+        src << "control b" << i << " {\n"
+            << "    float speed;\n"
+            << "    float s" << i << ";\n";
+        if(i > 0) src << "    float s" << i - 1 << ";\n";
+        src << "    int n" << i << ";\n"
+            << "    float out" << i << ";\n"
+            << "    set n" << i << " (n" << i << " + 1);\n"
+            << "    set out" << i << " speed + " << (i > 0 ? "s" + std::to_string(i - 1) : "0.5") << " - " << i % 9 << ".25;\n"
+            << "    if (out" << i << " > 100.0) {\n"
+            << "        float over;\n"
+            << "        set over (out" << i << " - 100.0);\n"
+            << "        set out" << i << " (out" << i << " - over);\n"
+            << "    }\n"
+            << "    set s" << i << " out" << i << " + 0.5;\n"
+            << "}\n";
+    }
+    return src.str();
+}
+
+// reuses of common subexpressions: value numbering places one temporary per repeated
+// expression behind the slots, which the image loader has to accept as part of the frame
+static std::string makeReuseProgram(int statements){
+    std::ostringstream src;
+    src << "control temps {\n"
+        << "    int x;\n"
+        << "    int y;\n";
+    for(int k = 0; k < statements; k++){
+        src << "    set y (x + " << k << ");\n"
+            << "    set y (x + " << k << ");\n";
+    }
+    src << "}\n";
+    return src.str();
+}
+
+static double nowMicros(){
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double medianMicros(int runs, const std::function<void()>& body){
+    std::vector<double> times;
+    for(int r = 0; r < runs; r++){
+        double start = nowMicros();
+        body();
+        times.push_back(nowMicros() - start);
+    }
+    std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+    return times[times.size() / 2];
+}
+
+static void fail(const std::string& what){
+    std::cerr << "ERROR :: " << what << "\n";
+    std::exit(1);
+}
+
+// the image opens and runs exactly what the compiled source runs
+static void checkRoundTrip(const std::string& source, const std::string& imagePath){
+    std::vector<std::string> errors;
+    CompiledProgram program;
+    if(!compileSource(source, program, errors)) fail("program does not compile");
+    ProgramImage image;
+    std::string err;
+    if(!image.open(imagePath, err)) fail(err);
+    FrameStore compiled(program);
+    FrameStore mapped(image.frameOffsets(), image.totalFrameBytes(), image.busBytes());
+    for(int t = 0; t < 100; t++){
+        runProgram(program, compiled);
+        runImage(image, mapped);
+    }
+    if(compiled.bytes() != mapped.bytes() || std::memcmp(compiled.data(), mapped.data(), compiled.bytes()) != 0){
+        fail("image and source disagree after 100 ticks");
+    }
+}
+
+int main(int argc, char* argv[]){
+    std::vector<int> sizes;
+    int runs = 21;
+    std::string base = "image_bench";
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg == "--runs" && i + 1 < argc) runs = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--path" && i + 1 < argc) base = argv[++i];
+        else sizes.push_back(std::atoi(argv[i]));
+    }
+    if(sizes.empty()) sizes = {16, 256, 4096};
+
+    // a frame that grew by value numbering temporaries survives the round trip
+    {
+        std::string source = makeReuseProgram(60);
+        std::string imagePath = base + ".alc";
+        std::vector<std::string> errors;
+        if(!compileImage(source, imagePath, errors)) fail(errors.empty() ? "image not written" : errors[0]);
+        checkRoundTrip(source, imagePath);
+        std::remove(imagePath.c_str());
+    }
+
+    std::cout << "startup to the first tick, median of " << runs << " runs\n";
+    std::cout << std::left << std::setw(8) << "blocks"
+              << std::setw(12) << "source KB"
+              << std::setw(11) << "image KB"
+              << std::setw(14) << "compile us"
+              << std::setw(12) << "image us"
+              << std::setw(15) << "no check us"
+              << std::setw(16) << "to program us"
+              << "speedup\n";
+
+    for(int blocks : sizes){
+        std::string sourcePath = base + ".alang";
+        std::string imagePath = base + ".alc";
+        std::string source = makeProgram(blocks);
+        {
+            std::ofstream out(sourcePath);
+            out << source;
+        }
+        std::vector<std::string> errors;
+        if(!compileImage(source, imagePath, errors)){
+            for(const auto& err : errors) std::cerr << err << "\n";
+            return 1;
+        }
+
+        // the image runs exactly what the compiled source runs
+        checkRoundTrip(source, imagePath);
+
+        double fromSource = medianMicros(runs, [&]{
+            std::string text;
+            CompiledProgram program;
+            std::vector<std::string> errs;
+            if(!readSourceFile(sourcePath, text) || !compileSource(text, program, errs)) fail("compile failed");
+            FrameStore frames(program);
+            runProgram(program, frames);
+        });
+        auto fromImage = [&](bool verify){
+            return medianMicros(runs, [&]{
+                ProgramImage image;
+                std::string err;
+                if(!image.open(imagePath, err, verify)) fail(err);
+                FrameStore frames(image.frameOffsets(), image.totalFrameBytes(), image.busBytes());
+                runImage(image, frames);
+            });
+        };
+        double mapped = fromImage(true);
+        double unchecked = fromImage(false);
+        double materialized = medianMicros(runs, [&]{
+            ProgramImage image;
+            std::string err;
+            if(!image.open(imagePath, err)) fail(err);
+            CompiledProgram program;
+            image.toProgram(program);
+            FrameStore frames(program);
+            runProgram(program, frames);
+        });
+
+        std::ifstream sized(imagePath, std::ios::binary | std::ios::ate);
+        double imageKB = static_cast<double>(sized.tellg()) / 1024.0;
+        std::cout << std::left << std::fixed << std::setprecision(1)
+                  << std::setw(8) << blocks
+                  << std::setw(12) << source.size() / 1024.0
+                  << std::setw(11) << imageKB
+                  << std::setw(14) << fromSource
+                  << std::setw(12) << mapped
+                  << std::setw(15) << unchecked
+                  << std::setw(16) << materialized
+                  << fromSource / mapped << "x\n"
+                  << std::defaultfloat;
+        std::remove(sourcePath.c_str());
+        std::remove(imagePath.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chainProgram.h"
+#include "../runtime/compiler.h"
+#include "../runtime/interpreter.h"
+#include "../runtime/sharded.h"
+#include "../telemetry/latency.h"
+
+// Cost of per block latency histograms: the same program run with and without
+// recording, reported as ns added per block run. Rounds alternate between the two
+// and the fastest round of each counts, which keeps scheduler noise out of a
+// difference of a few ns.
+
+static std::string makeProgram(int blocks, int work){
+    ChainOptions options;
+    options.blocks = blocks;
+    options.work = work;
+    return makeChainProgram(options);
+}
+
+static double seconds(const std::chrono::steady_clock::time_point& start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]){
+    int blocks = argc > 1 ? std::atoi(argv[1]) : 256;
+    uint64_t ticks = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20000;
+    int rounds = argc > 3 ? std::max(1, std::atoi(argv[3])) : 5;
+    size_t shards = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 2;
+    // a block run longer than this is an overrun
+    uint64_t budgetNanos = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 1000;
+
+    std::cout << "latency histograms: " << blocks << " blocks, " << ticks << " ticks x " << rounds
+              << " rounds, " << std::thread::hardware_concurrency() << " hardware threads\n";
+    std::cout << "clock: " << std::setprecision(4) << telemetryNanosPerTick() << " ns per tick\n"
+              << std::defaultfloat;
+
+    // the two parts of the overhead: reading the clock (once per block run) and updating the histogram
+    {
+        const uint64_t reads = 10000000;
+        uint64_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(uint64_t i = 0; i < reads; i++) sink += telemetryClock();
+        double clockNanos = seconds(start) * 1e9 / reads;
+
+        CompiledProgram program;
+        std::vector<std::string> errors;
+        compileSource(makeProgram(blocks, 1), program, errors);
+        LatencyRecorder recorder(program);
+        recorder.setBudget(budgetNanos);
+        LatencyTable* table = recorder.addTable();
+        start = std::chrono::steady_clock::now();
+        for(uint64_t i = 0; i < reads; i++) table->record(i % blocks, 100 + (sink + i * 37) % 200);
+        double recordNanos = seconds(start) * 1e9 / reads;
+        std::cout << std::fixed << std::setprecision(1) << "clock read: " << clockNanos << " ns, histogram update: "
+                  << recordNanos << " ns\n\n" << std::defaultfloat;
+    }
+    std::cout << std::left << std::setw(14) << "runtime"
+              << std::setw(7) << "work"
+              << std::setw(14) << "ns/block off"
+              << std::setw(13) << "ns/block on"
+              << std::setw(13) << "overhead ns"
+              << std::setw(10) << "p50 ns"
+              << std::setw(10) << "p99 ns"
+              << std::setw(10) << "p99.9 ns"
+              << std::setw(10) << "max ns"
+              << "overruns\n";
+
+    int failed = 0;
+    for(int work : {1, 8}){
+        CompiledProgram program;
+        std::vector<std::string> errors;
+        if(!compileSource(makeProgram(blocks, work), program, errors)){
+            for(const auto& err : errors) std::cerr << err << "\n";
+            return 1;
+        }
+
+        // 0 is runProgram on the calling thread
+        std::vector<size_t> runtimes = {0};
+        if(shards > 1) runtimes.push_back(shards);
+        for(size_t threads : runtimes){
+            FrameStore frames(program);
+            LatencyRecorder recorder(program);
+            recorder.setBudget(budgetNanos);
+            LatencyTable* table = recorder.addTable();
+            ShardedRuntime plain(program, frames, std::max<size_t>(threads, 1));
+            ShardedRuntime timed(program, frames, std::max<size_t>(threads, 1));
+            timed.setLatency(&recorder);
+
+            double off = 1e30, on = 1e30;
+            for(int r = 0; r < rounds; r++){
+                auto start = std::chrono::steady_clock::now();
+                if(threads == 0) for(uint64_t t = 0; t < ticks; t++) runProgram(program, frames);
+                else plain.run(ticks);
+                off = std::min(off, seconds(start));
+
+                start = std::chrono::steady_clock::now();
+                if(threads == 0) for(uint64_t t = 0; t < ticks; t++) runProgram(program, frames, *table);
+                else timed.run(ticks);
+                on = std::min(on, seconds(start));
+            }
+
+            // every run of every block is in the histograms, and the worst block is shown
+            uint64_t runs = 0, overruns = 0;
+            LatencyStats worst;
+            for(size_t b = 0; b < program.blocks.size(); b++){
+                LatencyStats s = recorder.stats(b);
+                runs += s.count;
+                overruns += s.overruns;
+                if(s.p999 >= worst.p999) worst = s;
+            }
+            double perBlock = 1e9 / (static_cast<double>(ticks) * blocks);
+            std::string name = threads == 0 ? "runProgram" : std::to_string(threads) + " shards";
+            std::cout << std::left << std::fixed << std::setprecision(1)
+                      << std::setw(14) << name
+                      << std::setw(7) << work
+                      << std::setw(14) << off * perBlock
+                      << std::setw(13) << on * perBlock
+                      << std::setw(13) << (on - off) * perBlock
+                      << std::setprecision(0)
+                      << std::setw(10) << worst.p50
+                      << std::setw(10) << worst.p99
+                      << std::setw(10) << worst.p999
+                      << std::setw(10) << worst.max
+                      << overruns << " over " << budgetNanos << " ns" << std::defaultfloat;
+            if(runs != ticks * rounds * program.blocks.size()){
+                std::cout << "  " << runs << " RUNS RECORDED, EXPECTED " << ticks * rounds * program.blocks.size();
+                failed = 1;
+            }
+            std::cout << "\n";
+        }
+    }
+    return failed;
+}
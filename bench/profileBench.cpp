@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../profile/branchProfile.h"
+#include "../replay/trace.h"
+#include "../runtime/compiler.h"
+#include "../runtime/interpreter.h"
+
+// Profile guided layout on a replayed sensor trace. Every block checks its sensors
+// against limits that are almost never reached and handles the fault in a long if
+// body, between checks that pass almost every tick. The program is profiled on one
+// trace, compiled again with the cold bodies out of line, checked to leave the same
+// frames tick by tick, and both layouts replay a second trace of the same sensors.
+
+static std::string makeProgram(int blocks, int sensors, int checks, int bodyLength){
+    std::ostringstream src;
+    for(int b = 0; b < blocks; b++){
+        std::string level = "level" + std::to_string(b), out = "out" + std::to_string(b);
+        std::string faults = "faults" + std::to_string(b), alarm = "alarm" + std::to_string(b);
+        std::string a = "s" + std::to_string(b % sensors), c = "s" + std::to_string((b * 7 + 3) % sensors);
+        src << "control block" << b << " {\n"
+            << "    float " << a << ";\n";
+        if(c != a) src << "    float " << c << ";\n";
+        src << "    float " << level << ";\n"
+            << "    float " << out << ";\n"
+            << "    int " << faults << ";\n"
+            << "    bool " << alarm << ";\n"
+            << "    set " << alarm << " false;\n";
+        for(int k = 0; k < checks; k++){
+            // hot: the sensor is above 1 in 99% of the samples
+            src << "    set " << level << " " << a << " - " << c << " + " << k << ".5;\n"
+                << "    if (" << (k % 2 ? c : a) << " > 1.0) {\n"
+                << "        set " << out << " (" << out << " + 0.5) - 0.25;\n"
+                << "    }\n"
+                // cold: the difference of two sensors past its limit, well under 1% of the samples
+                << "    if (" << level << " > 9" << 6 + k % 3 << ".0) {\n"
+                << "        set " << faults << " " << faults << " + 1;\n"
+                << "        set " << alarm << " true;\n"
+                << "        float excess;\n"
+                << "        set excess " << level << " - 90.0;\n";
+            for(int s = 0; s < bodyLength; s++){
+                src << "        set " << out << " (" << out << " - excess) + " << s % 5 << ".125;\n";
+            }
+            src << "        if (" << faults << " > 1000) {\n"
+                << "            set " << faults << " 0;\n"
+                << "        }\n"
+                << "    }\n";
+        }
+        src << "    set " << out << " " << out << " - " << level << ";\n"
+            << "}\n";
+    }
+    return src.str();
+}
+
+static bool writeTrace(const std::string& path, int sensors, size_t samples, uint64_t seed, std::string& err){
+    std::vector<TraceColumn> columns;
+    for(int s = 0; s < sensors; s++) columns.push_back(TraceColumn{"s" + std::to_string(s), TypeTag::TYPE_FLOAT});
+    TraceWriter writer;
+    if(!writer.open(path, columns, err)) return false;
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<float> value(0.0f, 100.0f);
+    std::vector<uint32_t> row(sensors);
+    for(size_t i = 0; i < samples; i++){
+        for(auto& v : row) v = floatBits(value(rng));
+        writer.append(row.data());
+    }
+    if(!writer.close()){
+        err = "failed writing " + path;
+        return false;
+    }
+    return true;
+}
+
+// the bus cell (or the frame slot) every trace column feeds
+static std::vector<uint8_t*> bindColumns(const CompiledProgram& program, FrameStore& frames, const Trace& trace){
+    std::vector<uint8_t*> dest(trace.columns.size(), nullptr);
+    for(size_t col = 0; col < trace.columns.size(); col++){
+        for(size_t b = 0; b < program.blocks.size() && !dest[col]; b++){
+            int slot = program.findTopLevelSlot(b, trace.columns[col].name);
+            if(slot >= 0) dest[col] = frames.slotData(b, slot);
+        }
+    }
+    return dest;
+}
+
+static void feed(const std::vector<uint8_t*>& dest, const uint32_t* row){
+    for(size_t col = 0; col < dest.size(); col++){
+        if(dest[col]) std::memcpy(dest[col], &row[col], sizeof(uint32_t));
+    }
+}
+
+// one replay of the whole trace, counting every if when a profiler is given
+static double replaySeconds(const CompiledProgram& program, const Trace& trace, BranchProfiler* profiler = nullptr){
+    FrameStore frames(program);
+    std::vector<uint8_t*> dest = bindColumns(program, frames, trace);
+    auto start = std::chrono::steady_clock::now();
+    for(size_t s = 0; s < trace.samples(); s++){
+        feed(dest, trace.row(s));
+        if(profiler) runProgram(program, frames, *profiler);
+        else runProgram(program, frames);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// instructions up to the first END, the code every tick may run
+static size_t hotInstructions(const CompiledProgram& program){
+    size_t hot = 0;
+    for(const auto& block : program.blocks){
+        for(const auto& instr : block.code){
+            hot++;
+            if(instr.op == OpCode::END) break;
+        }
+    }
+    return hot;
+}
+
+static size_t instructions(const CompiledProgram& program){
+    size_t total = 0;
+    for(const auto& block : program.blocks) total += block.code.size();
+    return total;
+}
+
+static void fail(const std::string& what){
+    std::cerr << "ERROR :: " << what << "\n";
+    std::exit(1);
+}
+
+int main(int argc, char* argv[]){
+    int blocks = argc > 1 ? std::atoi(argv[1]) : 1000;
+    int checks = argc > 2 ? std::atoi(argv[2]) : 4;
+    int bodyLength = argc > 3 ? std::atoi(argv[3]) : 8;
+    size_t samples = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 5000;
+    int rounds = argc > 5 ? std::max(1, std::atoi(argv[5])) : 5;
+    int sensors = 64;
+    if(blocks <= 0 || checks <= 0 || bodyLength < 0 || samples == 0){
+        std::cerr << "usage: autolangprofilebench [blocks] [checks] [bodyLength] [samples] [rounds]\n";
+        return 1;
+    }
+
+    std::string source = makeProgram(blocks, sensors, checks, bodyLength);
+    std::string err;
+    if(!writeTrace("profile_bench_train.altr", sensors, samples, 1, err)
+       || !writeTrace("profile_bench_test.altr", sensors, samples, 2, err)) fail(err);
+    Trace train, test;
+    if(!train.load("profile_bench_train.altr", err) || !test.load("profile_bench_test.altr", err)) fail(err);
+
+    std::vector<std::string> errors;
+    CompiledProgram plain;
+    if(!compileSource(source, plain, errors)) fail(errors.empty() ? "compile failed" : errors[0]);
+
+    // profile on the training trace
+    BranchProfiler profiler(plain);
+    replaySeconds(plain, train, &profiler);
+    std::ostringstream file;
+    profiler.write(file);
+    auto profile = std::make_shared<BranchProfile>();
+    if(!profile->parse(file.str(), err)) fail(err);
+
+    CompiledProgram laid;
+    Compiler::setDefaultBranchProfile(profile);
+    if(!compileSource(source, laid, errors)) fail(errors.empty() ? "compile failed" : errors[0]);
+    Compiler::setDefaultBranchProfile(nullptr);
+    size_t coldBodies = 0, ifs = 0;
+    for(const auto& block : laid.blocks){
+        coldBodies += block.coldBodies;
+        ifs += block.ifs.size();
+    }
+
+    // the layout changes where code is, never what it does
+    {
+        FrameStore a(plain), b(laid);
+        std::vector<uint8_t*> da = bindColumns(plain, a, test), db = bindColumns(laid, b, test);
+        for(size_t s = 0; s < test.samples(); s++){
+            feed(da, test.row(s));
+            feed(db, test.row(s));
+            runProgram(plain, a);
+            runProgram(laid, b);
+            if(a.bytes() != b.bytes() || std::memcmp(a.data(), b.data(), a.bytes()) != 0){
+                fail("frames differ after sample " + std::to_string(s));
+            }
+        }
+    }
+
+    // rounds alternate between the layouts (and the profiled run), the fastest round of each counts
+    double plainBest = 1e30, laidBest = 1e30, profiled = 1e30;
+    for(int r = 0; r < rounds; r++){
+        plainBest = std::min(plainBest, replaySeconds(plain, test));
+        laidBest = std::min(laidBest, replaySeconds(laid, test));
+        BranchProfiler scratch(plain);
+        profiled = std::min(profiled, replaySeconds(plain, test, &scratch));
+    }
+
+    std::cout << blocks << " blocks, " << ifs << " ifs, " << coldBodies << " cold bodies moved out of line, "
+              << samples << " samples, best of " << rounds << "\n";
+    std::cout << "code per tick: " << instructions(plain) * sizeof(Instr) / 1024 << " KB in source order, "
+              << hotInstructions(laid) * sizeof(Instr) / 1024 << " KB hot after layout (of "
+              << instructions(laid) * sizeof(Instr) / 1024 << " KB)\n";
+    std::cout << std::fixed << std::setprecision(0)
+              << "profiling run  " << test.samples() / profiled << " samples/sec ("
+              << std::setprecision(1) << 100.0 * (profiled / plainBest - 1) << "% more time than source order)\n"
+              << std::setprecision(0)
+              << "source order   " << test.samples() / plainBest << " samples/sec\n"
+              << "profile layout " << test.samples() / laidBest << " samples/sec\n"
+              << std::setprecision(3) << "speedup        " << plainBest / laidBest << "x\n";
+    return 0;
+}
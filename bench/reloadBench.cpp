@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../runtime/hotReload.h"
+
+// Hot reload while the control loop keeps running.
+// An editor thread rewrites the source file every few ms (block k % blocks gets a new
+// constant), the reloader notices, compiles and publishes it, the loop swaps it in.
+// Every block counts its ticks in a private variable, which has to survive every swap.
+
+static std::string makeProgram(int blocks, int edit){
+    std::ostringstream src;
+    for(int i = 0; i < blocks; i++){
+        // the edited block also gains a variable, which starts from zero
+        int gain = i == edit % blocks ? edit : 1;
+        src << "control b" << i << " {\n"
+            << "    int n" << i << ";\n"
+            << "    int out" << i << ";\n";
+        if(i == edit % blocks) src << "    int added" << edit << ";\n";
+        src << "    set n" << i << " (n" << i << " + 1);\n"
+            << "    set out" << i << " n" << i << " + " << gain << ";\n"
+            << "    if (out" << i << " > 1000) {\n"
+            << "        set out" << i << " (out" << i << " - 1000);\n"
+            << "    }\n"
+            << "}\n";
+    }
+    return src.str();
+}
+
+static uint64_t nowNanos(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t percentile(std::vector<uint64_t> v, double p){
+    if(v.empty()) return 0;
+    size_t k = std::min(v.size() - 1, static_cast<size_t>(p * (v.size() - 1)));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+static bool writeFile(const std::string& path, const std::string& text){
+    // write a new file and rename it over the old one, the reloader never sees half a program
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp);
+        if(!(out << text)) return false;
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+int main(int argc, char* argv[]){
+    int blocks = argc > 1 ? std::atoi(argv[1]) : 256;
+    int reloads = argc > 2 ? std::atoi(argv[2]) : 20;
+    unsigned pollMillis = argc > 3 ? std::atoi(argv[3]) : 5;
+    std::string path = argc > 4 ? argv[4] : "reload_bench.alang";
+
+    if(!writeFile(path, makeProgram(blocks, 0))){
+        std::cerr << "ERROR :: cannot write " << path << "\n";
+        return 1;
+    }
+    HotReloader reloader(path);
+    std::vector<std::string> errors;
+    if(!reloader.load(errors)){
+        for(const auto& err : errors) std::cerr << err << "\n";
+        return 1;
+    }
+    reloader.start(pollMillis);
+
+    // edits written faster than they are reloaded are merged into one version,
+    // then the version numbers no longer match the edits and the last one ends the run
+    std::vector<uint64_t> writtenAt(reloads + 1, 0);
+    std::atomic<uint64_t> editsDone{0};
+    std::thread editor([&]{
+        for(int k = 1; k <= reloads; k++){
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            writtenAt[k] = nowNanos();
+            writeFile(path, makeProgram(blocks, k));
+        }
+        editsDone.store(nowNanos());
+    });
+
+    std::cout << "hot reload: " << blocks << " blocks, " << reloads << " reloads, poll " << pollMillis << " ms, "
+              << std::thread::hardware_concurrency() << " hardware threads\n";
+    std::cout << std::left << std::setw(9) << "version"
+              << std::setw(12) << "notice us"
+              << std::setw(13) << "compile us"
+              << std::setw(13) << "to tick us"
+              << std::setw(13) << "total us"
+              << std::setw(10) << "swap ns"
+              << std::setw(9) << "carried"
+              << "state\n";
+
+    std::vector<uint64_t> tickNanos, swapTickNanos;
+    tickNanos.reserve(1 << 20);
+    uint64_t lastVersion = 0;
+    int32_t lastCount = 0;
+    bool stateKept = true;
+
+    ProgramVersion* current = nullptr;
+    while(true){
+        uint64_t start = nowNanos();
+        current = reloader.tickBoundary();
+        runProgram(current->program, *current->frames);
+        uint64_t took = nowNanos() - start;
+
+        // n0 counts ticks: after a swap it continues where the old version left off
+        const uint8_t* counter = current->frames->slotData(0, current->program.findTopLevelSlot(0, "n0"));
+        int32_t count;
+        std::memcpy(&count, counter, sizeof(count));
+
+        if(current->version != lastVersion){
+            if(lastVersion != 0){
+                swapTickNanos.push_back(took);
+                uint64_t k = current->version - 1;
+                bool kept = count == lastCount + 1;
+                stateKept = stateKept && kept;
+                uint64_t written = k < writtenAt.size() ? writtenAt[k] : current->requestedAt;
+                std::cout << std::left << std::setw(9) << current->version
+                          << std::setw(12) << (current->requestedAt - written) / 1000
+                          << std::setw(13) << (current->publishedAt - current->requestedAt) / 1000
+                          << std::setw(13) << (current->activeAt - current->publishedAt) / 1000
+                          << std::setw(13) << (current->activeAt - written) / 1000
+                          << std::setw(10) << current->swapNanos
+                          << std::setw(9) << current->carriedSlots
+                          << (kept ? "kept" : "LOST") << "\n";
+            }
+            lastVersion = current->version;
+        }
+        else if(tickNanos.size() < tickNanos.capacity()){
+            tickNanos.push_back(took);
+        }
+        lastCount = count;
+
+        uint64_t done = editsDone.load();
+        if(current->version > static_cast<uint64_t>(reloads) || (done && nowNanos() > done + 2000000000ull)) break;
+    }
+    editor.join();
+    reloader.stop();
+    std::remove(path.c_str());
+
+    std::cout << "ticks without swap: p50 " << percentile(tickNanos, 0.5) << " ns, p99 " << percentile(tickNanos, 0.99)
+              << " ns, max " << (tickNanos.empty() ? 0 : *std::max_element(tickNanos.begin(), tickNanos.end())) << " ns\n";
+    std::cout << "ticks with a swap:  p50 " << percentile(swapTickNanos, 0.5) << " ns, p99 " << percentile(swapTickNanos, 0.99)
+              << " ns, max " << (swapTickNanos.empty() ? 0 : *std::max_element(swapTickNanos.begin(), swapTickNanos.end())) << " ns\n";
+    if(reloader.rejectedCount()) std::cout << reloader.rejectedCount() << " versions rejected\n";
+    if(lastVersion <= static_cast<uint64_t>(reloads)){
+        std::cout << "edits were merged into " << lastVersion - 1 << " versions, compiling takes longer than the 20 ms between edits"
+                  << " (notice and total times are off for the merged ones)\n";
+    }
+    return stateKept ? 0 : 1;
+}
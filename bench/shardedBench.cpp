@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chainProgram.h"
+#include "../runtime/compiler.h"
+#include "../runtime/interpreter.h"
+#include "../runtime/sharded.h"
+
+// Per tick latency and throughput of the sharded runtime from 1 to N cores.
+// The program is a chain of blocks, block i consumes the signal of block i-1,
+// so most shards both produce and consume cross shard signals.
+
+// every block also counts its runs in a private int
+static std::string makeProgram(int blocks, int work){
+    ChainOptions options;
+    options.blocks = blocks;
+    options.work = work;
+    options.counter = true;
+    return makeChainProgram(options);
+}
+
+static uint32_t percentile(std::vector<uint32_t>& v, double p){
+    if(v.empty()) return 0;
+    size_t k = std::min(v.size() - 1, static_cast<size_t>(p * (v.size() - 1)));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+int main(int argc, char* argv[]){
+    int blocks = argc > 1 ? std::atoi(argv[1]) : 256;
+    int work = argc > 2 ? std::atoi(argv[2]) : 8;
+    uint64_t ticks = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 20000;
+    int maxCores = argc > 4 ? std::atoi(argv[4]) : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    CompiledProgram program;
+    std::vector<std::string> errors;
+    if(!compileSource(makeProgram(blocks, work), program, errors)){
+        for(const auto& err : errors) std::cerr << err << "\n";
+        return 1;
+    }
+
+    std::cout << "sharded runtime: " << blocks << " blocks, " << ticks << " ticks, "
+              << std::thread::hardware_concurrency() << " hardware threads\n";
+    std::cout << std::left << std::setw(8) << "cores"
+              << std::setw(10) << "channels"
+              << std::setw(16) << "ticks/sec"
+              << std::setw(16) << "blocks/sec"
+              << std::setw(12) << "p50 ns"
+              << std::setw(12) << "p99 ns"
+              << std::setw(12) << "max ns"
+              << "speedup\n";
+
+    double baseline = 0.0;
+    for(int cores = 1; cores <= maxCores; cores++){
+        FrameStore frames(program);
+        ShardedRuntime runtime(program, frames, cores);
+
+        auto start = std::chrono::steady_clock::now();
+        runtime.run(ticks);
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+
+        // a tick is done when its slowest shard is done
+        std::vector<uint32_t> latency(ticks, 0);
+        for(size_t s = 0; s < runtime.plan().shards.size(); s++){
+            const auto& nanos = runtime.tickLatencies(s);
+            for(uint64_t t = 0; t < ticks; t++) latency[t] = std::max(latency[t], nanos[t]);
+        }
+        uint32_t maxNs = *std::max_element(latency.begin(), latency.end());
+        uint32_t p50 = percentile(latency, 0.50);
+        uint32_t p99 = percentile(latency, 0.99);
+
+        double tps = ticks / seconds;
+        if(cores == 1) baseline = tps;
+        std::cout << std::left << std::setw(8) << cores
+                  << std::setw(10) << runtime.channelCount()
+                  << std::setw(16) << static_cast<uint64_t>(tps)
+                  << std::setw(16) << static_cast<uint64_t>(tps * blocks)
+                  << std::setw(12) << p50
+                  << std::setw(12) << p99
+                  << std::setw(12) << maxNs
+                  << std::fixed << std::setprecision(2) << tps / baseline << "x\n"
+                  << std::defaultfloat;
+    }
+    return 0;
+}
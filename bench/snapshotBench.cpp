@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../runtime/compiler.h"
+#include "../runtime/interpreter.h"
+#include "../runtime/snapshot.h"
+
+// Snapshot and restore cost of the whole program state for thousands of blocks.
+// Between two snapshots either every block runs (every frame changed, the worst case
+// for deltas) or 1% of them do (a rollout that only touches part of the program).
+// Every restore is compared against a copy of the state taken at capture time.
+
+static std::string makeProgram(int blocks){
+    std::ostringstream src;
+    for(int i = 0; i < blocks; i++){
+        src << "control b" << i << " {\n"
+            << "    float s" << i << ";\n";
+        if(i > 0) src << "    float s" << i - 1 << ";\n";
+        src << "    int n" << i << ";\n"
+            << "    float out" << i << ";\n"
+            << "    set n" << i << " (n" << i << " + 1);\n"
+            << "    set out" << i << " (out" << i << " + " << (i > 0 ? "s" + std::to_string(i - 1) : "0.5") << ");\n"
+            << "    if (out" << i << " > 1000.0) {\n"
+            << "        set out" << i << " (out" << i << " - 1000.0);\n"
+            << "    }\n"
+            << "    set s" << i << " out" << i << ";\n"
+            << "}\n";
+    }
+    return src.str();
+}
+
+static uint64_t nowNanos(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double percentileMicros(std::vector<uint64_t> v, double p){
+    if(v.empty()) return 0;
+    size_t k = std::min(v.size() - 1, static_cast<size_t>(p * (v.size() - 1)));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k] / 1000.0;
+}
+
+struct CaseResult{
+    std::vector<uint64_t> capture;
+    std::vector<uint64_t> restore;
+    double payloadBytes = 0;
+    size_t mismatches = 0;
+    // versions in the ring whose full snapshot was already overwritten
+    size_t unrestorable = 0;
+};
+
+static CaseResult runCase(const CompiledProgram& program, bool delta, bool sparse, const std::string& path,
+                          int snapshots, size_t slots){
+    FrameStore frames(program);
+    SnapshotStore store(program, slots);
+    std::string err;
+    if(!path.empty() && !store.open(path, err)){
+        std::cerr << "ERROR :: " << err << "\n";
+        std::exit(1);
+    }
+    store.setDelta(delta);
+
+    size_t blocks = program.blocks.size();
+    size_t step = std::max<size_t>(1, blocks / 100);
+    size_t cursor = 0;
+    auto advance = [&]{
+        if(!sparse){
+            runProgram(program, frames);
+            return;
+        }
+        for(size_t k = 0; k < step; k++){
+            size_t b = cursor++ % blocks;
+            uint8_t* frame = frames.frame(b);
+            importSignals(program.blocks[b], frame, frames.bus());
+            runBlock(program.blocks[b], frame);
+            exportSignals(program.blocks[b], frame, frames.bus());
+        }
+    };
+
+    CaseResult result;
+    // the versions that are still in the ring at the end are restored and compared
+    std::vector<std::vector<uint8_t>> expected(slots);
+    for(int i = 0; i < snapshots; i++){
+        advance();
+        uint64_t start = nowNanos();
+        uint64_t version = store.capture(frames);
+        result.capture.push_back(nowNanos() - start);
+        result.payloadBytes += store.info(version)->payloadBytes;
+        expected[(version - 1) % slots].assign(frames.data(), frames.data() + frames.bytes());
+    }
+    result.payloadBytes /= snapshots;
+
+    FrameStore check(program);
+    for(uint64_t v = store.oldest(); v != 0 && v <= store.latest(); v++){
+        uint64_t start = nowNanos();
+        bool ok = store.restore(v, check, err);
+        uint64_t took = nowNanos() - start;
+        if(!ok){
+            if(err.find("overwritten") == std::string::npos) result.mismatches++;
+            else result.unrestorable++;
+            continue;
+        }
+        result.restore.push_back(took);
+        const auto& want = expected[(v - 1) % slots];
+        if(std::memcmp(check.data(), want.data(), want.size()) != 0) result.mismatches++;
+    }
+    if(!path.empty()) std::remove(path.c_str());
+    return result;
+}
+
+int main(int argc, char* argv[]){
+    std::vector<int> sizes;
+    int snapshots = 200;
+    size_t slots = 32;
+    std::string path = "snapshot_bench.alsn";
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg == "--snapshots" && i + 1 < argc) snapshots = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--slots" && i + 1 < argc) slots = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--file" && i + 1 < argc) path = argv[++i];
+        else sizes.push_back(std::atoi(argv[i]));
+    }
+    if(sizes.empty()) sizes = {1024, 4096, 16384};
+
+    std::cout << "snapshots: " << snapshots << " per case, " << slots << " slots, full snapshot every 16\n";
+    std::cout << std::left << std::setw(8) << "blocks"
+              << std::setw(10) << "state KB"
+              << std::setw(8) << "mode"
+              << std::setw(9) << "changes"
+              << std::setw(8) << "store"
+              << std::setw(12) << "capture us"
+              << std::setw(10) << "p99 us"
+              << std::setw(12) << "payload KB"
+              << std::setw(12) << "restore us"
+              << std::setw(10) << "p99 us"
+              << std::setw(13) << "snapshots/s"
+              << "restorable\n";
+
+    int failed = 0;
+    for(int blocks : sizes){
+        CompiledProgram program;
+        std::vector<std::string> errors;
+        if(!compileSource(makeProgram(blocks), program, errors)){
+            for(const auto& e : errors) std::cerr << e << "\n";
+            return 1;
+        }
+        FrameStore sizing(program);
+        for(bool delta : {false, true}){
+            for(bool sparse : {false, true}){
+                for(bool file : {false, true}){
+                    CaseResult r = runCase(program, delta, sparse, file ? path : "", snapshots, slots);
+                    double capture = percentileMicros(r.capture, 0.5);
+                    std::cout << std::left << std::fixed << std::setprecision(1)
+                              << std::setw(8) << blocks
+                              << std::setw(10) << sizing.bytes() / 1024.0
+                              << std::setw(8) << (delta ? "delta" : "full")
+                              << std::setw(9) << (sparse ? "1%" : "all")
+                              << std::setw(8) << (file ? "file" : "memory")
+                              << std::setw(12) << capture
+                              << std::setw(10) << percentileMicros(r.capture, 0.99)
+                              << std::setw(12) << r.payloadBytes / 1024.0
+                              << std::setw(12) << percentileMicros(r.restore, 0.5)
+                              << std::setw(10) << percentileMicros(r.restore, 0.99)
+                              << std::setprecision(0) << std::setw(13) << 1e6 / capture
+                              << std::defaultfloat << r.restore.size() << "/" << r.restore.size() + r.unrestorable;
+                    if(r.mismatches){
+                        std::cout << "  " << r.mismatches << " RESTORES WRONG";
+                        failed = 1;
+                    }
+                    std::cout << "\n";
+                }
+            }
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../replay/trace.h"
+#include "../runtime/compiler.h"
+#include "../runtime/interpreter.h"
+
+// Decision tables on a replayed sensor trace. Every block looks its outputs up in
+// calibration trees: a chain of nested ifs over one sensor (the gear/speed nesting of
+// examples/complexExamle.alang, without the arithmetic), an if on the drive mode inside
+// it, and a second tree over another sensor and the mode. The program is compiled as
+// ifs and with --decision-tables, checked to leave the same frames tick by tick, and
+// both replay the trace.
+
+static std::string makeProgram(int blocks, int sensors, int depth){
+    std::ostringstream src;
+    for(int b = 0; b < blocks; b++){
+        std::string a = "s" + std::to_string(b % sensors), c = "s" + std::to_string((b * 7 + 3) % sensors);
+        std::string gear = "gear" + std::to_string(b), gain = "gain" + std::to_string(b);
+        std::string limit = "limit" + std::to_string(b), out = "out" + std::to_string(b);
+        src << "control block" << b << " {\n"
+            << "    float " << a << ";\n";
+        if(c != a) src << "    float " << c << ";\n";
+        src << "    int mode;\n"
+            << "    int " << gear << ";\n"
+            << "    float " << gain << ";\n"
+            << "    bool " << limit << ";\n"
+            << "    float " << out << ";\n"
+            << "    set " << gear << " 0;\n"
+            << "    set " << gain << " 0.25;\n"
+            << "    set " << limit << " false;\n";
+        // thresholds spread over the 0 .. 100 the sensors take
+        std::string indent = "    ";
+        for(int d = 0; d < depth; d++){
+            src << indent << "if (" << a << " > " << (d + 1) * 90 / depth << ".5) {\n"
+                << indent << "    set " << gear << " " << d + 1 << ";\n"
+                << indent << "    set " << gain << " " << d + 1 << ".25;\n";
+            if(d == depth / 2){
+                src << indent << "    if (mode == 2) {\n"
+                    << indent << "        set " << limit << " true;\n"
+                    << indent << "    }\n";
+            }
+            indent += "    ";
+        }
+        for(int d = depth; d > 0; d--){
+            indent.resize(indent.size() - 4);
+            src << indent << "}\n";
+        }
+        src << "    if (" << c << " > 50.0) {\n"
+            << "        set " << limit << " false;\n"
+            << "        if (mode > 3) {\n"
+            << "            set " << gain << " 0.5;\n"
+            << "        }\n"
+            << "    }\n"
+            << "    set " << out << " " << c << " - " << gain << ";\n"
+            << "}\n";
+    }
+    return src.str();
+}
+
+static bool writeTrace(const std::string& path, int sensors, size_t samples, uint64_t seed, std::string& err){
+    std::vector<TraceColumn> columns;
+    for(int s = 0; s < sensors; s++) columns.push_back(TraceColumn{"s" + std::to_string(s), TypeTag::TYPE_FLOAT});
+    columns.push_back(TraceColumn{"mode", TypeTag::TYPE_INT});
+    TraceWriter writer;
+    if(!writer.open(path, columns, err)) return false;
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<float> value(0.0f, 100.0f);
+    std::vector<uint32_t> row(sensors + 1);
+    for(size_t i = 0; i < samples; i++){
+        for(int s = 0; s < sensors; s++) row[s] = floatBits(value(rng));
+        row[sensors] = static_cast<uint32_t>(rng() % 6);
+        writer.append(row.data());
+    }
+    if(!writer.close()){
+        err = "failed writing " + path;
+        return false;
+    }
+    return true;
+}
+
+// the bus cell (or the frame slot) every trace column feeds
+static std::vector<uint8_t*> bindColumns(const CompiledProgram& program, FrameStore& frames, const Trace& trace){
+    std::vector<uint8_t*> dest(trace.columns.size(), nullptr);
+    for(size_t col = 0; col < trace.columns.size(); col++){
+        for(size_t b = 0; b < program.blocks.size() && !dest[col]; b++){
+            int slot = program.findTopLevelSlot(b, trace.columns[col].name);
+            if(slot >= 0) dest[col] = frames.slotData(b, slot);
+        }
+    }
+    return dest;
+}
+
+static void feed(const std::vector<uint8_t*>& dest, const uint32_t* row){
+    for(size_t col = 0; col < dest.size(); col++){
+        if(dest[col]) std::memcpy(dest[col], &row[col], sizeof(uint32_t));
+    }
+}
+
+static double replaySeconds(const CompiledProgram& program, const Trace& trace){
+    FrameStore frames(program);
+    std::vector<uint8_t*> dest = bindColumns(program, frames, trace);
+    auto start = std::chrono::steady_clock::now();
+    for(size_t s = 0; s < trace.samples(); s++){
+        feed(dest, trace.row(s));
+        runProgram(program, frames);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static size_t instructions(const CompiledProgram& program){
+    size_t total = 0;
+    for(const auto& block : program.blocks) total += block.code.size();
+    return total;
+}
+
+static void fail(const std::string& what){
+    std::cerr << "ERROR :: " << what << "\n";
+    std::exit(1);
+}
+
+int main(int argc, char* argv[]){
+    int blocks = argc > 1 ? std::atoi(argv[1]) : 64;
+    int depth = argc > 2 ? std::atoi(argv[2]) : 6;
+    size_t samples = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 20000;
+    int rounds = argc > 4 ? std::max(1, std::atoi(argv[4])) : 5;
+    int sensors = 16;
+    if(blocks <= 0 || depth <= 1 || depth > 15 || samples == 0){
+        std::cerr << "usage: autolangtablebench [blocks] [depth 2..15] [samples] [rounds]\n";
+        return 1;
+    }
+
+    std::string source = makeProgram(blocks, sensors, depth);
+    std::string err;
+    if(!writeTrace("table_bench.altr", sensors, samples, 3, err)) fail(err);
+    Trace trace;
+    if(!trace.load("table_bench.altr", err)) fail(err);
+
+    std::vector<std::string> errors;
+    CompiledProgram plain, tabled;
+    if(!compileSource(source, plain, errors)) fail(errors.empty() ? "compile failed" : errors[0]);
+    Compiler::setDefaultDecisionTables(true);
+    auto compileStart = std::chrono::steady_clock::now();
+    if(!compileSource(source, tabled, errors)) fail(errors.empty() ? "compile failed" : errors[0]);
+    double compileSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - compileStart).count();
+    Compiler::setDefaultDecisionTables(false);
+    size_t tables = 0, tableIfs = 0, ifs = 0;
+    for(const auto& block : tabled.blocks){
+        tables += block.decisionTables;
+        tableIfs += block.tableIfs;
+        ifs += block.ifs.size();
+    }
+    if(tables == 0) fail("no if tree became a decision table");
+
+    // the tables replace what the ifs compute, never change it
+    {
+        FrameStore a(plain), b(tabled);
+        std::vector<uint8_t*> da = bindColumns(plain, a, trace), db = bindColumns(tabled, b, trace);
+        for(size_t s = 0; s < trace.samples(); s++){
+            feed(da, trace.row(s));
+            feed(db, trace.row(s));
+            runProgram(plain, a);
+            runProgram(tabled, b);
+            if(a.bytes() != b.bytes() || std::memcmp(a.data(), b.data(), a.bytes()) != 0){
+                fail("frames differ after sample " + std::to_string(s));
+            }
+        }
+    }
+
+    // rounds alternate between the two, the fastest round of each counts
+    double plainBest = 1e30, tabledBest = 1e30;
+    for(int r = 0; r < rounds; r++){
+        plainBest = std::min(plainBest, replaySeconds(plain, trace));
+        tabledBest = std::min(tabledBest, replaySeconds(tabled, trace));
+    }
+
+    std::cout << blocks << " blocks, " << ifs << " ifs, " << tables << " decision tables replace " << tableIfs << " of them, "
+              << samples << " samples, best of " << rounds << "\n";
+    std::cout << "instructions: " << instructions(plain) << " as ifs, " << instructions(tabled)
+              << " with tables (table data included), compiled and checked in "
+              << std::fixed << std::setprecision(1) << compileSeconds * 1000 << " ms\n";
+    std::cout << std::setprecision(0)
+              << "ifs             " << trace.samples() / plainBest << " samples/sec\n"
+              << "decision tables " << trace.samples() / tabledBest << " samples/sec\n"
+              << std::setprecision(3) << "speedup         " << plainBest / tabledBest << "x\n";
+    return 0;
+}
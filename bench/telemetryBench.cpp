@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chainProgram.h"
+#include "../runtime/compiler.h"
+#include "../runtime/interpreter.h"
+#include "../runtime/sharded.h"
+#include "../telemetry/telemetry.h"
+
+// Cost of execution telemetry: the same program with tracing off and on,
+// on one thread (runProgram) and on the sharded runtime (one ring per shard).
+// Every block runs a few sets and ifs per tick, which is where events come from.
+
+static std::string makeProgram(int blocks, int work){
+    ChainOptions options;
+    options.blocks = blocks;
+    options.work = work;
+    return makeChainProgram(options);
+}
+
+struct RunResult{
+    double seconds = 0;
+    uint64_t events = 0;
+    uint64_t dropped = 0;
+};
+
+static RunResult runOnce(const CompiledProgram& program, uint64_t ticks, size_t shards,
+                         size_t ringEvents, const std::string& tracePath){
+    FrameStore frames(program);
+    Telemetry telemetry(program);
+    telemetry.setRingEvents(ringEvents);
+    std::string err;
+    bool traced = !tracePath.empty();
+    if(traced && !telemetry.open(tracePath, err)){
+        std::cerr << "ERROR :: " << err << "\n";
+        std::exit(1);
+    }
+
+    RunResult result;
+    auto start = std::chrono::steady_clock::now();
+    if(shards == 0){
+        TelemetryRing* ring = traced ? telemetry.addRing() : nullptr;
+        for(uint64_t t = 0; t < ticks; t++){
+            if(ring) runProgram(program, frames, *ring);
+            else runProgram(program, frames);
+        }
+    }
+    else{
+        ShardedRuntime runtime(program, frames, shards);
+        if(traced) runtime.setTelemetry(&telemetry);
+        runtime.run(ticks);
+    }
+    auto end = std::chrono::steady_clock::now();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+
+    if(traced){
+        if(!telemetry.close(err)) std::cerr << "ERROR :: " << err << "\n";
+        result.events = telemetry.events();
+        result.dropped = telemetry.dropped();
+        std::remove(tracePath.c_str());
+    }
+    return result;
+}
+
+int main(int argc, char* argv[]){
+    int blocks = argc > 1 ? std::atoi(argv[1]) : 64;
+    int work = argc > 2 ? std::atoi(argv[2]) : 4;
+    uint64_t ticks = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 50000;
+    size_t shards = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 4;
+    size_t ringEvents = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 1 << 16;
+    std::string tracePath = argc > 6 ? argv[6] : "telemetry_bench.alte";
+
+    CompiledProgram program;
+    std::vector<std::string> errors;
+    if(!compileSource(makeProgram(blocks, work), program, errors)){
+        for(const auto& err : errors) std::cerr << err << "\n";
+        return 1;
+    }
+
+    std::cout << "telemetry: " << blocks << " blocks, " << ticks << " ticks, "
+              << ringEvents << " events per ring, " << std::thread::hardware_concurrency() << " hardware threads\n";
+    std::cout << std::left << std::setw(14) << "runtime"
+              << std::setw(8) << "trace"
+              << std::setw(14) << "ticks/sec"
+              << std::setw(10) << "ns/tick"
+              << std::setw(16) << "events/sec"
+              << std::setw(12) << "dropped"
+              << "overhead\n";
+
+    // 0 is runProgram on the calling thread
+    std::vector<size_t> runtimes = {0};
+    if(shards > 1) runtimes.push_back(shards);
+    for(size_t threads : runtimes){
+        std::string name = threads == 0 ? "runProgram" : std::to_string(threads) + " shards";
+        double baseline = 0.0;
+        for(bool traced : {false, true}){
+            RunResult r = runOnce(program, ticks, threads, ringEvents, traced ? tracePath : "");
+            double tps = ticks / r.seconds;
+            if(!traced) baseline = r.seconds;
+            std::cout << std::left << std::setw(14) << name
+                      << std::setw(8) << (traced ? "on" : "off")
+                      << std::setw(14) << static_cast<uint64_t>(tps)
+                      << std::setw(10) << static_cast<uint64_t>(1e9 / tps)
+                      << std::setw(16) << static_cast<uint64_t>(r.events / r.seconds)
+                      << std::setw(12) << r.dropped
+                      << std::fixed << std::setprecision(1) << (r.seconds / baseline - 1.0) * 100.0 << "%\n"
+                      << std::defaultfloat;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../xref/xref.h"
+
+// Cross-reference index on a large program: building it (a parse with the hooks on),
+// opening the saved file, and looking names up.
+// Every block has a few names of its own and reads signals from a shared pool, so the
+// index holds a lot of rare names and some that appear in thousands of blocks.
+
+static std::string makeProgram(size_t lines, size_t signals, size_t& blocks){
+    std::ostringstream src;
+    std::mt19937_64 rng(7);
+    size_t written = 0;
+    blocks = 0;
+    while(written < lines){
+        size_t b = blocks++;
+        std::string a = "sig" + std::to_string(rng() % signals);
+        std::string c = "sig" + std::to_string(rng() % signals);
+        std::string out = "out" + std::to_string(b);
+        std::string err = "err" + std::to_string(b);
+        src << "control block" << b << " {\n"
+            << "    float " << a << ";\n"
+            << "    float " << c << ";\n"
+            << "    float " << out << ";\n"
+            << "    float " << err << ";\n"
+            << "    set " << err << " " << a << " - " << c << ";\n"
+            << "    if (" << err << " > 1.5) {\n"
+            << "        set " << out << " (" << out << " + " << err << ");\n"
+            << "        if (" << a << " > 100.0) {\n"
+            << "            set " << out << " 100.0;\n"
+            << "        }\n"
+            << "    }\n"
+            << "    set " << c << " " << out << " + 0.5;\n"
+            << "}\n";
+        written += 14;
+    }
+    return src.str();
+}
+
+static double nowMillis(){
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void fail(const std::string& what){
+    std::cerr << "ERROR :: " << what << "\n";
+    std::exit(1);
+}
+
+int main(int argc, char* argv[]){
+    size_t lines = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    size_t signals = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000;
+    size_t lookups = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 20000;
+    std::string path = argc > 4 ? argv[4] : "xref_bench.alx";
+    if(lines == 0 || signals == 0 || lookups == 0){
+        std::cerr << "usage: autolangxrefbench [lines] [signals] [lookups] [path]\n";
+        return 1;
+    }
+
+    size_t blocks;
+    double start = nowMillis();
+    std::string source = makeProgram(lines, signals, blocks);
+    double generated = nowMillis() - start;
+
+    // the same parse without the hooks, what indexing adds on top of it
+    start = nowMillis();
+    {
+        Lexer lexer(source);
+        Parser parser(lexer);
+        auto program = parser.parseProgram();
+        if(!parser.getErrors().empty()) fail(parser.getErrors()[0]);
+    }
+    double parsed = nowMillis() - start;
+
+    start = nowMillis();
+    std::vector<std::string> errors;
+    if(!buildXref(source, path, errors)){
+        for(const auto& e : errors) std::cerr << e << "\n";
+        return 1;
+    }
+    double built = nowMillis() - start;
+    source.clear();
+    source.shrink_to_fit();
+
+    // opening is the same for any size, take the median
+    std::vector<double> opens;
+    std::string error;
+    for(int r = 0; r < 21; r++){
+        XrefIndex index;
+        start = nowMillis();
+        if(!index.open(path, error)) fail(error);
+        opens.push_back(nowMillis() - start);
+    }
+    std::nth_element(opens.begin(), opens.begin() + opens.size() / 2, opens.end());
+
+    XrefIndex index;
+    if(!index.open(path, error)) fail(error);
+    std::cout << lines << " lines, " << blocks << " blocks (generated in " << std::fixed << std::setprecision(0) << generated << " ms)\n"
+              << index.nameCount() << " names, " << index.siteCount() << " sites\n"
+              << "parse " << parsed << " ms, parse with the index and save it " << built << " ms\n"
+              << "index " << std::setprecision(1) << index.fileBytes() / 1e6 << " MB, open " << std::setprecision(4) << opens[opens.size() / 2] << " ms\n\n";
+
+    // block local names have a handful of sites, shared signals thousands; the time
+    // includes reading every returned site once
+    std::mt19937_64 rng(11);
+    auto measure = [&](const char* label, const std::function<std::string()>& pick){
+        std::vector<double> times;
+        size_t found = 0;
+        for(size_t i = 0; i < lookups; i++){
+            std::string name = pick();
+            const XrefSite* sites;
+            size_t count;
+            double t = nowMillis();
+            if(!index.lookup(name, sites, count, error)) fail(error);
+            // touch what a caller would read
+            uint64_t sum = 0;
+            for(size_t s = 0; s < count; s++) sum += sites[s].line;
+            times.push_back(nowMillis() - t);
+            found += sum ? count : 0;
+        }
+        std::sort(times.begin(), times.end());
+        auto at = [&](double p){ return times[std::min(times.size() - 1, static_cast<size_t>(p * times.size()))]; };
+        std::cout << std::left << std::setw(10) << label << std::setw(10) << std::setprecision(1) << double(found) / lookups
+                  << std::setprecision(4) << std::setw(11) << at(0.5) << std::setw(11) << at(0.99) << times.back() << "\n";
+    };
+    std::cout << std::left << std::setw(10) << "names" << std::setw(10) << "sites" << std::setw(11) << "p50 ms"
+              << std::setw(11) << "p99 ms" << "max ms\n";
+    measure("local", [&]{ return (rng() & 1 ? "out" : "err") + std::to_string(rng() % blocks); });
+    measure("signal", [&]{ return "sig" + std::to_string(rng() % signals); });
+    measure("missing", [&]{ return "nope" + std::to_string(rng() % blocks); });
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include "batch.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <spawn.h>
+#include <sstream>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#include "driver.h"
+
+extern char** environ;
+
+// a worker never runs more than this many files ahead of the collator,
+// so the output of a huge batch is not all held in memory at once
+constexpr size_t WINDOW_PER_JOB = 4;
+
+namespace{
+struct FileResult{
+    std::string out, err;
+    size_t bytes = 0;
+    bool found = true;
+    bool done = false;
+};
+}
+
+std::vector<std::string> collectBatchFiles(const std::vector<std::string>& args, std::istream& manifest){
+    namespace fs = std::filesystem;
+    std::vector<std::string> files;
+    std::vector<std::string> sources = args;
+    if(sources.empty()) sources.push_back("-");
+
+    for(const auto& arg : sources){
+        if(arg == "-"){
+            std::string line;
+            while(std::getline(manifest, line)){
+                if(!line.empty() && line.back() == '\r') line.pop_back();
+                if(!line.empty()) files.push_back(line);
+            }
+            continue;
+        }
+        std::error_code ec;
+        if(fs::is_directory(arg, ec)){
+            std::vector<std::string> found;
+            for(fs::recursive_directory_iterator it(arg, ec), end; !ec && it != end; it.increment(ec)){
+                if(it->is_regular_file(ec) && it->path().extension() == ".alang"){
+                    found.push_back(it->path().string());
+                }
+            }
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        }
+        else{
+            // missing files are reported in order by runBatch
+            files.push_back(arg);
+        }
+    }
+    return files;
+}
+
+// one child per file, at most jobs at a time, output thrown away
+static double timeProcessPerFile(const std::vector<std::string>& files, const BatchOptions& options, unsigned jobs){
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t next = 0;
+    unsigned running = 0;
+    while(next < files.size() || running > 0){
+        while(running < jobs && next < files.size()){
+            std::vector<char*> argv{const_cast<char*>(options.self.c_str()),
+                                    const_cast<char*>(files[next].c_str()),
+                                    const_cast<char*>(options.mode.c_str()), nullptr};
+            pid_t pid;
+            if(posix_spawn(&pid, options.self.c_str(), &actions, nullptr, argv.data(), environ) == 0){
+                running++;
+            }
+            next++;
+        }
+        if(running == 0) break;
+        int status;
+        if(wait(&status) > 0) running--;
+    }
+    auto end = std::chrono::steady_clock::now();
+    posix_spawn_file_actions_destroy(&actions);
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int runBatch(const std::vector<std::string>& files, const BatchOptions& options){
+    unsigned jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::max(1u, std::min<unsigned>(jobs, std::max<size_t>(1, files.size())));
+    size_t window = static_cast<size_t>(jobs) * WINDOW_PER_JOB;
+
+    std::vector<FileResult> results(files.size());
+    std::mutex mutex;
+    std::condition_variable resultReady, slotFree;
+    size_t next = 0;       // next file a worker picks up
+    size_t collated = 0;   // files already written out
+
+    auto worker = [&](){
+        while(true){
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                slotFree.wait(lock, [&]{ return next >= files.size() || next < collated + window; });
+                if(next >= files.size()) return;
+                index = next++;
+            }
+
+            FileResult result;
+            std::string source;
+            if(readSourceFile(files[index], source)){
+                result.bytes = source.size();
+                std::ostringstream out, err;
+                PhaseStats stats; // disabled
+                runMode(options.mode, source, out, err, stats);
+                result.out = out.str();
+                result.err = err.str();
+            }
+            else{
+                result.found = false;
+                result.err = "ERROR :: FILE NOT FOUND :: " + files[index] + "\n";
+            }
+            result.done = true;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                results[index] = std::move(result);
+            }
+            resultReady.notify_one();
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(unsigned j = 0; j < jobs; j++) threads.emplace_back(worker);
+
+    // the calling thread writes the results out in list order as soon as they are ready
+    int status = 0;
+    size_t totalBytes = 0;
+    for(size_t i = 0; i < files.size(); i++){
+        FileResult result;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            resultReady.wait(lock, [&]{ return results[i].done; });
+            result = std::move(results[i]);
+            results[i] = FileResult();
+            collated = i + 1;
+        }
+        slotFree.notify_all();
+
+        if(result.found) std::cout << "==> " << files[i] << " <==\n" << result.out;
+        if(!result.err.empty()){
+            std::cout.flush();
+            std::cerr << "==> " << files[i] << " <==\n" << result.err;
+        }
+        if(!result.found) status = 1;
+        totalBytes += result.bytes;
+    }
+    for(auto& thread : threads) thread.join();
+    std::cout.flush();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if(options.summary || options.compare){
+        double mb = totalBytes / 1e6;
+        std::cerr << std::fixed << std::setprecision(2)
+                  << "batch: " << files.size() << " files, " << mb << " MB, " << jobs << " jobs: "
+                  << seconds << " s, " << files.size() / seconds << " files/s, " << mb / seconds << " MB/s\n";
+        if(options.compare && !options.self.empty()){
+            double processSeconds = timeProcessPerFile(files, options, jobs);
+            std::cerr << "process per file: " << processSeconds << " s, "
+                      << files.size() / processSeconds << " files/s, " << mb / processSeconds << " MB/s"
+                      << " (batch is " << processSeconds / seconds << "x faster)\n";
+        }
+        std::cerr << std::defaultfloat;
+    }
+    return status;
+}
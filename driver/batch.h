@@ -0,0 +1,28 @@
+#ifndef DRIVER_BATCH_H
+#define DRIVER_BATCH_H
+
+#include <istream>
+#include <string>
+#include <vector>
+
+struct BatchOptions{
+    std::string mode;          // -s -p -t -l -b
+    unsigned jobs = 0;         // worker threads, 0 means one per hardware thread
+    bool summary = false;      // print files/sec and MB/sec on stderr
+    bool compare = false;      // also time one process per file and print the speedup
+    std::string self;          // path of this executable, for the comparison
+};
+
+// Expands the batch arguments into the list of files to process.
+// A directory adds every *.alang below it in sorted order, a file is taken as is,
+// "-" (or no argument at all) reads one path per line from manifest.
+std::vector<std::string> collectBatchFiles(const std::vector<std::string>& args, std::istream& manifest);
+
+// Runs the mode on every file on a bounded pool of worker threads.
+// The output of every file is collated and written in list order:
+// "==> file <==" followed by what the single file tool would print on stdout,
+// and the same header plus its stderr messages on stderr.
+// Returns 1 when a file could not be read, 0 otherwise.
+int runBatch(const std::vector<std::string>& files, const BatchOptions& options);
+
+#endif // DRIVER_BATCH_H
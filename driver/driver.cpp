@@ -0,0 +1,351 @@
+#include "driver.h"
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../parser/ast.h"
+#include "../parser/astPrinter/astPrinter.h"
+#include "../lexer/symbol_table_printer/symbol_table_printer.h"
+#include "../typeChecker/typechecker.h"
+#include "../frameLayout/frameLayout.h"
+#include "../runtime/compiler.h"
+
+// "-spt": two or more of the single letter modes, each at most once
+static bool isFusedMode(const std::string& flag){
+    if(flag.size() < 3 || flag[0] != '-') return false;
+    for(size_t i = 1; i < flag.size(); i++){
+        if(std::string("sptlb").find(flag[i]) == std::string::npos) return false;
+        if(flag.find(flag[i], i + 1) != std::string::npos) return false;
+    }
+    return true;
+}
+
+bool isValidMode(const std::string& flag){
+    return flag == "-s" || flag == "-p" || flag == "-t" || flag == "-l" || flag == "-b" || isFusedMode(flag);
+}
+
+bool readSourceFile(const std::string& path, std::string& source){
+    std::ifstream file(path, std::ios::binary);
+    if(!file) return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    source = buffer.str();
+    return true;
+}
+
+bool splitDiagnostic(const std::string& text, int& line, int& col, std::string& message){
+    int consumed = 0;
+    line = col = 0;
+    message = text;
+    if(std::sscanf(text.c_str(), "Line %d, Col %d%n", &line, &col, &consumed) != 2 || consumed == 0){
+        line = col = 0;
+        return false;
+    }
+    size_t pos = consumed;
+    if(pos < text.size() && (text[pos] == ':' || text[pos] == ';')) pos++;
+    while(pos < text.size() && text[pos] == ' ') pos++;
+    message = text.substr(pos);
+    return true;
+}
+
+// counts the tokens a fused run lexes and prints them when -s is part of it
+class FusedTokens : public TokenListener{
+    public:
+    TokenTablePrinter* table = nullptr;
+    uint64_t count = 0;
+    bool ended = false;
+
+    void onToken(const Token& token) override{
+        if(ended) return;
+        if(token.type == TokenType::EOF_TOKEN) ended = true;
+        else count++;
+        if(table) table->onToken(token);
+    }
+};
+
+// Every requested output from one lexer and one parse:
+// the token table is printed while the parser pulls the tokens,
+// the checker, layout pass and compiler all walk the same AST.
+// Sections come in the order s p t l b and each is exactly what its own mode prints.
+static void runFused(const std::string& flag, const std::string& input, std::ostream& out, std::ostream& err, PhaseStats& stats){
+    auto wants = [&](char mode){ return flag.find(mode) != std::string::npos; };
+
+    Lexer lexer(input);
+    FusedTokens tokens;
+    std::unique_ptr<TokenTablePrinter> table;
+    if (wants('s')) table = std::make_unique<TokenTablePrinter>(out);
+    tokens.table = table.get();
+    lexer.setListener(&tokens);
+
+    // lexing, parsing and printing the token table are one phase here,
+    // the tokens are counted on the way
+    stats.begin("parse");
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    // what compileSource (-b) would have seen, before the rest is lexed for the table
+    std::vector<std::string> compileErrors = lexer.getErrors();
+    if (table) {
+        // the parser stops early on some errors, the table still lists every token
+        while (!tokens.ended) lexer.getNextToken();
+    }
+    stats.end(tokens.count, stats.isEnabled() ? countAstNodes(program.get()) : 0);
+
+    const auto& parseErrors = parser.getErrors();
+    if (table) table->finish(lexer.getErrors());
+
+    if (wants('p')) {
+        if (!parseErrors.empty()) {
+            out << "Errors:\n";
+            for (const auto& e : parseErrors)
+                out << e << "\n";
+        } else {
+            stats.begin("print");
+            printProgram(program.get(), out);
+            stats.end();
+        }
+    }
+
+    if (wants('t')) {
+        // a tree cut short by a parse error is not checked, like -l and -b
+        if (!parseErrors.empty()) {
+            out << "Errors:\n";
+            for (const auto& e : parseErrors)
+                out << e << "\n";
+        } else {
+            stats.begin("typecheck");
+            TypeChecker t;
+            bool passed = t.checkProgram(program.get());
+            stats.end();
+            if (passed) {
+                out << "\nSemantic Test Passed!\n";
+            } else {
+                err << "Semantic Errors occured!\n";
+                for (const auto& e : t.getErrors())
+                    out << e << "\n";
+            }
+        }
+    }
+
+    if (wants('l')) {
+        if (!parseErrors.empty()) {
+            out << "Errors:\n";
+            for (const auto& e : parseErrors)
+                out << e << "\n";
+        } else {
+            stats.begin("layout");
+            FrameLayoutPass layoutPass;
+            auto layouts = layoutPass.layoutProgram(program.get());
+            stats.end();
+            if (layoutPass.getErrors().empty()) {
+                stats.begin("print");
+                printFrameLayouts(layouts, out);
+                stats.end();
+            } else {
+                err << "Layout Errors occured!\n";
+                for (const auto& e : layoutPass.getErrors())
+                    out << e << "\n";
+            }
+        }
+    }
+
+    if (wants('b')) {
+        for (const auto& e : parseErrors) compileErrors.push_back(e);
+        CompiledProgram compiled;
+        if (compileErrors.empty()) {
+            stats.begin("compile");
+            Compiler compiler;
+            compiled = compiler.compileProgram(program.get());
+            compileErrors = compiler.getErrors();
+            for (const auto& w : compiler.getWarnings())
+                err << "WARNING :: " << w << "\n";
+            stats.end();
+        }
+        if (compileErrors.empty()) {
+            stats.begin("print");
+            printBytecode(compiled, out);
+            stats.end();
+        } else {
+            err << "Compile Errors occured!\n";
+            for (const auto& e : compileErrors)
+                out << e << "\n";
+        }
+    }
+}
+
+bool runMode(const std::string& flag, const std::string& input, std::ostream& out, std::ostream& err, PhaseStats& stats,
+             OutputFormat format){
+    if (isFusedMode(flag)) {
+        if (format != OutputFormat::TEXT) {
+            err << "ERROR :: --format only applies to -s and -p on their own\n";
+            return false;
+        }
+        try {
+            runFused(flag, input, out, err, stats);
+        } catch (const std::exception& e) {
+            err << "Error: " << e.what() << "\n";
+        }
+        return true;
+    }
+
+    if (format != OutputFormat::TEXT && flag != "-s" && flag != "-p") {
+        err << "ERROR :: --format only applies to -s and -p\n";
+        return false;
+    }
+
+    // the parser pulls its tokens on demand, so lexing on its own is only
+    // measured by an extra pass when stats are on (parse still includes lexing)
+    if (stats.isEnabled()) {
+        stats.begin("lex");
+        uint64_t tokens = countTokens(input);
+        stats.end(tokens);
+    }
+
+    if (flag == "-s") {
+        // Print Tokens / Symbol Table
+        try {
+            stats.begin("print");
+            if (format == OutputFormat::JSON) dumpTokensJson(input, out);
+            else if (format == OutputFormat::BINARY) dumpTokensBinary(input, out);
+            else printTokens(input, out);
+            stats.end();
+        } catch (const std::exception& e) {
+            err << "Error: " << e.what() << "\n";
+        }
+    } 
+    else if (flag == "-p") {
+        // Print AST Tree
+        try {
+            stats.begin("parse");
+            Lexer lexer(input);
+            Parser parser(lexer);
+            auto program = parser.parseProgram();
+            stats.end(0, stats.isEnabled() ? countAstNodes(program.get()) : 0);
+
+            if (format != OutputFormat::TEXT) {
+                // the machine readable dumps carry the errors themselves
+                stats.begin("print");
+                if (format == OutputFormat::JSON) dumpProgramJson(program.get(), parser.getErrors(), out);
+                else dumpProgramBinary(program.get(), parser.getErrors(), out);
+                stats.end();
+            } else if (!parser.getErrors().empty()) {
+                out << "Errors:\n";
+                for (const auto& e : parser.getErrors())
+                    out << e << "\n";
+            } else {
+                stats.begin("print");
+                printProgram(program.get(), out);
+                stats.end();
+            }
+
+        } catch (const std::exception& e) {
+            err << "Error: " << e.what() << "\n";
+        }
+    } 
+    else if (flag == "-t"){
+        // Beginning Syntax Checks...
+        try{
+            stats.begin("parse");
+            Lexer lexer (input);
+            Parser parser(lexer);
+            auto program = parser.parseProgram();
+            stats.end(0, stats.isEnabled() ? countAstNodes(program.get()) : 0);
+
+            // a tree cut short by a parse error (like the nesting limit) is not checked
+            if (!parser.getErrors().empty()) {
+                out << "Errors:\n";
+                for (const auto& e : parser.getErrors())
+                    out << e << "\n";
+            } else {
+                stats.begin("typecheck");
+                TypeChecker t;
+                bool passed = t.checkProgram(program.get());
+                stats.end();
+                if(passed){
+                    // True: means no semantic errors occured
+                    out << "\nSemantic Test Passed!\n";
+                }
+                else{
+                    err << "Semantic Errors occured!\n";
+                    for(const auto& e: t.getErrors()){
+                        out << e << "\n";
+                    }
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            err << "Error: " << e.what() << "\n";
+        }
+    }
+    else if(flag == "-l"){
+        // Static frame layout report
+        try{
+            stats.begin("parse");
+            Lexer lexer(input);
+            Parser parser(lexer);
+            auto program = parser.parseProgram();
+            stats.end(0, stats.isEnabled() ? countAstNodes(program.get()) : 0);
+
+            if (!parser.getErrors().empty()) {
+                out << "Errors:\n";
+                for (const auto& e : parser.getErrors())
+                    out << e << "\n";
+            } else {
+                stats.begin("layout");
+                FrameLayoutPass layoutPass;
+                auto layouts = layoutPass.layoutProgram(program.get());
+                stats.end();
+                if(layoutPass.getErrors().empty()){
+                    stats.begin("print");
+                    printFrameLayouts(layouts, out);
+                    stats.end();
+                }
+                else{
+                    err << "Layout Errors occured!\n";
+                    for(const auto& e: layoutPass.getErrors()){
+                        out << e << "\n";
+                    }
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            err << "Error: " << e.what() << "\n";
+        }
+    }
+    else if(flag == "-b"){
+        // Bytecode listing
+        try{
+            // compileSource lexes and parses too
+            stats.begin("compile");
+            CompiledProgram compiled;
+            std::vector<std::string> errors;
+            std::vector<std::string> warnings;
+            bool compiledOk = compileSource(input, compiled, errors, &warnings);
+            stats.end();
+            for(const auto& w : warnings){
+                err << "WARNING :: " << w << "\n";
+            }
+            if(compiledOk){
+                stats.begin("print");
+                printBytecode(compiled, out);
+                stats.end();
+            }
+            else{
+                err << "Compile Errors occured!\n";
+                for(const auto& e: errors){
+                    out << e << "\n";
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            err << "Error: " << e.what() << "\n";
+        }
+    }
+    else {
+        err << "ERROR :: Invalid option. Use -s for symbol table, -p for parse tree, -t for type check, -l for frame layout or -b for bytecode.\n";
+        return false;
+    }
+    return true;
+}
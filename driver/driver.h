@@ -0,0 +1,32 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <ostream>
+#include <string>
+
+#include "../stats/phaseStats.h"
+#include "../output/dump.h"
+
+// The modes of the command line tool, shared by the single file,
+// batch and server front ends so they all produce the same output.
+//   -s tokens, -p parse tree, -t type check, -l frame layout, -b bytecode
+// or several of them fused into one run over the source, e.g. -spt
+
+bool isValidMode(const std::string& flag);
+
+// Reads a whole file, returns false when it cannot be opened
+bool readSourceFile(const std::string& path, std::string& source);
+
+// Runs one mode on a source buffer.
+// The normal output goes to out, the messages that are not part of it
+// ("Semantic Errors occured!", exceptions) to err.
+// format picks text, JSON or binary output for -s and -p, the other modes only print text.
+// Returns false and complains on err for an unknown mode.
+bool runMode(const std::string& flag, const std::string& input, std::ostream& out, std::ostream& err, PhaseStats& stats,
+             OutputFormat format = OutputFormat::TEXT);
+
+// Takes a "Line X, Col Y: message" error apart (the lexer and parser write "; ").
+// Returns false for messages without a position, message is then the whole text.
+bool splitDiagnostic(const std::string& text, int& line, int& col, std::string& message);
+
+#endif // DRIVER_H
@@ -0,0 +1,378 @@
+#include "frameLayout.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+static size_t alignUp(size_t value, size_t align){
+    if(align == 0) return value;
+    return (value + align - 1) / align * align;
+}
+
+size_t typeSize(TypeTag t){
+    switch(t){
+        case TypeTag::TYPE_INT: return 4;
+        case TypeTag::TYPE_FLOAT: return 4;
+        case TypeTag::TYPE_BOOL: return 1;
+        default: return 0;
+    }
+}
+
+TypeTag declTypeToTag(TokenType t){
+    switch(t){
+        case TokenType::INT_TYPE: return TypeTag::TYPE_INT;
+        case TokenType::FLOAT_TYPE: return TypeTag::TYPE_FLOAT;
+        case TokenType::BOOL_TYPE: return TypeTag::TYPE_BOOL;
+        default: return TypeTag::TYPE_ERROR;
+    }
+}
+
+int FrameLayout::slotOf(const ASTNode* node) const{
+    auto it = resolved.find(node);
+    if(it == resolved.end()) return -1;
+    return it->second;
+}
+
+FrameLayoutPass::FrameLayoutPass(){
+    // nothing to initialize
+}
+
+const std::vector<std::string>& FrameLayoutPass::getErrors(){
+    return errors;
+}
+
+void FrameLayoutPass::reportError(int line, int col, const std::string& msg){
+    std::ostringstream oss;
+    if(line > 0)
+        oss << "Line " << line << ", Col " << col << ": " << msg;
+    else
+        oss << msg;
+    errors.push_back(oss.str());
+}
+
+int FrameLayoutPass::findGroup(int slot){
+    while(groupParent[slot] != slot){
+        groupParent[slot] = groupParent[groupParent[slot]];
+        slot = groupParent[slot];
+    }
+    return slot;
+}
+
+void FrameLayoutPass::joinGroups(int a, int b){
+    a = findGroup(a);
+    b = findGroup(b);
+    if(a != b) groupParent[std::max(a, b)] = std::min(a, b);
+}
+
+int FrameLayoutPass::lookup(const std::string& name){
+    // innermost scope first, just like lexical scoping
+    auto found = visible.find(name);
+    if(found == visible.end() || found->second.empty()) return -1;
+    return found->second.back();
+}
+
+void FrameLayoutPass::collectFactor(const FactorNode* factor, std::vector<int>* reads){
+    if(!factor) return;
+    if(auto ident = dynamic_cast<const IdentifierNode*>(factor)){
+        int slot = lookup(ident->identifier);
+        if(slot < 0){
+            reportError(ident->line, ident->col, "Use of undeclared identifier '" + ident->identifier + "'");
+            return;
+        }
+        current->resolved[ident] = slot;
+        if(reads) reads->push_back(slot);
+    }
+    // literals need no storage, parentheses are opened by collectExpression
+}
+
+void FrameLayoutPass::collectExpression(const ExpressionNode* expr, std::vector<int>* reads){
+    // factors left to right from a work stack, long a + b + ... chains and
+    // deep parentheses must not recurse
+    std::vector<const FactorNode*> work;
+    auto pushTerms = [&](const ExpressionNode* e){
+        if(!e) return;
+        if(e->right) work.push_back(e->right->factor.get());
+        if(e->left) work.push_back(e->left->factor.get());
+    };
+    pushTerms(expr);
+    while(!work.empty()){
+        const FactorNode* factor = work.back();
+        work.pop_back();
+        if(auto paren = dynamic_cast<const ParenExpressionNode*>(factor)) pushTerms(paren->expression.get());
+        else collectFactor(factor, reads);
+    }
+}
+
+void FrameLayoutPass::collectStatement(const StatementNode* statement){
+    if(!statement) return;
+    Scope& scope = scopes[scopeStack.back()];
+
+    if(auto decl = dynamic_cast<const VarDeclNode*>(statement)){
+        if(scope.names.count(decl->identifier)){
+            reportError(decl->line, decl->col, "Variable " + decl->identifier + " already declared in this scope");
+            return;
+        }
+        FrameSlot slot;
+        slot.name = decl->identifier;
+        slot.type = declTypeToTag(decl->type);
+        slot.size = typeSize(slot.type);
+        slot.scope = scopeStack.back();
+        slot.line = decl->line;
+        slot.col = decl->col;
+
+        int idx = current->slots.size();
+        current->slots.push_back(slot);
+        groupParent.push_back(idx);
+        scope.slots.push_back(idx);
+        scope.names[decl->identifier] = idx;
+        visible[decl->identifier].push_back(idx);
+        current->resolved[decl] = idx;
+    }
+    else if(auto assign = dynamic_cast<const AssignmentNode*>(statement)){
+        int slot = lookup(assign->identifier);
+        if(slot < 0){
+            reportError(assign->line, assign->col, "Undeclared variable " + assign->identifier + " in assignment");
+        }
+        else{
+            current->resolved[assign] = slot;
+        }
+        collectExpression(assign->expression.get(), nullptr);
+    }
+}
+
+void FrameLayoutPass::collectStatements(const std::vector<std::unique_ptr<StatementNode>>& statements){
+    // if bodies from an explicit stack, one entry per open body,
+    // so a deep nesting cannot overflow the call stack
+    struct Body{
+        const std::vector<std::unique_ptr<StatementNode>>* statements;
+        size_t next;
+    };
+    std::vector<Body> bodies{{&statements, 0}};
+    while(!bodies.empty()){
+        Body& body = bodies.back();
+        if(body.next == body.statements->size()){
+            bodies.pop_back();
+            if(bodies.empty()) continue;
+            for(const auto& name : scopes[scopeStack.back()].names) visible[name.first].pop_back();
+            scopeStack.pop_back();
+            continue;
+        }
+        const StatementNode* statement = (*body.statements)[body.next++].get();
+        auto ifnode = dynamic_cast<const IfNode*>(statement);
+        if(!ifnode){
+            collectStatement(statement);
+            continue;
+        }
+
+        // every variable read by the condition joins one affinity group
+        // so that evaluating the condition touches as few cache lines as possible
+        if(ifnode->condition){
+            std::vector<int> reads;
+            collectExpression(ifnode->condition->left.get(), &reads);
+            collectExpression(ifnode->condition->right.get(), &reads);
+            for(size_t i = 1; i < reads.size(); i++){
+                joinGroups(reads[0], reads[i]);
+            }
+        }
+
+        int id = scopes.size();
+        int parent = scopeStack.back();
+        scopes.push_back(Scope{parent, {}, {}, {}});
+        scopes[parent].children.push_back(id);
+
+        scopeStack.push_back(id);
+        bodies.push_back({&ifnode->statements, 0});
+    }
+}
+
+size_t FrameLayoutPass::placeScope(int scopeId, size_t base){
+    // A unit is a run of slots that must stay together:
+    // either the members of one condition group declared in this scope, or a single slot
+    struct Unit{
+        std::vector<int> members;
+        size_t size = 0;
+        size_t align = 1;
+        int first = 0; // declaration order, keeps the layout deterministic
+    };
+
+    std::vector<Unit> units;
+    std::unordered_map<int, int> unitOfGroup;
+    for(int idx : scopes[scopeId].slots){
+        int group = current->slots[idx].group;
+        if(group >= 0){
+            auto it = unitOfGroup.find(group);
+            if(it != unitOfGroup.end()){
+                units[it->second].members.push_back(idx);
+                continue;
+            }
+            unitOfGroup[group] = units.size();
+        }
+        Unit unit;
+        unit.members.push_back(idx);
+        unit.first = idx;
+        units.push_back(unit);
+    }
+
+    // pack by type: widest members first so a unit never needs inner padding
+    for(auto& unit : units){
+        std::stable_sort(unit.members.begin(), unit.members.end(), [&](int a, int b){
+            return current->slots[a].size > current->slots[b].size;
+        });
+        for(int idx : unit.members){
+            const FrameSlot& slot = current->slots[idx];
+            unit.align = std::max(unit.align, slot.size);
+            unit.size = alignUp(unit.size, slot.size) + slot.size;
+        }
+    }
+
+    // first fit decreasing into cache lines
+    std::stable_sort(units.begin(), units.end(), [](const Unit& a, const Unit& b){
+        if(a.size != b.size) return a.size > b.size;
+        return a.first < b.first;
+    });
+
+    struct Line{
+        size_t start, end, cursor;
+    };
+    std::vector<Line> lines;
+    size_t frontier = base;
+    auto openLine = [&](){
+        size_t end = (frontier / CACHE_LINE_SIZE + 1) * CACHE_LINE_SIZE;
+        lines.push_back(Line{frontier, end, frontier});
+        frontier = end;
+    };
+
+    for(const auto& unit : units){
+        size_t pos = 0;
+        bool placed = false;
+
+        if(unit.size <= CACHE_LINE_SIZE){
+            for(size_t i = 0; ; i++){
+                if(i == lines.size()) openLine();
+                size_t aligned = alignUp(lines[i].cursor, unit.align);
+                if(aligned + unit.size <= lines[i].end){
+                    pos = aligned;
+                    lines[i].cursor = aligned + unit.size;
+                    placed = true;
+                    break;
+                }
+                // a unit never fits in a line that is empty and still too short
+                // this only happens for the partial first line, so just move on
+            }
+        }
+
+        if(!placed){
+            // bigger than a cache line: give it whole lines of its own
+            if(lines.empty()) openLine();
+            pos = frontier;
+            size_t end = pos + unit.size;
+            while(frontier < end){
+                openLine();
+                lines.back().cursor = std::min(lines.back().end, end);
+            }
+        }
+
+        for(int idx : unit.members){
+            FrameSlot& slot = current->slots[idx];
+            pos = alignUp(pos, slot.size);
+            slot.offset = pos;
+            pos += slot.size;
+        }
+    }
+
+    size_t end = base;
+    for(const auto& line : lines){
+        end = std::max(end, line.cursor);
+    }
+
+    return end;
+}
+
+FrameLayout FrameLayoutPass::layoutControlBlock(const ControlNode* control){
+    FrameLayout layout;
+    if(!control) return layout;
+    layout.blockName = control->name;
+
+    current = &layout;
+    scopes.clear();
+    scopeStack.clear();
+    visible.clear();
+    groupParent.clear();
+
+    scopes.push_back(Scope{-1, {}, {}, {}});
+    scopeStack.push_back(0);
+    collectStatements(control->statements);
+
+    // a group only matters when it has more than one member
+    std::vector<int> groupSize(layout.slots.size(), 0);
+    for(size_t i = 0; i < layout.slots.size(); i++){
+        groupSize[findGroup(i)]++;
+    }
+    for(size_t i = 0; i < layout.slots.size(); i++){
+        int group = findGroup(i);
+        if(groupSize[group] > 1) layout.slots[i].group = group;
+    }
+
+    // sibling if bodies can never be live at the same time
+    // so they all start right after their parent scope and share the same bytes,
+    // the frame ends where the deepest placement does
+    std::vector<std::pair<int, size_t>> work{{0, 0}};
+    while(!work.empty()){
+        auto [scope, base] = work.back();
+        work.pop_back();
+        size_t end = placeScope(scope, base);
+        layout.frameSize = std::max(layout.frameSize, end);
+        const auto& children = scopes[scope].children;
+        for(auto it = children.rbegin(); it != children.rend(); ++it) work.push_back({*it, end});
+    }
+    layout.allocSize = alignUp(layout.frameSize, CACHE_LINE_SIZE);
+    for(const auto& scope : scopes){
+        layout.scopeParent.push_back(scope.parent);
+    }
+
+    current = nullptr;
+    return layout;
+}
+
+std::vector<FrameLayout> FrameLayoutPass::layoutProgram(const ProgramNode* program){
+    errors.clear();
+    std::vector<FrameLayout> layouts;
+    if(!program){
+        reportError(0, 0, "Null AST passed to FrameLayoutPass");
+        return layouts;
+    }
+    for(const auto& controlBlock : program->controlBlocks){
+        layouts.push_back(layoutControlBlock(controlBlock.get()));
+    }
+    return layouts;
+}
+
+void printFrameLayouts(const std::vector<FrameLayout>& layouts, std::ostream& out){
+    for(const auto& layout : layouts){
+        out << "frame " << layout.blockName
+                  << " size " << layout.frameSize
+                  << " alloc " << layout.allocSize
+                  << " slots " << layout.slots.size()
+                  << " scopes " << layout.scopeParent.size() << "\n";
+
+        for(size_t i = 0; i < layout.scopeParent.size(); i++){
+            out << "scope " << i << " parent " << layout.scopeParent[i] << "\n";
+        }
+
+        // slots in address order, that is what a backend wants to read
+        std::vector<const FrameSlot*> ordered;
+        for(const auto& slot : layout.slots) ordered.push_back(&slot);
+        std::stable_sort(ordered.begin(), ordered.end(), [](const FrameSlot* a, const FrameSlot* b){
+            return a->offset < b->offset;
+        });
+
+        for(const auto* slot : ordered){
+            out << "slot " << slot->offset
+                      << " " << slot->size
+                      << " " << typeTagToString(slot->type)
+                      << " " << slot->name
+                      << " scope " << slot->scope
+                      << " group " << slot->group
+                      << " line " << slot->line << "\n";
+        }
+    }
+}
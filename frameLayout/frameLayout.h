@@ -0,0 +1,103 @@
+#ifndef FRAME_LAYOUT_H
+#define FRAME_LAYOUT_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <iostream>
+
+#include "../parser/ast.h"
+#include "../typeChecker/types.h"
+
+// every frame starts on a cache line boundary
+// and is packed so that no small group of variables straddles two lines
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// One variable of a control block and the place it lives in the frame
+struct FrameSlot{
+    std::string name;
+    TypeTag type = TypeTag::TYPE_ERROR;
+    size_t offset = 0;
+    size_t size = 0;
+    int scope = 0;       // 0 is the control block body, every if body gets its own id
+    int group = -1;      // condition affinity group (variables read together in one condition)
+    int line = 0, col = 0;
+};
+
+// Layout of one control block's static frame
+struct FrameLayout{
+    std::string blockName;
+    size_t frameSize = 0;   // bytes actually used by slots
+    size_t allocSize = 0;   // frameSize rounded up to CACHE_LINE_SIZE
+    std::vector<FrameSlot> slots;
+
+    // parent scope of every scope, scopeParent[0] = -1
+    std::vector<int> scopeParent;
+
+    // every VarDeclNode, AssignmentNode and IdentifierNode of the block
+    // resolved to the index of the slot it refers to
+    std::unordered_map<const ASTNode*, int> resolved;
+
+    // returns -1 when the node was not resolved
+    int slotOf(const ASTNode* node) const;
+};
+
+class FrameLayoutPass{
+    private:
+    // a scope is the control block body or the body of an if
+    struct Scope{
+        int parent;
+        std::vector<int> slots;
+        std::vector<int> children;
+        std::unordered_map<std::string, int> names;
+    };
+
+    FrameLayout* current = nullptr;
+    std::vector<Scope> scopes;
+    std::vector<int> scopeStack;
+    // slots a name resolves to in the open scopes, innermost last
+    std::unordered_map<std::string, std::vector<int>> visible;
+
+    // union find over slots for condition affinity
+    std::vector<int> groupParent;
+
+    std::vector<std::string> errors;
+
+    void reportError(int line, int col, const std::string& msg);
+
+    // resolution walk
+    void collectStatements(const std::vector<std::unique_ptr<StatementNode>>& statements);
+    // declarations and assignments, collectStatements opens the if bodies
+    void collectStatement(const StatementNode* statement);
+    void collectExpression(const ExpressionNode* expr, std::vector<int>* reads);
+    void collectFactor(const FactorNode* factor, std::vector<int>* reads);
+    int lookup(const std::string& name);
+
+    int findGroup(int slot);
+    void joinGroups(int a, int b);
+
+    // packing walk, returns the end offset of the scope itself
+    size_t placeScope(int scope, size_t base);
+
+    public:
+    FrameLayoutPass();
+
+    // computes one layout per control block
+    std::vector<FrameLayout> layoutProgram(const ProgramNode* program);
+    FrameLayout layoutControlBlock(const ControlNode* control);
+
+    const std::vector<std::string>& getErrors();
+};
+
+size_t typeSize(TypeTag t);
+TypeTag declTypeToTag(TokenType t);
+
+// Prints the layout report
+// one "frame" line per control block followed by one "slot" line per variable
+// frame <block> size <bytes> alloc <bytes> slots <count> scopes <count>
+// scope <id> parent <id>
+// slot <offset> <size> <type> <name> scope <id> group <id> line <line>
+void printFrameLayouts(const std::vector<FrameLayout>& layouts, std::ostream& out = std::cout);
+
+#endif // FRAME_LAYOUT_H
@@ -0,0 +1,747 @@
+#include "image.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../runtime/checksum.h"
+#include "../runtime/compiler.h"
+#include "../runtime/decisionTable.h"
+#include "../typeChecker/typechecker.h"
+
+// the records are read in place, their layout is part of the format
+static_assert(sizeof(ImageHeader) == 136, "ImageHeader layout changed");
+static_assert(sizeof(ImageBlock) == 176, "ImageBlock layout changed");
+static_assert(sizeof(ImageSlot) == 40, "ImageSlot layout changed");
+static_assert(sizeof(ImageSignal) == 24, "ImageSignal layout changed");
+static_assert(sizeof(Instr) == 8 && offsetof(Instr, arg) == 4, "Instr layout changed");
+static_assert(sizeof(CodeSite) == 12 && sizeof(SignalLink) == 16, "CodeSite or SignalLink layout changed");
+
+// every table starts on an 8 byte boundary
+static constexpr size_t IMAGE_ALIGN = 8;
+
+static uint64_t imageChecksum(const uint8_t* data, size_t size){
+    ImageHeader head;
+    std::memcpy(&head, data, sizeof(head));
+    head.checksum = 0;
+    uint64_t h = hashBytes(reinterpret_cast<const uint8_t*>(&head), sizeof(head), 0);
+    return hashBytes(data + sizeof(head), size - sizeof(head), h);
+}
+
+// ---- writing ----
+
+namespace {
+
+class ImageWriter{
+    private:
+    std::vector<uint8_t>& out;
+    std::vector<char> strings;
+    std::unordered_map<std::string, uint32_t> stringAt;
+
+    public:
+    explicit ImageWriter(std::vector<uint8_t>& buffer) : out(buffer){}
+
+    void align(){
+        out.resize((out.size() + IMAGE_ALIGN - 1) / IMAGE_ALIGN * IMAGE_ALIGN, 0);
+    }
+
+    // reserves zeroed space for count records, returns its offset
+    uint64_t reserve(size_t bytes){
+        align();
+        uint64_t at = out.size();
+        out.resize(out.size() + bytes, 0);
+        return at;
+    }
+
+    template<typename T>
+    ImageRange append(const T* data, size_t count){
+        ImageRange range{reserve(count * sizeof(T)), count};
+        if(count) std::memcpy(out.data() + range.offset, data, count * sizeof(T));
+        return range;
+    }
+
+    ImageRange appendInts(const std::vector<int>& values){
+        std::vector<int32_t> v(values.begin(), values.end());
+        return append(v.data(), v.size());
+    }
+
+    ImageRange appendCode(const std::vector<Instr>& code){
+        // written field by field, the padding after the opcode is zero and the checksum stable
+        ImageRange range{reserve(code.size() * sizeof(Instr)), code.size()};
+        for(size_t i = 0; i < code.size(); i++){
+            uint8_t* at = out.data() + range.offset + i * sizeof(Instr);
+            std::memcpy(at + offsetof(Instr, op), &code[i].op, sizeof(OpCode));
+            std::memcpy(at + offsetof(Instr, arg), &code[i].arg, sizeof(int32_t));
+        }
+        return range;
+    }
+
+    uint32_t name(const std::string& s){
+        auto it = stringAt.find(s);
+        if(it != stringAt.end()) return it->second;
+        uint32_t at = static_cast<uint32_t>(strings.size());
+        strings.insert(strings.end(), s.begin(), s.end());
+        strings.push_back('\0');
+        stringAt.emplace(s, at);
+        return at;
+    }
+
+    ImageRange appendStrings(){
+        return append(strings.data(), strings.size());
+    }
+
+    template<typename T>
+    T* at(uint64_t offset){ return reinterpret_cast<T*>(out.data() + offset); }
+};
+
+}
+
+void writeImage(const CompiledProgram& program, std::vector<uint8_t>& out){
+    out.clear();
+    ImageWriter writer(out);
+    ImageHeader head{};
+    writer.reserve(sizeof(ImageHeader));
+    head.blocks = {writer.reserve(program.blocks.size() * sizeof(ImageBlock)), program.blocks.size()};
+    head.signals = {writer.reserve(program.signals.size() * sizeof(ImageSignal)), program.signals.size()};
+
+    // the tables are filled as the arrays they point to are appended, out may move meanwhile
+    for(size_t b = 0; b < program.blocks.size(); b++){
+        const CompiledBlock& block = program.blocks[b];
+        ImageBlock entry{};
+        entry.name = writer.name(block.name);
+        entry.maxStack = static_cast<uint32_t>(block.maxStack);
+        entry.frameSize = block.layout.frameSize;
+        entry.allocSize = block.layout.allocSize;
+        entry.reusedExpressions = block.reusedExpressions;
+        entry.removedInstructions = block.removedInstructions;
+        entry.code = writer.appendCode(block.code);
+
+        std::vector<ImageSlot> slots;
+        for(const auto& slot : block.layout.slots){
+            ImageSlot s{};
+            s.name = writer.name(slot.name);
+            s.type = static_cast<int32_t>(slot.type);
+            s.offset = slot.offset;
+            s.size = slot.size;
+            s.scope = slot.scope;
+            s.group = slot.group;
+            s.line = slot.line;
+            s.col = slot.col;
+            slots.push_back(s);
+        }
+        entry.slots = writer.append(slots.data(), slots.size());
+        entry.scopeParent = writer.appendInts(block.layout.scopeParent);
+        entry.sites = writer.append(block.sites.data(), block.sites.size());
+        entry.inputs = writer.appendInts(block.inputs);
+        entry.outputs = writer.appendInts(block.outputs);
+        entry.imports = writer.append(block.imports.data(), block.imports.size());
+        entry.exports = writer.append(block.exports.data(), block.exports.size());
+        entry.slotSignal = writer.appendInts(block.slotSignal);
+        std::memcpy(writer.at<ImageBlock>(head.blocks.offset) + b, &entry, sizeof(entry));
+    }
+
+    for(size_t s = 0; s < program.signals.size(); s++){
+        const Signal& signal = program.signals[s];
+        std::vector<ImageCopy> copies;
+        for(const auto& copy : signal.copies) copies.push_back({copy.first, copy.second});
+        ImageSignal entry{};
+        entry.name = writer.name(signal.name);
+        entry.type = static_cast<int32_t>(signal.type);
+        entry.copies = writer.append(copies.data(), copies.size());
+        std::memcpy(writer.at<ImageSignal>(head.signals.offset) + s, &entry, sizeof(entry));
+    }
+
+    std::vector<uint64_t> offsets(program.frameOffsets.begin(), program.frameOffsets.end());
+    head.order = writer.append(program.order.data(), program.order.size());
+    head.frameOffsets = writer.append(offsets.data(), offsets.size());
+    head.strings = writer.appendStrings();
+    writer.align();
+
+    std::memcpy(head.magic, IMAGE_MAGIC, sizeof(head.magic));
+    head.version = IMAGE_VERSION;
+    head.byteOrder = IMAGE_BYTE_ORDER;
+    head.wordSize = sizeof(size_t);
+    head.fileSize = out.size();
+    head.fracBits = program.fracBits;
+    head.blockCount = static_cast<uint32_t>(program.blocks.size());
+    head.signalCount = static_cast<uint32_t>(program.signals.size());
+    head.totalFrameBytes = program.totalFrameBytes;
+    std::memcpy(out.data(), &head, sizeof(head));
+    head.checksum = imageChecksum(out.data(), out.size());
+    std::memcpy(out.data(), &head, sizeof(head));
+}
+
+bool saveImage(const CompiledProgram& program, const std::string& path, std::string& error){
+    std::vector<uint8_t> bytes;
+    writeImage(program, bytes);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0){
+        error = "cannot create " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    size_t done = 0;
+    while(done < bytes.size()){
+        ssize_t n = ::write(fd, bytes.data() + done, bytes.size() - done);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0){
+            error = "cannot write " + path + ": " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    if(::close(fd) != 0){
+        error = "cannot write " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool compileImage(const std::string& source, const std::string& path, std::vector<std::string>& errors,
+                  std::vector<std::string>* warnings){
+    Lexer lexer(source);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    errors = lexer.getErrors();
+    for(const auto& err : parser.getErrors()) errors.push_back(err);
+    if(!errors.empty()) return false;
+
+    // an image is deployed as is, nothing the type checker rejects goes into one
+    TypeChecker checker;
+    if(!checker.checkProgram(program.get())){
+        errors = checker.getErrors();
+        return false;
+    }
+
+    Compiler compiler;
+    CompiledProgram compiled = compiler.compileProgram(program.get());
+    errors = compiler.getErrors();
+    if(warnings){
+        for(const auto& w : compiler.getWarnings()) warnings->push_back(w);
+    }
+    if(!errors.empty()) return false;
+
+    std::string error;
+    if(!saveImage(compiled, path, error)){
+        errors.push_back(error);
+        return false;
+    }
+    return true;
+}
+
+// ---- loading ----
+
+ProgramImage::~ProgramImage(){
+    close();
+}
+
+void ProgramImage::close(){
+    if(map) munmap(map, size);
+    map = nullptr;
+    base = nullptr;
+    size = 0;
+    head = nullptr;
+    blockTable = nullptr;
+    signalTable = nullptr;
+    strings = nullptr;
+}
+
+bool ProgramImage::open(const std::string& path, std::string& error, bool verifyChecksum){
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(ImageHeader))){
+        error = path + " is too small to be an image";
+        ::close(fd);
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(st.st_size);
+    // private and read only: the pages come straight from the page cache
+    void* m = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if(m == MAP_FAILED){
+        error = "cannot map " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    if(!attach(static_cast<const uint8_t*>(m), bytes, error, verifyChecksum)){
+        munmap(m, bytes);
+        error = path + ": " + error;
+        return false;
+    }
+    map = m;
+    return true;
+}
+
+bool ProgramImage::attach(const uint8_t* data, size_t bytes, std::string& error, bool verifyChecksum){
+    close();
+    base = data;
+    size = bytes;
+    if(!validate(error, verifyChecksum)){
+        // attach() never owns a mapping, open() unmaps its own
+        base = nullptr;
+        size = 0;
+        head = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// count records of elem bytes at range.offset fit into the file, checked without overflowing
+static bool inFile(const ImageRange& range, size_t elem, size_t fileSize){
+    if(range.offset % IMAGE_ALIGN != 0 || range.offset > fileSize) return false;
+    return range.count <= (fileSize - range.offset) / elem;
+}
+
+// values popped and pushed by every opcode
+static bool stackEffect(OpCode op, int& pops, int& pushes){
+    switch(op){
+        case OpCode::PUSH_I: case OpCode::PUSH_F: case OpCode::PUSH_B:
+        case OpCode::LOAD_I: case OpCode::LOAD_F: case OpCode::LOAD_B:
+            pops = 0; pushes = 1; return true;
+        case OpCode::STORE_I: case OpCode::STORE_F: case OpCode::STORE_B:
+        case OpCode::JUMP_IF_FALSE: case OpCode::JUMP_IF_TRUE:
+            pops = 1; pushes = 0; return true;
+        case OpCode::TEE_I: case OpCode::TEE_F:
+        case OpCode::I2F: case OpCode::I2Q:
+            pops = 1; pushes = 1; return true;
+        case OpCode::I2F_UNDER: case OpCode::I2Q_UNDER:
+            pops = 2; pushes = 2; return true;
+        case OpCode::ADD_I: case OpCode::SUB_I: case OpCode::ADD_F: case OpCode::SUB_F:
+        case OpCode::GT_I: case OpCode::GT_F: case OpCode::EQ_I: case OpCode::EQ_F: case OpCode::EQ_B:
+            pops = 2; pushes = 1; return true;
+        case OpCode::JUMP: case OpCode::TABLE: case OpCode::END:
+            pops = 0; pushes = 0; return true;
+        case OpCode::DATA:
+            return false;
+    }
+    return false;
+}
+
+// where execution may continue after an instruction, the jump target unchecked
+static size_t successorsOf(const Instr& instr, size_t pc, size_t successors[2]){
+    size_t count = 0;
+    if(instr.op == OpCode::END) return 0;
+    if(instr.op == OpCode::TABLE){
+        // over its data words
+        successors[count++] = pc + 1 + static_cast<size_t>(static_cast<uint32_t>(instr.arg));
+        return count;
+    }
+    if(instr.op == OpCode::JUMP || instr.op == OpCode::JUMP_IF_FALSE || instr.op == OpCode::JUMP_IF_TRUE){
+        successors[count++] = static_cast<size_t>(static_cast<uint32_t>(instr.arg));
+    }
+    if(instr.op != OpCode::JUMP) successors[count++] = pc + 1;
+    return count;
+}
+
+// bytes a frame access touches, 0 for opcodes that do not access the frame
+static size_t frameAccess(OpCode op){
+    switch(op){
+        case OpCode::LOAD_I: case OpCode::LOAD_F: case OpCode::STORE_I: case OpCode::STORE_F:
+        case OpCode::TEE_I: case OpCode::TEE_F:
+            return sizeof(int32_t);
+        case OpCode::LOAD_B: case OpCode::STORE_B:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+bool ProgramImage::validate(std::string& error, bool verifyChecksum){
+    if(reinterpret_cast<uintptr_t>(base) % IMAGE_ALIGN != 0){
+        error = "image is not 8 byte aligned in memory";
+        return false;
+    }
+    if(size < sizeof(ImageHeader)){
+        error = "too small to be an image";
+        return false;
+    }
+    const ImageHeader* h = reinterpret_cast<const ImageHeader*>(base);
+    if(std::memcmp(h->magic, IMAGE_MAGIC, sizeof(h->magic)) != 0){
+        error = "not an AutoLang image";
+        return false;
+    }
+    if(h->byteOrder != IMAGE_BYTE_ORDER){
+        error = "image was written on a machine of the other byte order";
+        return false;
+    }
+    if(h->version != IMAGE_VERSION){
+        error = "image version " + std::to_string(h->version) + ", expected " + std::to_string(IMAGE_VERSION);
+        return false;
+    }
+    if(h->wordSize != sizeof(size_t)){
+        error = "image was written for " + std::to_string(h->wordSize * 8) + " bit frame offsets";
+        return false;
+    }
+    if(h->fileSize != size){
+        error = "image is " + std::to_string(size) + " bytes, its header says " + std::to_string(h->fileSize);
+        return false;
+    }
+    if(verifyChecksum && imageChecksum(base, size) != h->checksum){
+        error = "checksum mismatch, the image is corrupt";
+        return false;
+    }
+    if(h->fracBits != FIXED_POINT_OFF && (h->fracBits < 0 || h->fracBits > MAX_FRAC_BITS)){
+        error = "bad fixed point format";
+        return false;
+    }
+
+    if(h->blocks.count != h->blockCount || h->order.count != h->blockCount || h->frameOffsets.count != h->blockCount
+       || h->signals.count != h->signalCount
+       || !inFile(h->blocks, sizeof(ImageBlock), size) || !inFile(h->signals, sizeof(ImageSignal), size)
+       || !inFile(h->order, sizeof(uint32_t), size) || !inFile(h->frameOffsets, sizeof(size_t), size)
+       || !inFile(h->strings, 1, size)){
+        error = "program tables are outside the image";
+        return false;
+    }
+    if(h->strings.count > UINT32_MAX || (h->strings.count && base[h->strings.offset + h->strings.count - 1] != '\0')){
+        error = "name table is not terminated";
+        return false;
+    }
+    head = h;
+    blockTable = array<ImageBlock>(h->blocks);
+    signalTable = array<ImageSignal>(h->signals);
+    strings = reinterpret_cast<const char*>(base + h->strings.offset);
+
+    // order runs every block exactly once
+    std::vector<uint8_t> ordered(h->blockCount, 0);
+    const uint32_t* ord = order();
+    for(size_t i = 0; i < h->blockCount; i++){
+        if(ord[i] >= h->blockCount || ordered[ord[i]]++){
+            error = "block order is not a permutation";
+            return false;
+        }
+    }
+
+    // scratch space of the stack depth check, shared by every block
+    std::vector<int> depth;
+    std::vector<size_t> work;
+    for(size_t b = 0; b < h->blockCount; b++){
+        if(!validateBlock(b, depth, work, error)){
+            error = "block " + std::to_string(b) + ": " + error;
+            return false;
+        }
+    }
+
+    // frames follow each other as the compiler lays them out
+    // (validateBlock already bounded each frame by what its slots and code use)
+    uint64_t frameEnd = 0;
+    for(size_t b = 0; b < h->blockCount; b++){
+        const ImageBlock& block = blockTable[b];
+        if(frameOffsets()[b] != frameEnd || block.allocSize % CACHE_LINE_SIZE != 0){
+            error = "block " + std::to_string(b) + ": frame does not follow the compiler's layout";
+            return false;
+        }
+        frameEnd += block.allocSize;
+    }
+    if(frameEnd != h->totalFrameBytes){
+        error = "frame buffer size does not match the frames";
+        return false;
+    }
+
+    for(size_t s = 0; s < h->signalCount; s++){
+        const ImageSignal& signal = signalTable[s];
+        if(signal.name >= h->strings.count || !inFile(signal.copies, sizeof(ImageCopy), size)){
+            error = "signal " + std::to_string(s) + " is outside the image";
+            return false;
+        }
+        const ImageCopy* copies = array<ImageCopy>(signal.copies);
+        for(size_t c = 0; c < signal.copies.count; c++){
+            if(copies[c].block >= h->blockCount || copies[c].slot < 0
+               || static_cast<uint64_t>(copies[c].slot) >= blockTable[copies[c].block].slots.count){
+                error = "signal " + std::to_string(s) + " names a slot that does not exist";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool ProgramImage::validateBlock(size_t b, std::vector<int>& depth, std::vector<size_t>& work, std::string& error){
+    const ImageBlock& block = blockTable[b];
+    if(block.name >= head->strings.count
+       || !inFile(block.code, sizeof(Instr), size) || !inFile(block.slots, sizeof(ImageSlot), size)
+       || !inFile(block.scopeParent, sizeof(int32_t), size) || !inFile(block.sites, sizeof(CodeSite), size)
+       || !inFile(block.inputs, sizeof(int32_t), size) || !inFile(block.outputs, sizeof(int32_t), size)
+       || !inFile(block.imports, sizeof(SignalLink), size) || !inFile(block.exports, sizeof(SignalLink), size)
+       || !inFile(block.slotSignal, sizeof(int32_t), size)){
+        error = "tables are outside the image";
+        return false;
+    }
+
+    size_t frameStart = frameOffsets()[b];
+    if(frameStart % CACHE_LINE_SIZE != 0 || block.allocSize > head->totalFrameBytes
+       || frameStart > head->totalFrameBytes - block.allocSize || block.frameSize > block.allocSize){
+        error = "frame is outside the frame buffer";
+        return false;
+    }
+
+    // the furthest byte a slot or the code touches, the frame may not ask for more memory than that
+    // (value numbering temporaries live past the slots and only show up in the code)
+    uint64_t reach = 0;
+    const ImageSlot* slots = array<ImageSlot>(block.slots);
+    for(size_t s = 0; s < block.slots.count; s++){
+        if(slots[s].name >= head->strings.count || slots[s].type < 0 || slots[s].type > static_cast<int32_t>(TypeTag::TYPE_ERROR)
+           || slots[s].size > block.allocSize || slots[s].offset > block.allocSize - slots[s].size){
+            error = "slot " + std::to_string(s) + " is outside the frame";
+            return false;
+        }
+        reach = std::max<uint64_t>(reach, slots[s].offset + slots[s].size);
+    }
+    auto slotIndex = [&](int32_t v, bool allowNone){
+        return (allowNone && v == -1) || (v >= 0 && static_cast<uint64_t>(v) < block.slots.count);
+    };
+    const int32_t* ints = array<int32_t>(block.inputs);
+    for(size_t i = 0; i < block.inputs.count; i++) if(!slotIndex(ints[i], false)) { error = "bad input slot"; return false; }
+    ints = array<int32_t>(block.outputs);
+    for(size_t i = 0; i < block.outputs.count; i++) if(!slotIndex(ints[i], false)) { error = "bad output slot"; return false; }
+    ints = array<int32_t>(block.scopeParent);
+    for(size_t i = 0; i < block.scopeParent.count; i++){
+        if(ints[i] < -1 || ints[i] >= static_cast<int64_t>(block.scopeParent.count)){
+            error = "bad scope parent";
+            return false;
+        }
+    }
+    if(block.slotSignal.count != 0 && block.slotSignal.count != block.slots.count){
+        error = "slot signal table does not match the slots";
+        return false;
+    }
+    ints = array<int32_t>(block.slotSignal);
+    for(size_t i = 0; i < block.slotSignal.count; i++){
+        if(ints[i] < -1 || ints[i] >= static_cast<int64_t>(head->signalCount)){
+            error = "bad slot signal";
+            return false;
+        }
+    }
+    for(const ImageRange* links : {&block.imports, &block.exports}){
+        const SignalLink* link = array<SignalLink>(*links);
+        for(size_t i = 0; i < links->count; i++){
+            if(link[i].signal >= head->signalCount || link[i].size > sizeof(uint32_t) || link[i].size > block.allocSize
+               || link[i].slotOffset > block.allocSize - link[i].size){
+                error = "signal link is outside the frame or the bus";
+                return false;
+            }
+        }
+    }
+
+    // the interpreter trusts the code: every access stays in the frame, every jump in the block,
+    // and the stack depth at every pc is the same on every path and fits MAX_STACK_DEPTH
+    const Instr* code = array<Instr>(block.code);
+    size_t count = block.code.count;
+    if(count == 0 || code[count - 1].op != OpCode::END){
+        error = "code does not end with END";
+        return false;
+    }
+    const CodeSite* sites = array<CodeSite>(block.sites);
+    for(size_t i = 0; i < block.sites.count; i++){
+        if(sites[i].pc >= count || !slotIndex(sites[i].slot, true)){
+            error = "bad code site";
+            return false;
+        }
+    }
+    depth.assign(count, -1);
+    work.assign(1, 0);
+    depth[0] = 0;
+    while(!work.empty()){
+        size_t pc = work.back();
+        work.pop_back();
+        const Instr& instr = code[pc];
+        int pops, pushes;
+        if(instr.op == OpCode::DATA){
+            error = "pc " + std::to_string(pc) + " runs into the data of a decision table";
+            return false;
+        }
+        if(!stackEffect(instr.op, pops, pushes)){
+            error = "unknown opcode at pc " + std::to_string(pc);
+            return false;
+        }
+        size_t bytes = frameAccess(instr.op);
+        if(bytes && (instr.arg < 0 || bytes > block.allocSize || static_cast<uint64_t>(instr.arg) > block.allocSize - bytes)){
+            error = "pc " + std::to_string(pc) + " accesses outside the frame";
+            return false;
+        }
+        if(bytes) reach = std::max<uint64_t>(reach, static_cast<uint64_t>(instr.arg) + bytes);
+        if((instr.op == OpCode::I2Q || instr.op == OpCode::I2Q_UNDER) && (instr.arg < 0 || instr.arg > 31)){
+            error = "pc " + std::to_string(pc) + " shifts by " + std::to_string(instr.arg);
+            return false;
+        }
+        if(instr.op == OpCode::TABLE){
+            if(instr.arg < 0 || static_cast<uint64_t>(instr.arg) >= count - pc - 1){
+                error = "code runs past its end";
+                return false;
+            }
+            if(!checkDecisionTable(code + pc + 1, instr.arg, block.allocSize, error)){
+                error = "pc " + std::to_string(pc) + ": " + error;
+                return false;
+            }
+        }
+        int d = depth[pc];
+        if(d < pops || d - pops + pushes > MAX_STACK_DEPTH){
+            error = "pc " + std::to_string(pc) + " leaves the value stack";
+            return false;
+        }
+        int next = d - pops + pushes;
+        if(instr.op == OpCode::END) continue;
+
+        if(instr.op == OpCode::JUMP || instr.op == OpCode::JUMP_IF_FALSE || instr.op == OpCode::JUMP_IF_TRUE){
+            if(instr.arg < 0 || static_cast<uint64_t>(instr.arg) >= count){
+                error = "pc " + std::to_string(pc) + " jumps outside the block";
+                return false;
+            }
+        }
+        size_t successors[2];
+        size_t successorCount = successorsOf(instr, pc, successors);
+        for(size_t i = 0; i < successorCount; i++){
+            size_t to = successors[i];
+            if(to >= count){
+                error = "code runs past its end";
+                return false;
+            }
+            if(depth[to] == -1){
+                depth[to] = next;
+                work.push_back(to);
+            }
+            else if(depth[to] != next){
+                error = "stack depth differs between paths into pc " + std::to_string(to);
+                return false;
+            }
+        }
+    }
+
+    // the language has no loops, so the jumps must not form one or a block might never end.
+    // Cold if bodies jump back (profile/PROFILE.md), so this is a topological sort of the
+    // reachable code rather than a check that every jump goes forward; depth becomes the in-degree
+    size_t reachable = 0;
+    for(size_t pc = 0; pc < count; pc++){
+        if(depth[pc] != -1){
+            depth[pc] = 0;
+            reachable++;
+        }
+    }
+    for(size_t pc = 0; pc < count; pc++){
+        if(depth[pc] == -1) continue;
+        size_t successors[2];
+        size_t successorCount = successorsOf(code[pc], pc, successors);
+        for(size_t i = 0; i < successorCount; i++) depth[successors[i]]++;
+    }
+    size_t sorted = 0;
+    work.clear();
+    if(depth[0] == 0) work.push_back(0);
+    while(!work.empty()){
+        size_t pc = work.back();
+        work.pop_back();
+        sorted++;
+        size_t successors[2];
+        size_t successorCount = successorsOf(code[pc], pc, successors);
+        for(size_t i = 0; i < successorCount; i++){
+            if(--depth[successors[i]] == 0) work.push_back(successors[i]);
+        }
+    }
+    if(sorted != reachable){
+        error = "the jumps of the code form a loop";
+        return false;
+    }
+
+    uint64_t lines = std::max<uint64_t>(1, (reach + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE);
+    if(block.allocSize > lines * CACHE_LINE_SIZE){
+        error = "frame of " + std::to_string(block.allocSize) + " bytes is larger than its slots and code use";
+        return false;
+    }
+    return true;
+}
+
+int ProgramImage::findTopLevelSlot(size_t b, const std::string& name) const{
+    const ImageBlock& entry = blockTable[b];
+    const ImageSlot* slots = array<ImageSlot>(entry.slots);
+    for(size_t s = 0; s < entry.slots.count; s++){
+        if(slots[s].scope == 0 && name == strings + slots[s].name) return static_cast<int>(s);
+    }
+    return -1;
+}
+
+template<typename T>
+static void copyInts(const ProgramImage& image, const ImageRange& range, std::vector<T>& out){
+    const int32_t* values = image.array<int32_t>(range);
+    out.assign(values, values + range.count);
+}
+
+void ProgramImage::toProgram(CompiledProgram& program) const{
+    program = CompiledProgram();
+    program.fracBits = head->fracBits;
+    program.totalFrameBytes = head->totalFrameBytes;
+    program.order.assign(order(), order() + head->blockCount);
+    program.frameOffsets.assign(frameOffsets(), frameOffsets() + head->blockCount);
+
+    program.blocks.resize(head->blockCount);
+    for(size_t b = 0; b < head->blockCount; b++){
+        const ImageBlock& entry = blockTable[b];
+        CompiledBlock& block = program.blocks[b];
+        block.name = name(entry.name);
+        block.maxStack = static_cast<int>(entry.maxStack);
+        block.reusedExpressions = entry.reusedExpressions;
+        block.removedInstructions = entry.removedInstructions;
+        block.code.assign(array<Instr>(entry.code), array<Instr>(entry.code) + entry.code.count);
+        block.sites.assign(array<CodeSite>(entry.sites), array<CodeSite>(entry.sites) + entry.sites.count);
+        block.imports.assign(array<SignalLink>(entry.imports), array<SignalLink>(entry.imports) + entry.imports.count);
+        block.exports.assign(array<SignalLink>(entry.exports), array<SignalLink>(entry.exports) + entry.exports.count);
+        copyInts(*this, entry.inputs, block.inputs);
+        copyInts(*this, entry.outputs, block.outputs);
+        copyInts(*this, entry.slotSignal, block.slotSignal);
+
+        block.layout.blockName = block.name;
+        block.layout.frameSize = entry.frameSize;
+        block.layout.allocSize = entry.allocSize;
+        copyInts(*this, entry.scopeParent, block.layout.scopeParent);
+        const ImageSlot* slots = array<ImageSlot>(entry.slots);
+        for(size_t s = 0; s < entry.slots.count; s++){
+            FrameSlot slot;
+            slot.name = name(slots[s].name);
+            slot.type = static_cast<TypeTag>(slots[s].type);
+            slot.offset = slots[s].offset;
+            slot.size = slots[s].size;
+            slot.scope = slots[s].scope;
+            slot.group = slots[s].group;
+            slot.line = slots[s].line;
+            slot.col = slots[s].col;
+            block.layout.slots.push_back(slot);
+        }
+    }
+
+    program.signals.resize(head->signalCount);
+    for(size_t s = 0; s < head->signalCount; s++){
+        const ImageSignal& entry = signalTable[s];
+        Signal& signal = program.signals[s];
+        signal.name = name(entry.name);
+        signal.type = static_cast<TypeTag>(entry.type);
+        const ImageCopy* copies = array<ImageCopy>(entry.copies);
+        for(size_t c = 0; c < entry.copies.count; c++) signal.copies.push_back({copies[c].block, copies[c].slot});
+    }
+}
+
+void runImage(const ProgramImage& image, FrameStore& frames){
+    uint8_t* bus = frames.bus();
+    const uint32_t* order = image.order();
+    for(size_t i = 0; i < image.blockCount(); i++){
+        uint32_t b = order[i];
+        const ImageBlock& block = image.block(b);
+        uint8_t* frame = frames.frame(b);
+        const SignalLink* imports = image.array<SignalLink>(block.imports);
+        for(size_t l = 0; l < block.imports.count; l++){
+            std::memcpy(frame + imports[l].slotOffset, bus + imports[l].signal * sizeof(uint32_t), imports[l].size);
+        }
+        runCode(image.array<Instr>(block.code), frame);
+        const SignalLink* exports = image.array<SignalLink>(block.exports);
+        for(size_t l = 0; l < block.exports.count; l++){
+            std::memcpy(bus + exports[l].signal * sizeof(uint32_t), frame + exports[l].slotOffset, exports[l].size);
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#ifndef IMAGE_IMAGE_H
+#define IMAGE_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../runtime/bytecode.h"
+#include "../runtime/interpreter.h"
+
+// A compiled program as one position independent file (".alc", see IMAGE.md).
+// Every table is at a file offset and holds plain records the interpreter reads
+// in place, so a mapped image runs without being deserialized.
+
+constexpr char IMAGE_MAGIC[4] = {'A', 'L', 'C', 'I'};
+constexpr uint32_t IMAGE_VERSION = 3;
+// written as is, reads back differently on a machine of the other byte order
+constexpr uint32_t IMAGE_BYTE_ORDER = 0x01020304;
+
+// count records starting at a file offset
+struct ImageRange{
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct ImageHeader{
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t wordSize;        // sizeof(size_t) of the writer, frame offsets are read as size_t
+    uint64_t fileSize;
+    uint64_t checksum;        // of the whole file, this field counted as 0
+    int32_t fracBits;
+    uint32_t blockCount;
+    uint32_t signalCount;
+    uint32_t reserved;
+    uint64_t totalFrameBytes;
+    ImageRange blocks;        // ImageBlock
+    ImageRange signals;       // ImageSignal
+    ImageRange order;         // uint32_t, blocks in dependency order
+    ImageRange frameOffsets;  // size_t, where every block's frame starts
+    ImageRange strings;       // NUL terminated names, referenced by their offset in here
+};
+
+struct ImageBlock{
+    uint32_t name;
+    uint32_t maxStack;
+    uint64_t frameSize;
+    uint64_t allocSize;
+    int32_t reusedExpressions;
+    int32_t removedInstructions;
+    ImageRange code;          // Instr
+    ImageRange slots;         // ImageSlot
+    ImageRange scopeParent;   // int32_t
+    ImageRange sites;         // CodeSite
+    ImageRange inputs;        // int32_t
+    ImageRange outputs;       // int32_t
+    ImageRange imports;       // SignalLink
+    ImageRange exports;       // SignalLink
+    ImageRange slotSignal;    // int32_t
+};
+
+struct ImageSlot{
+    uint32_t name;
+    int32_t type;             // TypeTag
+    uint64_t offset;
+    uint64_t size;
+    int32_t scope;
+    int32_t group;
+    int32_t line;
+    int32_t col;
+};
+
+struct ImageCopy{
+    uint32_t block;
+    int32_t slot;
+};
+
+struct ImageSignal{
+    uint32_t name;
+    int32_t type;             // TypeTag
+    ImageRange copies;        // ImageCopy
+};
+
+// Lays a compiled program out as an image
+void writeImage(const CompiledProgram& program, std::vector<uint8_t>& out);
+bool saveImage(const CompiledProgram& program, const std::string& path, std::string& error);
+
+// Lexes, parses, type checks and compiles source and saves the image,
+// what `autolangparser <file> <mode> --image=<file.alc>` does
+bool compileImage(const std::string& source, const std::string& path, std::vector<std::string>& errors,
+                  std::vector<std::string>* warnings = nullptr);
+
+// A validated, read only image: mapped from a file or attached to bytes the caller keeps alive.
+// Validation checks the header, the checksum (unless turned off), that every table and name
+// is inside the file and that the code never leaves its frame, its stack or its block,
+// so a corrupt or hostile file is rejected instead of being run.
+class ProgramImage{
+    private:
+    const uint8_t* base = nullptr;
+    size_t size = 0;
+    void* map = nullptr;
+
+    const ImageHeader* head = nullptr;
+    const ImageBlock* blockTable = nullptr;
+    const ImageSignal* signalTable = nullptr;
+    const char* strings = nullptr;
+
+    bool validate(std::string& error, bool verifyChecksum);
+    bool validateBlock(size_t b, std::vector<int>& depth, std::vector<size_t>& work, std::string& error);
+
+    public:
+    ProgramImage() = default;
+    ~ProgramImage();
+    ProgramImage(const ProgramImage&) = delete;
+    ProgramImage& operator=(const ProgramImage&) = delete;
+
+    bool open(const std::string& path, std::string& error, bool verifyChecksum = true);
+    bool attach(const uint8_t* data, size_t bytes, std::string& error, bool verifyChecksum = true);
+    void close();
+    bool isOpen() const { return head != nullptr; }
+
+    const ImageHeader& header() const { return *head; }
+    size_t blockCount() const { return head->blockCount; }
+    size_t signalCount() const { return head->signalCount; }
+    const ImageBlock& block(size_t b) const { return blockTable[b]; }
+    const ImageSignal& signal(size_t s) const { return signalTable[s]; }
+    const char* name(uint32_t offset) const { return strings + offset; }
+
+    template<typename T>
+    const T* array(const ImageRange& range) const { return reinterpret_cast<const T*>(base + range.offset); }
+
+    const uint32_t* order() const { return array<uint32_t>(head->order); }
+    const size_t* frameOffsets() const { return array<size_t>(head->frameOffsets); }
+    size_t totalFrameBytes() const { return head->totalFrameBytes; }
+    size_t busBytes() const { return head->signalCount * sizeof(uint32_t); }
+    int fracBits() const { return head->fracBits; }
+
+    // slot of a top level variable, -1 if the block does not declare it
+    int findTopLevelSlot(size_t block, const std::string& name) const;
+
+    // copies everything into a CompiledProgram, for tools that need one
+    // (the reactive and sharded runtimes, replay)
+    void toProgram(CompiledProgram& program) const;
+};
+
+// Runs every block of an image once in dependency order, straight from the mapping (one tick).
+// frames is a FrameStore(image.frameOffsets(), image.totalFrameBytes(), image.busBytes())
+void runImage(const ProgramImage& image, FrameStore& frames);
+
+#endif // IMAGE_IMAGE_H
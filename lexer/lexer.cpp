@@ -127,6 +127,12 @@ Token Lexer::lexNumber(){
 
 // getNextToken api
 Token Lexer::getNextToken(){
+    Token token = lexToken();
+    if(listener) listener->onToken(token);
+    return token;
+}
+
+Token Lexer::lexToken(){
     skipWhiteSpaceorComments();
 
     char ch = peek(0);
@@ -5,6 +5,15 @@
 #include<vector>
 #include<unordered_map>
 
+// Sees every token the lexer hands out, in order.
+// Lets the token table be printed while the parser pulls the same tokens,
+// so a fused run (-sp...) does not lex the source twice.
+class TokenListener{
+public:
+    virtual ~TokenListener() = default;
+    virtual void onToken(const Token& token) = 0;
+};
+
 class Lexer{
 private:
     std::string input;
@@ -12,6 +21,7 @@ private:
     int line, col;
     
     std::vector<std::string>errors;
+    TokenListener* listener = nullptr;
 
     static const std::unordered_map<std::string, TokenType> keywords;
 
@@ -19,6 +29,7 @@ private:
     char advance();
     void skipWhiteSpaceorComments();
 
+    Token lexToken();
     Token lexIdentifier();
     Token lexNumber();
     // Token lexBoolLiteral(); // already taken care in lexidentifier
@@ -33,6 +44,7 @@ private:
 public:
     Lexer(const std::string& src);
     Token getNextToken();
+    void setListener(TokenListener* l) { listener = l; }
     const std::vector<std::string>& getErrors();
 };
 
@@ -1,4 +1,5 @@
 #include <bits/stdc++.h>
+#include "symbol_table_printer.h"
 #include "../lexer.h"
 #include "../../parser/parser.h"
 #include "../../parser/ast.h"
@@ -9,42 +10,56 @@ using namespace std;
 // -----------------------------------------------------
 // Function: printTokens
 // -----------------------------------------------------
-void printTokens(const std::string& input) {
+void printTokens(const std::string& input, std::ostream& out) {
     Lexer lexer(input);
-    Token token = lexer.getNextToken();
+    TokenTablePrinter printer(out);
+    lexer.setListener(&printer);
+    while (lexer.getNextToken().type != TokenType::EOF_TOKEN) {
+    }
+    printer.finish(lexer.getErrors());
+}
 
-    std::cout << "ID\t\t" 
+// -----------------------------------------------------
+// TokenTablePrinter
+// -----------------------------------------------------
+// one row per token adds up to a lot of output, so it is buffered
+// and written in large chunks instead of flushed line by line
+TokenTablePrinter::TokenTablePrinter(std::ostream& stream) : out(stream) {
+    out << "ID\t\t" 
               << "TokenType\t\t" 
               << "Line[Col]\t\t" 
-              << "Symbol\t\t" << std::endl;
+              << "Symbol\t\t" << "\n";
+}
 
-    int idx = 0;
-    while (token.type != TokenType::EOF_TOKEN) {
-        std::cout << idx << "\t\t"
-                  << tokenTypeToString(token.type) << "\t\t"
-                  << token.line << "[" << token.col << "]\t\t\t";
-
-        // Print literal or lexeme
-        if (std::holds_alternative<int>(token.value))
-            std::cout << std::get<int>(token.value);
-        else if (std::holds_alternative<float>(token.value))
-            std::cout << std::get<float>(token.value);
-        else if (std::holds_alternative<bool>(token.value))
-            std::cout << std::boolalpha << std::get<bool>(token.value);
-        else
-            std::cout << token.lexeme;
+void TokenTablePrinter::onToken(const Token& token) {
+    if (ended || token.type == TokenType::EOF_TOKEN) {
+        ended = true;
+        return;
+    }
+    out << static_cast<unsigned long>(count) << "\t\t"
+              << tokenTypeName(token.type) << "\t\t"
+              << token.line << "[" << token.col << "]\t\t\t";
 
-        std::cout << std::endl;
+    // Print literal or lexeme
+    if (std::holds_alternative<int>(token.value))
+        out << std::get<int>(token.value);
+    else if (std::holds_alternative<float>(token.value))
+        out << std::get<float>(token.value);
+    else if (std::holds_alternative<bool>(token.value))
+        out.boolean(std::get<bool>(token.value));
+    else
+        out << token.lexeme;
 
-        token = lexer.getNextToken();
-        idx++;
-    }
+    out << "\n";
+    count++;
+}
 
+void TokenTablePrinter::finish(const std::vector<std::string>& errors) {
     // Print lexical errors, if any
-    const auto& errors = lexer.getErrors();
     if (!errors.empty()) {
-        std::cout << "\nLexical Errors:\n";
+        out << "\nLexical Errors:\n";
         for (const auto& e : errors)
-            std::cout << e << "\n";
+            out << e << "\n";
     }
-}
\ No newline at end of file
+    out.flush();
+}
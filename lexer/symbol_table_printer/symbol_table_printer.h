@@ -1,7 +1,12 @@
 #ifndef SYMBOL_TABLE_PRINTER_H
 #define SYMBOL_TABLE_PRINTER_H
 
+#include <iostream>
 #include <string>
+#include <vector>
+
+#include "../lexer.h"
+#include "../../output/outputBuffer.h"
 
 // -----------------------------------------------------
 // Function Declarations
@@ -9,6 +14,23 @@
 
 // Prints all tokens generated by the lexer along with
 // their type, line/column position, and symbol/lexeme value.
-void printTokens(const std::string& input);
+void printTokens(const std::string& input, std::ostream& out = std::cout);
+
+// The same table, one row per token as a lexer hands it out.
+// Attach it with Lexer::setListener() to print the tokens a parser is pulling;
+// finish() adds the lexical errors and flushes.
+class TokenTablePrinter : public TokenListener{
+    private:
+    OutputBuffer out;
+    uint64_t count = 0;
+    bool ended = false; // the parser may ask for EOF_TOKEN more than once
+
+    public:
+    explicit TokenTablePrinter(std::ostream& stream);
+    void onToken(const Token& token) override;
+    void finish(const std::vector<std::string>& errors);
+
+    uint64_t tokens() const { return count; }
+};
 
 #endif // SYMBOL_TABLE_PRINTER_H
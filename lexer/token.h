@@ -73,7 +73,8 @@ struct Token{
 
 };
 
-inline std::string tokenTypeToString(TokenType type) {
+// same names without building a std::string, for the hot output paths
+inline const char* tokenTypeName(TokenType type) {
     switch (type) {
         case TokenType::KW_CONTROL: return "KW_CONTROL";
         case TokenType::KW_TOKEN_SET: return "KW_TOKEN_SET";
@@ -99,4 +100,8 @@ inline std::string tokenTypeToString(TokenType type) {
     }
 }
 
+inline std::string tokenTypeToString(TokenType type) {
+    return tokenTypeName(type);
+}
+
 #endif
\ No newline at end of file
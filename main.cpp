@@ -1,88 +1,278 @@
 #include<bits/stdc++.h>
-#include "lexer/lexer.h"
-#include "parser/parser.h"
-#include "parser/ast.h"
 #include <string>
 
-#include "parser/astPrinter/astPrinter.h"
-#include "lexer/symbol_table_printer/symbol_table_printer.h"
-#include "typeChecker/typechecker.h"
+#include "driver/batch.h"
+#include "driver/driver.h"
+#include "image/image.h"
+#include "parser/parser.h"
+#include "profile/branchProfile.h"
+#include "runtime/compiler.h"
+#include "server/server.h"
+#include "stats/phaseStats.h"
+#include "xref/xref.h"
 
-int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <filename> <-s|-p>\n";
+// autolangparser --batch <mode> [-j N] [--summary] [--compare] [--max-nesting N] [files|dirs|-]
+static int batchMain(int argc, char* argv[]) {
+    BatchOptions options;
+    std::vector<std::string> args;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) options.jobs = std::atoi(argv[++i]);
+        else if (arg == "--summary") options.summary = true;
+        else if (arg == "--compare") options.compare = true;
+        else if (arg == "--max-nesting" && i + 1 < argc) Parser::setDefaultMaxNesting(std::atoi(argv[++i]));
+        else if (options.mode.empty() && isValidMode(arg)) options.mode = arg;
+        else args.push_back(arg);
+    }
+    if (options.mode.empty()) {
+        std::cerr << "ERROR :: --batch needs a mode: -s, -p, -t, -l or -b\n";
         return 1;
     }
 
-    std::string filename = argv[1];
-    std::string flag = argv[2];
+    // the comparison runs this very executable once per file
+    char self[4096];
+    ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (len > 0) options.self.assign(self, len);
 
-    std::ifstream file(filename);
-    if (!file) {
-        std::cerr << "ERROR :: FILE NOT FOUND :: " << filename << std::endl;
+    return runBatch(collectBatchFiles(args, std::cin), options);
+}
+
+// autolangparser --serve <socket> [-j maxClients] [--no-cache]
+static int serveMain(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "ERROR :: --serve needs a socket path\n";
         return 1;
     }
+    unsigned clients = 64;
+    bool caching = true;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) clients = std::atoi(argv[++i]);
+        else if (arg == "--no-cache") caching = false;
+    }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string input = buffer.str();
-
-    if (flag == "-s") {
-        // Print Tokens / Symbol Table
-        try {
-            printTokens(input);
-        } catch (const std::exception& e) {
-            std::cerr << "Error: " << e.what() << "\n";
-        }
-    } 
-    else if (flag == "-p") {
-        // Print AST Tree
-        try {
-            Lexer lexer(input);
-            Parser parser(lexer);
-            auto program = parser.parseProgram();
-
-            if (!parser.getErrors().empty()) {
-                std::cout << "Errors:\n";
-                for (const auto& err : parser.getErrors())
-                    std::cout << err << "\n";
-            } else {
-                printProgram(program.get());
-            }
+    CompileServer server(argv[2], clients);
+    server.setCaching(caching);
+    std::string error;
+    if (!server.start(error)) {
+        std::cerr << "ERROR :: " << error << "\n";
+        return 1;
+    }
+    std::cerr << "listening on " << argv[2] << "\n";
+    server.run();
+    return 0;
+}
+
+// autolangparser --query <index.alx|source> <name>... [--reads|--writes|--decls] [--in-condition] [--block <name>] [--time]
+static int queryMain(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::cerr << "ERROR :: --query needs an index (or a source file) and at least one name\n";
+        return 1;
+    }
+    std::string path = argv[2];
+    std::vector<std::string> names;
+    std::string block;
+    int kind = 0; // XrefKind to keep, 0 for all
+    bool inCondition = false, timed = false;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--reads") kind = static_cast<int>(XrefKind::READ);
+        else if (arg == "--writes") kind = static_cast<int>(XrefKind::WRITE);
+        else if (arg == "--decls") kind = static_cast<int>(XrefKind::DECLARATION);
+        else if (arg == "--in-condition") inCondition = true;
+        else if (arg == "--block" && i + 1 < argc) block = argv[++i];
+        else if (arg == "--time") timed = true;
+        else names.push_back(arg);
+    }
+
+    // a source file is indexed in memory first
+    XrefIndex index;
+    std::vector<uint8_t> built;
+    std::string error;
+    bool isIndex = path.size() > 4 && path.compare(path.size() - 4, 4, ".alx") == 0;
+    if (isIndex) {
+        if (!index.open(path, error)) {
+            std::cerr << "ERROR :: " << error << "\n";
+            return 1;
+        }
+    }
+    else {
+        std::string source;
+        std::vector<std::string> errors;
+        if (!readSourceFile(path, source)) {
+            std::cerr << "ERROR :: FILE NOT FOUND :: " << path << std::endl;
+            return 1;
+        }
+        if (!buildXref(source, built, errors)) {
+            for (const auto& e : errors) std::cerr << e << "\n";
+            return 1;
+        }
+        if (!index.attach(built.data(), built.size(), error)) {
+            std::cerr << "ERROR :: " << error << "\n";
+            return 1;
+        }
+    }
+
+    for (const auto& name : names) {
+        auto start = std::chrono::steady_clock::now();
+        const XrefSite* sites;
+        size_t count;
+        if (!index.lookup(name, sites, count, error)) {
+            std::cerr << "ERROR :: " << path << ": " << error << "\n";
+            return 1;
+        }
+        double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        size_t counts[4] = {0, 0, 0, 0};
+        size_t conditions = 0;
+        for (size_t s = 0; s < count; s++) {
+            counts[static_cast<int>(sites[s].kind)]++;
+            if (sites[s].flags & XREF_IN_CONDITION) conditions++;
+        }
+        std::cout << name << ": " << counts[1] << " declarations, " << counts[3] << " writes, "
+                  << counts[2] << " reads (" << conditions << " in if conditions)\n";
+        for (size_t s = 0; s < count; s++) {
+            const XrefSite& site = sites[s];
+            if (kind && static_cast<int>(site.kind) != kind) continue;
+            if (inCondition && !(site.flags & XREF_IN_CONDITION)) continue;
+            if (!block.empty() && index.controlName(site.control) != block) continue;
+            printXrefSite(index, site, std::cout);
+        }
+        if (timed) std::cerr << "lookup " << name << ": " << millis << " ms\n";
+    }
+    return 0;
+}
 
-        } catch (const std::exception& e) {
-            std::cerr << "Error: " << e.what() << "\n";
-        }
-    } 
-    else if (flag == "-t"){
-        // Beginning Syntax Checks...
-        try{
-            Lexer lexer (input);
-            Parser parser(lexer);
-            auto program = parser.parseProgram();
-            TypeChecker t;
-            if(t.checkProgram(program.get())){
-                // True: means no semantic errors occured
-                std::cout << "\nSemantic Test Passed!\n";
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && std::string(argv[1]) == "--batch") {
+        return batchMain(argc, argv);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--serve") {
+        return serveMain(argc, argv);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--query") {
+        return queryMain(argc, argv);
+    }
+
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <filename> <-s|-p|-t|-l|-b|-spt...> [--format=text|json|binary] [--max-nesting N] [--no-cse] [--decision-tables] [--fixed=Q15.16] [--layout=profile] [--image=out.alc] [--xref=out.alx] [--stats|--stats=json] [--perf]\n"
+                  << "       " << argv[0] << " --batch <-s|-p|-t|-l|-b> [-j N] [--summary] [--compare] [files|dirs|-]\n"
+                  << "       " << argv[0] << " --serve <socket> [-j maxClients] [--no-cache]\n"
+                  << "       " << argv[0] << " --query <file.alx|file.alang> <name>... [--reads|--writes|--decls] [--in-condition] [--block <name>] [--time]\n";
+        return 1;
+    }
+
+    std::string filename = argv[1];
+    std::string flag = argv[2];
+
+    // --stats reports time and memory of every phase on stderr,
+    // --perf adds hardware counters (and implies --stats)
+    // --format=json|binary dumps tokens (-s) or the parse tree (-p) for other tools
+    std::string statsFormat;
+    std::string imagePath;
+    std::string xrefPath;
+    bool perf = false;
+    OutputFormat format = OutputFormat::TEXT;
+    for (int i = 3; i < argc; i++) {
+        std::string opt = argv[i];
+        if (opt.rfind("--format=", 0) == 0) {
+            if (!parseOutputFormat(opt.substr(9), format)) {
+                std::cerr << "ERROR :: Invalid format " << opt.substr(9) << ", expected text, json or binary\n";
+                return 1;
             }
-            else{
-                std::cerr << "Semantic Errors occured!\n";
-                for(const auto& err: t.getErrors()){
-                    std::cout << err << "\n";
-                }
+        }
+        else if (opt == "--max-nesting" && i + 1 < argc) {
+            // deeper if blocks / parentheses are a parse error, 0 lifts the limit
+            Parser::setDefaultMaxNesting(std::atoi(argv[++i]));
+        }
+        else if (opt == "--no-cse") {
+            // compile every expression again instead of reusing equal ones (-b)
+            Compiler::setDefaultValueNumbering(false);
+        }
+        else if (opt == "--decision-tables") {
+            // if trees over a few variables and constants become table lookups (-b, --image)
+            Compiler::setDefaultDecisionTables(true);
+        }
+        else if (opt.rfind("--fixed=", 0) == 0) {
+            // float variables and literals become Q format fixed point (-b)
+            int fracBits;
+            if (!parseQFormat(opt.substr(8), fracBits)) {
+                std::cerr << "ERROR :: Invalid fixed point format " << opt.substr(8) << ", expected Qm.n with m + n = 31, like Q15.16\n";
+                return 1;
             }
-        
+            Compiler::setDefaultFixedPoint(fracBits);
         }
-        catch (const std::exception& e) {
-            std::cerr << "Error: " << e.what() << "\n";
+        else if (opt.rfind("--layout=", 0) == 0) {
+            // cold if bodies of the branch profile move out of line (-b, --image, profile/PROFILE.md)
+            auto profile = std::make_shared<BranchProfile>();
+            std::string error;
+            if (!profile->load(opt.substr(9), error)) {
+                std::cerr << "ERROR :: " << error << "\n";
+                return 1;
+            }
+            Compiler::setDefaultBranchProfile(profile);
+        }
+        else if (opt.rfind("--image=", 0) == 0) {
+            // also writes the type checked, compiled program as a mapped image (image/IMAGE.md)
+            imagePath = opt.substr(8);
+        }
+        else if (opt.rfind("--xref=", 0) == 0) {
+            // also writes the cross-reference index of every identifier (xref/XREF.md)
+            xrefPath = opt.substr(7);
+        }
+        else if (opt == "--stats") statsFormat = "table";
+        else if (opt == "--stats=json") statsFormat = "json";
+        else if (opt == "--perf") perf = true;
+        else {
+            std::cerr << "ERROR :: Invalid option " << opt << ", expected --format, --max-nesting, --no-cse, --decision-tables, --fixed, --layout, --image, --xref, --stats, --stats=json or --perf\n";
+            return 1;
         }
     }
-    else {
-        std::cerr << "ERROR :: Invalid option. Use -s for symbol table or -p for parse tree.\n";
+    if (perf && statsFormat.empty()) statsFormat = "table";
+    PhaseStats stats(!statsFormat.empty());
+    if (perf) stats.enableHardwareCounters();
+
+    stats.begin("read");
+    std::string input;
+    if (!readSourceFile(filename, input)) {
+        std::cerr << "ERROR :: FILE NOT FOUND :: " << filename << std::endl;
+        return 1;
+    }
+    stats.end();
+
+    if (!runMode(flag, input, std::cout, std::cerr, stats, format)) {
         return 1;
     }
 
-    
+    if (!imagePath.empty()) {
+        stats.begin("image");
+        std::vector<std::string> errors, warnings;
+        bool written = compileImage(input, imagePath, errors, &warnings);
+        stats.end();
+        for (const auto& w : warnings) std::cerr << "WARNING :: " << w << "\n";
+        if (!written) {
+            std::cerr << "ERROR :: no image written to " << imagePath << "\n";
+            for (const auto& e : errors) std::cerr << e << "\n";
+            return 1;
+        }
+    }
+
+    if (!xrefPath.empty()) {
+        stats.begin("xref");
+        std::vector<std::string> errors;
+        bool written = buildXref(input, xrefPath, errors);
+        stats.end();
+        if (!written) {
+            std::cerr << "ERROR :: no index written to " << xrefPath << "\n";
+            for (const auto& e : errors) std::cerr << e << "\n";
+            return 1;
+        }
+    }
+
+    // stdout may be piped somewhere else, stats go to stderr
+    std::cout.flush();
+    if (statsFormat == "table") stats.printTable(std::cerr);
+    else if (statsFormat == "json") stats.printJson(std::cerr, filename);
 
     return 0;
 }
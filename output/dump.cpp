@@ -0,0 +1,333 @@
+#include "dump.h"
+#include "../lexer/lexer.h"
+
+bool parseOutputFormat(const std::string& name, OutputFormat& format){
+    if(name == "text") format = OutputFormat::TEXT;
+    else if(name == "json") format = OutputFormat::JSON;
+    else if(name == "binary") format = OutputFormat::BINARY;
+    else return false;
+    return true;
+}
+
+static void jsonErrors(const std::vector<std::string>& errors, OutputBuffer& out){
+    out << "\"errors\":[";
+    for(size_t i = 0; i < errors.size(); i++){
+        if(i) out.put(',');
+        out.jsonString(errors[i]);
+    }
+    out.put(']');
+}
+
+static void binaryErrors(const std::vector<std::string>& errors, OutputBuffer& out){
+    out.u32(errors.size());
+    for(const auto& e : errors) out.bytes(e);
+}
+
+// ---------------------------------------------------------------------------
+// tokens
+
+void dumpTokensJson(const std::string& input, std::ostream& stream){
+    OutputBuffer out(stream);
+    Lexer lexer(input);
+    out << "{\"tokens\":[";
+    bool first = true;
+    for(Token token = lexer.getNextToken(); token.type != TokenType::EOF_TOKEN; token = lexer.getNextToken()){
+        out << (first ? "\n{\"type\":\"" : ",\n{\"type\":\"") << tokenTypeName(token.type)
+            << "\",\"line\":" << token.line << ",\"col\":" << token.col;
+        first = false;
+        if(std::holds_alternative<int>(token.value)){
+            out << ",\"value\":" << std::get<int>(token.value);
+        }
+        else if(std::holds_alternative<float>(token.value)){
+            out << ",\"value\":";
+            out.exactFloat(std::get<float>(token.value));
+        }
+        else if(std::holds_alternative<bool>(token.value)){
+            out << ",\"value\":";
+            out.boolean(std::get<bool>(token.value));
+        }
+        else{
+            out << ",\"lexeme\":";
+            out.jsonString(token.lexeme);
+        }
+        out.put('}');
+    }
+    out << "\n],";
+    jsonErrors(lexer.getErrors(), out);
+    out << "}\n";
+}
+
+void dumpTokensBinary(const std::string& input, std::ostream& stream){
+    OutputBuffer out(stream);
+    Lexer lexer(input);
+    out.write(TOKEN_DUMP_MAGIC, 4);
+    out.u32(DUMP_VERSION);
+    // the count is not known up front, the list ends with an EOF_TOKEN record
+    Token token = lexer.getNextToken();
+    while(true){
+        out.u8(static_cast<uint8_t>(token.type));
+        out.u32(token.line);
+        out.u32(token.col);
+        if(token.type == TokenType::EOF_TOKEN) break;
+        if(std::holds_alternative<int>(token.value)){
+            out.u8(static_cast<uint8_t>(ValueKind::INT));
+            out.u32(static_cast<uint32_t>(std::get<int>(token.value)));
+        }
+        else if(std::holds_alternative<float>(token.value)){
+            out.u8(static_cast<uint8_t>(ValueKind::FLOAT));
+            out.f32(std::get<float>(token.value));
+        }
+        else if(std::holds_alternative<bool>(token.value)){
+            out.u8(static_cast<uint8_t>(ValueKind::BOOL));
+            out.u8(std::get<bool>(token.value));
+        }
+        else{
+            out.u8(static_cast<uint8_t>(ValueKind::LEXEME));
+            out.bytes(token.lexeme);
+        }
+        token = lexer.getNextToken();
+    }
+    binaryErrors(lexer.getErrors(), out);
+}
+
+// ---------------------------------------------------------------------------
+// parse tree
+//
+// Both tree dumps walk the AST with an explicit work stack, like the text printer,
+// so a deeply nested program cannot overflow the native stack.
+// Tasks are pushed in reverse order, TEXT writes a fixed piece of JSON that
+// closes what an earlier task opened.
+
+namespace {
+
+enum class DumpKind{
+    STATEMENT, EXPRESSION, FACTOR, OP, TEXT, COUNT
+};
+
+struct DumpTask{
+    DumpKind kind;
+    const ASTNode* node = nullptr;
+    const char* text = nullptr;
+    TokenType op = TokenType::TOKEN_UNKNOWN;
+    uint32_t count = 0;
+};
+
+DumpTask node(DumpKind kind, const ASTNode* n){ return DumpTask{kind, n}; }
+DumpTask text(const char* t){ return DumpTask{DumpKind::TEXT, nullptr, t}; }
+
+// pushes a JSON array of statements, "]" is written by the caller's closing text
+void pushJsonStatements(const std::vector<std::unique_ptr<StatementNode>>& statements, std::vector<DumpTask>& work){
+    for(size_t i = statements.size(); i-- > 0;){
+        work.push_back(node(DumpKind::STATEMENT, statements[i].get()));
+        if(i) work.push_back(text(","));
+    }
+}
+
+void jsonTree(std::vector<DumpTask>& work, OutputBuffer& out){
+    while(!work.empty()){
+        DumpTask task = work.back();
+        work.pop_back();
+        switch(task.kind){
+            case DumpKind::TEXT:
+                out << task.text;
+                break;
+            case DumpKind::OP:
+                out << ",\"op\":\"" << tokenTypeName(task.op) << "\",\"right\":";
+                break;
+            case DumpKind::EXPRESSION:{
+                auto expression = static_cast<const ExpressionNode*>(task.node);
+                out << "{\"left\":";
+                work.push_back(text("}"));
+                if(expression->right){
+                    work.push_back(node(DumpKind::FACTOR, expression->right->factor.get()));
+                    work.push_back(DumpTask{DumpKind::OP, nullptr, nullptr, expression->op});
+                }
+                work.push_back(node(DumpKind::FACTOR, expression->left->factor.get()));
+                break;
+            }
+            case DumpKind::FACTOR:
+                if(auto ident = dynamic_cast<const IdentifierNode*>(task.node)){
+                    out << "{\"identifier\":";
+                    out.jsonString(ident->identifier);
+                    out << ",\"line\":" << ident->line << ",\"col\":" << ident->col << "}";
+                }
+                else if(auto literal = dynamic_cast<const LiteralNode*>(task.node)){
+                    out << "{\"literal\":\"" << tokenTypeName(literal->literalType) << "\",\"value\":";
+                    if(std::holds_alternative<int>(literal->literalValue)) out << std::get<int>(literal->literalValue);
+                    else if(std::holds_alternative<float>(literal->literalValue)) out.exactFloat(std::get<float>(literal->literalValue));
+                    else if(std::holds_alternative<bool>(literal->literalValue)) out.boolean(std::get<bool>(literal->literalValue));
+                    else out << "null";
+                    out << ",\"line\":" << literal->line << ",\"col\":" << literal->col << "}";
+                }
+                else{
+                    auto paren = static_cast<const ParenExpressionNode*>(task.node);
+                    out << "{\"paren\":";
+                    work.push_back(text("}"));
+                    work.push_back(node(DumpKind::EXPRESSION, paren->expression.get()));
+                }
+                break;
+            case DumpKind::STATEMENT:
+                if(auto decl = dynamic_cast<const VarDeclNode*>(task.node)){
+                    out << "{\"kind\":\"decl\",\"type\":\"" << tokenTypeName(decl->type) << "\",\"identifier\":";
+                    out.jsonString(decl->identifier);
+                    out << ",\"line\":" << decl->line << ",\"col\":" << decl->col << "}";
+                }
+                else if(auto assign = dynamic_cast<const AssignmentNode*>(task.node)){
+                    out << "{\"kind\":\"assign\",\"identifier\":";
+                    out.jsonString(assign->identifier);
+                    out << ",\"line\":" << assign->line << ",\"col\":" << assign->col << ",\"expression\":";
+                    work.push_back(text("}"));
+                    work.push_back(node(DumpKind::EXPRESSION, assign->expression.get()));
+                }
+                else{
+                    auto ifNode = static_cast<const IfNode*>(task.node);
+                    out << "{\"kind\":\"if\",\"line\":" << ifNode->line << ",\"col\":" << ifNode->col << ",\"condition\":{\"left\":";
+                    work.push_back(text("]}"));
+                    pushJsonStatements(ifNode->statements, work);
+                    work.push_back(text("},\"statements\":["));
+                    work.push_back(node(DumpKind::EXPRESSION, ifNode->condition->right.get()));
+                    work.push_back(DumpTask{DumpKind::OP, nullptr, nullptr, ifNode->condition->comparisonOp});
+                    work.push_back(node(DumpKind::EXPRESSION, ifNode->condition->left.get()));
+                }
+                break;
+            case DumpKind::COUNT:
+                break;
+        }
+    }
+}
+
+void binaryTree(std::vector<DumpTask>& work, OutputBuffer& out){
+    while(!work.empty()){
+        DumpTask task = work.back();
+        work.pop_back();
+        switch(task.kind){
+            case DumpKind::COUNT:
+                out.u32(task.count);
+                break;
+            case DumpKind::EXPRESSION:{
+                auto expression = static_cast<const ExpressionNode*>(task.node);
+                out.u8(static_cast<uint8_t>(AstTag::EXPRESSION));
+                out.u32(expression->line);
+                out.u32(expression->col);
+                // op is EOF_TOKEN for a single term
+                out.u8(static_cast<uint8_t>(expression->right ? expression->op : TokenType::EOF_TOKEN));
+                if(expression->right) work.push_back(node(DumpKind::FACTOR, expression->right->factor.get()));
+                work.push_back(node(DumpKind::FACTOR, expression->left->factor.get()));
+                break;
+            }
+            case DumpKind::FACTOR:
+                if(auto ident = dynamic_cast<const IdentifierNode*>(task.node)){
+                    out.u8(static_cast<uint8_t>(AstTag::IDENTIFIER));
+                    out.u32(ident->line);
+                    out.u32(ident->col);
+                    out.bytes(ident->identifier);
+                }
+                else if(auto literal = dynamic_cast<const LiteralNode*>(task.node)){
+                    out.u8(static_cast<uint8_t>(AstTag::LITERAL));
+                    out.u32(literal->line);
+                    out.u32(literal->col);
+                    out.u8(static_cast<uint8_t>(literal->literalType));
+                    if(std::holds_alternative<int>(literal->literalValue)){
+                        out.u8(static_cast<uint8_t>(ValueKind::INT));
+                        out.u32(static_cast<uint32_t>(std::get<int>(literal->literalValue)));
+                    }
+                    else if(std::holds_alternative<float>(literal->literalValue)){
+                        out.u8(static_cast<uint8_t>(ValueKind::FLOAT));
+                        out.f32(std::get<float>(literal->literalValue));
+                    }
+                    else if(std::holds_alternative<bool>(literal->literalValue)){
+                        out.u8(static_cast<uint8_t>(ValueKind::BOOL));
+                        out.u8(std::get<bool>(literal->literalValue));
+                    }
+                    else{
+                        out.u8(static_cast<uint8_t>(ValueKind::NONE));
+                    }
+                }
+                else{
+                    out.u8(static_cast<uint8_t>(AstTag::PAREN));
+                    work.push_back(node(DumpKind::EXPRESSION, static_cast<const ParenExpressionNode*>(task.node)->expression.get()));
+                }
+                break;
+            case DumpKind::STATEMENT:
+                if(auto decl = dynamic_cast<const VarDeclNode*>(task.node)){
+                    out.u8(static_cast<uint8_t>(AstTag::DECL));
+                    out.u32(decl->line);
+                    out.u32(decl->col);
+                    out.u8(static_cast<uint8_t>(decl->type));
+                    out.bytes(decl->identifier);
+                }
+                else if(auto assign = dynamic_cast<const AssignmentNode*>(task.node)){
+                    out.u8(static_cast<uint8_t>(AstTag::ASSIGN));
+                    out.u32(assign->line);
+                    out.u32(assign->col);
+                    out.bytes(assign->identifier);
+                    work.push_back(node(DumpKind::EXPRESSION, assign->expression.get()));
+                }
+                else{
+                    auto ifNode = static_cast<const IfNode*>(task.node);
+                    out.u8(static_cast<uint8_t>(AstTag::IF));
+                    out.u32(ifNode->line);
+                    out.u32(ifNode->col);
+                    out.u8(static_cast<uint8_t>(ifNode->condition->comparisonOp));
+                    // both expressions, the statement count, the statements
+                    const auto& statements = ifNode->statements;
+                    for(auto it = statements.rbegin(); it != statements.rend(); ++it){
+                        work.push_back(node(DumpKind::STATEMENT, it->get()));
+                    }
+                    DumpTask count{DumpKind::COUNT};
+                    count.count = statements.size();
+                    work.push_back(count);
+                    work.push_back(node(DumpKind::EXPRESSION, ifNode->condition->right.get()));
+                    work.push_back(node(DumpKind::EXPRESSION, ifNode->condition->left.get()));
+                }
+                break;
+            case DumpKind::OP:
+            case DumpKind::TEXT:
+                break;
+        }
+    }
+}
+
+} // namespace
+
+void dumpProgramJson(const ProgramNode* program, const std::vector<std::string>& errors, std::ostream& stream){
+    OutputBuffer out(stream);
+    out << "{\"blocks\":[";
+    if(errors.empty() && program){
+        bool first = true;
+        std::vector<DumpTask> work;
+        for(const auto& block : program->controlBlocks){
+            out << (first ? "\n{\"name\":" : ",\n{\"name\":");
+            first = false;
+            out.jsonString(block->name);
+            out << ",\"statements\":[";
+            work.push_back(text("]}"));
+            pushJsonStatements(block->statements, work);
+            jsonTree(work, out);
+        }
+        out.put('\n');
+    }
+    out << "],";
+    jsonErrors(errors, out);
+    out << "}\n";
+}
+
+void dumpProgramBinary(const ProgramNode* program, const std::vector<std::string>& errors, std::ostream& stream){
+    OutputBuffer out(stream);
+    out.write(AST_DUMP_MAGIC, 4);
+    out.u32(DUMP_VERSION);
+    binaryErrors(errors, out);
+    bool valid = errors.empty() && program;
+    out.u32(valid ? program->controlBlocks.size() : 0);
+    if(!valid) return;
+    std::vector<DumpTask> work;
+    for(const auto& block : program->controlBlocks){
+        out.u8(static_cast<uint8_t>(AstTag::BLOCK));
+        out.bytes(block->name);
+        out.u32(block->statements.size());
+        for(auto it = block->statements.rbegin(); it != block->statements.rend(); ++it){
+            work.push_back(node(DumpKind::STATEMENT, it->get()));
+        }
+        binaryTree(work, out);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef OUTPUT_DUMP_H
+#define OUTPUT_DUMP_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "outputBuffer.h"
+#include "../parser/ast.h"
+
+// Machine readable versions of the -s (tokens) and -p (parse tree) output.
+// See output/OUTPUT.md for both layouts.
+enum class OutputFormat{
+    TEXT, JSON, BINARY
+};
+
+// "text", "json" or "binary", false for anything else
+bool parseOutputFormat(const std::string& name, OutputFormat& format);
+
+// the binary dumps start with a 4 byte magic and this version
+constexpr char TOKEN_DUMP_MAGIC[4] = {'A', 'L', 'T', 'K'};
+constexpr char AST_DUMP_MAGIC[4] = {'A', 'L', 'A', 'S'};
+constexpr uint32_t DUMP_VERSION = 1;
+
+// record tags of the binary AST dump, written in preorder
+enum class AstTag : uint8_t{
+    BLOCK = 1, DECL, ASSIGN, IF, EXPRESSION, IDENTIFIER, LITERAL, PAREN
+};
+
+// how a token or literal value follows in the binary dumps
+enum class ValueKind : uint8_t{
+    LEXEME, INT, FLOAT, BOOL, NONE
+};
+
+// Lexes input and writes every token, then the lexer errors
+void dumpTokensJson(const std::string& input, std::ostream& out);
+void dumpTokensBinary(const std::string& input, std::ostream& out);
+
+// Writes the parsed tree, or only the parser errors when there are any
+void dumpProgramJson(const ProgramNode* program, const std::vector<std::string>& errors, std::ostream& out);
+void dumpProgramBinary(const ProgramNode* program, const std::vector<std::string>& errors, std::ostream& out);
+
+#endif // OUTPUT_DUMP_H
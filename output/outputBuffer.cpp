@@ -0,0 +1,62 @@
+#include "outputBuffer.h"
+#include <charconv>
+#include <cstdio>
+
+OutputBuffer::OutputBuffer(std::ostream& out, size_t cap) : sink(out), capacity(cap ? cap : DEFAULT_CAPACITY){
+    data = new char[capacity];
+}
+
+OutputBuffer::~OutputBuffer(){
+    flush();
+    delete[] data;
+}
+
+void OutputBuffer::drain(){
+    if(used) sink.write(data, used);
+    used = 0;
+}
+
+void OutputBuffer::flush(){
+    drain();
+    sink.flush();
+}
+
+void OutputBuffer::integer(long long v){
+    char buf[24];
+    auto result = std::to_chars(buf, buf + sizeof(buf), v);
+    write(buf, result.ptr - buf);
+}
+
+void OutputBuffer::floating(float v){
+    char buf[32];
+    int n = std::snprintf(buf, sizeof(buf), "%g", static_cast<double>(v));
+    write(buf, n);
+}
+
+void OutputBuffer::exactFloat(float v){
+    char buf[32];
+    int n = std::snprintf(buf, sizeof(buf), "%.9g", static_cast<double>(v));
+    write(buf, n);
+}
+
+void OutputBuffer::jsonString(const std::string& s){
+    escapeJson(s, [this](const char* bytes, size_t n){ write(bytes, n); });
+}
+
+std::string jsonString(const std::string& s){
+    std::string out;
+    out.reserve(s.size() + 2);
+    escapeJson(s, [&out](const char* bytes, size_t n){ out.append(bytes, n); });
+    return out;
+}
+
+void OutputBuffer::u32(uint32_t v){
+    char b[4] = {static_cast<char>(v), static_cast<char>(v >> 8), static_cast<char>(v >> 16), static_cast<char>(v >> 24)};
+    write(b, 4);
+}
+
+void OutputBuffer::f32(float v){
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    u32(bits);
+}
@@ -0,0 +1,110 @@
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+// Escapes s as a JSON string literal, quotes included, handing the pieces to emit(bytes, n).
+// The one escaper of the tool: the dumps, the compile server and --stats=json all use it.
+// Runs of characters that need no escape are handed over in one piece
+template<typename Emit>
+void escapeJson(const std::string& s, Emit&& emit){
+    emit("\"", 1);
+    size_t run = 0;
+    for(size_t i = 0; i < s.size(); i++){
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if(c >= 0x20 && c != '"' && c != '\\') continue;
+        emit(s.data() + run, i - run);
+        run = i + 1;
+        switch(c){
+            case '"': emit("\\\"", 2); break;
+            case '\\': emit("\\\\", 2); break;
+            case '\n': emit("\\n", 2); break;
+            case '\t': emit("\\t", 2); break;
+            case '\r': emit("\\r", 2); break;
+            default: {
+                const char* hex = "0123456789abcdef";
+                char buf[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+                emit(buf, 6);
+            }
+        }
+    }
+    emit(s.data() + run, s.size() - run);
+    emit("\"", 1);
+}
+
+// escapeJson() into a new string
+std::string jsonString(const std::string& s);
+
+// One large reusable buffer in front of an output stream.
+// Every dump appends into it and it reaches the stream in big chunks,
+// the only write path, instead of one << per fragment and a flush per line.
+class OutputBuffer{
+    private:
+    std::ostream& sink;
+    char* data;
+    size_t capacity;
+    size_t used = 0;
+
+    void drain();
+
+    public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 20;
+
+    explicit OutputBuffer(std::ostream& sink, size_t capacity = DEFAULT_CAPACITY);
+    ~OutputBuffer(); // flushes
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void write(const char* bytes, size_t n){
+        if(used + n > capacity){
+            drain();
+            if(n > capacity){
+                sink.write(bytes, n);
+                return;
+            }
+        }
+        std::memcpy(data + used, bytes, n);
+        used += n;
+    }
+    void put(char c){
+        if(used == capacity) drain();
+        data[used++] = c;
+    }
+    void text(const char* s){ write(s, std::strlen(s)); }
+    void text(const std::string& s){ write(s.data(), s.size()); }
+    void repeat(const char* s, size_t n, int times){
+        for(int i = 0; i < times; i++) write(s, n);
+    }
+
+    // decimal formatting identical to what std::ostream prints by default
+    void integer(long long v);
+    void floating(float v);     // like << on a float: %g, 6 significant digits
+    void exactFloat(float v);   // %.9g, enough digits to read the same float back
+    void boolean(bool v){ text(v ? "true" : "false"); }
+    // a JSON string literal, quotes included
+    void jsonString(const std::string& s);
+
+    // little endian binary values for the binary dumps
+    void u8(uint8_t v){ put(static_cast<char>(v)); }
+    void u32(uint32_t v);
+    void f32(float v);
+    void bytes(const std::string& s){ u32(s.size()); write(s.data(), s.size()); }
+
+    // so printers keep their << chains
+    OutputBuffer& operator<<(const char* s){ text(s); return *this; }
+    OutputBuffer& operator<<(const std::string& s){ text(s); return *this; }
+    OutputBuffer& operator<<(char c){ put(c); return *this; }
+    OutputBuffer& operator<<(int v){ integer(v); return *this; }
+    OutputBuffer& operator<<(long v){ integer(v); return *this; }
+    OutputBuffer& operator<<(unsigned long v){ integer(static_cast<long long>(v)); return *this; }
+    OutputBuffer& operator<<(float v){ floating(v); return *this; }
+
+    // hands everything buffered to the stream and flushes it
+    void flush();
+};
+
+#endif // OUTPUT_BUFFER_H
@@ -34,6 +34,9 @@ struct ConditionNode;
 struct ASTNode{
     virtual ~ASTNode() = default;
     // somehow it helps in cleanup when deleting derived classes such as declaration, assignment, etc...
+
+    // moves the node's children to out, so ~ProgramNode can free the tree without recursion
+    virtual void releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out) {}
 };
 
 // ProgramNode:= { ControlNode }
@@ -44,6 +47,9 @@ struct ProgramNode : ASTNode{
     // we need to store pointer of these 
     // that too unique_ptr, don't know why
     std::vector<std::unique_ptr<struct ControlNode>> controlBlocks;
+
+    // frees the tree without recursing, see the end of this file
+    ~ProgramNode() override;
 };
 
 // ControlNode:= "control" IDENTIFIER "{" { statement } "}"
@@ -53,6 +59,8 @@ struct ControlNode : ASTNode{
     
     // and a vector of all the statements
     std::vector<std::unique_ptr<struct StatementNode>> statements;
+
+    void releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out) override;
 };
 
 // StatementNode:= VarDeclNode | AssignmentNode | IfNode
@@ -73,6 +81,8 @@ struct AssignmentNode : StatementNode{
     std::string identifier;
     std::unique_ptr<struct ExpressionNode> expression;
     int line = 0, col = 0; // position of `set` or identifier
+
+    void releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out) override;
 };
 
 // ExpressionNode := TermNode op TermNode
@@ -82,11 +92,15 @@ struct ExpressionNode : ASTNode{
     std::unique_ptr<struct TermNode> left;
     TokenType op;
     std::unique_ptr<struct TermNode> right;
+
+    void releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out) override;
 };
 
 // TermNode:= FactorNode
 struct TermNode : ASTNode{
     std::unique_ptr<struct FactorNode> factor;
+
+    void releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out) override;
 };
 
 // FactorNode:= IDENTIFIER | literal | "(" expression ")" 
@@ -107,6 +121,8 @@ struct LiteralNode : FactorNode {
 
 struct ParenExpressionNode : FactorNode {
     std::unique_ptr<struct ExpressionNode> expression; // for parentheses
+
+    void releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out) override;
 };
 
 // IfNode := "if" ConditionNode "{" { statement } "}"
@@ -114,6 +130,8 @@ struct IfNode : StatementNode{
     std::unique_ptr<ConditionNode> condition;
     std::vector<std::unique_ptr<StatementNode>> statements;
     int line=0, col=0;
+
+    void releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out) override;
 };
 
 
@@ -122,7 +140,59 @@ struct ConditionNode : ASTNode{
     std::unique_ptr<struct ExpressionNode> left;
     TokenType comparisonOp; // GREATER or EQUAL_EQUAL
     std::unique_ptr<struct ExpressionNode> right;
+
+    void releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out) override;
 };
 
 
+// Letting unique_ptr free the tree recurses once per level and a deeply nested
+// program (or a very long a + b + ... chain) would overflow the native stack.
+// Instead every node's children are moved onto a work list before the node dies,
+// so each destructor call only ever frees a node without children.
+inline ProgramNode::~ProgramNode(){
+    std::vector<std::unique_ptr<ASTNode>> work;
+    for(auto& block : controlBlocks) work.push_back(std::move(block));
+    while(!work.empty()){
+        std::unique_ptr<ASTNode> node = std::move(work.back());
+        work.pop_back();
+        node->releaseChildren(work);
+    }
+}
+
+template <typename T>
+inline void releaseChild(std::unique_ptr<T>& child, std::vector<std::unique_ptr<ASTNode>>& out){
+    if(child) out.push_back(std::move(child));
+}
+
+inline void ControlNode::releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out){
+    for(auto& statement : statements) releaseChild(statement, out);
+}
+
+inline void AssignmentNode::releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out){
+    releaseChild(expression, out);
+}
+
+inline void ExpressionNode::releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out){
+    releaseChild(left, out);
+    releaseChild(right, out);
+}
+
+inline void TermNode::releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out){
+    releaseChild(factor, out);
+}
+
+inline void ParenExpressionNode::releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out){
+    releaseChild(expression, out);
+}
+
+inline void IfNode::releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out){
+    releaseChild(condition, out);
+    for(auto& statement : statements) releaseChild(statement, out);
+}
+
+inline void ConditionNode::releaseChildren(std::vector<std::unique_ptr<ASTNode>>& out){
+    releaseChild(left, out);
+    releaseChild(right, out);
+}
+
 #endif // AST_H
\ No newline at end of file
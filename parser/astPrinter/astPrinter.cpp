@@ -2,148 +2,181 @@
 #include <variant>
 #include <string>
 #include <memory>
+#include <vector>
 #include "astPrinter.h"
 #include "../../lexer/token.h"
 
-void printBranch(int level){
-    for(int i=0; i<level; i++){
-        std::cout << "|\t";
-    }
-    std::cout << "|-";
+void printBranch(int level, OutputBuffer& out){
+    out.repeat("|\t", 2, level);
+    out.write("|-", 2);
 }
 
-void printIdentifier(const IdentifierNode * ident){
-    std::cout << "identifier : " << ident->identifier << "\n";
+void printIdentifier(const IdentifierNode * ident, OutputBuffer& out){
+    out << "identifier : " << ident->identifier << "\n";
 }
 
-void printLiteral(const LiteralNode* literal){
-    std::cout << "literal : ";
-    std::cout << tokenTypeToString(literal->literalType) << " [";
+void printLiteral(const LiteralNode* literal, OutputBuffer& out){
+    out << "literal : ";
+    out << tokenTypeName(literal->literalType) << " [";
     // for literalValue (int, float, bool)
     if (std::holds_alternative<int>(literal->literalValue))
-        std::cout << std::get<int>(literal->literalValue);
+        out << std::get<int>(literal->literalValue);
     else if (std::holds_alternative<float>(literal->literalValue))
-        std::cout << std::get<float>(literal->literalValue);
+        out << std::get<float>(literal->literalValue);
     else if (std::holds_alternative<bool>(literal->literalValue))
-        std::cout << (std::get<bool>(literal->literalValue) ? "true" : "false");
-    std::cout << "]\n";
+        out << (std::get<bool>(literal->literalValue) ? "true" : "false");
+    out << "]\n";
 }
 
-void printFactor(const FactorNode* factor, int level){
-    printBranch(level);
-    std::cout << "factor : ";
-    if(auto ident = dynamic_cast<const IdentifierNode*> (factor)){
-        printIdentifier(ident);
-    }
-    else if(auto literal = dynamic_cast<const LiteralNode*> (factor)){
-        printLiteral(literal);
-    }
-    else{
-        auto paren = dynamic_cast<const ParenExpressionNode*> (factor);
-        std::cout << "\n";
-        printExpression(paren->expression.get(), level+1);
-    }
-}
-
-
-void printTerm(const TermNode * term, const std::string& msg, int level){
-    printBranch(level);
-    std::cout << msg <<"Term\n";
-    printFactor(term->factor.get(), level+1);
+void printValDeclNode(const VarDeclNode* decl, int level, OutputBuffer& out){
+    out << "varDeclNode\n";
+    printBranch(level, out);
+    out << "type : " << tokenTypeName(decl->type) << "\n";
+    printBranch(level, out);
+    out << "identifier : " << decl->identifier << "\n";
 }
 
-void printExpression(const ExpressionNode * expression,int level){
-    printBranch(level);
-
-    std::cout << "expression\n";
-    // print left term
-    printTerm(expression->left.get(), "Left", level+1);
-
-    if(expression->right.get()){
-        printBranch(level+1);
-        std::cout << "op : " << tokenTypeToString(expression->op);
-        std::cout << "\n";
-        printTerm(expression->right.get(), "Right", level+1);
+// The tree is printed from an explicit work stack, not by recursion,
+// so nested ifs and parentheses of any depth only cost heap memory.
+// Every task prints one line (or a few) and pushes what comes below it,
+// in reverse order so the first child is printed first.
+namespace {
+
+enum class PrintKind{
+    STATEMENT, CONDITION, EXPRESSION, LEFT_TERM, RIGHT_TERM, FACTOR, OP
+};
+
+struct PrintTask{
+    PrintKind kind;
+    const ASTNode* node;
+    int level;
+    TokenType op = TokenType::TOKEN_UNKNOWN; // for OP lines
+};
+
+void printTasks(std::vector<PrintTask>& work, OutputBuffer& out){
+    while(!work.empty()){
+        PrintTask task = work.back();
+        work.pop_back();
+        int level = task.level;
+
+        switch(task.kind){
+            case PrintKind::STATEMENT:{
+                printBranch(level, out);
+                out << "statement : ";
+                level++;
+                if(auto decl = dynamic_cast<const VarDeclNode*>(task.node)){
+                    printValDeclNode(decl, level, out);
+                }
+                else if(auto assign = dynamic_cast<const AssignmentNode*>(task.node)){
+                    out << "assignmentNode (set) \n";
+                    printBranch(level, out);
+                    out << "identifier : " << assign->identifier << "\n";
+                    // print expression
+                    work.push_back({PrintKind::EXPRESSION, assign->expression.get(), level});
+                }
+                else{
+                    auto ifNode = static_cast<const IfNode*>(task.node);
+                    out << "ifNode \n";
+                    printBranch(level, out);
+                    // print condition, then statements
+                    out << "condition\n";
+                    const auto& statements = ifNode->statements;
+                    for(auto it = statements.rbegin(); it != statements.rend(); ++it){
+                        work.push_back({PrintKind::STATEMENT, it->get(), level});
+                    }
+                    work.push_back({PrintKind::CONDITION, ifNode->condition.get(), level + 1});
+                }
+                break;
+            }
+            case PrintKind::CONDITION:{
+                // left expression, op, right expression
+                auto condition = static_cast<const ConditionNode*>(task.node);
+                work.push_back({PrintKind::EXPRESSION, condition->right.get(), level});
+                work.push_back({PrintKind::OP, nullptr, level, condition->comparisonOp});
+                work.push_back({PrintKind::EXPRESSION, condition->left.get(), level});
+                break;
+            }
+            case PrintKind::EXPRESSION:{
+                auto expression = static_cast<const ExpressionNode*>(task.node);
+                printBranch(level, out);
+                out << "expression\n";
+                if(expression->right.get()){
+                    work.push_back({PrintKind::RIGHT_TERM, expression->right.get(), level + 1});
+                    work.push_back({PrintKind::OP, nullptr, level + 1, expression->op});
+                }
+                // print left term
+                work.push_back({PrintKind::LEFT_TERM, expression->left.get(), level + 1});
+                break;
+            }
+            case PrintKind::LEFT_TERM:
+            case PrintKind::RIGHT_TERM:{
+                auto term = static_cast<const TermNode*>(task.node);
+                printBranch(level, out);
+                out << (task.kind == PrintKind::LEFT_TERM ? "Left" : "Right") << "Term\n";
+                work.push_back({PrintKind::FACTOR, term->factor.get(), level + 1});
+                break;
+            }
+            case PrintKind::FACTOR:{
+                printBranch(level, out);
+                out << "factor : ";
+                if(auto ident = dynamic_cast<const IdentifierNode*> (task.node)){
+                    printIdentifier(ident, out);
+                }
+                else if(auto literal = dynamic_cast<const LiteralNode*> (task.node)){
+                    printLiteral(literal, out);
+                }
+                else{
+                    auto paren = static_cast<const ParenExpressionNode*> (task.node);
+                    out << "\n";
+                    work.push_back({PrintKind::EXPRESSION, paren->expression.get(), level + 1});
+                }
+                break;
+            }
+            case PrintKind::OP:
+                printBranch(level, out);
+                out << "op : " << tokenTypeName(task.op);
+                out << "\n";
+                break;
+        }
     }
-
-}
-
-void printCondition(const ConditionNode * condition, int level){
-    // print left term
-    printExpression(condition->left.get(), level);
-    printBranch(level);
-    std::cout << "op : " << tokenTypeToString(condition->comparisonOp);
-    std::cout << "\n";
-
-    printExpression(condition->right.get(), level);
-}
-
-void printValDeclNode(const VarDeclNode* decl, int level){
-    std::cout << "varDeclNode\n";
-    printBranch(level);
-    std::cout << "type : " << tokenTypeToString(decl->type) << "\n";
-    printBranch(level);
-    std::cout << "identifier : " << decl->identifier << "\n";
 }
 
-void printAssignmentNode(const AssignmentNode* assign, int level){
-std::cout << "assignmentNode (set) \n";
-    printBranch(level);
-    std::cout << "identifier : " << assign->identifier << "\n";
+} // namespace
 
-    // print expression
-    // std::cout << "expression : " << assign->expression.get() << "\n";
-    printExpression(assign->expression.get(), level); 
+void printExpression(const ExpressionNode * expression, int level, OutputBuffer& out){
+    std::vector<PrintTask> work{{PrintKind::EXPRESSION, expression, level}};
+    printTasks(work, out);
 }
 
-void printIfNode(const IfNode* ifNode, int level){
-    std::cout << "ifNode \n";
-        printBranch(level);
-
-        // print condition
-        std::cout << "condition\n";
-        printCondition(ifNode->condition.get(), level+1);
-
-        // print statements
-        const auto& statements = ifNode->statements;
-        for(const auto& statement : statements){
-            printStatement(statement.get(), level);
-        }
+void printStatement(const StatementNode * statement, int level, OutputBuffer& out){
+    std::vector<PrintTask> work{{PrintKind::STATEMENT, statement, level}};
+    printTasks(work, out);
 }
 
-void printStatement(const StatementNode * statement, int level){
-    printBranch(level);
-    std::cout << "statement : ";
-    level++;
-    if(auto decl = dynamic_cast<const VarDeclNode*>(statement)){
-        printValDeclNode(decl, level);
-    }
-    else if(auto assign = dynamic_cast<const AssignmentNode*>(statement)){
-        printAssignmentNode(assign, level);
-    }
-    else{
-        auto ifNode = dynamic_cast<const IfNode*>(statement);
-        printIfNode(ifNode, level);
-    }
-}
-
-void printControlBlock(const ControlNode * controlBlock, int level){
-    std::cout << "|\n";
-    std::cout << "|- ";
-    std::cout << "controlBlock : " << controlBlock->name << "\n";
+void printControlBlock(const ControlNode * controlBlock, int level, OutputBuffer& out){
+    out << "|\n";
+    out << "|- ";
+    out << "controlBlock : " << controlBlock->name << "\n";
     const auto& statements = controlBlock->statements;
-    for(const auto& statement : statements){
-        printStatement(statement.get(), level+1);
+    std::vector<PrintTask> work;
+    for(auto it = statements.rbegin(); it != statements.rend(); ++it){
+        work.push_back({PrintKind::STATEMENT, it->get(), level + 1});
     }
+    printTasks(work, out);
 }
 
-void printProgram(const ProgramNode * program){
-    std::cout << "Program\n";
+void printProgram(const ProgramNode * program, OutputBuffer& out){
+    out << "Program\n";
     int level = 0;
     // printControlBlocks from 
     // std::vector<std::unique_ptr<struct ControlNode>> controlBlocks;
     const auto& controlBlocks = program->controlBlocks;
     for(const auto& controlBlock : controlBlocks){
-        printControlBlock(controlBlock.get(), level);
+        printControlBlock(controlBlock.get(), level, out);
     }
 }
+
+void printProgram(const ProgramNode * program, std::ostream& out){
+    OutputBuffer buffer(out);
+    printProgram(program, buffer);
+}
@@ -7,24 +7,22 @@
 #include <memory>
 #include "../ast.h"   // assuming all node types are defined here
 #include "../../lexer/token.h" // for tokenTypeToString()
+#include "../../output/outputBuffer.h"
 
 // Function declarations
-void printBranch(int level);
+void printBranch(int level, OutputBuffer& out);
 
-void printIdentifier(const struct IdentifierNode* ident);
-void printLiteral(const struct LiteralNode* literal);
+void printIdentifier(const struct IdentifierNode* ident, OutputBuffer& out);
+void printLiteral(const struct LiteralNode* literal, OutputBuffer& out);
+void printValDeclNode(const struct VarDeclNode* decl, int level, OutputBuffer& out);
 
-void printFactor(const struct FactorNode* factor, int level);
-void printTerm(const struct TermNode* term, const std::string& msg, int level);
-void printExpression(const struct ExpressionNode* expression, int level);
-void printCondition(const struct ConditionNode* condition, int level);
+// these walk everything below the node with an explicit stack, never recursively
+void printExpression(const struct ExpressionNode* expression, int level, OutputBuffer& out);
+void printStatement(const struct StatementNode* statement, int level, OutputBuffer& out);
+void printControlBlock(const struct ControlNode* controlBlock, int level, OutputBuffer& out);
+void printProgram(const struct ProgramNode* program, OutputBuffer& out);
 
-void printValDeclNode(const struct VarDeclNode* decl, int level);
-void printAssignmentNode(const struct AssignmentNode* assign, int level);
-void printIfNode(const struct IfNode* ifNode, int level);
-
-void printStatement(const struct StatementNode* statement, int level);
-void printControlBlock(const struct ControlNode* controlBlock, int level);
-void printProgram(const struct ProgramNode* program);
+// buffers the whole tree and writes it to out in large chunks
+void printProgram(const struct ProgramNode* program, std::ostream& out = std::cout);
 
 #endif // AST_PRINTER_H
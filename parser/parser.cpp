@@ -1,13 +1,20 @@
 #include "parser.h"
 #include <sstream>
 #include "../lexer/lexer.h"
+#include "../xref/xref.h"
 #include <unordered_set>
 #include <iostream>
 
-Parser::Parser(Lexer &lexer) : lexer(lexer) {
+int Parser::defaultMaxNesting = DEFAULT_MAX_NESTING;
+
+Parser::Parser(Lexer &lexer) : lexer(lexer), maxNesting(defaultMaxNesting) {
     currentToken = lexer.getNextToken();
 }
 
+void Parser::setDefaultMaxNesting(int levels){
+    defaultMaxNesting = levels;
+}
+
 void Parser::raiseError(const std::string &message){
     std::ostringstream oss;
     oss << "Line " << currentToken.line << ", Col " << currentToken.col << "; " << message;
@@ -62,6 +69,7 @@ std::unique_ptr<VarDeclNode> Parser::parseVarDecl(){
     decl->type = type;
     decl->line = nameLine;
     decl->col = nameCol;
+    if(xref) xref->declare(name, nameLine, nameCol);
 
     return decl;
 }
@@ -72,14 +80,15 @@ const std::unordered_set<TokenType> literalTypes = {
     TokenType::BOOL_LITERAL
 };
 
-std::unique_ptr<FactorNode> Parser::parseFactor(){
-    // could be IDENTIFIER | literal | "(" expression ")" 
+std::unique_ptr<FactorNode> Parser::parseOperand(){
+    // could be IDENTIFIER | literal, "(" expression ")" is handled by parseExpression
     // std::cout << currentToken.lexeme << " " << tokenTypeToString(currentToken.type) << "\n"; 
     if(currentToken.type == TokenType::IDENTIFIER){
         auto node = std::make_unique<IdentifierNode> ();
         node->identifier = currentToken.lexeme;
         node->col = currentToken.col;
         node->line = currentToken.line;
+        if(xref) xref->read(node->identifier, node->line, node->col);
         advance();
         return node;
     }
@@ -92,15 +101,6 @@ std::unique_ptr<FactorNode> Parser::parseFactor(){
         advance();
         return node;
     }
-    else if(currentToken.type == TokenType::LPARABRACE){
-        advance(); // consume "("
-        auto expr = parseExpression();
-        expect(TokenType::RPARABRACE);
-
-        auto node = std::make_unique<ParenExpressionNode> ();
-        node->expression = std::move(expr);
-        return node;
-    }
     else{
         raiseError("Unexpected token in factor: " + currentToken.lexeme);
         advance();
@@ -108,80 +108,106 @@ std::unique_ptr<FactorNode> Parser::parseFactor(){
     }
 }
 
-std::unique_ptr<TermNode> Parser::parseTerm(){
-    auto factor = parseFactor();
-    auto term = std::make_unique<TermNode>();
-    term->factor = std::move(factor);
-    return term;
+bool Parser::tooDeep(int depth){
+    if(maxNesting <= 0 || depth <= maxNesting) return false;
+    raiseError("Nesting deeper than " + std::to_string(maxNesting) + " levels of if blocks and parentheses");
+    return true;
 }
 
-std::unique_ptr<ExpressionNode> Parser::parseExpression(){
-    // first we get left term
-    // std::cout << currentToken.lexeme << std::endl;
-    auto leftTerm = parseTerm();
-    if(!leftTerm){
-        // recover gracefully: create an empty expression (or return nullptr)
-        raiseError("Expected expression term");
-        return nullptr;
+void Parser::skipNested(TokenType open, TokenType close){
+    // currentToken is the opening token, stop after its partner
+    int depth = 0;
+    while(currentToken.type != TokenType::EOF_TOKEN){
+        if(currentToken.type == open) depth++;
+        else if(currentToken.type == close && --depth == 0){
+            advance();
+            return;
+        }
+        advance();
     }
-    auto expr = std::make_unique<ExpressionNode> ();
-    expr->left = std::move(leftTerm);
-
-    // line and col for error
-    expr->line = currentToken.line;
-    expr->col = currentToken.col;
-
-    // next we get operator : PLUS, MINUS
-    TokenType op = TokenType::TOKEN_UNKNOWN;
-    expr->right = nullptr;
-
-    // while we have + or -
-    while(currentToken.type == TokenType::SYM_PLUS || currentToken.type == TokenType::SYM_MINUS){
-        op = currentToken.type;
-        int opLine = currentToken.line;
-        int opCol  = currentToken.col;
+}
 
-        // consume op
-        advance();
-        auto rightTerm = parseTerm();
-
-        // if no rightTerm that means its a literal or identifier
-        // which means op = Unknown and rightTerm = nullptr
-        if(!rightTerm){
-            // syntax error: operator without an operand
-            raiseError("Expected term after '+' or '-'");
-            // best effort: stop parsing expression and return what we have
-            break;
+std::unique_ptr<ExpressionNode> Parser::parseExpression(){
+    // expression := term { ("+" | "-") term }, term := IDENTIFIER | literal | "(" expression ")"
+    // Every open "(" is one level on this stack instead of a recursive call,
+    // so parentheses nested any number of levels deep only use heap memory.
+    struct Level{
+        std::unique_ptr<ExpressionNode> expr;
+        TokenType op = TokenType::TOKEN_UNKNOWN;
+        int opLine = 0, opCol = 0;
+    };
+    std::vector<Level> levels(1);
+
+    while(true){
+        std::unique_ptr<FactorNode> factor;
+        if(currentToken.type == TokenType::LPARABRACE){
+            if(!tooDeep(nesting + static_cast<int>(levels.size()))){
+                advance(); // consume "("
+                levels.emplace_back();
+                continue;
+            }
+            // the whole group is dropped, the factor stays empty
+            skipNested(TokenType::LPARABRACE, TokenType::RPARABRACE);
+        }
+        else{
+            factor = parseOperand();
         }
 
-        // create a new expression node where current expr becomes the left (wrap)
-        auto newExpr = std::make_unique<ExpressionNode>();
-        // left of newExpr is a TermNode that wraps the previous expression
-        // i.e expression processed till now
-
-        // set line and col from operator token
-        newExpr->line = opLine;
-        newExpr->col = opCol;
-
-        // This makes it a lot messy 
-        // TODO: improve this in the next project
-        auto wrapperFactor  = std::make_unique<ParenExpressionNode> ();
-        wrapperFactor->expression = std::move(expr);
-
-        auto wrapperTerm = std::make_unique<TermNode> ();
-        wrapperTerm->factor = std::move(wrapperFactor);
-
-        newExpr->left = std::move(wrapperTerm);
-        newExpr->op = op;
-        
-        // now for right part
-        auto rightWrapperTerm = std::move(rightTerm);
-        newExpr->right = std::move(rightWrapperTerm);
-
-        expr = std::move(newExpr);
-    }    
-
-    return expr;
+        // add the term to the innermost level, then close every level that ends here
+        while(true){
+            Level& level = levels.back();
+            auto term = std::make_unique<TermNode>();
+            term->factor = std::move(factor);
+
+            if(!level.expr){
+                // first term is the left side
+                level.expr = std::make_unique<ExpressionNode> ();
+                level.expr->left = std::move(term);
+                // line and col for error
+                level.expr->line = currentToken.line;
+                level.expr->col = currentToken.col;
+                level.expr->right = nullptr;
+            }
+            else{
+                // create a new expression node where current expr becomes the left (wrap)
+                // i.e expression processed till now, line and col from operator token
+                auto newExpr = std::make_unique<ExpressionNode>();
+                newExpr->line = level.opLine;
+                newExpr->col = level.opCol;
+
+                // This makes it a lot messy 
+                // TODO: improve this in the next project
+                auto wrapperFactor  = std::make_unique<ParenExpressionNode> ();
+                wrapperFactor->expression = std::move(level.expr);
+
+                auto wrapperTerm = std::make_unique<TermNode> ();
+                wrapperTerm->factor = std::move(wrapperFactor);
+
+                newExpr->left = std::move(wrapperTerm);
+                newExpr->op = level.op;
+                newExpr->right = std::move(term);
+                level.expr = std::move(newExpr);
+            }
+
+            // while we have + or -, consume op and go for the next term
+            if(currentToken.type == TokenType::SYM_PLUS || currentToken.type == TokenType::SYM_MINUS){
+                level.op = currentToken.type;
+                level.opLine = currentToken.line;
+                level.opCol = currentToken.col;
+                advance();
+                break;
+            }
+
+            if(levels.size() == 1) return std::move(level.expr);
+
+            // the parenthesized expression is a term of the level around it
+            auto paren = std::make_unique<ParenExpressionNode> ();
+            paren->expression = std::move(level.expr);
+            levels.pop_back();
+            expect(TokenType::RPARABRACE);
+            factor = std::move(paren);
+        }
+    }
 }
 
 std::unique_ptr<AssignmentNode> Parser::parseAssignment(){
@@ -197,6 +223,7 @@ std::unique_ptr<AssignmentNode> Parser::parseAssignment(){
     std::string name = currentToken.lexeme;
     int nameLine = currentToken.line;
     int nameCol = currentToken.col;
+    if(xref) xref->write(name, nameLine, nameCol);
     
     // next we check for expression
     advance();
@@ -235,27 +262,23 @@ std::unique_ptr<ConditionNode> Parser::parseCondition(){
     return cond;
 }
 
-std::unique_ptr<IfNode> Parser::parseIfStatement(){
+std::unique_ptr<IfNode> Parser::parseIfHeader(){
     // this means currentToken = IF
+    // parses up to the "{", the body belongs to parseControlBlock
+    int ifLine = currentToken.line, ifCol = currentToken.col;
+    if(xref) xref->enterIf(ifLine, ifCol);
     advance();
     expect(TokenType::LPARABRACE);
 
     auto condition = parseCondition();
     expect(TokenType::RPARABRACE);
     expect(TokenType::LCURLYBRACE);
+    if(xref) xref->enterIfBody();
 
     auto ifnode = std::make_unique<IfNode>();
+    ifnode->line = ifLine;
+    ifnode->col = ifCol;
     ifnode->condition = std::move(condition);
-
-    while(currentToken.type != TokenType::RCURLYBRACE && currentToken.type != TokenType::EOF_TOKEN){
-
-        auto stmt = parseStatement();
-        ifnode->statements.push_back(std::move(stmt));
-    }
-
-
-    expect(TokenType::RCURLYBRACE);
-
     return ifnode;
 }
 
@@ -274,10 +297,7 @@ std::unique_ptr<StatementNode> Parser::parseStatement(){
         return parseAssignment();
     }
 
-    // ifNode
-    else if(currentToken.type == TokenType::KW_TOKEN_IF){
-        return parseIfStatement();
-    }
+    // ifNode is opened by parseControlBlock
     else {
         raiseError("Unexpected token in statement: " + currentToken.lexeme);
         advance();
@@ -298,6 +318,7 @@ std::unique_ptr<ControlNode> Parser::parseControlBlock(){
     
     // if name is there
     std::string name = currentToken.lexeme;
+    if(xref) xref->enterControl(name, currentToken.line);
     advance();
     
     // next we expect "{"
@@ -309,13 +330,41 @@ std::unique_ptr<ControlNode> Parser::parseControlBlock(){
     control->name = name;
 
     // expecting statements until "}" i.e RCURLYBRACE or EOF
-    while(currentToken.type != TokenType::RCURLYBRACE && currentToken.type!= TokenType::EOF_TOKEN){
-        // parse statements
+    // if bodies are kept on an explicit stack instead of recursing,
+    // the innermost open if is at the back and gets the statements
+    std::vector<IfNode*> open;
+    while(true){
+        if(currentToken.type == TokenType::RCURLYBRACE || currentToken.type == TokenType::EOF_TOKEN){
+            if(open.empty()) break;
+            // end of the innermost if body
+            expect(TokenType::RCURLYBRACE);
+            open.pop_back();
+            nesting = open.size();
+            if(xref) xref->leaveIf();
+            continue;
+        }
+
+        auto& statements = open.empty() ? control->statements : open.back()->statements;
+        if(currentToken.type == TokenType::KW_TOKEN_IF){
+            if(tooDeep(open.size() + 1)){
+                skipNested(TokenType::LCURLYBRACE, TokenType::RCURLYBRACE);
+                continue;
+            }
+            auto ifnode = parseIfHeader();
+            open.push_back(ifnode.get());
+            nesting = open.size();
+            statements.push_back(std::move(ifnode));
+            continue;
+        }
+
+        // parse statements, an if body keeps the failed ones as nullptr
         auto stmt = parseStatement();
-        if(stmt){
-            control->statements.push_back(std::move(stmt));
+        if(stmt || !open.empty()){
+            statements.push_back(std::move(stmt));
         }
     }
+    nesting = 0;
+    if(xref) xref->leaveControl();
 
     // next expect RCURLYBRACE
     expect(TokenType::RCURLYBRACE);
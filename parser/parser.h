@@ -4,28 +4,52 @@
 #include "lexer/lexer.h"
 #include "ast.h"
 
+class XrefBuilder;
+
+// deepest nesting of if blocks and parentheses (counted together) the parser accepts.
+// Anything deeper is reported as an error instead of building a deeper tree,
+// which keeps the passes after the parser within a bounded depth. 0 means no limit.
+constexpr int DEFAULT_MAX_NESTING = 1000;
+
 class Parser{
 private:
     Lexer &lexer;
     Token currentToken;
     std::vector<std::string>errors;
 
+    // the parser itself never recurses on nesting, open ifs and parentheses live on
+    // explicit stacks; nesting is the number of if bodies open around the current statement
+    static int defaultMaxNesting;
+    int maxNesting;
+    int nesting = 0;
+
+    // receives every declaration, read and write as it is parsed (see xref/), nullptr when off
+    XrefBuilder* xref = nullptr;
+
     void raiseError(const std::string& msg);
 
     std::unique_ptr<ControlNode> parseControlBlock();
     std::unique_ptr<StatementNode> parseStatement();
     std::unique_ptr<VarDeclNode> parseVarDecl();
     std::unique_ptr<AssignmentNode> parseAssignment();
-    std::unique_ptr<IfNode> parseIfStatement();
+    std::unique_ptr<IfNode> parseIfHeader();
     std::unique_ptr<ExpressionNode> parseExpression();
-    std::unique_ptr<TermNode>parseTerm();
-    std::unique_ptr<FactorNode>parseFactor();
+    std::unique_ptr<FactorNode>parseOperand();
     std::unique_ptr<ConditionNode>parseCondition();
 
+    // reports the error when depth is over the limit
+    bool tooDeep(int depth);
+    // skips from an opening token past its matching closing token
+    void skipNested(TokenType open, TokenType close);
+
     void expect(TokenType tok);
     void advance();
 public:
     Parser(Lexer &lexer);
+    // limit for parsers created afterwards / for this parser
+    static void setDefaultMaxNesting(int levels);
+    void setMaxNesting(int levels) { maxNesting = levels; }
+    void setXref(XrefBuilder* builder) { xref = builder; }
     std::unique_ptr<ProgramNode> parseProgram();
     const std::vector<std::string> & getErrors();
 };
@@ -0,0 +1,122 @@
+#include "branchProfile.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+BranchProfiler::BranchProfiler(const CompiledProgram& prog) : program(prog){
+    for(const auto& block : program.blocks){
+        counters.emplace_back(block.code.size());
+    }
+}
+
+void BranchProfiler::clear(){
+    for(auto& block : counters){
+        for(auto& c : block) c = BranchCounter();
+    }
+    tickCount = 0;
+}
+
+// autolang branch profile 1
+// ticks <n>
+// block <name> <ifs>
+// if <id> <line> <runs> <taken>    one per if of the block, by id
+void BranchProfiler::write(std::ostream& out) const{
+    out << "autolang branch profile 1\n";
+    out << "ticks " << tickCount << "\n";
+    for(size_t b = 0; b < program.blocks.size(); b++){
+        const CompiledBlock& block = program.blocks[b];
+        out << "block " << block.name << " " << block.ifs.size() << "\n";
+        for(uint32_t id = 0; id < block.ifs.size(); id++){
+            const BranchCounter& c = counts(b, id);
+            out << "if " << id << " " << block.ifs[id].line << " " << c.runs << " " << c.taken << "\n";
+        }
+    }
+}
+
+bool BranchProfiler::save(const std::string& path, std::string& error) const{
+    std::ofstream out(path);
+    if(!out){
+        error = "cannot write " + path;
+        return false;
+    }
+    write(out);
+    out.close();
+    if(!out){
+        error = "failed writing " + path;
+        return false;
+    }
+    return true;
+}
+
+bool BranchProfile::load(const std::string& path, std::string& error){
+    std::ifstream in(path);
+    if(!in){
+        error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    if(!parse(buffer.str(), error)){
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+bool BranchProfile::parse(const std::string& text, std::string& error){
+    blocks.clear();
+    std::istringstream in(text);
+    std::string line;
+    int lineNo = 0;
+    std::vector<IfProfile>* block = nullptr;
+    size_t expected = 0;
+    // every if of a block has a line of its own, a count beyond that is not worth allocating
+    size_t lineCount = std::count(text.begin(), text.end(), '\n') + 1;
+    auto fail = [&](const std::string& msg){
+        error = "line " + std::to_string(lineNo) + ": " + msg;
+        blocks.clear();
+        return false;
+    };
+
+    while(std::getline(in, line)){
+        lineNo++;
+        if(lineNo == 1){
+            if(line != "autolang branch profile 1") return fail("not a branch profile (version 1)");
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string word;
+        if(!(fields >> word)) continue;
+
+        if(word == "ticks") continue;
+        if(word == "block"){
+            if(block && block->size() != expected) return fail("block before it has all its ifs");
+            std::string name;
+            if(!(fields >> name >> expected)) return fail("expected block <name> <ifs>");
+            if(blocks.count(name)) return fail("block '" + name + "' is in the profile twice");
+            if(expected > lineCount) return fail("block '" + name + "' has " + std::to_string(expected) + " ifs, more than the profile has lines");
+            block = &blocks[name];
+            block->reserve(expected);
+        }
+        else if(word == "if"){
+            uint64_t id;
+            IfProfile entry;
+            if(!block) return fail("if outside a block");
+            if(!(fields >> id >> entry.line >> entry.runs >> entry.taken)) return fail("expected if <id> <line> <runs> <taken>");
+            if(id != block->size() || id >= expected) return fail("if " + std::to_string(id) + " out of order");
+            if(entry.taken > entry.runs) return fail("if taken more often than it ran");
+            block->push_back(entry);
+        }
+        else{
+            return fail("unknown record '" + word + "'");
+        }
+    }
+    if(lineNo == 0) return fail("empty profile");
+    if(block && block->size() != expected) return fail("last block is missing ifs");
+    return true;
+}
+
+const std::vector<IfProfile>* BranchProfile::find(const std::string& block) const{
+    auto it = blocks.find(block);
+    return it == blocks.end() ? nullptr : &it->second;
+}
@@ -0,0 +1,78 @@
+#ifndef PROFILE_BRANCH_PROFILE_H
+#define PROFILE_BRANCH_PROFILE_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../runtime/bytecode.h"
+
+// Branch profiles, see PROFILE.md.
+// An if is named by its block and its if id, the position of the if in the block in
+// source order (CompiledBlock::ifs), which does not depend on how the code is laid out,
+// and checked against the line of the if when a profile is used.
+
+// how often the condition of one if was evaluated and how often it was true
+struct BranchCounter{
+    uint64_t runs = 0;
+    uint64_t taken = 0;
+};
+
+// Counts every if of a program while it runs (runProgram(program, frames, profiler)).
+// The counters of a block are indexed by pc so the interpreter needs no lookup.
+class BranchProfiler{
+    private:
+    const CompiledProgram& program;
+    std::vector<std::vector<BranchCounter>> counters;
+    uint64_t tickCount = 0;
+    BranchCounter never;
+
+    public:
+    explicit BranchProfiler(const CompiledProgram& program);
+
+    BranchCounter* block(size_t b) { return counters[b].data(); }
+    // an if inside a decision table is never counted, it reads as never run
+    const BranchCounter& counts(size_t block, uint32_t ifId) const {
+        uint32_t pc = program.blocks[block].ifs[ifId].pc;
+        return pc == NO_JUMP ? never : counters[block][pc];
+    }
+    void addTick() { tickCount++; }
+    uint64_t ticks() const { return tickCount; }
+    void clear();
+
+    // text profile file, what BranchProfile::load() reads
+    bool save(const std::string& path, std::string& error) const;
+    void write(std::ostream& out) const;
+};
+
+// an if below this share of runs taken, with at least PROFILE_MIN_RUNS runs, is cold
+constexpr double PROFILE_COLD_RATIO = 0.05;
+constexpr uint64_t PROFILE_MIN_RUNS = 100;
+
+struct IfProfile{
+    int line = 0;
+    uint64_t runs = 0;
+    uint64_t taken = 0;
+};
+
+// A profile file loaded for the compiler (Compiler::setBranchProfile())
+class BranchProfile{
+    private:
+    std::unordered_map<std::string, std::vector<IfProfile>> blocks;
+
+    public:
+    bool load(const std::string& path, std::string& error);
+    bool parse(const std::string& text, std::string& error);
+
+    // the ifs of a block by if id, nullptr when the profile has no such block
+    const std::vector<IfProfile>* find(const std::string& block) const;
+    size_t blockCount() const { return blocks.size(); }
+
+    static bool isCold(const IfProfile& entry) {
+        return entry.runs >= PROFILE_MIN_RUNS && entry.taken < entry.runs * PROFILE_COLD_RATIO;
+    }
+};
+
+#endif // PROFILE_BRANCH_PROFILE_H
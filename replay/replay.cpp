@@ -0,0 +1,380 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+#include "../runtime/compiler.h"
+#include "../runtime/interpreter.h"
+#include "../runtime/reactive.h"
+#include "../image/image.h"
+#include "../profile/branchProfile.h"
+#include "../telemetry/latency.h"
+#include "../telemetry/telemetry.h"
+
+// Replays a recorded sensor trace through every control block of a program.
+// Each sample: bound trace columns are written into the block frames (or the signal bus),
+// all blocks run once (one tick), the chosen output slots are appended to
+// the output trace.
+
+struct InputBinding{
+    uint32_t column;
+    uint32_t block;
+    int slot;
+    uint8_t* dest;
+    TypeTag columnType;
+    TypeTag slotType;
+    int fracBits; // float slots of a fixed point program hold Q format values
+};
+
+struct OutputBinding{
+    const uint8_t* src;
+    TypeTag slotType;
+    int fracBits;
+};
+
+static void usage(const char* prog){
+    std::cerr << "Usage: " << prog << " <program.alang|program.alc> <trace.altr|trace.csv> [options]\n"
+              << "  -o <file>            write outputs to a binary trace\n"
+              << "  --bind <var>=<col>   bind a variable (var or block.var) to a trace column\n"
+              << "  --out <var>          record a variable (var or block.var) in the output trace\n"
+              << "  --repeat <n>         replay the trace n times (for benchmarking)\n"
+              << "  --reactive           only re-run blocks whose inputs changed\n"
+              << "  --no-cse             compute repeated expressions again instead of reusing them\n"
+              << "  --decision-tables    compile if trees over constants into table lookups\n"
+              << "  --fixed <Qm.n>       run float logic in fixed point, e.g. Q15.16\n"
+              << "  --telemetry <file>   record block runs, writes and ifs (decode with autolangtelemetry)\n"
+              << "  --latency            print p50/p99/p99.9/max run time of every block\n"
+              << "  --deadline <us>      the same, counting runs longer than us microseconds as overruns\n"
+              << "  --profile <file>     count how often every if is taken and write a branch profile\n"
+              << "  --layout <file>      compile with cold if bodies out of line, by a branch profile\n"
+              << "  columns are bound by name to top level variables automatically\n"
+              << "  a .alc image is loaded as compiled, --no-cse, --decision-tables, --fixed and --layout do not apply to it\n";
+}
+
+// "var" matches that top level variable in every block, "block.var" in one block
+static std::vector<std::pair<size_t, int>> resolveTarget(const CompiledProgram& program, const std::string& target){
+    std::vector<std::pair<size_t, int>> found;
+    size_t dot = target.find('.');
+    std::string blockName = dot == std::string::npos ? "" : target.substr(0, dot);
+    std::string var = dot == std::string::npos ? target : target.substr(dot + 1);
+    for(size_t b = 0; b < program.blocks.size(); b++){
+        if(!blockName.empty() && program.blocks[b].name != blockName) continue;
+        int slot = program.findTopLevelSlot(b, var);
+        if(slot >= 0) found.push_back({b, slot});
+    }
+    return found;
+}
+
+// converts one 4 byte trace value to the representation of the slot
+static inline uint32_t convert(const InputBinding& in, uint32_t bits){
+    if(in.slotType == TypeTag::TYPE_BOOL){
+        return bits != 0;
+    }
+    else if(in.slotType == TypeTag::TYPE_FLOAT && in.fracBits != FIXED_POINT_OFF){
+        double value;
+        if(in.columnType == TypeTag::TYPE_FLOAT) value = bitsToFloat(bits);
+        else value = static_cast<int32_t>(bits);
+        // sensor values outside the format saturate
+        int32_t q = saturateFixed(value, in.fracBits);
+        return static_cast<uint32_t>(q);
+    }
+    else if(in.slotType == in.columnType || in.columnType == TypeTag::TYPE_BOOL){
+        return bits;
+    }
+    else if(in.slotType == TypeTag::TYPE_FLOAT){
+        int32_t i;
+        std::memcpy(&i, &bits, sizeof(i));
+        return floatBits(static_cast<float>(i));
+    }
+    int32_t i = saturateTraceInt(bitsToFloat(bits));
+    uint32_t out;
+    std::memcpy(&out, &i, sizeof(out));
+    return out;
+}
+
+static inline void feed(const InputBinding& in, uint32_t bits){
+    uint32_t value = convert(in, bits);
+    if(in.slotType == TypeTag::TYPE_BOOL) *in.dest = static_cast<uint8_t>(value);
+    else std::memcpy(in.dest, &value, sizeof(value));
+}
+
+int main(int argc, char* argv[]){
+    if(argc < 3){
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string programPath = argv[1];
+    std::string tracePath = argv[2];
+    std::string outPath;
+    std::string telemetryPath;
+    std::string profilePath;
+    std::vector<std::pair<std::string, std::string>> binds;
+    std::vector<std::string> outs;
+    long repeat = 1;
+    bool reactive = false;
+    bool latency = false;
+    double deadlineMicros = 0;
+
+    for(int i = 3; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "-o" && hasValue) outPath = argv[++i];
+        else if(arg == "--out" && hasValue) outs.push_back(argv[++i]);
+        else if(arg == "--reactive") reactive = true;
+        else if(arg == "--telemetry" && hasValue) telemetryPath = argv[++i];
+        else if(arg == "--latency") latency = true;
+        else if(arg == "--deadline" && hasValue){
+            latency = true;
+            deadlineMicros = std::atof(argv[++i]);
+        }
+        else if(arg == "--profile" && hasValue) profilePath = argv[++i];
+        else if(arg == "--layout" && hasValue){
+            auto profile = std::make_shared<BranchProfile>();
+            std::string err;
+            if(!profile->load(argv[++i], err)){
+                std::cerr << "ERROR :: " << err << "\n";
+                return 1;
+            }
+            Compiler::setDefaultBranchProfile(profile);
+        }
+        else if(arg == "--no-cse") Compiler::setDefaultValueNumbering(false);
+        else if(arg == "--decision-tables") Compiler::setDefaultDecisionTables(true);
+        else if(arg == "--fixed" && hasValue){
+            int fracBits;
+            if(!parseQFormat(argv[++i], fracBits)){
+                std::cerr << "ERROR :: bad fixed point format '" << argv[i] << "', expected Qm.n with m + n = 31\n";
+                return 1;
+            }
+            Compiler::setDefaultFixedPoint(fracBits);
+        }
+        else if(arg == "--repeat" && hasValue) repeat = std::max(1L, std::atol(argv[++i]));
+        else if(arg == "--bind" && hasValue){
+            std::string spec = argv[++i];
+            size_t eq = spec.find('=');
+            if(eq == std::string::npos){
+                std::cerr << "ERROR :: bad binding '" << spec << "', expected var=column\n";
+                return 1;
+            }
+            binds.push_back({spec.substr(0, eq), spec.substr(eq + 1)});
+        }
+        else{
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    CompiledProgram program;
+    bool isImage = programPath.size() > 4 && programPath.compare(programPath.size() - 4, 4, ".alc") == 0;
+    if(isImage){
+        ProgramImage image;
+        std::string err;
+        if(!image.open(programPath, err)){
+            std::cerr << "ERROR :: " << err << "\n";
+            return 1;
+        }
+        image.toProgram(program);
+    }
+    else{
+        std::ifstream file(programPath);
+        if(!file){
+            std::cerr << "ERROR :: FILE NOT FOUND :: " << programPath << std::endl;
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+
+        std::vector<std::string> errors;
+        std::vector<std::string> warnings;
+        if(!compileSource(buffer.str(), program, errors, &warnings)){
+            std::cerr << "Compile Errors occured!\n";
+            for(const auto& err : errors) std::cerr << err << "\n";
+            return 1;
+        }
+        for(const auto& w : warnings) std::cerr << "WARNING :: " << w << "\n";
+    }
+
+    Trace trace;
+    std::string err;
+    if(!trace.load(tracePath, err)){
+        std::cerr << "ERROR :: " << err << "\n";
+        return 1;
+    }
+
+    FrameStore frames(program);
+
+    // every column binds to the variables of the same name, --bind adds more
+    for(const auto& column : trace.columns){
+        binds.push_back({column.name, column.name});
+    }
+    std::vector<InputBinding> inputs;
+    for(const auto& bind : binds){
+        int column = trace.findColumn(bind.second);
+        if(column < 0){
+            std::cerr << "ERROR :: trace has no column '" << bind.second << "'\n";
+            return 1;
+        }
+        for(const auto& target : resolveTarget(program, bind.first)){
+            const FrameSlot& slot = program.blocks[target.first].layout.slots[target.second];
+            InputBinding in;
+            in.column = column;
+            in.block = target.first;
+            in.slot = target.second;
+            // a shared signal is fed through its bus cell, every block importing it sees the value
+            in.dest = frames.slotData(target.first, target.second);
+            in.columnType = trace.columns[column].type;
+            in.slotType = slot.type;
+            in.fracBits = program.fracBits;
+            inputs.push_back(in);
+        }
+    }
+
+    std::vector<OutputBinding> outputs;
+    std::vector<TraceColumn> outColumns;
+    for(const auto& target : outs){
+        auto found = resolveTarget(program, target);
+        if(found.empty()){
+            std::cerr << "ERROR :: no top level variable '" << target << "'\n";
+            return 1;
+        }
+        for(const auto& f : found){
+            const FrameSlot& slot = program.blocks[f.first].layout.slots[f.second];
+            outputs.push_back(OutputBinding{frames.slotData(f.first, f.second), slot.type, program.fracBits});
+            outColumns.push_back(TraceColumn{program.blocks[f.first].name + "." + slot.name, slot.type});
+        }
+    }
+
+    TraceWriter writer;
+    bool writing = !outPath.empty();
+    if(writing && !writer.open(outPath, outColumns, err)){
+        std::cerr << "ERROR :: " << err << "\n";
+        return 1;
+    }
+    std::vector<uint32_t> outRow(outputs.size());
+
+    ReactiveExecutor executor(program, frames);
+
+    Telemetry telemetry(program);
+    TelemetryRing* ring = nullptr;
+    if(!telemetryPath.empty()){
+        if(!telemetry.open(telemetryPath, err)){
+            std::cerr << "ERROR :: " << err << "\n";
+            return 1;
+        }
+        ring = telemetry.addRing();
+        executor.setTelemetry(ring);
+    }
+
+    LatencyRecorder latencies(program);
+    LatencyTable* table = nullptr;
+    if(latency){
+        if(ring){
+            std::cerr << "ERROR :: --latency times untraced runs, it does not combine with --telemetry\n";
+            return 1;
+        }
+        if(deadlineMicros > 0) latencies.setBudget(static_cast<uint64_t>(deadlineMicros * 1000));
+        table = latencies.addTable();
+        executor.setLatency(table);
+    }
+
+    // if ids come from the source, an image does not have them
+    BranchProfiler profiler(program);
+    bool profiling = !profilePath.empty();
+    if(profiling && (isImage || reactive || ring || table)){
+        std::cerr << "ERROR :: --profile counts full ticks of a source program, it does not combine with a .alc image, "
+                  << "--reactive, --telemetry or --latency\n";
+        return 1;
+    }
+
+    size_t samples = trace.samples();
+    auto start = std::chrono::steady_clock::now();
+    for(long r = 0; r < repeat; r++){
+        for(size_t s = 0; s < samples; s++){
+            const uint32_t* row = trace.row(s);
+            if(reactive){
+                for(const auto& in : inputs){
+                    uint32_t value = convert(in, row[in.column]);
+                    uint8_t byte = static_cast<uint8_t>(value);
+                    executor.write(in.block, in.slot, in.slotType == TypeTag::TYPE_BOOL ? static_cast<const void*>(&byte) : &value);
+                }
+                executor.tick();
+            }
+            else{
+                for(const auto& in : inputs){
+                    feed(in, row[in.column]);
+                }
+                if(ring) runProgram(program, frames, *ring);
+                else if(table) runProgram(program, frames, *table);
+                else if(profiling) runProgram(program, frames, profiler);
+                else runProgram(program, frames);
+            }
+
+            if(writing){
+                for(size_t o = 0; o < outputs.size(); o++){
+                    // bool slots are one byte, everything else four
+                    uint32_t bits = 0;
+                    if(outputs[o].slotType == TypeTag::TYPE_BOOL) bits = *outputs[o].src;
+                    else std::memcpy(&bits, outputs[o].src, sizeof(bits));
+                    if(outputs[o].slotType == TypeTag::TYPE_FLOAT && outputs[o].fracBits != FIXED_POINT_OFF){
+                        // output traces always hold floats
+                        bits = floatBits(static_cast<float>(fixedToDouble(static_cast<int32_t>(bits), outputs[o].fracBits)));
+                    }
+                    outRow[o] = bits;
+                }
+                writer.append(outRow.data());
+            }
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if(writing && !writer.close()){
+        std::cerr << "ERROR :: failed writing " << outPath << "\n";
+        return 1;
+    }
+    if(ring && !telemetry.close(err)){
+        std::cerr << "ERROR :: " << err << "\n";
+        return 1;
+    }
+    if(profiling && !profiler.save(profilePath, err)){
+        std::cerr << "ERROR :: " << err << "\n";
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double total = static_cast<double>(samples) * repeat;
+    std::cout << "replayed " << static_cast<uint64_t>(total) << " samples"
+              << " through " << program.blocks.size() << " blocks"
+              << " in " << seconds << " s"
+              << " (" << (seconds > 0 ? total / seconds : 0.0) << " samples/sec)\n";
+    if(reactive){
+        uint64_t all = executor.blocksRun() + executor.blocksSkipped();
+        std::cout << "reactive: ran " << executor.blocksRun() << " of " << all << " block evaluations"
+                  << " (" << (all ? 100.0 * executor.blocksSkipped() / all : 0.0) << "% saved)\n";
+    }
+    if(ring){
+        std::cout << "telemetry: " << telemetry.events() << " events written to " << telemetryPath
+                  << ", " << telemetry.dropped() << " dropped\n";
+    }
+    if(profiling){
+        size_t ifs = 0, cold = 0;
+        for(size_t b = 0; b < program.blocks.size(); b++){
+            for(uint32_t id = 0; id < program.blocks[b].ifs.size(); id++){
+                const BranchCounter& c = profiler.counts(b, id);
+                ifs++;
+                if(BranchProfile::isCold(IfProfile{0, c.runs, c.taken})) cold++;
+            }
+        }
+        std::cout << "profile: " << ifs << " ifs, " << cold << " cold, written to " << profilePath << "\n";
+    }
+    if(table){
+        std::cout << "\n";
+        latencies.report(std::cout);
+    }
+    return 0;
+}
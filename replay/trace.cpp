@@ -0,0 +1,252 @@
+#include "trace.h"
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile(){
+    if(bytes && length) munmap(const_cast<uint8_t*>(bytes), length);
+}
+
+bool MappedFile::open(const std::string& path, std::string& err){
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        err = "cannot open " + path;
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0){
+        ::close(fd);
+        err = "cannot stat " + path;
+        return false;
+    }
+    length = st.st_size;
+    if(length == 0){
+        ::close(fd);
+        return true;
+    }
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(mapped == MAP_FAILED){
+        length = 0;
+        err = "cannot mmap " + path;
+        return false;
+    }
+    // replay walks the trace front to back exactly once
+    madvise(mapped, length, MADV_SEQUENTIAL);
+    bytes = static_cast<const uint8_t*>(mapped);
+    return true;
+}
+
+uint32_t encodeTraceValue(TypeTag type, double value){
+    uint32_t bits = 0;
+    if(type == TypeTag::TYPE_FLOAT){
+        float f = static_cast<float>(value);
+        std::memcpy(&bits, &f, sizeof(bits));
+    }
+    else if(type == TypeTag::TYPE_BOOL){
+        bits = value != 0.0 ? 1 : 0;
+    }
+    else{
+        int32_t i = saturateTraceInt(value);
+        std::memcpy(&bits, &i, sizeof(bits));
+    }
+    return bits;
+}
+
+double decodeTraceValue(TypeTag type, uint32_t bits){
+    if(type == TypeTag::TYPE_FLOAT){
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+    int32_t i;
+    std::memcpy(&i, &bits, sizeof(i));
+    return i;
+}
+
+static bool parseTypeName(const std::string& name, TypeTag& type){
+    if(name == "int") type = TypeTag::TYPE_INT;
+    else if(name == "float") type = TypeTag::TYPE_FLOAT;
+    else if(name == "bool") type = TypeTag::TYPE_BOOL;
+    else return false;
+    return true;
+}
+
+int Trace::findColumn(const std::string& name) const{
+    for(size_t i = 0; i < columns.size(); i++){
+        if(columns[i].name == name) return i;
+    }
+    return -1;
+}
+
+bool Trace::load(const std::string& path, std::string& err){
+    if(!file.open(path, err)) return false;
+    if(file.size() >= sizeof(TraceHeader) && std::memcmp(file.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0){
+        return loadBinary(err);
+    }
+    return loadCsv(err);
+}
+
+bool Trace::loadBinary(std::string& err){
+    TraceHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if(header.version != TRACE_VERSION){
+        err = "unsupported trace version " + std::to_string(header.version);
+        return false;
+    }
+
+    // the sample count comes from the file, so the size of the rows is
+    // checked by division: samples * columns * 4 can wrap around
+    uint64_t descEnd = sizeof(TraceHeader) + uint64_t(header.columns) * sizeof(TraceColumnDesc);
+    uint64_t rowBytes = uint64_t(header.columns) * sizeof(uint32_t);
+    if(descEnd > header.dataOffset || header.dataOffset > file.size() || header.dataOffset % sizeof(uint32_t) != 0
+       || (rowBytes != 0 && header.samples > (file.size() - header.dataOffset) / rowBytes)){
+        err = "truncated or corrupt trace";
+        return false;
+    }
+
+    const TraceColumnDesc* descs = reinterpret_cast<const TraceColumnDesc*>(file.data() + sizeof(TraceHeader));
+    for(uint32_t i = 0; i < header.columns; i++){
+        TraceColumn column;
+        column.name = std::string(descs[i].name, strnlen(descs[i].name, TRACE_NAME_LEN));
+        uint8_t type = descs[i].type;
+        if(type != uint8_t(TypeTag::TYPE_INT) && type != uint8_t(TypeTag::TYPE_FLOAT) && type != uint8_t(TypeTag::TYPE_BOOL)){
+            err = "unknown type " + std::to_string(type) + " of trace column '" + column.name + "'";
+            return false;
+        }
+        column.type = static_cast<TypeTag>(type);
+        columns.push_back(column);
+    }
+
+    // zero copy: rows point straight into the mapping
+    rows = reinterpret_cast<const uint32_t*>(file.data() + header.dataOffset);
+    sampleCount = header.samples;
+    return true;
+}
+
+bool Trace::loadCsv(std::string& err){
+    const char* p = reinterpret_cast<const char*>(file.data());
+    const char* end = p + file.size();
+
+    // header: name[:type] separated by commas, untyped columns are float
+    const char* lineEnd = std::find(p, end, '\n');
+    std::string headerLine(p, lineEnd);
+    if(!headerLine.empty() && headerLine.back() == '\r') headerLine.pop_back();
+    size_t start = 0;
+    while(start <= headerLine.size()){
+        size_t comma = headerLine.find(',', start);
+        if(comma == std::string::npos) comma = headerLine.size();
+        std::string field = headerLine.substr(start, comma - start);
+        TraceColumn column;
+        size_t colon = field.find(':');
+        column.name = field.substr(0, colon);
+        if(colon != std::string::npos && !parseTypeName(field.substr(colon + 1), column.type)){
+            err = "unknown column type in '" + field + "'";
+            return false;
+        }
+        if(column.name.empty()){
+            err = "empty column name in csv header";
+            return false;
+        }
+        columns.push_back(column);
+        start = comma + 1;
+    }
+
+    p = lineEnd < end ? lineEnd + 1 : end;
+    size_t lineNo = 1;
+    while(p < end){
+        lineNo++;
+        lineEnd = std::find(p, end, '\n');
+        if(lineEnd == p || (lineEnd - p == 1 && *p == '\r')){
+            p = lineEnd + 1;
+            continue;
+        }
+
+        for(size_t c = 0; c < columns.size(); c++){
+            while(p < lineEnd && (*p == ' ' || *p == '\t')) p++;
+            double value = 0.0;
+            if(lineEnd - p >= 4 && std::memcmp(p, "true", 4) == 0){
+                value = 1.0;
+                p += 4;
+            }
+            else if(lineEnd - p >= 5 && std::memcmp(p, "false", 5) == 0){
+                p += 5;
+            }
+            else{
+                auto result = std::from_chars(p, lineEnd, value);
+                if(result.ec != std::errc()){
+                    err = "bad value on csv line " + std::to_string(lineNo);
+                    return false;
+                }
+                p = result.ptr;
+            }
+            parsed.push_back(encodeTraceValue(columns[c].type, value));
+
+            while(p < lineEnd && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+            if(c + 1 < columns.size()){
+                if(p >= lineEnd || *p != ','){
+                    err = "missing column on csv line " + std::to_string(lineNo);
+                    return false;
+                }
+                p++;
+            }
+        }
+        p = lineEnd + 1;
+        sampleCount++;
+    }
+
+    rows = parsed.data();
+    return true;
+}
+
+TraceWriter::~TraceWriter(){
+    close();
+}
+
+bool TraceWriter::open(const std::string& path, const std::vector<TraceColumn>& columns, std::string& err){
+    out = std::fopen(path.c_str(), "wb");
+    if(!out){
+        err = "cannot write " + path;
+        return false;
+    }
+    // one big buffer so every sample is a memcpy, not a syscall
+    buffer.resize(1 << 20);
+    std::setvbuf(out, buffer.data(), _IOFBF, buffer.size());
+
+    columnCount = columns.size();
+    size_t descEnd = sizeof(TraceHeader) + columns.size() * sizeof(TraceColumnDesc);
+    dataOffset = (descEnd + 63) / 64 * 64;
+
+    TraceHeader header;
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.columns = columnCount;
+    header.dataOffset = dataOffset;
+    header.samples = 0;
+    std::fwrite(&header, sizeof(header), 1, out);
+
+    for(const auto& column : columns){
+        TraceColumnDesc desc;
+        std::memset(&desc, 0, sizeof(desc));
+        desc.type = static_cast<uint8_t>(column.type);
+        std::strncpy(desc.name, column.name.c_str(), TRACE_NAME_LEN - 1);
+        std::fwrite(&desc, sizeof(desc), 1, out);
+    }
+    std::vector<char> pad(dataOffset - descEnd, 0);
+    if(!pad.empty()) std::fwrite(pad.data(), 1, pad.size(), out);
+    return true;
+}
+
+bool TraceWriter::close(){
+    if(!out) return true;
+    bool ok = std::fseek(out, offsetof(TraceHeader, samples), SEEK_SET) == 0
+           && std::fwrite(&sampleCount, sizeof(sampleCount), 1, out) == 1;
+    ok = std::fclose(out) == 0 && ok;
+    out = nullptr;
+    return ok;
+}
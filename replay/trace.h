@@ -0,0 +1,108 @@
+#ifndef REPLAY_TRACE_H
+#define REPLAY_TRACE_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../typeChecker/types.h"
+
+// Binary sensor trace (.altr)
+// header (TraceHeader), then one TraceColumnDesc per column,
+// then samples stored row major, every value 4 bytes
+// (int32 for int, IEEE float for float, int32 0/1 for bool),
+// rows start at header.dataOffset which is cache line aligned
+constexpr char TRACE_MAGIC[4] = {'A', 'L', 'T', 'R'};
+constexpr uint32_t TRACE_VERSION = 1;
+constexpr size_t TRACE_NAME_LEN = 31;
+
+struct TraceHeader{
+    char magic[4];
+    uint32_t version;
+    uint32_t columns;
+    uint32_t dataOffset;
+    uint64_t samples;
+};
+
+struct TraceColumnDesc{
+    uint8_t type; // TypeTag
+    char name[TRACE_NAME_LEN];
+};
+
+struct TraceColumn{
+    std::string name;
+    TypeTag type = TypeTag::TYPE_FLOAT;
+};
+
+// Read only memory mapping of a whole file
+class MappedFile{
+    private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+
+    public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, std::string& err);
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// A trace ready for replay: binary traces are used straight from the mapping,
+// csv traces are parsed once into the same row major layout
+class Trace{
+    private:
+    MappedFile file;
+    std::vector<uint32_t> parsed;
+    const uint32_t* rows = nullptr;
+    size_t sampleCount = 0;
+
+    bool loadBinary(std::string& err);
+    bool loadCsv(std::string& err);
+
+    public:
+    std::vector<TraceColumn> columns;
+
+    bool load(const std::string& path, std::string& err);
+
+    size_t samples() const { return sampleCount; }
+    const uint32_t* row(size_t sample) const { return rows + sample * columns.size(); }
+    int findColumn(const std::string& name) const;
+};
+
+// Writes a binary trace through one large buffer
+class TraceWriter{
+    private:
+    std::FILE* out = nullptr;
+    std::vector<char> buffer;
+    uint64_t sampleCount = 0;
+    uint32_t dataOffset = 0;
+    uint32_t columnCount = 0;
+
+    public:
+    ~TraceWriter();
+    bool open(const std::string& path, const std::vector<TraceColumn>& columns, std::string& err);
+    void append(const uint32_t* row) { std::fwrite(row, sizeof(uint32_t), columnCount, out); sampleCount++; }
+    // patches the sample count into the header
+    bool close();
+};
+
+uint32_t encodeTraceValue(TypeTag type, double value);
+double decodeTraceValue(TypeTag type, uint32_t bits);
+// value truncated to int32, NaN reads 0 and anything outside the range saturates,
+// inline so the interpreter can use it without linking the trace reader
+inline int32_t saturateTraceInt(double value){
+    // converting NaN or a value outside int32 is undefined
+    if(std::isnan(value)) return 0;
+    if(value >= 2147483647.0) return INT32_MAX;
+    if(value <= -2147483648.0) return INT32_MIN;
+    return static_cast<int32_t>(value);
+}
+
+#endif // REPLAY_TRACE_H
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+// Generates a synthetic sensor trace for benchmarking replay.
+// float columns follow a bounded random walk (like speed),
+// int columns step up and down (like gear), bool columns toggle rarely (like brakePressed)
+
+static void usage(const char* prog){
+    std::cerr << "Usage: " << prog << " <out.altr|out.csv> <samples> <name:type>... [--seed <n>] [--hold <n>]\n"
+              << "  type is int, float or bool\n"
+              << "  --hold keeps every value for n samples, like a signal sampled slower than the control loop\n";
+}
+
+int main(int argc, char* argv[]){
+    if(argc < 4){
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string outPath = argv[1];
+    uint64_t samples = std::strtoull(argv[2], nullptr, 10);
+    uint64_t seed = 42;
+    uint64_t hold = 1;
+    std::vector<TraceColumn> columns;
+
+    for(int i = 3; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg == "--seed" && i + 1 < argc){
+            seed = std::strtoull(argv[++i], nullptr, 10);
+            continue;
+        }
+        if(arg == "--hold" && i + 1 < argc){
+            hold = std::max<uint64_t>(1, std::strtoull(argv[++i], nullptr, 10));
+            continue;
+        }
+        size_t colon = arg.find(':');
+        TraceColumn column;
+        column.name = arg.substr(0, colon);
+        std::string type = colon == std::string::npos ? "float" : arg.substr(colon + 1);
+        if(type == "int") column.type = TypeTag::TYPE_INT;
+        else if(type == "float") column.type = TypeTag::TYPE_FLOAT;
+        else if(type == "bool") column.type = TypeTag::TYPE_BOOL;
+        else{
+            usage(argv[0]);
+            return 1;
+        }
+        columns.push_back(column);
+    }
+    if(columns.empty()){
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> step(-1.0, 1.0);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::vector<double> state(columns.size(), 0.0);
+    for(size_t c = 0; c < columns.size(); c++){
+        if(columns[c].type == TypeTag::TYPE_FLOAT) state[c] = 60.0;
+        if(columns[c].type == TypeTag::TYPE_INT) state[c] = 3;
+    }
+
+    uint64_t sample = 0;
+    auto advance = [&](size_t c){
+        if(sample % hold != 0) return;
+        switch(columns[c].type){
+            case TypeTag::TYPE_FLOAT:
+                state[c] = std::min(200.0, std::max(0.0, state[c] + step(rng)));
+                break;
+            case TypeTag::TYPE_INT:
+                if(chance(rng) < 0.01) state[c] = std::min(6.0, std::max(0.0, state[c] + (step(rng) > 0 ? 1 : -1)));
+                break;
+            default:
+                if(chance(rng) < 0.001) state[c] = state[c] != 0.0 ? 0.0 : 1.0;
+                break;
+        }
+    };
+
+    bool csv = outPath.size() >= 4 && outPath.compare(outPath.size() - 4, 4, ".csv") == 0;
+    if(csv){
+        std::ofstream out(outPath);
+        if(!out){
+            std::cerr << "ERROR :: cannot write " << outPath << "\n";
+            return 1;
+        }
+        for(size_t c = 0; c < columns.size(); c++){
+            out << (c ? "," : "") << columns[c].name << ":" << typeTagToString(columns[c].type);
+        }
+        out << "\n";
+        for(uint64_t s = 0; s < samples; s++){
+            for(size_t c = 0; c < columns.size(); c++){
+                advance(c);
+                out << (c ? "," : "");
+                if(columns[c].type == TypeTag::TYPE_BOOL) out << (state[c] != 0.0 ? "true" : "false");
+                else out << state[c];
+            }
+            out << "\n";
+            sample++;
+        }
+        return 0;
+    }
+
+    TraceWriter writer;
+    std::string err;
+    if(!writer.open(outPath, columns, err)){
+        std::cerr << "ERROR :: " << err << "\n";
+        return 1;
+    }
+    std::vector<uint32_t> row(columns.size());
+    for(uint64_t s = 0; s < samples; s++){
+        for(size_t c = 0; c < columns.size(); c++){
+            advance(c);
+            row[c] = encodeTraceValue(columns[c].type, state[c]);
+        }
+        writer.append(row.data());
+        sample++;
+    }
+    if(!writer.close()){
+        std::cerr << "ERROR :: failed writing " << outPath << "\n";
+        return 1;
+    }
+    return 0;
+}
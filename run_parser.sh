@@ -2,15 +2,23 @@
 
 # Usage check
 if [ $# -lt 2 ]; then
-    echo "Usage: $0 <filename> <-s|-p|-t>"
+    echo "Usage: $0 <filename> <-s|-p|-t|-l|-b|-spt...> [--format=text|json|binary] [--max-nesting N] [--stats|--stats=json] [--perf]"
     echo "  -s : Display Symbol Table"
     echo "  -p : Display Parse Tree"
     echo "  -t : Run Type Checker"
+    echo "  -l : Display Frame Layout"
+    echo "  -b : Display Bytecode"
+    echo "  -spt ... : Several of the above from one pass over the source"
+    echo "  --format=json|binary : Machine readable tokens (-s) or parse tree (-p)"
+    echo "  --max-nesting N : Deepest if/parentheses nesting before a parse error (0: no limit)"
+    echo "  --stats : Report time and memory per phase on stderr"
+    echo "  --perf  : Add hardware counters per phase (implies --stats)"
     exit 1
 fi
 
 FILE="$1"
 FLAG="$2"
+STATS="${@:3}"
 
 # Check if the file exists
 if [ ! -f "$FILE" ]; then
@@ -19,8 +27,8 @@ if [ ! -f "$FILE" ]; then
 fi
 
 # Validate flag
-if [[ "$FLAG" != "-s" && "$FLAG" != "-p" && "$FLAG" != "-t" ]]; then
-    echo "Error: Invalid option '$FLAG'. Use -s for symbol table or -p for parse tree."
+if [[ ! "$FLAG" =~ ^-[sptlb]+$ ]]; then
+    echo "Error: Invalid option '$FLAG'. Use -s for symbol table, -p for parse tree, -t for type check, -l for frame layout or -b for bytecode (or several, e.g. -spt)."
     exit 1
 fi
 
@@ -37,4 +45,4 @@ make
 
 # Run the parser with the given file and flag
 echo "Running parser on '$FILE' with option '$FLAG'..."
-./build/autolangparser "$FILE" "$FLAG"
+./build/autolangparser "$FILE" "$FLAG" $STATS
@@ -0,0 +1,102 @@
+#include "bytecode.h"
+#include "decisionTable.h"
+#include <iostream>
+
+int CompiledProgram::findTopLevelSlot(size_t block, const std::string& name) const{
+    if(block >= blocks.size()) return -1;
+    const auto& slots = blocks[block].layout.slots;
+    for(size_t i = 0; i < slots.size(); i++){
+        if(slots[i].scope == 0 && slots[i].name == name) return i;
+    }
+    return -1;
+}
+
+const char* opCodeToString(OpCode op){
+    switch(op){
+        case OpCode::PUSH_I: return "PUSH_I";
+        case OpCode::PUSH_F: return "PUSH_F";
+        case OpCode::PUSH_B: return "PUSH_B";
+        case OpCode::LOAD_I: return "LOAD_I";
+        case OpCode::LOAD_F: return "LOAD_F";
+        case OpCode::LOAD_B: return "LOAD_B";
+        case OpCode::STORE_I: return "STORE_I";
+        case OpCode::STORE_F: return "STORE_F";
+        case OpCode::STORE_B: return "STORE_B";
+        case OpCode::TEE_I: return "TEE_I";
+        case OpCode::TEE_F: return "TEE_F";
+        case OpCode::ADD_I: return "ADD_I";
+        case OpCode::SUB_I: return "SUB_I";
+        case OpCode::ADD_F: return "ADD_F";
+        case OpCode::SUB_F: return "SUB_F";
+        case OpCode::I2F: return "I2F";
+        case OpCode::I2F_UNDER: return "I2F_UNDER";
+        case OpCode::I2Q: return "I2Q";
+        case OpCode::I2Q_UNDER: return "I2Q_UNDER";
+        case OpCode::GT_I: return "GT_I";
+        case OpCode::GT_F: return "GT_F";
+        case OpCode::EQ_I: return "EQ_I";
+        case OpCode::EQ_F: return "EQ_F";
+        case OpCode::EQ_B: return "EQ_B";
+        case OpCode::JUMP_IF_FALSE: return "JUMP_IF_FALSE";
+        case OpCode::JUMP_IF_TRUE: return "JUMP_IF_TRUE";
+        case OpCode::JUMP: return "JUMP";
+        case OpCode::TABLE: return "TABLE";
+        case OpCode::DATA: return "DATA";
+        case OpCode::END: return "END";
+        default: return "UNKNOWN";
+    }
+}
+
+void printBytecode(const CompiledProgram& program, std::ostream& out){
+    if(program.fracBits != FIXED_POINT_OFF) out << "fixed " << qFormatName(program.fracBits) << "\n";
+    out << "order";
+    for(uint32_t b : program.order) out << " " << program.blocks[b].name;
+    out << "\n";
+    for(const auto& block : program.blocks){
+        out << "block " << block.name
+                  << " frame " << block.layout.allocSize
+                  << " stack " << block.maxStack << "\n";
+        out << "  inputs";
+        for(int slot : block.inputs) out << " " << block.layout.slots[slot].name;
+        out << "\n  outputs";
+        for(int slot : block.outputs) out << " " << block.layout.slots[slot].name;
+        out << "\n";
+        if(block.reusedExpressions > 0){
+            out << "  reused " << block.reusedExpressions << " expressions, "
+                << block.removedInstructions << " instructions removed\n";
+        }
+        if(block.coldBodies > 0){
+            out << "  " << block.coldBodies << " cold if bodies moved out of line\n";
+        }
+        if(block.decisionTables > 0){
+            out << "  " << block.decisionTables << " decision tables replace " << block.tableIfs << " ifs\n";
+        }
+        for(size_t pc = 0; pc < block.code.size(); pc++){
+            const Instr& instr = block.code[pc];
+            out << "  " << pc << "\t" << opCodeToString(instr.op);
+            switch(instr.op){
+                case OpCode::PUSH_F:
+                    out << " " << bitsToFloat(instr.arg);
+                    break;
+                case OpCode::PUSH_I: case OpCode::PUSH_B:
+                case OpCode::JUMP_IF_FALSE: case OpCode::JUMP_IF_TRUE: case OpCode::JUMP:
+                case OpCode::I2Q: case OpCode::I2Q_UNDER:
+                    out << " " << instr.arg;
+                    break;
+                case OpCode::LOAD_I: case OpCode::LOAD_F: case OpCode::LOAD_B:
+                case OpCode::STORE_I: case OpCode::STORE_F: case OpCode::STORE_B:
+                case OpCode::TEE_I: case OpCode::TEE_F:
+                    out << " [" << instr.arg << "]";
+                    break;
+                case OpCode::TABLE:
+                    // the data words are summed up instead of listed
+                    out << " " << instr.arg << " ";
+                    describeDecisionTable(&block.code[pc + 1], out);
+                    pc += instr.arg;
+                    break;
+                default: break;
+            }
+            out << "\n";
+        }
+    }
+}
@@ -0,0 +1,174 @@
+#ifndef RUNTIME_BYTECODE_H
+#define RUNTIME_BYTECODE_H
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "fixedPoint.h"
+#include "../frameLayout/frameLayout.h"
+
+// Every control block is compiled into a flat list of stack machine instructions.
+// Variables are never looked up by name at runtime, LOAD/STORE carry the byte
+// offset of the slot inside the block's frame (see frameLayout).
+enum class OpCode : uint8_t{
+    // push an immediate, arg is the value (float stored as its bit pattern)
+    PUSH_I, PUSH_F, PUSH_B,
+
+    // frame access, arg is the slot offset
+    LOAD_I, LOAD_F, LOAD_B,
+    STORE_I, STORE_F, STORE_B,
+    // store the top value without popping it (keeps a reused expression in a temporary)
+    TEE_I, TEE_F,
+
+    // arithmetic on the two topmost values
+    ADD_I, SUB_I, ADD_F, SUB_F,
+
+    // int to float widening of the top value / of the value below the top
+    I2F, I2F_UNDER,
+    // the same in fixed point mode: shift left by arg fraction bits
+    I2Q, I2Q_UNDER,
+
+    // comparisons, push a bool
+    GT_I, GT_F, EQ_I, EQ_F, EQ_B,
+
+    // pop a bool and jump to arg when it is false / true
+    JUMP_IF_FALSE,
+    // (the condition of an if whose body was moved out of line, see profile/PROFILE.md)
+    JUMP_IF_TRUE,
+    JUMP,
+
+    // a decision table replacing an if tree, followed by arg DATA instructions holding the
+    // table (see decisionTable.h); DATA is never executed, TABLE jumps over it
+    TABLE, DATA,
+
+    END
+};
+
+struct Instr{
+    OpCode op;
+    int32_t arg = 0;
+};
+
+// one stack slot, the compiler knows which member is live
+union Value{
+    int32_t i;
+    float f;
+};
+
+inline int32_t floatBits(float f){
+    int32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+inline float bitsToFloat(int32_t bits){
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// deepest value stack any block may use, deeper expressions are a compile error
+constexpr int MAX_STACK_DEPTH = 256;
+
+// Moves one shared signal between a block's frame and the signal bus:
+// imports are copied bus -> frame before the block runs,
+// exports frame -> bus after it ran
+struct SignalLink{
+    uint32_t slotOffset;
+    uint32_t signal;
+    uint32_t size;
+    uint32_t slot;
+};
+
+// Where a STORE of a variable or the conditional jump of an if came from,
+// so the events of a telemetry trace (see telemetry/TELEMETRY.md) can be named
+struct CodeSite{
+    uint32_t pc;
+    int slot;  // slot written, -1 for an if
+    int line;
+};
+
+// the conditional jump of an if
+struct IfSite{
+    uint32_t pc;
+    int line;
+};
+
+// IfSite::pc of an if that was compiled into a decision table and has no jump of its own
+constexpr uint32_t NO_JUMP = UINT32_MAX;
+
+struct CompiledBlock{
+    std::string name;
+    FrameLayout layout;
+    std::vector<Instr> code;
+    int maxStack = 0;
+
+    // expressions loaded from a temporary instead of computed again,
+    // and how many instructions that saved (the stores into the temporaries already subtracted)
+    int reusedExpressions = 0;
+    int removedInstructions = 0;
+
+    // every variable write and if of the block, in the order they were compiled
+    std::vector<CodeSite> sites;
+
+    // every if by its if id: ids count the ifs of the block in source order, so they
+    // do not change when a profile moves bodies around (profile/PROFILE.md)
+    std::vector<IfSite> ifs;
+    // if bodies a branch profile moved behind the END of the hot code
+    int coldBodies = 0;
+    // if trees replaced by decision tables and the ifs in them
+    int decisionTables = 0;
+    int tableIfs = 0;
+
+    // top level slots read before the block writes them / written anywhere in the block
+    // (filled by the dependency analysis)
+    std::vector<int> inputs;
+    std::vector<int> outputs;
+
+    // shared signals the block uses (inputs and outputs) / writes (outputs)
+    std::vector<SignalLink> imports;
+    std::vector<SignalLink> exports;
+
+    // signal of every slot, -1 for slots that are private to the block
+    std::vector<int> slotSignal;
+};
+
+// A top level variable name declared by two or more blocks.
+// Blocks that declare the same name with the same type see the same signal,
+// whose current value lives in one 4 byte cell of the signal bus.
+struct Signal{
+    std::string name;
+    TypeTag type = TypeTag::TYPE_ERROR;
+    std::vector<std::pair<uint32_t, int>> copies; // (block, slot)
+};
+
+struct CompiledProgram{
+    std::vector<CompiledBlock> blocks;
+    std::vector<Signal> signals;
+
+    // blocks in dependency order: producers of a signal run before its consumers
+    std::vector<uint32_t> order;
+
+    // all frames live in one buffer, frameOffsets[i] is where block i starts
+    std::vector<size_t> frameOffsets;
+    size_t totalFrameBytes = 0;
+
+    // FIXED_POINT_OFF, or the fraction bits every float slot, literal and operation uses (fixedPoint.h)
+    int fracBits = FIXED_POINT_OFF;
+
+    // the bus holds one 4 byte cell per signal, cell i at byte 4 * i
+    size_t busBytes() const { return signals.size() * sizeof(uint32_t); }
+
+    // slot of a top level variable, -1 if the block does not declare it
+    int findTopLevelSlot(size_t block, const std::string& name) const;
+};
+
+const char* opCodeToString(OpCode op);
+
+// Prints the instructions of every block
+void printBytecode(const CompiledProgram& program, std::ostream& out = std::cout);
+
+#endif // RUNTIME_BYTECODE_H
@@ -0,0 +1,31 @@
+#ifndef RUNTIME_CHECKSUM_H
+#define RUNTIME_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// 64 bit hash over 8 byte words, four independent lanes so it is not one long multiply chain.
+// Used to catch corrupt files (program images, snapshots), not against an attacker.
+inline uint64_t hashBytes(const uint8_t* data, size_t size, uint64_t seed){
+    const uint64_t k = 0x9E3779B97F4A7C15ull;
+    uint64_t lane[4] = {seed ^ size, seed + k, seed ^ (k >> 7), seed - k};
+    size_t i = 0;
+    for(; i + 32 <= size; i += 32){
+        for(int l = 0; l < 4; l++){
+            uint64_t w;
+            std::memcpy(&w, data + i + 8 * l, sizeof(w));
+            lane[l] = (lane[l] ^ w) * 0xFF51AFD7ED558CCDull;
+            lane[l] ^= lane[l] >> 29;
+        }
+    }
+    uint64_t h = lane[0] ^ (lane[1] * 3) ^ (lane[2] * 5) ^ (lane[3] * 7);
+    for(; i < size; i++){
+        h = (h ^ data[i]) * 0x100000001B3ull;
+    }
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    return h ^ (h >> 33);
+}
+
+#endif // RUNTIME_CHECKSUM_H
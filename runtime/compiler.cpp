@@ -0,0 +1,659 @@
+#include "compiler.h"
+#include "decisionTable.h"
+#include "dependency.h"
+#include "interpreter.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../profile/branchProfile.h"
+
+bool Compiler::defaultValueNumbering = true;
+
+int Compiler::defaultFracBits = FIXED_POINT_OFF;
+
+std::shared_ptr<const BranchProfile> Compiler::defaultProfile;
+
+bool Compiler::defaultDecisionTables = false;
+
+Compiler::Compiler() : fracBits(defaultFracBits), valueNumbering(defaultValueNumbering), profile(defaultProfile),
+                       decisionTables(defaultDecisionTables){
+}
+
+void Compiler::setDefaultDecisionTables(bool on){
+    defaultDecisionTables = on;
+}
+
+void Compiler::setDecisionTables(bool on){
+    decisionTables = on;
+}
+
+void Compiler::setDefaultBranchProfile(std::shared_ptr<const BranchProfile> p){
+    defaultProfile = std::move(p);
+}
+
+void Compiler::setBranchProfile(std::shared_ptr<const BranchProfile> p){
+    profile = std::move(p);
+}
+
+void Compiler::setDefaultFixedPoint(int bits){
+    defaultFracBits = bits;
+}
+
+void Compiler::setFixedPoint(int bits){
+    fracBits = bits;
+}
+
+void Compiler::setDefaultValueNumbering(bool on){
+    defaultValueNumbering = on;
+}
+
+void Compiler::setValueNumbering(bool on){
+    valueNumbering = on;
+}
+
+const std::vector<std::string>& Compiler::getErrors(){
+    return errors;
+}
+
+const std::vector<std::string>& Compiler::getWarnings(){
+    return warnings;
+}
+
+void Compiler::reportError(int line, int col, const std::string& msg){
+    std::ostringstream oss;
+    if(line > 0)
+        oss << "Line " << line << ", Col " << col << ": " << msg;
+    else
+        oss << msg;
+    errors.push_back(oss.str());
+}
+
+void Compiler::reportWarning(int line, int col, const std::string& msg){
+    std::ostringstream oss;
+    if(line > 0)
+        oss << "Line " << line << ", Col " << col << ": " << msg;
+    else
+        oss << msg;
+    warnings.push_back(oss.str());
+}
+
+OpCode Compiler::pick(TypeTag type, OpCode intOp, OpCode floatOp) const{
+    // in fixed point mode a float is an int with a different scale
+    return type == TypeTag::TYPE_INT || fracBits != FIXED_POINT_OFF ? intOp : floatOp;
+}
+
+void Compiler::emit(OpCode op, int32_t arg){
+    Instr instr;
+    instr.op = op;
+    instr.arg = arg;
+    current->code.push_back(instr);
+}
+
+void Compiler::push(int n){
+    depth += n;
+    if(depth > current->maxStack) current->maxStack = depth;
+}
+
+void Compiler::pop(int n){
+    depth -= n;
+}
+
+TypeTag Compiler::unifyNumeric(TypeTag left, TypeTag right, int line, int col){
+    if(left == TypeTag::TYPE_INT && right == TypeTag::TYPE_INT) return TypeTag::TYPE_INT;
+
+    // int op float => float
+    if(left == TypeTag::TYPE_INT) widen(true, line, col);
+    if(right == TypeTag::TYPE_INT) widen(false, line, col);
+    return TypeTag::TYPE_FLOAT;
+}
+
+static bool pushesOneValue(OpCode op){
+    switch(op){
+        case OpCode::PUSH_I: case OpCode::PUSH_F: case OpCode::PUSH_B:
+        case OpCode::LOAD_I: case OpCode::LOAD_F: case OpCode::LOAD_B:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void Compiler::widen(bool under, int line, int col){
+    if(fracBits == FIXED_POINT_OFF){
+        emit(under ? OpCode::I2F_UNDER : OpCode::I2F);
+        return;
+    }
+
+    // an int literal is scaled right away: it is the last instruction, or the one
+    // before when the top value came from a single push or load
+    auto& code = current->code;
+    size_t n = code.size();
+    bool literal = under ? n >= 2 && pushesOneValue(code[n-1].op) && code[n-2].op == OpCode::PUSH_I
+                         : n >= 1 && code[n-1].op == OpCode::PUSH_I;
+    if(literal){
+        Instr& push = code[under ? n - 2 : n - 1];
+        int32_t q;
+        if(!toFixed(push.arg, fracBits, q)){
+            reportError(line, col, "Int literal " + std::to_string(push.arg) + " does not fit " + qFormatName(fracBits));
+            return;
+        }
+        push.arg = q;
+        return;
+    }
+
+    if(fracBits > 0){
+        std::ostringstream oss;
+        oss << "int widened to " << qFormatName(fracBits) << " wraps outside "
+            << static_cast<int64_t>(fixedMin(fracBits)) << " .. " << static_cast<int64_t>(fixedMax(fracBits));
+        reportWarning(line, col, oss.str());
+    }
+    emit(under ? OpCode::I2Q_UNDER : OpCode::I2Q, fracBits);
+}
+
+void Compiler::pushFloat(const LiteralNode* lit){
+    float value = std::get<float>(lit->literalValue);
+    if(fracBits == FIXED_POINT_OFF){
+        emit(OpCode::PUSH_F, floatBits(value));
+        return;
+    }
+
+    // the literal as it was most likely written
+    int decimals = literalDecimals(value);
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(decimals) << value << std::defaultfloat << std::setprecision(10);
+
+    int32_t q = 0;
+    if(!toFixed(value, fracBits, q)){
+        oss << " is out of range for " << qFormatName(fracBits)
+            << " (" << fixedMin(fracBits) << " .. " << fixedMax(fracBits) << ")";
+        reportError(lit->line, lit->col, "Float literal " + oss.str());
+    }
+    else if(std::fabs(fixedToDouble(q, fracBits) - value) > 0.5 * std::pow(10.0, -decimals)){
+        // rounding to the format changes the literal as written, e.g. 0.001 in Q23.8 becomes 0
+        oss << " becomes " << fixedToDouble(q, fracBits) << " in " << qFormatName(fracBits)
+            << ", which resolves 1/" << (int64_t(1) << fracBits);
+        reportWarning(lit->line, lit->col, "Float literal " + oss.str());
+    }
+    emit(OpCode::PUSH_I, q);
+}
+
+TypeTag Compiler::compileFactor(const FactorNode* factor, const ExpressionNode*& nested){
+    if(!factor) return TypeTag::TYPE_ERROR;
+
+    if(auto ident = dynamic_cast<const IdentifierNode*>(factor)){
+        int slot = current->layout.slotOf(ident);
+        if(slot < 0) return TypeTag::TYPE_ERROR; // reported by the layout pass
+
+        const FrameSlot& s = current->layout.slots[slot];
+        switch(s.type){
+            case TypeTag::TYPE_INT: emit(OpCode::LOAD_I, s.offset); break;
+            case TypeTag::TYPE_FLOAT: emit(pick(s.type, OpCode::LOAD_I, OpCode::LOAD_F), s.offset); break;
+            case TypeTag::TYPE_BOOL: emit(OpCode::LOAD_B, s.offset); break;
+            default: return TypeTag::TYPE_ERROR;
+        }
+        push();
+        return s.type;
+    }
+
+    else if(auto lit = dynamic_cast<const LiteralNode*>(factor)){
+        switch(lit->literalType){
+            case TokenType::INT_LITERAL:
+                emit(OpCode::PUSH_I, std::get<int>(lit->literalValue));
+                push();
+                return TypeTag::TYPE_INT;
+            case TokenType::FLOAT_LITERAL:
+                pushFloat(lit);
+                push();
+                return TypeTag::TYPE_FLOAT;
+            case TokenType::BOOL_LITERAL:
+                emit(OpCode::PUSH_B, std::get<bool>(lit->literalValue) ? 1 : 0);
+                push();
+                return TypeTag::TYPE_BOOL;
+            default:
+                reportError(lit->line, lit->col, "Unknown literal type");
+                return TypeTag::TYPE_ERROR;
+        }
+    }
+
+    else if(auto paren = dynamic_cast<const ParenExpressionNode*>(factor)){
+        // compiled next by compileExpression's work stack
+        nested = paren->expression.get();
+        return TypeTag::TYPE_ERROR;
+    }
+
+    reportError(0, 0, "Unknown factor node");
+    return TypeTag::TYPE_ERROR;
+}
+
+bool Compiler::loadReused(const ExpressionNode* expr, TypeTag& type){
+    if(!valueNumbering) return false;
+    const ValueUse* use = numbering.find(expr);
+    if(!use || use->kind != ValueUse::REUSE) return false;
+
+    emit(pick(use->type, OpCode::LOAD_I, OpCode::LOAD_F), use->temp);
+    push();
+    type = use->type;
+    current->reusedExpressions++;
+    current->removedInstructions += definedSize[use->def] - 1;
+    return true;
+}
+
+void Compiler::keepDefined(const ExpressionNode* expr, size_t start, int removedBefore){
+    if(!valueNumbering) return;
+    const ValueUse* use = numbering.find(expr);
+    if(!use || use->kind != ValueUse::DEFINE) return;
+
+    // what a reuse saves is the subtree as it would be without value numbering
+    definedSize[expr] = static_cast<int>(current->code.size() - start) + current->removedInstructions - removedBefore;
+    emit(pick(use->type, OpCode::TEE_I, OpCode::TEE_F), use->temp);
+    current->removedInstructions--;
+}
+
+TypeTag Compiler::compileExpression(const ExpressionNode* expr){
+    if(!expr || !expr->left) return TypeTag::TYPE_ERROR;
+
+    TypeTag result = TypeTag::TYPE_ERROR;
+    if(loadReused(expr, result)) return result;
+
+    // post order from an explicit stack, like TypeChecker::inferExpression:
+    // stage 0 compiles the left factor, 1 the right one, 2 the operator
+    struct Frame{
+        const ExpressionNode* expr;
+        int stage;
+        TypeTag leftT;
+        size_t start;       // code size and removed instructions when the node started
+        int removedBefore;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({expr, 0, TypeTag::TYPE_ERROR, current->code.size(), current->removedInstructions});
+
+    while(!stack.empty()){
+        Frame& frame = stack.back();
+        const FactorNode* factor = nullptr;
+        if(frame.stage == 0){
+            frame.stage = 1;
+            factor = frame.expr->left->factor.get();
+        }
+        else if(frame.stage == 1){
+            frame.leftT = result;
+            if(!frame.expr->right){
+                stack.pop_back();
+                continue;
+            }
+            frame.stage = 2;
+            factor = frame.expr->right->factor.get();
+        }
+        else{
+            result = compileOperator(frame.expr, frame.leftT, result);
+            if(result != TypeTag::TYPE_ERROR) keepDefined(frame.expr, frame.start, frame.removedBefore);
+            stack.pop_back();
+            continue;
+        }
+
+        const ExpressionNode* nested = nullptr;
+        result = compileFactor(factor, nested);
+        if(nested){
+            if(!nested->left) result = TypeTag::TYPE_ERROR;
+            else if(!loadReused(nested, result)){
+                stack.push_back({nested, 0, TypeTag::TYPE_ERROR, current->code.size(), current->removedInstructions});
+            }
+        }
+    }
+    return result;
+}
+
+TypeTag Compiler::compileOperator(const ExpressionNode* expr, TypeTag leftT, TypeTag rightT){
+    if(leftT == TypeTag::TYPE_ERROR || rightT == TypeTag::TYPE_ERROR) return TypeTag::TYPE_ERROR;
+
+    if(leftT == TypeTag::TYPE_BOOL || rightT == TypeTag::TYPE_BOOL){
+        reportError(expr->line, expr->col, "Operator '+'/'-' requires numeric operands");
+        return TypeTag::TYPE_ERROR;
+    }
+
+    TypeTag t = unifyNumeric(leftT, rightT, expr->line, expr->col);
+    if(expr->op == TokenType::SYM_PLUS) emit(pick(t, OpCode::ADD_I, OpCode::ADD_F));
+    else emit(pick(t, OpCode::SUB_I, OpCode::SUB_F));
+    pop();
+    return t;
+}
+
+TypeTag Compiler::compileCondition(const ConditionNode* condition){
+    if(!condition) return TypeTag::TYPE_ERROR;
+
+    TypeTag leftT = compileExpression(condition->left.get());
+    TypeTag rightT = compileExpression(condition->right.get());
+    if(leftT == TypeTag::TYPE_ERROR || rightT == TypeTag::TYPE_ERROR) return TypeTag::TYPE_ERROR;
+
+    int line = condition->left ? condition->left->line : 0;
+    int col = condition->left ? condition->left->col : 0;
+
+    if(leftT == TypeTag::TYPE_BOOL || rightT == TypeTag::TYPE_BOOL){
+        if(condition->comparisonOp != TokenType::EQUAL_EQUAL || leftT != rightT){
+            reportError(line, col, std::string("Invalid comparison between ") + typeTagToString(leftT) + " and " + typeTagToString(rightT));
+            return TypeTag::TYPE_ERROR;
+        }
+        emit(OpCode::EQ_B);
+        pop();
+        return TypeTag::TYPE_BOOL;
+    }
+
+    TypeTag t = unifyNumeric(leftT, rightT, line, col);
+    if(condition->comparisonOp == TokenType::SYM_GREATER) emit(pick(t, OpCode::GT_I, OpCode::GT_F));
+    else emit(pick(t, OpCode::EQ_I, OpCode::EQ_F));
+    pop();
+    return TypeTag::TYPE_BOOL;
+}
+
+void Compiler::compileVarDecl(const VarDeclNode* decl){
+    int slot = current->layout.slotOf(decl);
+    if(slot < 0) return;
+
+    // top level variables keep their value from one tick to the next,
+    // variables of an if body live only until the body ends and may share
+    // bytes with a sibling body, so they start from zero every time
+    const FrameSlot& s = current->layout.slots[slot];
+    if(s.scope == 0) return;
+
+    current->sites.push_back({static_cast<uint32_t>(current->code.size() + 1), slot, decl->line});
+    switch(s.type){
+        case TypeTag::TYPE_INT: emit(OpCode::PUSH_I, 0); emit(OpCode::STORE_I, s.offset); break;
+        case TypeTag::TYPE_FLOAT:
+            // 0.0 is all zero bits in both float and fixed point
+            emit(pick(s.type, OpCode::PUSH_I, OpCode::PUSH_F), floatBits(0.0f));
+            emit(pick(s.type, OpCode::STORE_I, OpCode::STORE_F), s.offset);
+            break;
+        case TypeTag::TYPE_BOOL: emit(OpCode::PUSH_B, 0); emit(OpCode::STORE_B, s.offset); break;
+        default: return;
+    }
+    push();
+    pop();
+}
+
+void Compiler::compileAssignment(const AssignmentNode* assign){
+    int slot = current->layout.slotOf(assign);
+    if(!assign->expression){
+        reportError(assign->line, assign->col, "Empty expression in assignment to '" + assign->identifier + "'");
+        return;
+    }
+
+    TypeTag exprT = compileExpression(assign->expression.get());
+    if(slot < 0 || exprT == TypeTag::TYPE_ERROR) return;
+
+    const FrameSlot& s = current->layout.slots[slot];
+    if(s.type == TypeTag::TYPE_FLOAT && exprT == TypeTag::TYPE_INT){
+        // int -> float widening is the only implicit conversion
+        widen(false, assign->line, assign->col);
+        exprT = TypeTag::TYPE_FLOAT;
+    }
+    if(s.type != exprT){
+        reportError(assign->line, assign->col,
+            "Type mismatch in assignment to '" + assign->identifier + "' : expected " + typeTagToString(s.type) + " but found " + typeTagToString(exprT));
+        return;
+    }
+
+    current->sites.push_back({static_cast<uint32_t>(current->code.size()), slot, assign->line});
+    switch(s.type){
+        case TypeTag::TYPE_INT: emit(OpCode::STORE_I, s.offset); break;
+        case TypeTag::TYPE_FLOAT: emit(pick(s.type, OpCode::STORE_I, OpCode::STORE_F), s.offset); break;
+        case TypeTag::TYPE_BOOL: emit(OpCode::STORE_B, s.offset); break;
+        default: break;
+    }
+    pop();
+}
+
+void Compiler::compileIf(const IfNode* root){
+    // the bodies of the tree from an explicit stack, one entry per open body,
+    // so a deep nesting cannot overflow the call stack
+    struct Body{
+        const IfNode* ifnode;
+        size_t next;
+        size_t jump;
+    };
+    std::vector<Body> bodies;
+    size_t jump;
+    if(openIf(root, jump)) bodies.push_back({root, 0, jump});
+    while(!bodies.empty()){
+        Body& body = bodies.back();
+        if(body.next == body.ifnode->statements.size()){
+            // patch the jump to land right after the body
+            current->code[body.jump].arg = current->code.size();
+            bodies.pop_back();
+            continue;
+        }
+        const StatementNode* statement = body.ifnode->statements[body.next++].get();
+        auto ifnode = dynamic_cast<const IfNode*>(statement);
+        if(!ifnode) compileStatement(statement);
+        else if(openIf(ifnode, jump)) bodies.push_back({ifnode, 0, jump});
+    }
+}
+
+bool Compiler::openIf(const IfNode* ifnode, size_t& jump){
+    if(decisionTables && compileTable(ifnode)) return false;
+
+    TypeTag condT = compileCondition(ifnode->condition.get());
+    if(condT != TypeTag::TYPE_BOOL){
+        if(!ifnode->condition) reportError(ifnode->line, ifnode->col, "Missing condition in if statement");
+        return false;
+    }
+
+    uint32_t id = ifIds[ifnode];
+    jump = current->code.size();
+    current->sites.push_back({static_cast<uint32_t>(jump), -1, ifnode->line});
+    current->ifs[id].pc = static_cast<uint32_t>(jump);
+    bool cold = isCold(ifnode, id);
+    emit(cold ? OpCode::JUMP_IF_TRUE : OpCode::JUMP_IF_FALSE);
+    pop();
+
+    if(cold){
+        // the hot path falls through, the body is compiled behind END and jumps back
+        coldBodies.push_back({ifnode, jump});
+        return false;
+    }
+    return true;
+}
+
+bool Compiler::compileTable(const IfNode* ifnode){
+    DecisionTable table;
+    if(!table.build(ifnode, current->layout, fracBits)) return false;
+
+    // the tree compiled as ifs first (in source layout), the reference the table has to agree with
+    size_t start = current->code.size();
+    size_t siteCount = current->sites.size(), errorCount = errors.size();
+    int maxStack = current->maxStack;
+    const std::vector<IfProfile>* profiled = blockProfile;
+    blockProfile = nullptr;
+    decisionTables = false;
+    compileIf(ifnode);
+    decisionTables = true;
+    blockProfile = profiled;
+    if(errors.size() != errorCount) return true;
+
+    std::vector<Instr> reference(current->code.begin() + start, current->code.end());
+    for(auto& instr : reference){
+        if(instr.op == OpCode::JUMP_IF_FALSE) instr.arg -= static_cast<int32_t>(start);
+    }
+    reference.push_back({OpCode::END, 0});
+    std::vector<Instr> code(1 + table.words().size(), Instr{OpCode::DATA, 0});
+    code[0] = {OpCode::TABLE, static_cast<int32_t>(table.words().size())};
+    for(size_t i = 0; i < table.words().size(); i++) code[1 + i].arg = table.words()[i];
+
+    // every test input through both, from a frame of garbage so outputs the tree keeps show up
+    std::vector<uint8_t> before(current->layout.allocSize), viaIfs, viaTable;
+    for(size_t test = 0; test < table.testCount(); test++){
+        std::fill(before.begin(), before.end(), 0xA5);
+        table.writeTest(test, before.data());
+        viaIfs = before;
+        viaTable = before;
+        runCode(reference.data(), viaIfs.data());
+        runDecisionTable(code.data() + 1, viaTable.data());
+        if(viaIfs != viaTable){
+            reportWarning(ifnode->line, ifnode->col, "decision table of this if does not match its ifs, compiled as ifs");
+            return true;
+        }
+    }
+
+    current->code.resize(start);
+    current->code.insert(current->code.end(), code.begin(), code.end());
+    current->sites.resize(siteCount);
+    current->maxStack = maxStack;
+    for(const IfNode* inner : table.ifs()) current->ifs[ifIds[inner]].pc = NO_JUMP;
+    current->decisionTables++;
+    current->tableIfs += static_cast<int>(table.ifs().size());
+    return true;
+}
+
+void Compiler::numberIfs(const ControlNode* control){
+    ifIds.clear();
+    current->ifs.clear();
+    // preorder from an explicit stack, the order the ifs appear in the source
+    std::vector<const StatementNode*> stack;
+    for(auto it = control->statements.rbegin(); it != control->statements.rend(); ++it) stack.push_back(it->get());
+    while(!stack.empty()){
+        auto ifnode = dynamic_cast<const IfNode*>(stack.back());
+        stack.pop_back();
+        if(!ifnode) continue;
+        ifIds[ifnode] = static_cast<uint32_t>(current->ifs.size());
+        current->ifs.push_back({0, ifnode->line});
+        for(auto it = ifnode->statements.rbegin(); it != ifnode->statements.rend(); ++it) stack.push_back(it->get());
+    }
+}
+
+bool Compiler::isCold(const IfNode* ifnode, uint32_t id){
+    if(!blockProfile) return false;
+    const IfProfile& entry = (*blockProfile)[id];
+    if(entry.line != ifnode->line){
+        reportWarning(ifnode->line, ifnode->col, "profile of if " + std::to_string(id) + " of block '" + current->name
+                      + "' was taken at line " + std::to_string(entry.line) + ", ignored");
+        return false;
+    }
+    return BranchProfile::isCold(entry);
+}
+
+void Compiler::compileStatement(const StatementNode* statement){
+    if(!statement) return;
+
+    if(auto decl = dynamic_cast<const VarDeclNode*>(statement)){
+        compileVarDecl(decl);
+    }
+    else if(auto assign = dynamic_cast<const AssignmentNode*>(statement)){
+        compileAssignment(assign);
+    }
+    else if(auto ifnode = dynamic_cast<const IfNode*>(statement)){
+        compileIf(ifnode);
+    }
+    else{
+        reportError(0, 0, "Unknown statement node encountered in compiler");
+    }
+
+    if(current->maxStack > MAX_STACK_DEPTH){
+        reportError(0, 0, "Expression too deep in control block '" + current->name + "'");
+        current->maxStack = 0;
+    }
+}
+
+void Compiler::compileControlBlock(const ControlNode* control, CompiledBlock& block){
+    current = &block;
+    depth = 0;
+    definedSize.clear();
+    if(valueNumbering){
+        // decides which expressions are kept in a temporary, grows the frame by those
+        numbering.numberBlock(control, block.layout);
+    }
+
+    numberIfs(control);
+    blockProfile = profile ? profile->find(control->name) : nullptr;
+    if(blockProfile && blockProfile->size() != block.ifs.size()){
+        reportWarning(0, 0, "profile of block '" + block.name + "' has " + std::to_string(blockProfile->size())
+                      + " ifs, the block " + std::to_string(block.ifs.size()) + ", ignored");
+        blockProfile = nullptr;
+    }
+
+    for(const auto& statement : control->statements){
+        compileStatement(statement.get());
+    }
+    emit(OpCode::END);
+
+    // cold bodies in the order their ifs were compiled, a cold if inside one adds to the list
+    for(size_t i = 0; i < coldBodies.size(); i++){
+        auto [ifnode, jump] = coldBodies[i];
+        current->code[jump].arg = current->code.size();
+        for(const auto& statement : ifnode->statements){
+            compileStatement(statement.get());
+        }
+        emit(OpCode::JUMP, static_cast<int32_t>(jump + 1));
+        block.coldBodies++;
+    }
+    // every block still ends with END (the image loader checks it)
+    if(!coldBodies.empty()) emit(OpCode::END);
+    coldBodies.clear();
+    current = nullptr;
+}
+
+CompiledProgram Compiler::compileProgram(const ProgramNode* program){
+    errors.clear();
+    warnings.clear();
+    CompiledProgram compiled;
+    compiled.fracBits = fracBits;
+    if(!program){
+        reportError(0, 0, "Null AST passed to Compiler");
+        return compiled;
+    }
+
+    // names and storage first
+    FrameLayoutPass layoutPass;
+    auto layouts = layoutPass.layoutProgram(program);
+    for(const auto& err : layoutPass.getErrors()){
+        errors.push_back(err);
+    }
+
+    for(size_t i = 0; i < program->controlBlocks.size(); i++){
+        CompiledBlock block;
+        block.name = program->controlBlocks[i]->name;
+        block.layout = std::move(layouts[i]);
+        compiled.blocks.push_back(std::move(block));
+    }
+    for(size_t i = 0; i < program->controlBlocks.size(); i++){
+        compileControlBlock(program->controlBlocks[i].get(), compiled.blocks[i]);
+    }
+
+    // inputs, outputs, shared signals and the order blocks run in
+    DependencyAnalysis deps;
+    deps.analyzeProgram(program, compiled);
+
+    // every frame starts on its own cache line
+    for(const auto& block : compiled.blocks){
+        compiled.frameOffsets.push_back(compiled.totalFrameBytes);
+        compiled.totalFrameBytes += block.layout.allocSize;
+    }
+
+    return compiled;
+}
+
+bool compileSource(const std::string& source, CompiledProgram& out, std::vector<std::string>& errors,
+                   std::vector<std::string>* warnings){
+    Lexer lexer(source);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+
+    errors = lexer.getErrors();
+    for(const auto& err : parser.getErrors()){
+        errors.push_back(err);
+    }
+    if(!errors.empty()) return false;
+
+    Compiler compiler;
+    out = compiler.compileProgram(program.get());
+    errors = compiler.getErrors();
+    if(warnings){
+        for(const auto& w : compiler.getWarnings()) warnings->push_back(w);
+    }
+
+    // the resolved map points into the AST we are about to free
+    for(auto& block : out.blocks){
+        block.layout.resolved.clear();
+    }
+    return errors.empty();
+}
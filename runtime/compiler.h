@@ -0,0 +1,131 @@
+#ifndef RUNTIME_COMPILER_H
+#define RUNTIME_COMPILER_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bytecode.h"
+#include "valueNumbering.h"
+#include "../parser/ast.h"
+#include "../typeChecker/types.h"
+
+class BranchProfile;
+struct IfProfile;
+
+// Lowers a parsed program into bytecode.
+// Names are resolved by the frame layout pass, the compiler only
+// infers operand types to pick the right instruction and widen int to float.
+class Compiler{
+    private:
+    CompiledBlock* current = nullptr;
+    int depth = 0; // value stack depth at the current instruction
+
+    std::vector<std::string> errors;
+
+    // FIXED_POINT_OFF or the fraction bits floats are compiled to, see fixedPoint.h
+    static int defaultFracBits;
+    int fracBits;
+    std::vector<std::string> warnings;
+
+    // repeated expressions of the current block, see valueNumbering.h
+    static bool defaultValueNumbering;
+    bool valueNumbering;
+    ValueNumbering numbering;
+    // full size of every DEFINE subtree, as if nothing inside it had been reused
+    std::unordered_map<const ExpressionNode*, int> definedSize;
+
+    // branch profile the ifs are laid out by, see profile/PROFILE.md
+    static std::shared_ptr<const BranchProfile> defaultProfile;
+    std::shared_ptr<const BranchProfile> profile;
+    // the profile of the current block, by if id
+    const std::vector<IfProfile>* blockProfile = nullptr;
+    std::unordered_map<const IfNode*, uint32_t> ifIds;
+    // cold ifs whose bodies still have to be compiled behind the END of the block
+    std::vector<std::pair<const IfNode*, size_t>> coldBodies; // if, pc of its jump
+
+    // if trees compiled into decision tables, see decisionTable.h
+    static bool defaultDecisionTables;
+    bool decisionTables;
+
+    void reportError(int line, int col, const std::string& msg);
+    void reportWarning(int line, int col, const std::string& msg);
+
+    // the int or the float flavour of an instruction for a value of type
+    OpCode pick(TypeTag type, OpCode intOp, OpCode floatOp) const;
+
+    void emit(OpCode op, int32_t arg = 0);
+    void push(int n = 1);
+    void pop(int n = 1);
+
+    void compileControlBlock(const ControlNode* control, CompiledBlock& block);
+    void compileStatement(const StatementNode* statement);
+    void compileVarDecl(const VarDeclNode* decl);
+    void compileAssignment(const AssignmentNode* assign);
+    void compileIf(const IfNode* root);
+    // condition and jump of one if, true when its body follows inline (not a table, not cold)
+    bool openIf(const IfNode* ifnode, size_t& jump);
+    // gives every if of the block its id (CompiledBlock::ifs)
+    void numberIfs(const ControlNode* control);
+    bool isCold(const IfNode* ifnode, uint32_t id);
+    // compiles the tree of ifnode into a decision table once the table gives the same frame
+    // as the tree compiled as ifs for every test input, false when the tree does not qualify
+    bool compileTable(const IfNode* ifnode);
+
+    // each returns the type of the value left on the stack or TYPE_ERROR
+    TypeTag compileCondition(const ConditionNode* condition);
+    TypeTag compileExpression(const ExpressionNode* expr);
+    // a parenthesized factor is not compiled here but handed back in nested
+    TypeTag compileFactor(const FactorNode* factor, const ExpressionNode*& nested);
+    // adds the + or - of expr once both operands are on the stack
+    TypeTag compileOperator(const ExpressionNode* expr, TypeTag leftT, TypeTag rightT);
+
+    // loads the temporary of an expression computed before, false when it has to be compiled
+    bool loadReused(const ExpressionNode* expr, TypeTag& type);
+    // keeps a copy of a value that is reused later, the node's code started at start
+    void keepDefined(const ExpressionNode* expr, size_t start, int removedBefore);
+
+    // widens the two topmost values to a common numeric type
+    TypeTag unifyNumeric(TypeTag left, TypeTag right, int line, int col);
+    // int to float of the top value (or the one below), to fixed point in that mode
+    void widen(bool under, int line, int col);
+    // a float literal as float bits or as a range and precision checked fixed point value
+    void pushFloat(const LiteralNode* lit);
+
+    public:
+    Compiler();
+
+    // on by default, --no-cse turns it off for every compiler created afterwards
+    static void setDefaultValueNumbering(bool on);
+    void setValueNumbering(bool on);
+
+    // compile float as fixed point with fracBits fraction bits (FIXED_POINT_OFF for real floats),
+    // --fixed=Q15.16 sets the default
+    static void setDefaultFixedPoint(int fracBits);
+    void setFixedPoint(int fracBits);
+
+    // moves the bodies of ifs the profile found cold out of line, nullptr keeps the
+    // source layout; --layout=<profile> sets the default
+    static void setDefaultBranchProfile(std::shared_ptr<const BranchProfile> profile);
+    void setBranchProfile(std::shared_ptr<const BranchProfile> profile);
+
+    // off by default, --decision-tables turns it on for every compiler created afterwards
+    static void setDefaultDecisionTables(bool on);
+    void setDecisionTables(bool on);
+
+    CompiledProgram compileProgram(const ProgramNode* program);
+    const std::vector<std::string>& getErrors();
+    // fixed point literals that lose precision, int widenings that may overflow,
+    // profile entries that do not match the source and decision tables that were dropped
+    const std::vector<std::string>& getWarnings();
+};
+
+// Lex, parse and compile a whole source buffer.
+// The AST is released afterwards, so FrameLayout::resolved is cleared.
+// Returns false and fills errors when any phase reported an error,
+// warnings (fixed point precision, stale branch profiles) are appended when asked for.
+bool compileSource(const std::string& source, CompiledProgram& out, std::vector<std::string>& errors,
+                   std::vector<std::string>* warnings = nullptr);
+
+#endif // RUNTIME_COMPILER_H
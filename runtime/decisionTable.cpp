@@ -0,0 +1,410 @@
+#include "decisionTable.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <map>
+
+#include "fixedPoint.h"
+
+static bool lessConstant(TableKind kind, int32_t a, int32_t b){
+    return kind == TABLE_FLOAT ? bitsToFloat(a) < bitsToFloat(b) : a < b;
+}
+
+// 0.0 and -0.0 are the same threshold
+static bool sameConstant(TableKind kind, int32_t a, int32_t b){
+    return kind == TABLE_FLOAT ? bitsToFloat(a) == bitsToFloat(b) : a == b;
+}
+
+// the identifier or literal an operand is, nullptr for anything longer
+static const FactorNode* operand(const ExpressionNode* expr){
+    if(!expr || !expr->left || expr->right) return nullptr;
+    return expr->left->factor.get();
+}
+
+// a literal stored into or compared with a float, as the compiler would push it; false
+// where the compiler reports an error or a precision warning, such trees stay ifs
+static bool floatConstant(const LiteralNode* lit, int fracBits, int32_t& out){
+    if(lit->literalType == TokenType::INT_LITERAL){
+        int value = std::get<int>(lit->literalValue);
+        if(fracBits == FIXED_POINT_OFF){
+            out = floatBits(static_cast<float>(value));
+            return true;
+        }
+        return toFixed(value, fracBits, out);
+    }
+    if(lit->literalType != TokenType::FLOAT_LITERAL) return false;
+    float value = std::get<float>(lit->literalValue);
+    if(fracBits == FIXED_POINT_OFF){
+        out = floatBits(value);
+        return true;
+    }
+    return toFixed(value, fracBits, out)
+        && std::fabs(fixedToDouble(out, fracBits) - value) <= 0.5 * std::pow(10.0, -literalDecimals(value));
+}
+
+bool DecisionTable::addIf(const IfNode* ifnode){
+    const ConditionNode* condition = ifnode->condition.get();
+    if(!condition) return false;
+    bool greater = condition->comparisonOp == TokenType::SYM_GREATER;
+    if(!greater && condition->comparisonOp != TokenType::EQUAL_EQUAL) return false;
+
+    auto ident = dynamic_cast<const IdentifierNode*>(operand(condition->left.get()));
+    auto lit = dynamic_cast<const LiteralNode*>(operand(condition->right.get()));
+    if(!ident && !greater){
+        // constant == variable
+        ident = dynamic_cast<const IdentifierNode*>(operand(condition->right.get()));
+        lit = dynamic_cast<const LiteralNode*>(operand(condition->left.get()));
+    }
+    if(!ident || !lit) return false;
+    int slot = layout->slotOf(ident);
+    if(slot < 0) return false;
+
+    const FrameSlot& s = layout->slots[slot];
+    TableKind kind;
+    int32_t constant;
+    switch(s.type){
+        case TypeTag::TYPE_INT:
+            // an int compared with a float literal is widened, left to the ifs
+            if(lit->literalType != TokenType::INT_LITERAL) return false;
+            kind = TABLE_INT;
+            constant = std::get<int>(lit->literalValue);
+            break;
+        case TypeTag::TYPE_FLOAT:
+            if(!floatConstant(lit, fracBits, constant)) return false;
+            kind = fracBits == FIXED_POINT_OFF ? TABLE_FLOAT : TABLE_INT;
+            break;
+        case TypeTag::TYPE_BOOL:
+            if(greater || lit->literalType != TokenType::BOOL_LITERAL) return false;
+            kind = TABLE_BOOL;
+            constant = std::get<bool>(lit->literalValue) ? 1 : 0;
+            break;
+        default:
+            return false;
+    }
+
+    int var = 0;
+    while(var < static_cast<int>(vars.size()) && vars[var].slot != slot) var++;
+    if(var == static_cast<int>(vars.size())){
+        if(vars.size() == MAX_TABLE_VARS) return false;
+        vars.push_back(Var{slot, static_cast<int32_t>(s.offset), kind, {}, {}, {}});
+    }
+    (greater ? vars[var].thresholds : vars[var].equals).push_back(constant);
+
+    Step step{};
+    step.isIf = true;
+    step.var = var;
+    step.greater = greater;
+    step.constant = constant;
+    steps.push_back(step);
+    ifNodes.push_back(ifnode);
+    return true;
+}
+
+bool DecisionTable::addWrite(const AssignmentNode* assign){
+    auto lit = dynamic_cast<const LiteralNode*>(operand(assign->expression.get()));
+    int slot = layout->slotOf(assign);
+    if(!lit || slot < 0) return false;
+
+    const FrameSlot& s = layout->slots[slot];
+    int32_t value;
+    int32_t size = sizeof(int32_t);
+    switch(s.type){
+        case TypeTag::TYPE_INT:
+            if(lit->literalType != TokenType::INT_LITERAL) return false;
+            value = std::get<int>(lit->literalValue);
+            break;
+        case TypeTag::TYPE_FLOAT:
+            if(!floatConstant(lit, fracBits, value)) return false;
+            break;
+        case TypeTag::TYPE_BOOL:
+            if(lit->literalType != TokenType::BOOL_LITERAL) return false;
+            value = std::get<bool>(lit->literalValue) ? 1 : 0;
+            size = 1;
+            break;
+        default:
+            return false;
+    }
+
+    int output = 0;
+    while(output < static_cast<int>(outputs.size()) && outputs[output].slot != slot) output++;
+    if(output == static_cast<int>(outputs.size())){
+        if(outputs.size() == MAX_TABLE_OUTPUTS) return false;
+        outputs.push_back(Output{slot, static_cast<int32_t>(s.offset), size});
+    }
+
+    Step step{};
+    step.isIf = false;
+    step.output = output;
+    step.value = value;
+    steps.push_back(step);
+    return true;
+}
+
+bool DecisionTable::build(const IfNode* root, const FrameLayout& frameLayout, int bits){
+    layout = &frameLayout;
+    fracBits = bits;
+    vars.clear();
+    outputs.clear();
+    steps.clear();
+    ifNodes.clear();
+    data.clear();
+    tests = 0;
+
+    // preorder from an explicit stack, the step of an if learns its end when its body is done
+    struct Open{
+        const IfNode* ifnode;
+        size_t next;
+        size_t step;
+    };
+    std::vector<Open> stack;
+    if(!addIf(root)) return false;
+    stack.push_back({root, 0, 0});
+    while(!stack.empty()){
+        Open& open = stack.back();
+        if(open.next == open.ifnode->statements.size()){
+            steps[open.step].end = steps.size();
+            stack.pop_back();
+            continue;
+        }
+        const StatementNode* statement = open.ifnode->statements[open.next++].get();
+        if(auto inner = dynamic_cast<const IfNode*>(statement)){
+            if(!addIf(inner)) return false;
+            stack.push_back({inner, 0, steps.size() - 1});
+        }
+        else if(auto assign = dynamic_cast<const AssignmentNode*>(statement)){
+            if(!addWrite(assign)) return false;
+        }
+        else{
+            // a declaration zeroes an if body variable, left to the ifs
+            return false;
+        }
+        if(steps.size() > MAX_TABLE_STEPS) return false;
+    }
+    layout = nullptr;
+    return finish();
+}
+
+bool DecisionTable::finish(){
+    if(ifNodes.size() < 2 || outputs.empty()) return false;
+
+    // a tested variable that is also set would make the order of the ifs matter
+    for(const auto& var : vars){
+        int32_t size = var.kind == TABLE_BOOL ? 1 : sizeof(int32_t);
+        for(const auto& output : outputs){
+            if(var.offset < output.offset + output.size && output.offset < var.offset + size) return false;
+        }
+    }
+
+    size_t cells = 1;
+    tests = 1;
+    for(auto& var : vars){
+        TableKind kind = var.kind;
+        for(auto* list : {&var.thresholds, &var.equals}){
+            std::sort(list->begin(), list->end(), [kind](int32_t a, int32_t b){ return lessConstant(kind, a, b); });
+            list->erase(std::unique(list->begin(), list->end(), [kind](int32_t a, int32_t b){ return sameConstant(kind, a, b); }),
+                        list->end());
+        }
+        if(var.thresholds.size() + var.equals.size() > MAX_TABLE_CONSTANTS) return false;
+        cells *= (var.thresholds.size() + 1) << var.equals.size();
+        if(cells > MAX_TABLE_CELLS) return false;
+
+        // a value on, just below and just above every constant, and both ends of the type
+        std::vector<int32_t>& values = var.tests;
+        values.clear();
+        if(kind == TABLE_BOOL){
+            values = {0, 1};
+        }
+        else if(kind == TABLE_FLOAT){
+            values = {floatBits(-INFINITY), floatBits(INFINITY), floatBits(NAN), floatBits(0.0f), floatBits(-0.0f)};
+            for(auto* list : {&var.thresholds, &var.equals}){
+                for(int32_t c : *list){
+                    values.push_back(floatBits(std::nextafter(bitsToFloat(c), -INFINITY)));
+                    values.push_back(c);
+                    values.push_back(floatBits(std::nextafter(bitsToFloat(c), INFINITY)));
+                }
+            }
+        }
+        else{
+            values = {INT32_MIN, INT32_MAX, 0};
+            for(auto* list : {&var.thresholds, &var.equals}){
+                for(int32_t c : *list){
+                    if(c > INT32_MIN) values.push_back(c - 1);
+                    values.push_back(c);
+                    if(c < INT32_MAX) values.push_back(c + 1);
+                }
+            }
+        }
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        tests *= values.size();
+        if(tests > MAX_TABLE_TESTS) return false;
+    }
+
+    for(auto& step : steps){
+        if(!step.isIf) continue;
+        const Var& var = vars[step.var];
+        const auto& list = step.greater ? var.thresholds : var.equals;
+        for(size_t i = 0; i < list.size(); i++){
+            if(sameConstant(var.kind, list[i], step.constant)) step.index = i;
+        }
+    }
+
+    data = {static_cast<int32_t>(vars.size()), static_cast<int32_t>(outputs.size()), static_cast<int32_t>(cells), 0};
+    for(const auto& var : vars){
+        data.insert(data.end(), {var.offset, var.kind, static_cast<int32_t>(var.thresholds.size()),
+                                 static_cast<int32_t>(var.equals.size())});
+        data.insert(data.end(), var.thresholds.begin(), var.thresholds.end());
+        data.insert(data.end(), var.equals.begin(), var.equals.end());
+    }
+    for(const auto& output : outputs){
+        data.insert(data.end(), {output.offset, output.size});
+    }
+    // cells that end up making the same writes share one action
+    std::map<std::vector<int32_t>, int32_t> actionIds;
+    std::vector<const std::vector<int32_t>*> actions;
+    for(size_t cell = 0; cell < cells; cell++){
+        auto [it, added] = actionIds.emplace(actionOf(cell), static_cast<int32_t>(actions.size()));
+        if(added) actions.push_back(&it->first);
+        data.push_back(it->second);
+    }
+    for(const auto* action : actions){
+        data.insert(data.end(), action->begin(), action->end());
+    }
+    data[3] = static_cast<int32_t>(actions.size());
+    return true;
+}
+
+std::vector<int32_t> DecisionTable::actionOf(size_t cell) const{
+    std::vector<uint32_t> above(vars.size()), equal(vars.size());
+    for(size_t v = 0; v < vars.size(); v++){
+        size_t e = vars[v].equals.size();
+        size_t radix = (vars[v].thresholds.size() + 1) << e;
+        size_t code = cell % radix;
+        cell /= radix;
+        above[v] = static_cast<uint32_t>(code >> e);
+        equal[v] = static_cast<uint32_t>(code & ((size_t(1) << e) - 1));
+    }
+
+    // walk the tree as the ifs would with these outcomes, the last write to an output wins
+    std::vector<int32_t> action(1 + outputs.size(), 0);
+    for(size_t i = 0; i < steps.size();){
+        const Step& step = steps[i];
+        if(!step.isIf){
+            action[0] |= 1 << step.output;
+            action[1 + step.output] = step.value;
+            i++;
+            continue;
+        }
+        bool taken = step.greater ? above[step.var] > step.index : (equal[step.var] >> step.index & 1);
+        i = taken ? i + 1 : step.end;
+    }
+    return action;
+}
+
+void DecisionTable::writeTest(size_t test, uint8_t* frame) const{
+    for(const auto& var : vars){
+        int32_t value = var.tests[test % var.tests.size()];
+        test /= var.tests.size();
+        if(var.kind == TABLE_BOOL) frame[var.offset] = static_cast<uint8_t>(value);
+        else std::memcpy(frame + var.offset, &value, sizeof(value));
+    }
+}
+
+bool checkDecisionTable(const Instr* words, size_t count, size_t frameBytes, std::string& error){
+    for(size_t i = 0; i < count; i++){
+        if(words[i].op != OpCode::DATA){
+            error = "decision table is cut short";
+            return false;
+        }
+    }
+    auto inFrame = [frameBytes](int32_t offset, size_t size){
+        return offset >= 0 && size <= frameBytes && static_cast<uint64_t>(offset) <= frameBytes - size;
+    };
+
+    size_t at = 4;
+    if(count < at){
+        error = "decision table is cut short";
+        return false;
+    }
+    int32_t vars = words[0].arg, outputs = words[1].arg, cells = words[2].arg, actions = words[3].arg;
+    if(vars < 1 || vars > MAX_TABLE_VARS || outputs < 1 || outputs > MAX_TABLE_OUTPUTS
+       || cells < 1 || cells > MAX_TABLE_CELLS || actions < 1 || actions > cells){
+        error = "decision table has bad counts";
+        return false;
+    }
+
+    uint64_t product = 1;
+    for(int32_t v = 0; v < vars; v++){
+        if(count - at < 4){
+            error = "decision table is cut short";
+            return false;
+        }
+        int32_t offset = words[at].arg, kind = words[at + 1].arg, t = words[at + 2].arg, e = words[at + 3].arg;
+        if(kind != TABLE_INT && kind != TABLE_FLOAT && kind != TABLE_BOOL){
+            error = "decision table has a variable of unknown kind";
+            return false;
+        }
+        if(t < 0 || e < 0 || t + e > MAX_TABLE_CONSTANTS){
+            error = "decision table has bad counts";
+            return false;
+        }
+        if(!inFrame(offset, kind == TABLE_BOOL ? 1 : sizeof(int32_t))){
+            error = "decision table reads outside the frame";
+            return false;
+        }
+        product *= static_cast<uint64_t>(t + 1) << e;
+        if(product > MAX_TABLE_CELLS){
+            error = "decision table has bad counts";
+            return false;
+        }
+        at += 4;
+        if(count - at < static_cast<size_t>(t + e)){
+            error = "decision table is cut short";
+            return false;
+        }
+        at += t + e;
+    }
+    if(product != static_cast<uint64_t>(cells)){
+        error = "decision table has bad counts";
+        return false;
+    }
+
+    size_t rest = 2 * outputs + cells + static_cast<size_t>(actions) * (outputs + 1);
+    if(count - at != rest){
+        error = "decision table is cut short";
+        return false;
+    }
+    for(int32_t o = 0; o < outputs; o++, at += 2){
+        int32_t offset = words[at].arg, size = words[at + 1].arg;
+        if((size != 1 && size != sizeof(int32_t)) || !inFrame(offset, size)){
+            error = "decision table writes outside the frame";
+            return false;
+        }
+    }
+    for(int32_t c = 0; c < cells; c++, at++){
+        if(words[at].arg < 0 || words[at].arg >= actions){
+            error = "decision table has a bad action";
+            return false;
+        }
+    }
+    for(int32_t a = 0; a < actions; a++, at += outputs + 1){
+        if(static_cast<uint32_t>(words[at].arg) >> outputs != 0){
+            error = "decision table has a bad action";
+            return false;
+        }
+    }
+    return true;
+}
+
+void describeDecisionTable(const Instr* words, std::ostream& out){
+    int32_t vars = words[0].arg, outputs = words[1].arg;
+    const Instr* w = words + 4;
+    out << "vars";
+    for(int32_t v = 0; v < vars; v++){
+        out << " [" << w[0].arg << "]";
+        w += 4 + w[2].arg + w[3].arg;
+    }
+    out << " outputs";
+    for(int32_t o = 0; o < outputs; o++) out << " [" << w[2 * o].arg << "]";
+    out << " cells " << words[2].arg << " actions " << words[3].arg;
+}
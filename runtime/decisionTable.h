@@ -0,0 +1,154 @@
+#ifndef RUNTIME_DECISION_TABLE_H
+#define RUNTIME_DECISION_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "bytecode.h"
+#include "../frameLayout/frameLayout.h"
+#include "../parser/ast.h"
+
+// Decision tables, see RUNTIME.md section 12.
+// An if tree whose conditions only compare a few variables against constants, and whose
+// bodies only set other variables to constants, is a function from those variables to the
+// writes it makes. With --decision-tables the compiler replaces such a tree by one TABLE
+// instruction followed by arg DATA instructions, whose args are the words of the table:
+//
+//   vars outputs cells actions
+//   per var:    offset kind t e, then t ascending thresholds and e constants tested with ==
+//   per output: offset size
+//   per cell:   action
+//   per action: write mask, then one value per output
+//
+// A variable becomes its coordinate in the table: how many thresholds it is greater than,
+// shifted left by e, plus one bit per equality constant it equals. Every comparison is
+// computed and added up, none is branched on; the coordinates of all variables pick the
+// cell, the cell the action, and the action which outputs get which constant.
+
+enum TableKind : int32_t{
+    TABLE_INT = 0,      // int, and float in fixed point mode
+    TABLE_FLOAT = 1,
+    TABLE_BOOL = 2
+};
+
+constexpr int MAX_TABLE_VARS = 4;
+constexpr int MAX_TABLE_CONSTANTS = 16; // thresholds plus equality constants of one variable
+constexpr int MAX_TABLE_OUTPUTS = 16;
+constexpr int MAX_TABLE_CELLS = 256;
+// ifs and writes of one tree, a larger tree is not looked at any further
+constexpr size_t MAX_TABLE_STEPS = 1024;
+// inputs the compiler runs through both the table and the ifs it replaces
+constexpr size_t MAX_TABLE_TESTS = 4096;
+
+// Runs one table, words points to its first DATA instruction
+inline void runDecisionTable(const Instr* words, uint8_t* frame){
+    int32_t vars = words[0].arg, outputs = words[1].arg, cells = words[2].arg;
+    const Instr* w = words + 4;
+    uint32_t cell = 0, stride = 1;
+    for(int32_t v = 0; v < vars; v++){
+        int32_t offset = w[0].arg, kind = w[1].arg, t = w[2].arg, e = w[3].arg;
+        const Instr* k = w + 4;
+        uint32_t above = 0, equal = 0;
+        if(kind == TABLE_FLOAT){
+            float x;
+            std::memcpy(&x, frame + offset, sizeof(x));
+            for(int32_t i = 0; i < t; i++) above += x > bitsToFloat(k[i].arg);
+            for(int32_t i = 0; i < e; i++) equal |= static_cast<uint32_t>(x == bitsToFloat(k[t + i].arg)) << i;
+        }
+        else{
+            int32_t x;
+            if(kind == TABLE_BOOL) x = frame[offset];
+            else std::memcpy(&x, frame + offset, sizeof(x));
+            for(int32_t i = 0; i < t; i++) above += x > k[i].arg;
+            for(int32_t i = 0; i < e; i++) equal |= static_cast<uint32_t>(x == k[t + i].arg) << i;
+        }
+        cell += (above << e | equal) * stride;
+        stride *= static_cast<uint32_t>(t + 1) << e;
+        w = k + t + e;
+    }
+
+    const Instr* out = w;
+    const Instr* cellAction = out + 2 * outputs;
+    const Instr* action = cellAction + cells + cellAction[cell].arg * (outputs + 1);
+    uint32_t mask = static_cast<uint32_t>(action[0].arg);
+    for(int32_t o = 0; o < outputs; o++){
+        if(!(mask >> o & 1)) continue;
+        if(out[2 * o + 1].arg == 1) frame[out[2 * o].arg] = static_cast<uint8_t>(action[1 + o].arg);
+        else std::memcpy(frame + out[2 * o].arg, &action[1 + o].arg, sizeof(int32_t));
+    }
+}
+
+// Checks the count DATA words of one table the way the image loader checks code:
+// every count in range, every access inside frameBytes, every action index valid
+bool checkDecisionTable(const Instr* words, size_t count, size_t frameBytes, std::string& error);
+
+// "vars [0] [8] outputs [4] [12] cells 12 actions 4", what -b prints for a TABLE
+void describeDecisionTable(const Instr* words, std::ostream& out);
+
+// Recognizes an if tree that can become a table and lays the table out.
+// Qualifies: at least two ifs, every condition `variable > constant` or `variable == constant`
+// (the constant may come first for ==), every body statement a nested if or `set x constant;`,
+// and no variable both tested and set. The constants are what the ifs would compile to,
+// so int literals compared with floats are widened and fixed point mode is honoured.
+class DecisionTable{
+    private:
+    struct Var{
+        int slot;
+        int32_t offset;
+        TableKind kind;
+        std::vector<int32_t> thresholds;
+        std::vector<int32_t> equals;
+        std::vector<int32_t> tests;     // values writeTest() tries
+    };
+    struct Output{
+        int slot;
+        int32_t offset;
+        int32_t size;
+    };
+    // the tree in preorder: an if skips to end when its condition is false
+    struct Step{
+        bool isIf;
+        int var;            // if: variable, comparison and constant
+        bool greater;
+        int32_t constant;
+        size_t index = 0;   // position of the constant in thresholds or equals
+        size_t end = 0;
+        int output;         // write: output and value
+        int32_t value;
+    };
+
+    int fracBits = FIXED_POINT_OFF;
+    const FrameLayout* layout = nullptr;
+    std::vector<Var> vars;
+    std::vector<Output> outputs;
+    std::vector<Step> steps;
+    std::vector<const IfNode*> ifNodes;
+    std::vector<int32_t> data;
+    size_t tests = 0;
+
+    bool addIf(const IfNode* ifnode);
+    bool addWrite(const AssignmentNode* assign);
+    bool finish();
+    // the writes the tree makes when its variables are at coordinate cell of the table
+    std::vector<int32_t> actionOf(size_t cell) const;
+
+    public:
+    // false when the tree does not qualify, its ifs then compile as usual
+    bool build(const IfNode* root, const FrameLayout& layout, int fracBits);
+
+    // the DATA words following TABLE
+    const std::vector<int32_t>& words() const { return data; }
+    // every if of the tree in source order
+    const std::vector<const IfNode*>& ifs() const { return ifNodes; }
+
+    // inputs that reach every cell the variables can really be in: every constant, its
+    // neighbours, the extremes (and NaN for floats); writeTest() stores one of them into frame
+    size_t testCount() const { return tests; }
+    void writeTest(size_t test, uint8_t* frame) const;
+};
+
+#endif // RUNTIME_DECISION_TABLE_H
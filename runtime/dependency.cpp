@@ -0,0 +1,210 @@
+#include "dependency.h"
+#include <algorithm>
+#include <map>
+
+bool DependencyAnalysis::isTopLevel(int slot){
+    return slot >= 0 && current->layout.slots[slot].scope == 0;
+}
+
+void DependencyAnalysis::readFactor(const FactorNode* factor, const std::set<int>& written){
+    if(!factor) return;
+    if(auto ident = dynamic_cast<const IdentifierNode*>(factor)){
+        // a read only depends on the outside world if nothing in this
+        // run of the block is guaranteed to have written the slot before
+        int slot = current->layout.slotOf(ident);
+        if(isTopLevel(slot) && !written.count(slot)) inputs.insert(slot);
+    }
+}
+
+void DependencyAnalysis::readExpression(const ExpressionNode* expr, const std::set<int>& written){
+    // parentheses (and the parser's left nested a + b + ... chains) from a work stack
+    std::vector<const FactorNode*> work;
+    auto pushTerms = [&](const ExpressionNode* e){
+        if(!e) return;
+        if(e->right) work.push_back(e->right->factor.get());
+        if(e->left) work.push_back(e->left->factor.get());
+    };
+    pushTerms(expr);
+    while(!work.empty()){
+        const FactorNode* factor = work.back();
+        work.pop_back();
+        if(auto paren = dynamic_cast<const ParenExpressionNode*>(factor)) pushTerms(paren->expression.get());
+        else readFactor(factor, written);
+    }
+}
+
+void DependencyAnalysis::analyzeStatements(const std::vector<std::unique_ptr<StatementNode>>& statements){
+    // if bodies from an explicit stack, one entry per open body, so a deep nesting
+    // cannot overflow the call stack. written holds the slots definitely written
+    // before the next statement of the body
+    struct Body{
+        const std::vector<std::unique_ptr<StatementNode>>* statements;
+        size_t next;
+        std::set<int> written;
+    };
+    std::vector<Body> bodies;
+    bodies.push_back({&statements, 0, {}});
+    while(!bodies.empty()){
+        Body& body = bodies.back();
+        if(body.next == body.statements->size()){
+            bodies.pop_back();
+            continue;
+        }
+        const StatementNode* statement = (*body.statements)[body.next++].get();
+        if(!statement) continue;
+
+        if(auto assign = dynamic_cast<const AssignmentNode*>(statement)){
+            readExpression(assign->expression.get(), body.written);
+            int slot = current->layout.slotOf(assign);
+            if(isTopLevel(slot)){
+                outputs.insert(slot);
+                body.written.insert(slot);
+            }
+        }
+        else if(auto ifnode = dynamic_cast<const IfNode*>(statement)){
+            if(ifnode->condition){
+                readExpression(ifnode->condition->left.get(), body.written);
+                readExpression(ifnode->condition->right.get(), body.written);
+            }
+            // writes inside the body may not happen, so they are not
+            // definite after the if: the body gets its own copy of the set
+            std::set<int> written = body.written;
+            bodies.push_back({&ifnode->statements, 0, std::move(written)});
+        }
+        // declarations inside an if body reset their slot, nested slots are never inputs
+    }
+}
+
+void DependencyAnalysis::analyzeBlock(const ControlNode* control, CompiledBlock& block){
+    current = &block;
+    inputs.clear();
+    outputs.clear();
+    analyzeStatements(control->statements);
+    block.inputs.assign(inputs.begin(), inputs.end());
+    block.outputs.assign(outputs.begin(), outputs.end());
+    current = nullptr;
+}
+
+void DependencyAnalysis::buildSignals(CompiledProgram& compiled){
+    // group the top level slots of all blocks by name and type
+    std::map<std::pair<std::string, TypeTag>, std::vector<std::pair<uint32_t, int>>> byName;
+    for(uint32_t b = 0; b < compiled.blocks.size(); b++){
+        const auto& slots = compiled.blocks[b].layout.slots;
+        for(size_t s = 0; s < slots.size(); s++){
+            if(slots[s].scope != 0) continue;
+            byName[{slots[s].name, slots[s].type}].push_back({b, static_cast<int>(s)});
+        }
+    }
+
+    // a name declared by a single block is private state, not a signal
+    compiled.signals.clear();
+    for(auto& block : compiled.blocks){
+        block.slotSignal.assign(block.layout.slots.size(), -1);
+    }
+    for(auto& entry : byName){
+        if(entry.second.size() < 2) continue;
+        Signal signal;
+        signal.name = entry.first.first;
+        signal.type = entry.first.second;
+        signal.copies = entry.second;
+        for(const auto& copy : signal.copies){
+            compiled.blocks[copy.first].slotSignal[copy.second] = compiled.signals.size();
+        }
+        compiled.signals.push_back(signal);
+    }
+
+    for(auto& block : compiled.blocks){
+        block.imports.clear();
+        block.exports.clear();
+
+        std::set<int> used(block.inputs.begin(), block.inputs.end());
+        used.insert(block.outputs.begin(), block.outputs.end());
+        for(int slot : used){
+            int signal = block.slotSignal[slot];
+            if(signal < 0) continue;
+            const FrameSlot& s = block.layout.slots[slot];
+            SignalLink link{static_cast<uint32_t>(s.offset), static_cast<uint32_t>(signal),
+                            static_cast<uint32_t>(s.size), static_cast<uint32_t>(slot)};
+            block.imports.push_back(link);
+            if(std::binary_search(block.outputs.begin(), block.outputs.end(), slot)){
+                block.exports.push_back(link);
+            }
+        }
+    }
+}
+
+void DependencyAnalysis::buildOrder(CompiledProgram& compiled){
+    // producer -> signal -> consumer edges. Going through the signal keeps the graph
+    // linear in the number of links: a popular name written and read by every
+    // block would otherwise need an edge between every pair of blocks
+    size_t n = compiled.blocks.size();
+    size_t signals = compiled.signals.size();
+    std::vector<int> writers(signals, 0);
+    for(const auto& block : compiled.blocks){
+        for(const auto& link : block.exports) writers[link.signal]++;
+    }
+
+    // readers[signal] = (block, the block writes the signal too)
+    // a block waits for every signal it reads to be final, ignoring its own write
+    struct Reader{
+        uint32_t block;
+        bool writes;
+    };
+    std::vector<std::vector<Reader>> readers(signals);
+    std::vector<int> indegree(n, 0);
+    for(uint32_t b = 0; b < n; b++){
+        const CompiledBlock& block = compiled.blocks[b];
+        for(int in : block.inputs){
+            int signal = block.slotSignal[in];
+            if(signal < 0) continue;
+            bool writes = std::binary_search(block.outputs.begin(), block.outputs.end(), in);
+            if(writers[signal] <= (writes ? 1 : 0)) continue;
+            readers[signal].push_back(Reader{b, writes});
+            indegree[b]++;
+        }
+    }
+
+    // Kahn's algorithm, ties broken by program order so independent blocks keep their order
+    compiled.order.clear();
+    std::set<uint32_t> ready;
+    for(uint32_t b = 0; b < n; b++){
+        if(indegree[b] == 0) ready.insert(b);
+    }
+    std::vector<bool> placed(n, false);
+    while(compiled.order.size() < n){
+        if(ready.empty()){
+            // a cycle: run the first remaining block, its consumers see last tick's values
+            for(uint32_t b = 0; b < n; b++){
+                if(!placed[b]){
+                    ready.insert(b);
+                    break;
+                }
+            }
+        }
+        uint32_t b = *ready.begin();
+        ready.erase(ready.begin());
+        if(placed[b]) continue;
+        placed[b] = true;
+        compiled.order.push_back(b);
+
+        for(const auto& link : compiled.blocks[b].exports){
+            // one writer left: readers that are that writer may go
+            // no writer left: everybody else may go
+            int left = --writers[link.signal];
+            if(left > 1) continue;
+            for(const auto& reader : readers[link.signal]){
+                if(placed[reader.block] || reader.writes != (left == 1)) continue;
+                if(--indegree[reader.block] == 0) ready.insert(reader.block);
+            }
+        }
+    }
+}
+
+void DependencyAnalysis::analyzeProgram(const ProgramNode* program, CompiledProgram& compiled){
+    if(!program) return;
+    for(size_t i = 0; i < program->controlBlocks.size() && i < compiled.blocks.size(); i++){
+        analyzeBlock(program->controlBlocks[i].get(), compiled.blocks[i]);
+    }
+    buildSignals(compiled);
+    buildOrder(compiled);
+}
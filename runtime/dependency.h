@@ -0,0 +1,33 @@
+#ifndef RUNTIME_DEPENDENCY_H
+#define RUNTIME_DEPENDENCY_H
+
+#include <set>
+#include <vector>
+
+#include "bytecode.h"
+#include "../parser/ast.h"
+
+// Computes, from IdentifierNode reads and AssignmentNode writes,
+// the input and output slots of every block, the signals shared between
+// blocks, the copy list that propagates them and the dependency order.
+// Needs the AST the program was compiled from (FrameLayout::resolved).
+class DependencyAnalysis{
+    private:
+    CompiledBlock* current = nullptr;
+    std::set<int> inputs;
+    std::set<int> outputs;
+
+    bool isTopLevel(int slot);
+    void readExpression(const ExpressionNode* expr, const std::set<int>& written);
+    void readFactor(const FactorNode* factor, const std::set<int>& written);
+    void analyzeStatements(const std::vector<std::unique_ptr<StatementNode>>& statements);
+
+    void analyzeBlock(const ControlNode* control, CompiledBlock& block);
+    void buildSignals(CompiledProgram& compiled);
+    void buildOrder(CompiledProgram& compiled);
+
+    public:
+    void analyzeProgram(const ProgramNode* program, CompiledProgram& compiled);
+};
+
+#endif // RUNTIME_DEPENDENCY_H
@@ -0,0 +1,69 @@
+#include "fixedPoint.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+bool parseQFormat(const std::string& text, int& fracBits){
+    if(text.size() < 2 || (text[0] != 'Q' && text[0] != 'q')) return false;
+
+    std::string rest = text.substr(1);
+    size_t dot = rest.find('.');
+    std::string intPart = dot == std::string::npos ? "" : rest.substr(0, dot);
+    std::string fracPart = dot == std::string::npos ? rest : rest.substr(dot + 1);
+
+    auto number = [](const std::string& s, int& out){
+        if(s.empty() || s.size() > 2) return false;
+        for(char c : s){
+            if(c < '0' || c > '9') return false;
+        }
+        out = std::atoi(s.c_str());
+        return true;
+    };
+
+    int frac = 0;
+    if(!number(fracPart, frac) || frac > MAX_FRAC_BITS) return false;
+    if(dot != std::string::npos){
+        // one bit is the sign
+        int whole = 0;
+        if(!number(intPart, whole) || whole + frac != 31) return false;
+    }
+    fracBits = frac;
+    return true;
+}
+
+std::string qFormatName(int fracBits){
+    return "Q" + std::to_string(31 - fracBits) + "." + std::to_string(fracBits);
+}
+
+double fixedMax(int fracBits){
+    return fixedToDouble(INT32_MAX, fracBits);
+}
+
+double fixedMin(int fracBits){
+    return fixedToDouble(INT32_MIN, fracBits);
+}
+
+bool toFixed(double value, int fracBits, int32_t& out){
+    double scaled = std::nearbyint(value * static_cast<double>(int64_t(1) << fracBits));
+    if(!(scaled >= static_cast<double>(INT32_MIN) && scaled <= static_cast<double>(INT32_MAX))) return false;
+    out = static_cast<int32_t>(scaled);
+    return true;
+}
+
+int32_t saturateFixed(double value, int fracBits){
+    // NaN compares false both ways, so it gets its own rule
+    if(std::isnan(value)) return 0;
+    int32_t q;
+    if(!toFixed(value, fracBits, q)) q = value > 0 ? INT32_MAX : INT32_MIN;
+    return q;
+}
+
+int literalDecimals(float value){
+    // the lexer keeps no spelling, so take the shortest one that reads back as the same float
+    char buffer[64];
+    for(int digits = 0; digits < 10; digits++){
+        std::snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+        if(std::strtof(buffer, nullptr) == value) return digits;
+    }
+    return 10;
+}
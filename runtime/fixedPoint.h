@@ -0,0 +1,38 @@
+#ifndef RUNTIME_FIXED_POINT_H
+#define RUNTIME_FIXED_POINT_H
+
+#include <cstdint>
+#include <string>
+
+// Fixed point execution mode for targets without an FPU.
+// A float is stored as a signed 32 bit integer scaled by 2^fracBits,
+// i.e. the Q(31 - fracBits).fracBits format, so + - > == are plain int instructions.
+// fracBits < 0 means floats are real IEEE floats.
+
+constexpr int FIXED_POINT_OFF = -1;
+constexpr int MAX_FRAC_BITS = 30;
+
+// "Q15.16" (integer bits + fraction bits must be 31) or just "Q16", false if malformed
+bool parseQFormat(const std::string& text, int& fracBits);
+
+// "Q15.16"
+std::string qFormatName(int fracBits);
+
+// largest and smallest value a Q format can hold
+double fixedMax(int fracBits);
+double fixedMin(int fracBits);
+
+// nearest fixed point value, false when value is out of range
+bool toFixed(double value, int fracBits, int32_t& out);
+
+// same, but out of range values saturate and NaN becomes 0, for values fed into slots
+int32_t saturateFixed(double value, int fracBits);
+
+inline double fixedToDouble(int32_t value, int fracBits){
+    return static_cast<double>(value) / static_cast<double>(int64_t(1) << fracBits);
+}
+
+// decimal digits after the point the shortest spelling of a float literal needs
+int literalDecimals(float value);
+
+#endif // RUNTIME_FIXED_POINT_H
@@ -0,0 +1,229 @@
+#include "fleet.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "spscRing.h"
+
+static constexpr size_t HUGE_PAGE_BYTES = 2u << 20;
+// when the cache size is unknown
+static constexpr size_t DEFAULT_L2_BYTES = 256u << 10;
+
+static size_t alignUp(size_t value, size_t to){
+    return (value + to - 1) / to * to;
+}
+
+static uint64_t packRange(size_t begin, size_t end){
+    return static_cast<uint64_t>(begin) << 32 | static_cast<uint32_t>(end);
+}
+
+void TickBarrier::wait(){
+    uint32_t gen = generation.load(std::memory_order_acquire);
+    if(waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == count){
+        // nobody touches waiting again before the generation moves on
+        waiting.store(0, std::memory_order_relaxed);
+        generation.store(gen + 1, std::memory_order_release);
+        return;
+    }
+    unsigned spins = 0;
+    while(generation.load(std::memory_order_acquire) == gen) cpuRelax(spins);
+}
+
+FleetRuntime::FleetRuntime(const CompiledProgram& prog, size_t vehicles, size_t threads, size_t chunk)
+    : program(prog), vehicleCount(vehicles){
+    busOffset = alignUp(program.totalFrameBytes, CACHE_LINE_SIZE);
+    stride = std::max(alignUp(busOffset + program.busBytes(), CACHE_LINE_SIZE), CACHE_LINE_SIZE);
+
+    if(chunk == 0){
+        long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        size_t cache = l2 > 0 ? static_cast<size_t>(l2) : DEFAULT_L2_BYTES;
+        chunk = cache / 2 / stride;
+    }
+    chunkVehicles = std::max<size_t>(1, chunk);
+
+    size_t chunks = (vehicleCount + chunkVehicles - 1) / chunkVehicles;
+    threads = std::max<size_t>(1, threads);
+    for(size_t w = 0; w < threads; w++){
+        auto worker = std::make_unique<Worker>();
+        worker->index = w;
+        worker->firstChunk = w * chunks / threads;
+        worker->chunks = (w + 1) * chunks / threads - worker->firstChunk;
+        worker->firstVehicle = std::min(vehicleCount, worker->firstChunk * chunkVehicles);
+        worker->vehicles = std::min(vehicleCount, (worker->firstChunk + worker->chunks) * chunkVehicles) - worker->firstVehicle;
+        workers.push_back(std::move(worker));
+    }
+    barrier = std::make_unique<TickBarrier>(threads);
+
+    // every worker allocates and zeroes its own memory from its own cpu
+    std::vector<std::thread> touch;
+    for(size_t w = 0; w < threads; w++) touch.emplace_back(&FleetRuntime::allocate, this, w);
+    for(auto& thread : touch) thread.join();
+    for(const auto& worker : workers){
+        if(worker->vehicles && !worker->memory){
+            release();
+            throw std::bad_alloc();
+        }
+    }
+    chunkState.resize(chunks);
+    for(const auto& worker : workers){
+        for(size_t c = 0; c < worker->chunks; c++){
+            chunkState[worker->firstChunk + c] = worker->memory + c * chunkVehicles * stride;
+        }
+    }
+}
+
+FleetRuntime::~FleetRuntime(){
+    release();
+}
+
+void FleetRuntime::pinTo(size_t index) const{
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % cpus, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+void FleetRuntime::allocate(size_t index){
+    Worker& w = *workers[index];
+    if(w.vehicles == 0) return;
+    pinTo(index);
+
+    // explicit huge pages when some are reserved, otherwise ask for transparent ones
+    size_t bytes = w.vehicles * stride;
+    void* memory = MAP_FAILED;
+    if(bytes >= HUGE_PAGE_BYTES){
+        size_t huge = alignUp(bytes, HUGE_PAGE_BYTES);
+        memory = mmap(nullptr, huge, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(memory != MAP_FAILED){
+            bytes = huge;
+            w.hugePages = true;
+        }
+    }
+    if(memory == MAP_FAILED){
+        memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(memory == MAP_FAILED) return;
+#ifdef MADV_HUGEPAGE
+        if(bytes >= HUGE_PAGE_BYTES) madvise(memory, bytes, MADV_HUGEPAGE);
+#endif
+    }
+    // the first write places every page on this cpu's node
+    std::memset(memory, 0, bytes);
+    w.memory = static_cast<uint8_t*>(memory);
+    w.bytes = bytes;
+}
+
+void FleetRuntime::release(){
+    for(auto& worker : workers){
+        if(worker->memory) munmap(worker->memory, worker->bytes);
+        worker->memory = nullptr;
+    }
+}
+
+uint8_t* FleetRuntime::slotData(size_t vehicle, size_t block, int slot){
+    const CompiledBlock& b = program.blocks[block];
+    int signal = b.slotSignal.empty() ? -1 : b.slotSignal[slot];
+    if(signal >= 0) return bus(vehicle) + signal * sizeof(uint32_t);
+    return frame(vehicle, block) + b.layout.slots[slot].offset;
+}
+
+size_t FleetRuntime::hugePageWorkers() const{
+    size_t count = 0;
+    for(const auto& worker : workers) count += worker->hugePages;
+    return count;
+}
+
+bool FleetRuntime::takeOwn(Worker& w, int parity, size_t& chunk){
+    std::atomic<uint64_t>& bounds = w.ranges[parity].bounds;
+    uint64_t range = bounds.load(std::memory_order_acquire);
+    for(;;){
+        size_t begin = range >> 32, end = static_cast<uint32_t>(range);
+        if(begin >= end) return false;
+        if(bounds.compare_exchange_weak(range, packRange(begin + 1, end), std::memory_order_acq_rel)){
+            chunk = begin;
+            return true;
+        }
+    }
+}
+
+bool FleetRuntime::steal(const Worker& w, int parity, size_t& chunk){
+    for(size_t k = 1; k < workers.size(); k++){
+        Worker& victim = *workers[(w.index + k) % workers.size()];
+        std::atomic<uint64_t>& bounds = victim.ranges[parity].bounds;
+        uint64_t range = bounds.load(std::memory_order_acquire);
+        for(;;){
+            size_t begin = range >> 32, end = static_cast<uint32_t>(range);
+            if(begin >= end) break;
+            // from the back, away from where the owner is working
+            if(bounds.compare_exchange_weak(range, packRange(begin, end - 1), std::memory_order_acq_rel)){
+                chunk = end - 1;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void FleetRuntime::runChunk(size_t chunk){
+    uint8_t* first = chunkState[chunk];
+    size_t count = std::min(chunkVehicles, vehicleCount - chunk * chunkVehicles);
+    // vehicle by vehicle: one vehicle's state stays in L1 while every block of the program runs on it
+    for(size_t v = 0; v < count; v++){
+        uint8_t* state = first + v * stride;
+        uint8_t* bus = state + busOffset;
+        for(uint32_t b : program.order){
+            const CompiledBlock& block = program.blocks[b];
+            uint8_t* frame = state + program.frameOffsets[b];
+            importSignals(block, frame, bus);
+            runBlock(block, frame);
+            exportSignals(block, frame, bus);
+        }
+    }
+}
+
+void FleetRuntime::work(size_t index, uint64_t ticks){
+    if(pin) pinTo(index);
+    Worker& w = *workers[index];
+    for(uint64_t t = 0; t < ticks; t++){
+        int parity = (tickCount + t) & 1;
+        size_t chunk;
+        while(takeOwn(w, parity, chunk)){
+            runChunk(chunk);
+            w.ran++;
+        }
+        while(steal(w, parity, chunk)){
+            runChunk(chunk);
+            w.ran++;
+            w.stolen++;
+        }
+        // nobody takes from the next tick's range before everyone passed the barrier
+        w.ranges[parity ^ 1].bounds.store(packRange(w.firstChunk, w.firstChunk + w.chunks), std::memory_order_relaxed);
+        barrier->wait();
+    }
+}
+
+void FleetRuntime::run(uint64_t ticks){
+    if(ticks == 0) return;
+    int parity = tickCount & 1;
+    for(auto& worker : workers){
+        worker->ranges[parity].bounds.store(packRange(worker->firstChunk, worker->firstChunk + worker->chunks),
+                                            std::memory_order_relaxed);
+    }
+
+    std::vector<std::thread> threads;
+    for(size_t w = 1; w < workers.size(); w++){
+        threads.emplace_back(&FleetRuntime::work, this, w, ticks);
+    }
+    // the calling thread is worker 0, give its affinity back afterwards
+    cpu_set_t saved;
+    bool restore = pin && pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved) == 0;
+    work(0, ticks);
+    for(auto& thread : threads) thread.join();
+    if(restore) pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+    tickCount += ticks;
+}
@@ -0,0 +1,112 @@
+#ifndef RUNTIME_FLEET_H
+#define RUNTIME_FLEET_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "bytecode.h"
+#include "interpreter.h"
+
+// Barrier the workers of a fleet meet at after every tick. One atomic add to arrive,
+// the last one to arrive bumps the generation the others spin on; no lock, no syscall
+// unless a waiter has spun long enough to yield its core.
+class TickBarrier{
+    private:
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> waiting{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> generation{0};
+    uint32_t count;
+
+    public:
+    explicit TickBarrier(size_t threads) : count(static_cast<uint32_t>(threads)) {}
+    void wait();
+};
+
+// Runs one program for a fleet of vehicles, each with a private copy of every frame
+// and of the signal bus (the layout of a FrameStore), on a pool of worker threads.
+//
+// Vehicles are split into chunks whose state fits in half of the L2 cache, the unit a
+// worker runs and steals. Inside a chunk every vehicle runs the whole program before the
+// next one starts, so its state stays in L1 while its blocks pass signals over its bus.
+// Every worker owns a contiguous range of chunks whose memory it allocated and touched
+// first, pinned to its CPU (NUMA local under the default first touch policy), on huge
+// pages where the system has them. A worker runs its own chunks front to back and, when
+// it runs out, steals chunks from the back of the other workers' ranges; ranges are
+// atomic words taken with a compare and swap.
+class FleetRuntime{
+    private:
+    // [begin, end) chunk indices packed in one word, begin in the high half
+    struct alignas(CACHE_LINE_SIZE) ChunkRange{
+        std::atomic<uint64_t> bounds{0};
+    };
+
+    struct Worker{
+        size_t index = 0;
+        size_t firstVehicle = 0, vehicles = 0;
+        size_t firstChunk = 0, chunks = 0;
+        uint8_t* memory = nullptr;
+        size_t bytes = 0;
+        bool hugePages = false;
+        // one range per tick parity: a worker refills the next tick's range before it
+        // reaches the barrier, while thieves may still look at this tick's one
+        ChunkRange ranges[2];
+        uint64_t ran = 0, stolen = 0;
+    };
+
+    const CompiledProgram& program;
+    size_t vehicleCount;
+    size_t stride = 0;       // bytes of one vehicle's state, cache line aligned
+    size_t busOffset = 0;
+    size_t chunkVehicles = 0;
+    bool pin = true;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    // state of the first vehicle of every chunk
+    std::vector<uint8_t*> chunkState;
+    std::unique_ptr<TickBarrier> barrier;
+    uint64_t tickCount = 0;
+
+    void allocate(size_t index);
+    void release();
+    void pinTo(size_t index) const;
+    static bool takeOwn(Worker& w, int parity, size_t& chunk);
+    bool steal(const Worker& w, int parity, size_t& chunk);
+    void runChunk(size_t chunk);
+    void work(size_t index, uint64_t ticks);
+
+    public:
+    // chunkVehicles = 0 sizes chunks from the L2 cache
+    FleetRuntime(const CompiledProgram& program, size_t vehicles, size_t threads, size_t chunkVehicles = 0);
+    ~FleetRuntime();
+    FleetRuntime(const FleetRuntime&) = delete;
+    FleetRuntime& operator=(const FleetRuntime&) = delete;
+
+    // pin worker i to cpu i (modulo the cpu count) while it runs; the memory of a worker
+    // is always first touched from its cpu
+    void setPinning(bool enabled) { pin = enabled; }
+
+    // runs ticks ticks of every vehicle and joins
+    void run(uint64_t ticks);
+
+    size_t vehicles() const { return vehicleCount; }
+    size_t threads() const { return workers.size(); }
+    size_t chunkSize() const { return chunkVehicles; }
+    size_t stateBytes() const { return stride; }
+
+    // state of one vehicle, laid out like a FrameStore of the program
+    uint8_t* state(size_t vehicle) { return chunkState[vehicle / chunkVehicles] + vehicle % chunkVehicles * stride; }
+    uint8_t* frame(size_t vehicle, size_t block) { return state(vehicle) + program.frameOffsets[block]; }
+    uint8_t* bus(size_t vehicle) { return state(vehicle) + busOffset; }
+    // the bus cell for a shared signal, the frame otherwise (see FrameStore::slotData)
+    uint8_t* slotData(size_t vehicle, size_t block, int slot);
+
+    // chunks a worker ran in total and how many of those it stole
+    uint64_t chunksRun(size_t worker) const { return workers[worker]->ran; }
+    uint64_t chunksStolen(size_t worker) const { return workers[worker]->stolen; }
+    // workers whose memory is on explicit huge pages (the others may still get transparent ones)
+    size_t hugePageWorkers() const;
+};
+
+#endif // RUNTIME_FLEET_H
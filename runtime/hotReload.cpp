@@ -0,0 +1,288 @@
+#include "hotReload.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "compiler.h"
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../typeChecker/typechecker.h"
+
+static uint64_t nowNanos(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+HotReloader::HotReloader(const std::string& file) : path(file){
+    // nothing is compiled before load()
+}
+
+HotReloader::~HotReloader(){
+    stop();
+    // the control loop is gone, nobody can see any version any more
+    ProgramVersion* waiting = pending.exchange(nullptr);
+    delete waiting;
+    if(unswapped && unswapped != waiting) delete unswapped->replaced;
+    delete active.exchange(nullptr);
+    delete retiring;
+}
+
+int64_t HotReloader::modifiedTime() const{
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0) return -1;
+    // size too, some editors rewrite a file within one timestamp tick
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec + st.st_size;
+}
+
+ProgramVersion* HotReloader::compile(std::vector<std::string>& errs, std::vector<std::string>& warns){
+    errs.clear();
+    warns.clear();
+    std::ifstream file(path);
+    if(!file){
+        errs.push_back("cannot open " + path);
+        return nullptr;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string source = buffer.str();
+
+    Lexer lexer(source);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    errs = lexer.getErrors();
+    for(const auto& err : parser.getErrors()) errs.push_back(err);
+    if(!errs.empty()) return nullptr;
+
+    // a version the type checker rejects never replaces a running one
+    TypeChecker checker;
+    if(!checker.checkProgram(program.get())){
+        errs = checker.getErrors();
+        return nullptr;
+    }
+
+    auto next = std::make_unique<ProgramVersion>();
+    Compiler compiler;
+    next->program = compiler.compileProgram(program.get());
+    errs = compiler.getErrors();
+    warns = compiler.getWarnings();
+    if(!errs.empty()) return nullptr;
+    // the resolved map points into the AST we are about to free
+    for(auto& block : next->program.blocks){
+        block.layout.resolved.clear();
+    }
+    next->frames = std::make_unique<FrameStore>(next->program);
+    return next.release();
+}
+
+void HotReloader::planCarry(ProgramVersion& next, ProgramVersion& previous){
+    const CompiledProgram& from = previous.program;
+    const CompiledProgram& to = next.program;
+    std::unordered_map<std::string, size_t> blockAt;
+    for(size_t b = 0; b < from.blocks.size(); b++) blockAt.emplace(from.blocks[b].name, b);
+
+    // a shared signal is written once even when several blocks declare it
+    std::unordered_set<const uint8_t*> written;
+    next.carry.clear();
+    next.carriedSlots = 0;
+    for(size_t b = 0; b < to.blocks.size(); b++){
+        auto it = blockAt.find(to.blocks[b].name);
+        if(it == blockAt.end()) continue;
+        const auto& oldSlots = from.blocks[it->second].layout.slots;
+        std::unordered_map<std::string, size_t> slotAt;
+        for(size_t s = 0; s < oldSlots.size(); s++){
+            if(oldSlots[s].scope == 0) slotAt.emplace(oldSlots[s].name, s);
+        }
+
+        const auto& slots = to.blocks[b].layout.slots;
+        for(size_t s = 0; s < slots.size(); s++){
+            // if body variables start from zero on every run anyway
+            if(slots[s].scope != 0) continue;
+            auto old = slotAt.find(slots[s].name);
+            if(old == slotAt.end()) continue;
+            const FrameSlot& oldSlot = oldSlots[old->second];
+            if(oldSlot.type != slots[s].type) continue;
+            if(slots[s].type == TypeTag::TYPE_FLOAT && from.fracBits != to.fracBits) continue;
+
+            uint8_t* dst = next.frames->slotData(b, s);
+            if(!written.insert(dst).second) continue;
+            const uint8_t* src = previous.frames->slotData(it->second, old->second);
+            uint32_t size = static_cast<uint32_t>(slots[s].size);
+            next.carriedSlots++;
+            // slots that follow each other in both frames are copied as one run
+            if(!next.carry.empty()){
+                auto& last = next.carry.back();
+                if(last.from + last.size == src && last.to + last.size == dst){
+                    last.size += size;
+                    continue;
+                }
+            }
+            next.carry.push_back({src, dst, size});
+        }
+    }
+}
+
+bool HotReloader::load(std::vector<std::string>& errs){
+    std::vector<std::string> warns;
+    seenModified = modifiedTime();
+    ProgramVersion* first = compile(errs, warns);
+    if(!first) return false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        warnings = warns;
+    }
+    first->version = nextVersion++;
+    first->requestedAt = first->publishedAt = first->activeAt = nowNanos();
+    first->retireEpoch.store(epoch.load());
+    delete active.exchange(first);
+    latest = first;
+    return true;
+}
+
+ProgramVersion* HotReloader::swap(){
+    ProgramVersion* next = pending.exchange(nullptr, std::memory_order_acq_rel);
+    ProgramVersion* old = active.load(std::memory_order_relaxed);
+    if(!next) return old;
+
+    uint64_t start = nowNanos();
+    // the old version ran its last tick, its state is final
+    for(const auto& copy : next->carry) std::memcpy(copy.to, copy.from, copy.size);
+    next->replaced = old;
+    active.store(next, std::memory_order_seq_cst);
+    uint64_t retire = epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+    uint64_t end = nowNanos();
+    next->swapNanos = end - start;
+    next->activeAt = end;
+    // last, the reloader takes this as the sign the swap is done
+    next->retireEpoch.store(retire, std::memory_order_release);
+    return next;
+}
+
+size_t HotReloader::addReader(){
+    size_t index = readerCount.fetch_add(1);
+    if(index >= MAX_READERS){
+        readerCount.fetch_sub(1);
+        return SIZE_MAX;
+    }
+    return index;
+}
+
+const ProgramVersion* HotReloader::enter(size_t reader){
+    if(reader >= MAX_READERS) return nullptr;
+    // announce the epoch before looking at the pointer: a version replaced after
+    // this store is not freed before exit()
+    readers[reader].seen.store(epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    return active.load(std::memory_order_seq_cst);
+}
+
+void HotReloader::exit(size_t reader){
+    if(reader >= MAX_READERS) return;
+    readers[reader].seen.store(0, std::memory_order_release);
+}
+
+bool HotReloader::tryReclaim(){
+    if(!retiring) return true;
+    size_t count = std::min(readerCount.load(), MAX_READERS);
+    for(size_t r = 0; r < count; r++){
+        uint64_t seen = readers[r].seen.load(std::memory_order_seq_cst);
+        if(seen != 0 && seen < retireAt) return false;
+    }
+    delete retiring;
+    retiring = nullptr;
+    return true;
+}
+
+void HotReloader::workerLoop(){
+    std::unique_lock<std::mutex> guard(lock);
+    while(running){
+        if(unswapped){
+            uint64_t retire = unswapped->retireEpoch.load(std::memory_order_acquire);
+            if(retire != 0){
+                retiring = unswapped->replaced;
+                retireAt = retire;
+                unswapped = nullptr;
+            }
+        }
+        tryReclaim();
+
+        // one version in flight at a time: the next one carries state from the active one
+        if(!unswapped && !retiring){
+            int64_t modified = modifiedTime();
+            if(requested || modified != seenModified){
+                requested = false;
+                seenModified = modified;
+                uint64_t requestedAt = nowNanos();
+
+                guard.unlock();
+                std::vector<std::string> errs, warns;
+                ProgramVersion* next = compile(errs, warns);
+                if(next){
+                    planCarry(*next, *latest);
+                    next->version = nextVersion++;
+                    next->requestedAt = requestedAt;
+                    next->publishedAt = nowNanos();
+                }
+                guard.lock();
+
+                if(!next){
+                    errors = errs;
+                    rejected++;
+                    continue;
+                }
+                warnings = warns;
+                latest = next;
+                unswapped = next;
+                pending.store(next, std::memory_order_release);
+                continue;
+            }
+        }
+        // poll faster while a swap or a reclaim is outstanding
+        auto wait = unswapped || retiring ? std::chrono::milliseconds(1) : std::chrono::milliseconds(pollMillis);
+        wake.wait_for(guard, wait, [this]{ return !running || (requested && !unswapped && !retiring); });
+    }
+}
+
+void HotReloader::start(unsigned poll){
+    std::lock_guard<std::mutex> guard(lock);
+    if(running || !latest) return;
+    pollMillis = poll ? poll : 1;
+    running = true;
+    worker = std::thread(&HotReloader::workerLoop, this);
+}
+
+void HotReloader::stop(){
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if(!running) return;
+        running = false;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void HotReloader::reload(){
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        requested = true;
+    }
+    wake.notify_all();
+}
+
+std::vector<std::string> HotReloader::lastErrors(){
+    std::lock_guard<std::mutex> guard(lock);
+    return errors;
+}
+
+std::vector<std::string> HotReloader::lastWarnings(){
+    std::lock_guard<std::mutex> guard(lock);
+    return warnings;
+}
+
+uint64_t HotReloader::rejectedCount(){
+    std::lock_guard<std::mutex> guard(lock);
+    return rejected;
+}
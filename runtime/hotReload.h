@@ -0,0 +1,134 @@
+#ifndef RUNTIME_HOT_RELOAD_H
+#define RUNTIME_HOT_RELOAD_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bytecode.h"
+#include "interpreter.h"
+
+// One compiled version of a hot reloaded source file, with the frames it runs on.
+// The control loop owns the active version; it is freed by the reloader once
+// no reader can still see it.
+struct ProgramVersion{
+    uint64_t version = 0;
+    CompiledProgram program;
+    std::unique_ptr<FrameStore> frames;
+
+    // state kept from the version this one replaces: top level variables whose
+    // block, name and type did not change (shared signals once, through their bus cell)
+    struct StateCopy{
+        const uint8_t* from;
+        uint8_t* to;
+        uint32_t size;
+    };
+    std::vector<StateCopy> carry;
+    size_t carriedSlots = 0;
+
+    // steady clock nanoseconds: change noticed, compiled and published, first tick that ran it
+    uint64_t requestedAt = 0;
+    uint64_t publishedAt = 0;
+    uint64_t activeAt = 0;
+    // time the swap took at the tick boundary (copying the carried state)
+    uint64_t swapNanos = 0;
+
+    // set by the swap: the version this one replaced and the epoch readers must reach
+    // before it is freed, non zero once the swap is done
+    ProgramVersion* replaced = nullptr;
+    std::atomic<uint64_t> retireEpoch{0};
+};
+
+// Watches a source file, recompiles it in the background when it changes
+// (lexer, parser, TypeChecker, compiler; a version with errors is rejected and the
+// running one stays), and hands the new version to the control loop, which swaps it
+// in at a tick boundary with a single pointer exchange.
+//
+// Reclamation is RCU style: the control loop is the only thread that swaps and never
+// looks at a version after replacing it; other threads that read the active version
+// (monitors, tools reading outputs) wrap every read in enter()/exit(), and a replaced
+// version is only freed once every such reader has left the section it was in.
+class HotReloader{
+    private:
+    static constexpr size_t MAX_READERS = 64;
+
+    struct alignas(CACHE_LINE_SIZE) Reader{
+        // epoch seen when entering, 0 while outside a read section
+        std::atomic<uint64_t> seen{0};
+    };
+
+    std::string path;
+    unsigned pollMillis = 50;
+
+    std::atomic<ProgramVersion*> active{nullptr};
+    std::atomic<ProgramVersion*> pending{nullptr};
+    std::atomic<uint64_t> epoch{1};
+    Reader readers[MAX_READERS];
+    std::atomic<size_t> readerCount{0};
+
+    // reloader thread state
+    ProgramVersion* latest = nullptr;   // last version published, the next one carries state from it
+    ProgramVersion* unswapped = nullptr; // latest while the control loop has not swapped it in yet
+    ProgramVersion* retiring = nullptr; // replaced, waiting for readers
+    uint64_t retireAt = 0;
+    int64_t seenModified = -1;
+    uint64_t nextVersion = 1;
+
+    std::thread worker;
+    std::mutex lock;                    // guards everything below, never taken by the control loop
+    std::condition_variable wake;
+    bool running = false;
+    bool requested = false;
+    std::vector<std::string> errors;
+    std::vector<std::string> warnings;
+    uint64_t rejected = 0;
+
+    void workerLoop();
+    // compiles the current file, nullptr (and errors set) when it does not pass
+    ProgramVersion* compile(std::vector<std::string>& errs, std::vector<std::string>& warns);
+    void planCarry(ProgramVersion& next, ProgramVersion& previous);
+    bool tryReclaim();
+    int64_t modifiedTime() const;
+
+    public:
+    explicit HotReloader(const std::string& path);
+    ~HotReloader();
+    HotReloader(const HotReloader&) = delete;
+    HotReloader& operator=(const HotReloader&) = delete;
+
+    // compiles the first version synchronously, before the control loop starts
+    bool load(std::vector<std::string>& errs);
+
+    // starts the background thread that polls the file every pollMillis ms
+    void start(unsigned pollMillis = 50);
+    void stop();
+    // recompile now, even when the file did not change
+    void reload();
+
+    // control loop side, once per tick before running blocks: swaps in a pending
+    // version (copying the carried state) and returns the one to run.
+    // Without a pending version it is one atomic load.
+    ProgramVersion* tickBoundary(){
+        if(!pending.load(std::memory_order_acquire)) return active.load(std::memory_order_relaxed);
+        return swap();
+    }
+    ProgramVersion* swap();
+
+    // other readers: the returned version stays valid until exit().
+    // At most MAX_READERS of them, addReader() returns SIZE_MAX beyond that
+    size_t addReader();
+    const ProgramVersion* enter(size_t reader);
+    void exit(size_t reader);
+
+    // errors and warnings of the last rejected / accepted version, and how many were rejected
+    std::vector<std::string> lastErrors();
+    std::vector<std::string> lastWarnings();
+    uint64_t rejectedCount();
+};
+
+#endif // RUNTIME_HOT_RELOAD_H
@@ -0,0 +1,299 @@
+#include "interpreter.h"
+#include "decisionTable.h"
+#include "../profile/branchProfile.h"
+#include "../replay/trace.h"
+#include "../telemetry/latency.h"
+#include "../telemetry/telemetry.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+FrameStore::FrameStore(const CompiledProgram& prog)
+    : FrameStore(prog.frameOffsets.data(), prog.totalFrameBytes, prog.busBytes()){
+    program = &prog;
+}
+
+FrameStore::FrameStore(const size_t* frameOffsets, size_t totalFrameBytes, size_t busBytes) : offsets(frameOffsets){
+    // the bus starts on its own cache line right after the last frame
+    busOffset = (totalFrameBytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    size = busOffset + busBytes;
+    // aligned_alloc wants a non zero multiple of the alignment
+    size_t allocSize = (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    if(allocSize == 0) allocSize = CACHE_LINE_SIZE;
+    base = static_cast<uint8_t*>(std::aligned_alloc(CACHE_LINE_SIZE, allocSize));
+    if(!base) throw std::bad_alloc();
+    std::memset(base, 0, allocSize);
+}
+
+FrameStore::~FrameStore(){
+    std::free(base);
+}
+
+void FrameStore::clear(){
+    std::memset(base, 0, size);
+}
+
+uint8_t* FrameStore::slotData(size_t block, int slot){
+    const CompiledBlock& b = program->blocks[block];
+    int signal = b.slotSignal.empty() ? -1 : b.slotSignal[slot];
+    if(signal >= 0) return busCell(signal);
+    return frame(block) + b.layout.slots[slot].offset;
+}
+
+// one interpreter for every mode, the plain instantiation has no trace or profile code at all
+template<bool TRACED, bool PROFILED>
+static void execute(const Instr* code, uint8_t* frame, TelemetryRing* ring, uint32_t blockId, BranchCounter* counters){
+    Value stack[MAX_STACK_DEPTH];
+    int sp = 0;
+    size_t pc = 0;
+
+    while(true){
+        const Instr& instr = code[pc++];
+        switch(instr.op){
+            case OpCode::PUSH_I:
+            case OpCode::PUSH_F:
+            case OpCode::PUSH_B:
+                // float immediates are stored as their bit pattern
+                stack[sp++].i = instr.arg;
+                break;
+
+            case OpCode::LOAD_I:
+                std::memcpy(&stack[sp++].i, frame + instr.arg, sizeof(int32_t));
+                break;
+            case OpCode::LOAD_F:
+                std::memcpy(&stack[sp++].f, frame + instr.arg, sizeof(float));
+                break;
+            case OpCode::LOAD_B:
+                stack[sp++].i = frame[instr.arg];
+                break;
+
+            case OpCode::STORE_I:
+            case OpCode::STORE_F:
+                // the same 4 bytes either way
+                std::memcpy(frame + instr.arg, &stack[--sp].i, sizeof(int32_t));
+                if constexpr(TRACED){
+                    ring->record(TelemetryKind::WRITE, blockId, pc - 1, static_cast<uint32_t>(stack[sp].i));
+                }
+                break;
+            case OpCode::STORE_B:
+                frame[instr.arg] = stack[--sp].i ? 1 : 0;
+                if constexpr(TRACED) ring->record(TelemetryKind::WRITE, blockId, pc - 1, frame[instr.arg]);
+                break;
+
+            case OpCode::TEE_I:
+                std::memcpy(frame + instr.arg, &stack[sp-1].i, sizeof(int32_t));
+                break;
+            case OpCode::TEE_F:
+                std::memcpy(frame + instr.arg, &stack[sp-1].f, sizeof(float));
+                break;
+
+            // int arithmetic wraps instead of being undefined
+            case OpCode::ADD_I:
+                sp--;
+                stack[sp-1].i = static_cast<int32_t>(static_cast<uint32_t>(stack[sp-1].i) + static_cast<uint32_t>(stack[sp].i));
+                break;
+            case OpCode::SUB_I:
+                sp--;
+                stack[sp-1].i = static_cast<int32_t>(static_cast<uint32_t>(stack[sp-1].i) - static_cast<uint32_t>(stack[sp].i));
+                break;
+            case OpCode::ADD_F:
+                sp--;
+                stack[sp-1].f = stack[sp-1].f + stack[sp].f;
+                break;
+            case OpCode::SUB_F:
+                sp--;
+                stack[sp-1].f = stack[sp-1].f - stack[sp].f;
+                break;
+
+            case OpCode::I2F:
+                stack[sp-1].f = static_cast<float>(stack[sp-1].i);
+                break;
+            case OpCode::I2F_UNDER:
+                stack[sp-2].f = static_cast<float>(stack[sp-2].i);
+                break;
+
+            // fixed point widening, the int wraps like int arithmetic does
+            case OpCode::I2Q:
+                stack[sp-1].i = static_cast<int32_t>(static_cast<uint32_t>(stack[sp-1].i) << instr.arg);
+                break;
+            case OpCode::I2Q_UNDER:
+                stack[sp-2].i = static_cast<int32_t>(static_cast<uint32_t>(stack[sp-2].i) << instr.arg);
+                break;
+
+            case OpCode::GT_I:
+                sp--;
+                stack[sp-1].i = stack[sp-1].i > stack[sp].i;
+                break;
+            case OpCode::GT_F:
+                sp--;
+                stack[sp-1].i = stack[sp-1].f > stack[sp].f;
+                break;
+            case OpCode::EQ_I:
+            case OpCode::EQ_B:
+                sp--;
+                stack[sp-1].i = stack[sp-1].i == stack[sp].i;
+                break;
+            case OpCode::EQ_F:
+                sp--;
+                stack[sp-1].i = stack[sp-1].f == stack[sp].f;
+                break;
+
+            case OpCode::JUMP_IF_FALSE:
+                if constexpr(TRACED) ring->record(TelemetryKind::BRANCH, blockId, pc - 1, stack[sp-1].i != 0);
+                if constexpr(PROFILED){
+                    counters[pc - 1].runs++;
+                    counters[pc - 1].taken += stack[sp-1].i != 0;
+                }
+                if(!stack[--sp].i) pc = instr.arg;
+                break;
+            case OpCode::JUMP_IF_TRUE:
+                if constexpr(TRACED) ring->record(TelemetryKind::BRANCH, blockId, pc - 1, stack[sp-1].i != 0);
+                if constexpr(PROFILED){
+                    counters[pc - 1].runs++;
+                    counters[pc - 1].taken += stack[sp-1].i != 0;
+                }
+                if(stack[--sp].i) pc = instr.arg;
+                break;
+            case OpCode::JUMP:
+                pc = instr.arg;
+                break;
+
+            // the ifs of a table are neither traced nor profiled, they have no jump left
+            case OpCode::TABLE:
+                runDecisionTable(&code[pc], frame);
+                pc += instr.arg;
+                break;
+            case OpCode::DATA:
+            case OpCode::END:
+                return;
+        }
+    }
+}
+
+void runBlock(const CompiledBlock& block, uint8_t* frame){
+    execute<false, false>(block.code.data(), frame, nullptr, 0, nullptr);
+}
+
+void runCode(const Instr* code, uint8_t* frame){
+    execute<false, false>(code, frame, nullptr, 0, nullptr);
+}
+
+void runBlock(const CompiledBlock& block, uint8_t* frame, TelemetryRing& ring, uint32_t blockId){
+    ring.enter(blockId);
+    execute<true, false>(block.code.data(), frame, &ring, blockId, nullptr);
+    ring.exit(blockId);
+}
+
+void runBlock(const CompiledBlock& block, uint8_t* frame, BranchCounter* counters){
+    execute<false, true>(block.code.data(), frame, nullptr, 0, counters);
+}
+
+void importSignals(const CompiledBlock& block, uint8_t* frame, const uint8_t* bus){
+    for(const auto& link : block.imports){
+        std::memcpy(frame + link.slotOffset, bus + link.signal * sizeof(uint32_t), link.size);
+    }
+}
+
+void exportSignals(const CompiledBlock& block, const uint8_t* frame, uint8_t* bus){
+    for(const auto& link : block.exports){
+        std::memcpy(bus + link.signal * sizeof(uint32_t), frame + link.slotOffset, link.size);
+    }
+}
+
+void runProgram(const CompiledProgram& program, FrameStore& frames){
+    uint8_t* bus = frames.bus();
+    for(uint32_t b : program.order){
+        const CompiledBlock& block = program.blocks[b];
+        uint8_t* frame = frames.frame(b);
+        importSignals(block, frame, bus);
+        runBlock(block, frame);
+        exportSignals(block, frame, bus);
+    }
+}
+
+void runProgram(const CompiledProgram& program, FrameStore& frames, TelemetryRing& ring){
+    uint8_t* bus = frames.bus();
+    for(uint32_t b : program.order){
+        const CompiledBlock& block = program.blocks[b];
+        uint8_t* frame = frames.frame(b);
+        importSignals(block, frame, bus);
+        runBlock(block, frame, ring, b);
+        exportSignals(block, frame, bus);
+    }
+}
+
+void runProgram(const CompiledProgram& program, FrameStore& frames, LatencyTable& latency){
+    uint8_t* bus = frames.bus();
+    // one clock read per block: where a block ends the next one starts
+    uint64_t last = telemetryClock();
+    for(uint32_t b : program.order){
+        const CompiledBlock& block = program.blocks[b];
+        uint8_t* frame = frames.frame(b);
+        importSignals(block, frame, bus);
+        runBlock(block, frame);
+        exportSignals(block, frame, bus);
+        uint64_t now = telemetryClock();
+        latency.record(b, now - last);
+        last = now;
+    }
+}
+
+void runProgram(const CompiledProgram& program, FrameStore& frames, BranchProfiler& profiler){
+    uint8_t* bus = frames.bus();
+    for(uint32_t b : program.order){
+        const CompiledBlock& block = program.blocks[b];
+        uint8_t* frame = frames.frame(b);
+        importSignals(block, frame, bus);
+        runBlock(block, frame, profiler.block(b));
+        exportSignals(block, frame, bus);
+    }
+    profiler.addTick();
+}
+
+void writeSlot(uint8_t* frame, const FrameSlot& slot, double value, int fracBits){
+    switch(slot.type){
+        case TypeTag::TYPE_INT: {
+            int32_t v = saturateTraceInt(value);
+            std::memcpy(frame + slot.offset, &v, sizeof(v));
+            break;
+        }
+        case TypeTag::TYPE_FLOAT: {
+            if(fracBits != FIXED_POINT_OFF){
+                int32_t q = saturateFixed(value, fracBits);
+                std::memcpy(frame + slot.offset, &q, sizeof(q));
+                break;
+            }
+            float v = static_cast<float>(value);
+            std::memcpy(frame + slot.offset, &v, sizeof(v));
+            break;
+        }
+        case TypeTag::TYPE_BOOL:
+            frame[slot.offset] = value != 0.0 ? 1 : 0;
+            break;
+        default: break;
+    }
+}
+
+double readSlot(const uint8_t* frame, const FrameSlot& slot, int fracBits){
+    switch(slot.type){
+        case TypeTag::TYPE_INT: {
+            int32_t v;
+            std::memcpy(&v, frame + slot.offset, sizeof(v));
+            return v;
+        }
+        case TypeTag::TYPE_FLOAT: {
+            if(fracBits != FIXED_POINT_OFF){
+                int32_t q;
+                std::memcpy(&q, frame + slot.offset, sizeof(q));
+                return fixedToDouble(q, fracBits);
+            }
+            float v;
+            std::memcpy(&v, frame + slot.offset, sizeof(v));
+            return v;
+        }
+        case TypeTag::TYPE_BOOL:
+            return frame[slot.offset];
+        default:
+            return 0.0;
+    }
+}
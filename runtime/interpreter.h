@@ -0,0 +1,79 @@
+#ifndef RUNTIME_INTERPRETER_H
+#define RUNTIME_INTERPRETER_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "bytecode.h"
+
+class TelemetryRing;
+class LatencyTable;
+class BranchProfiler;
+struct BranchCounter;
+
+// Owns the one buffer every frame of a compiled program lives in,
+// followed by the signal bus. It is allocated once, cache line aligned
+// and zeroed, nothing else is allocated while blocks execute.
+class FrameStore{
+    private:
+    uint8_t* base = nullptr;
+    size_t size = 0;
+    size_t busOffset = 0;
+    const size_t* offsets = nullptr;
+    const CompiledProgram* program = nullptr;
+
+    public:
+    explicit FrameStore(const CompiledProgram& program);
+    // frames of a program that is not a CompiledProgram (a mapped image, see image/),
+    // frameOffsets has to outlive the store and slotData() is not available
+    FrameStore(const size_t* frameOffsets, size_t totalFrameBytes, size_t busBytes);
+    ~FrameStore();
+    FrameStore(const FrameStore&) = delete;
+    FrameStore& operator=(const FrameStore&) = delete;
+
+    uint8_t* frame(size_t block) { return base + offsets[block]; }
+    const uint8_t* frame(size_t block) const { return base + offsets[block]; }
+    uint8_t* data() { return base; }
+    const uint8_t* data() const { return base; }
+    size_t bytes() const { return size; }
+
+    // one 4 byte cell per shared signal
+    uint8_t* bus() { return base + busOffset; }
+    const uint8_t* bus() const { return base + busOffset; }
+    uint8_t* busCell(size_t signal) { return bus() + signal * sizeof(uint32_t); }
+
+    // where the current value of a slot lives: the bus cell for a shared signal, the frame otherwise
+    uint8_t* slotData(size_t block, int slot);
+
+    // zero every frame
+    void clear();
+};
+
+// Runs one block once against its frame
+void runBlock(const CompiledBlock& block, uint8_t* frame);
+// the same, recording entry, exit, every variable write and every if into ring (see telemetry/)
+void runBlock(const CompiledBlock& block, uint8_t* frame, TelemetryRing& ring, uint32_t blockId);
+// the same, counting how often the condition of every if ran and was true, by pc
+void runBlock(const CompiledBlock& block, uint8_t* frame, BranchCounter* counters);
+// the same for code that does not live in a CompiledBlock (a mapped program image, see image/)
+void runCode(const Instr* code, uint8_t* frame);
+
+// Copies the shared signals of a block from the bus into its frame / from its frame to the bus
+void importSignals(const CompiledBlock& block, uint8_t* frame, const uint8_t* bus);
+void exportSignals(const CompiledBlock& block, const uint8_t* frame, uint8_t* bus);
+
+// Runs every block once in dependency order, passing signals over the bus (one tick)
+void runProgram(const CompiledProgram& program, FrameStore& frames);
+void runProgram(const CompiledProgram& program, FrameStore& frames, TelemetryRing& ring);
+// the same, adding how long every block took (signals included) to its latency histogram
+void runProgram(const CompiledProgram& program, FrameStore& frames, LatencyTable& latency);
+// the same, counting every if into a branch profile (profile/PROFILE.md)
+void runProgram(const CompiledProgram& program, FrameStore& frames, BranchProfiler& profiler);
+
+// typed access to a slot, used by tools that feed inputs and read outputs,
+// pass CompiledProgram::fracBits so float slots of a fixed point program are converted,
+// values that do not fit an int or fixed point slot saturate and NaN writes 0
+void writeSlot(uint8_t* frame, const FrameSlot& slot, double value, int fracBits = FIXED_POINT_OFF);
+double readSlot(const uint8_t* frame, const FrameSlot& slot, int fracBits = FIXED_POINT_OFF);
+
+#endif // RUNTIME_INTERPRETER_H
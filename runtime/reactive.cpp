@@ -0,0 +1,94 @@
+#include "reactive.h"
+#include "../telemetry/latency.h"
+#include <algorithm>
+#include <cstring>
+
+ReactiveExecutor::ReactiveExecutor(const CompiledProgram& prog, FrameStore& store)
+    : program(prog), frames(store){
+    size_t n = program.blocks.size();
+    dirty.assign(n, 1); // nothing has run yet
+    watched.resize(n);
+    isInput.resize(n);
+    consumers.resize(program.signals.size());
+    size_t maxFeedback = 0;
+    for(size_t b = 0; b < n; b++){
+        const CompiledBlock& block = program.blocks[b];
+        watched[b].assign(block.layout.slots.size(), 0);
+        isInput[b].assign(block.layout.slots.size(), 0);
+        for(int slot : block.inputs) isInput[b][slot] = 1;
+        // an input obviously matters, and so does an output: the block would
+        // overwrite a value somebody else put there
+        for(int slot : block.inputs) watched[b][slot] = 1;
+        for(int slot : block.outputs) watched[b][slot] = 1;
+        for(const auto& link : block.imports) consumers[link.signal].push_back(b);
+
+        feedback.emplace_back();
+        for(int slot : block.outputs){
+            if(isInput[b][slot] && block.slotSignal[slot] < 0) feedback[b].push_back(slot);
+        }
+        maxFeedback = std::max(maxFeedback, feedback[b].size());
+    }
+    before.resize(maxFeedback);
+}
+
+void ReactiveExecutor::markAllDirty(){
+    std::fill(dirty.begin(), dirty.end(), 1);
+}
+
+void ReactiveExecutor::write(size_t block, int slot, const void* bytes){
+    const FrameSlot& s = program.blocks[block].layout.slots[slot];
+    uint8_t* dst = frames.slotData(block, slot);
+    if(std::memcmp(dst, bytes, s.size) == 0) return;
+    std::memcpy(dst, bytes, s.size);
+
+    int signal = program.blocks[block].slotSignal[slot];
+    if(signal < 0){
+        if(watched[block][slot]) dirty[block] = 1;
+        return;
+    }
+    for(uint32_t c : consumers[signal]) dirty[c] = 1;
+}
+
+void ReactiveExecutor::tick(){
+    uint8_t* bus = frames.bus();
+    for(uint32_t b : program.order){
+        if(!dirty[b]){
+            skips++;
+            continue;
+        }
+        dirty[b] = 0;
+        runs++;
+
+        const CompiledBlock& block = program.blocks[b];
+        uint8_t* frame = frames.frame(b);
+        uint64_t start = latency ? telemetryClock() : 0;
+        importSignals(block, frame, bus);
+
+        const auto& loop = feedback[b];
+        for(size_t i = 0; i < loop.size(); i++){
+            const FrameSlot& s = block.layout.slots[loop[i]];
+            before[i] = 0;
+            std::memcpy(&before[i], frame + s.offset, s.size);
+        }
+
+        if(telemetry) runBlock(block, frame, *telemetry, b);
+        else runBlock(block, frame);
+
+        // reading its own private output back (set x (x + 1)) keeps a block awake
+        for(size_t i = 0; i < loop.size(); i++){
+            const FrameSlot& s = block.layout.slots[loop[i]];
+            if(std::memcmp(&before[i], frame + s.offset, s.size) != 0) dirty[b] = 1;
+        }
+
+        // publish changed signals, waking the blocks that import them
+        for(const auto& link : block.exports){
+            uint8_t* cell = bus + link.signal * sizeof(uint32_t);
+            if(std::memcmp(cell, frame + link.slotOffset, link.size) == 0) continue;
+            std::memcpy(cell, frame + link.slotOffset, link.size);
+            for(uint32_t c : consumers[link.signal]){
+                if(c != b || isInput[b][link.slot]) dirty[c] = 1;
+            }
+        }
+        if(latency) latency->record(b, telemetryClock() - start);
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef RUNTIME_REACTIVE_H
+#define RUNTIME_REACTIVE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "bytecode.h"
+#include "interpreter.h"
+
+// Event driven execution: a block only runs when one of the slots it
+// reads or writes changed since its last run. Blocks still run in
+// dependency order, so a producer that changes a signal wakes its
+// consumers within the same tick.
+class ReactiveExecutor{
+    private:
+    const CompiledProgram& program;
+    FrameStore& frames;
+
+    std::vector<uint8_t> dirty;
+    // watched[b][slot] is true when a change of that slot must re-run block b
+    std::vector<std::vector<uint8_t>> watched;
+    // isInput[b][slot] is true for the inputs of block b
+    std::vector<std::vector<uint8_t>> isInput;
+    // consumers[signal] are the blocks that import the signal
+    std::vector<std::vector<uint32_t>> consumers;
+    // private slots a block both reads and writes, with their values before the block ran
+    std::vector<std::vector<int>> feedback;
+    std::vector<uint32_t> before;
+
+    uint64_t runs = 0;
+    uint64_t skips = 0;
+
+    TelemetryRing* telemetry = nullptr;
+    LatencyTable* latency = nullptr;
+
+    public:
+    ReactiveExecutor(const CompiledProgram& program, FrameStore& frames);
+
+    // Writes a value from outside (a sensor) into a slot, or into the bus when the slot is a shared
+    // signal; a changed value marks the blocks that watch it dirty
+    void write(size_t block, int slot, const void* bytes);
+    void markAllDirty();
+
+    // record the blocks that run into a telemetry ring, nullptr stops it
+    void setTelemetry(TelemetryRing* ring) { telemetry = ring; }
+    // add the duration of every block that runs to a latency histogram, nullptr stops it
+    void setLatency(LatencyTable* table) { latency = table; }
+
+    // one tick: runs the dirty blocks only
+    void tick();
+
+    uint64_t blocksRun() const { return runs; }
+    uint64_t blocksSkipped() const { return skips; }
+};
+
+#endif // RUNTIME_REACTIVE_H
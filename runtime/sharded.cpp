@@ -0,0 +1,245 @@
+#include "sharded.h"
+#include "../telemetry/latency.h"
+#include "../telemetry/telemetry.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+
+// every message slot of a ring holds one tick; a producer may run this many ticks ahead
+constexpr size_t CHANNEL_DEPTH = 8;
+
+uint64_t estimateBlockCost(const CompiledBlock& block){
+    // worst case path: every instruction runs once, frame accesses weigh a bit more
+    uint64_t cost = 0;
+    for(const auto& instr : block.code){
+        switch(instr.op){
+            case OpCode::LOAD_I: case OpCode::LOAD_F: case OpCode::LOAD_B:
+            case OpCode::STORE_I: case OpCode::STORE_F: case OpCode::STORE_B:
+            case OpCode::TEE_I: case OpCode::TEE_F:
+                cost += 2;
+                break;
+            default:
+                cost += 1;
+        }
+    }
+    return cost + block.imports.size() + block.exports.size();
+}
+
+ShardPlan partitionBlocks(const CompiledProgram& program, size_t shardCount){
+    ShardPlan plan;
+    size_t blockCount = program.blocks.size();
+
+    // blocks that export the same signal stay in one shard: there their writes land on
+    // one bus in dependency order, exactly as in runProgram(). Spread over shards the
+    // merge could not tell which write was the last one
+    std::vector<uint32_t> groupOf(blockCount);
+    for(uint32_t b = 0; b < blockCount; b++) groupOf[b] = b;
+    auto find = [&](uint32_t b){
+        while(groupOf[b] != b){
+            groupOf[b] = groupOf[groupOf[b]];
+            b = groupOf[b];
+        }
+        return b;
+    };
+    std::vector<int64_t> exporter(program.signals.size(), -1);
+    for(uint32_t b = 0; b < blockCount; b++){
+        for(const auto& link : program.blocks[b].exports){
+            int64_t& first = exporter[link.signal];
+            if(first < 0) first = b;
+            else groupOf[find(b)] = find(static_cast<uint32_t>(first));
+        }
+    }
+
+    // one unit per group, its cost the sum of its blocks
+    std::vector<uint64_t> unitCost;
+    std::vector<size_t> unitOf(blockCount), unitOfRoot(blockCount, SIZE_MAX);
+    for(uint32_t b = 0; b < blockCount; b++){
+        uint32_t root = find(b);
+        if(unitOfRoot[root] == SIZE_MAX){
+            unitOfRoot[root] = unitCost.size();
+            unitCost.push_back(0);
+        }
+        unitOf[b] = unitOfRoot[root];
+        unitCost[unitOf[b]] += estimateBlockCost(program.blocks[b]);
+    }
+
+    shardCount = std::max<size_t>(1, std::min(shardCount, std::max<size_t>(1, unitCost.size())));
+    plan.shards.resize(shardCount);
+    plan.cost.assign(shardCount, 0);
+
+    std::vector<size_t> byCost(unitCost.size());
+    for(size_t u = 0; u < byCost.size(); u++) byCost[u] = u;
+    std::stable_sort(byCost.begin(), byCost.end(), [&](size_t a, size_t b){
+        return unitCost[a] > unitCost[b];
+    });
+
+    std::vector<size_t> shardOfUnit(unitCost.size());
+    for(size_t u : byCost){
+        size_t best = std::min_element(plan.cost.begin(), plan.cost.end()) - plan.cost.begin();
+        plan.cost[best] += unitCost[u];
+        shardOfUnit[u] = best;
+    }
+
+    // inside a shard blocks keep the global dependency order
+    for(uint32_t b : program.order){
+        plan.shards[shardOfUnit[unitOf[b]]].push_back(b);
+    }
+    return plan;
+}
+
+ShardedRuntime::ShardedRuntime(const CompiledProgram& prog, FrameStore& store, size_t shardCount)
+    : program(prog), frames(store){
+    shardPlan = partitionBlocks(program, shardCount);
+    shards.resize(shardPlan.shards.size());
+
+    std::vector<size_t> shardOf(program.blocks.size());
+    for(size_t s = 0; s < shards.size(); s++){
+        for(uint32_t b : shardPlan.shards[s]) shardOf[b] = s;
+    }
+
+    // a signal crosses from every shard that exports it to every other shard that imports it
+    std::vector<std::vector<uint8_t>> exportedBy(program.signals.size()), importedBy(program.signals.size());
+    for(uint32_t b = 0; b < program.blocks.size(); b++){
+        for(const auto& link : program.blocks[b].exports){
+            auto& mask = exportedBy[link.signal];
+            if(mask.empty()) mask.assign(shards.size(), 0);
+            mask[shardOf[b]] = 1;
+        }
+        for(const auto& link : program.blocks[b].imports){
+            auto& mask = importedBy[link.signal];
+            if(mask.empty()) mask.assign(shards.size(), 0);
+            mask[shardOf[b]] = 1;
+        }
+    }
+
+    for(size_t s = 0; s < shards.size(); s++){
+        shards[s].blocks = shardPlan.shards[s];
+    }
+
+    std::map<std::pair<size_t, size_t>, size_t> channelOf;
+    for(uint32_t signal = 0; signal < program.signals.size(); signal++){
+        if(exportedBy[signal].empty()) continue;
+        for(size_t from = 0; from < shards.size(); from++){
+            if(!exportedBy[signal][from]) continue;
+            shards[from].exported.push_back(signal);
+            if(importedBy[signal].empty()) continue;
+            for(size_t to = 0; to < shards.size(); to++){
+                if(to == from || !importedBy[signal][to]) continue;
+                auto key = std::make_pair(from, to);
+                auto it = channelOf.find(key);
+                if(it == channelOf.end()){
+                    it = channelOf.emplace(key, channels.size()).first;
+                    channels.emplace_back();
+                    channels.back().from = from;
+                    channels.back().to = to;
+                }
+                channels[it->second].signals.push_back(signal);
+            }
+        }
+    }
+
+    for(size_t c = 0; c < channels.size(); c++){
+        channels[c].ring = std::make_unique<SpscRing>(channels[c].signals.size(), CHANNEL_DEPTH);
+        shards[channels[c].from].outgoing.push_back(c);
+        shards[channels[c].to].incoming.push_back(c);
+    }
+}
+
+void ShardedRuntime::runShard(size_t index, uint64_t ticks){
+    Shard& shard = shards[index];
+    shard.tickNanos.assign(ticks, 0);
+    uint32_t* bus = shard.bus.data();
+    uint8_t* busBytes = reinterpret_cast<uint8_t*>(bus);
+
+    if(pin){
+        unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(index % cpus, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    for(uint64_t t = 0; t < ticks; t++){
+        auto start = std::chrono::steady_clock::now();
+
+        // last tick's values from the shards that feed this one
+        if(t > 0){
+            for(size_t c : shard.incoming){
+                Channel& channel = channels[c];
+                const uint32_t* msg;
+                unsigned spins = 0;
+                while(!(msg = channel.ring->beginRead())) cpuRelax(spins);
+                for(size_t i = 0; i < channel.signals.size(); i++){
+                    bus[channel.signals[i]] = msg[i];
+                }
+                channel.ring->commitRead();
+            }
+        }
+
+        uint64_t last = shard.latency ? telemetryClock() : 0;
+        for(uint32_t b : shard.blocks){
+            const CompiledBlock& block = program.blocks[b];
+            uint8_t* frame = frames.frame(b);
+            importSignals(block, frame, busBytes);
+            if(shard.telemetry) runBlock(block, frame, *shard.telemetry, b);
+            else runBlock(block, frame);
+            exportSignals(block, frame, busBytes);
+            if(shard.latency){
+                uint64_t now = telemetryClock();
+                shard.latency->record(b, now - last);
+                last = now;
+            }
+        }
+
+        // the last tick has no consumer left
+        if(t + 1 < ticks){
+            for(size_t c : shard.outgoing){
+                Channel& channel = channels[c];
+                uint32_t* msg;
+                unsigned spins = 0;
+                while(!(msg = channel.ring->beginWrite())) cpuRelax(spins);
+                for(size_t i = 0; i < channel.signals.size(); i++){
+                    msg[i] = bus[channel.signals[i]];
+                }
+                channel.ring->commitWrite();
+            }
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        shard.tickNanos[t] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    }
+}
+
+void ShardedRuntime::run(uint64_t ticks){
+    if(ticks == 0) return;
+    // every shard starts from the current bus
+    const uint32_t* shared = reinterpret_cast<const uint32_t*>(frames.bus());
+    for(auto& shard : shards){
+        shard.bus.assign(shared, shared + program.signals.size());
+        // rings are allocated here, never on the shard threads
+        if(telemetry && !shard.telemetry) shard.telemetry = telemetry->addRing();
+        if(latency && !shard.latency) shard.latency = latency->addTable();
+    }
+
+    std::vector<std::thread> threads;
+    for(size_t s = 1; s < shards.size(); s++){
+        threads.emplace_back(&ShardedRuntime::runShard, this, s, ticks);
+    }
+    // the calling thread is shard 0, give its affinity back afterwards
+    cpu_set_t saved;
+    bool restore = pin && pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved) == 0;
+    runShard(0, ticks);
+    for(auto& thread : threads) thread.join();
+    if(restore) pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+
+    // hand the values every shard produced back to the frame store
+    uint32_t* merged = reinterpret_cast<uint32_t*>(frames.bus());
+    for(const auto& shard : shards){
+        for(uint32_t signal : shard.exported) merged[signal] = shard.bus[signal];
+    }
+}
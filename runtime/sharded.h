@@ -0,0 +1,87 @@
+#ifndef RUNTIME_SHARDED_H
+#define RUNTIME_SHARDED_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "bytecode.h"
+#include "interpreter.h"
+#include "spscRing.h"
+
+class Telemetry;
+class LatencyRecorder;
+class LatencyTable;
+
+// static estimate of how expensive one run of a block is
+uint64_t estimateBlockCost(const CompiledBlock& block);
+
+// blocks of every shard, each list in dependency order
+struct ShardPlan{
+    std::vector<std::vector<uint32_t>> shards;
+    std::vector<uint64_t> cost;
+};
+
+// longest processing time first: the most expensive block goes to the
+// least loaded shard, which keeps the slowest shard close to the average.
+// Blocks exporting the same signal are placed together, as one unit
+ShardPlan partitionBlocks(const CompiledProgram& program, size_t shardCount);
+
+// Runs the blocks of a program on one thread per shard.
+// Every shard has a private copy of the signal bus, so signals inside a shard
+// behave as in runProgram(); a signal that crosses shards travels through a
+// wait-free SPSC ring and is seen by the consumer one tick later. Shards never
+// share a lock: a shard only waits for the previous tick's message of the
+// shards that feed it.
+class ShardedRuntime{
+    private:
+    struct Channel{
+        size_t from = 0, to = 0;
+        // signals the producer shard exports and the consumer shard imports
+        std::vector<uint32_t> signals;
+        std::unique_ptr<SpscRing> ring;
+    };
+
+    struct Shard{
+        std::vector<uint32_t> blocks;
+        std::vector<uint32_t> bus;
+        // signals written by the blocks of this shard, merged back into the frame store after a run
+        std::vector<uint32_t> exported;
+        std::vector<size_t> incoming, outgoing;
+        std::vector<uint32_t> tickNanos;
+        TelemetryRing* telemetry = nullptr;
+        LatencyTable* latency = nullptr;
+    };
+
+    const CompiledProgram& program;
+    FrameStore& frames;
+    ShardPlan shardPlan;
+    std::vector<Shard> shards;
+    std::vector<Channel> channels;
+    bool pin = true;
+    Telemetry* telemetry = nullptr;
+    LatencyRecorder* latency = nullptr;
+
+    void runShard(size_t index, uint64_t ticks);
+
+    public:
+    ShardedRuntime(const CompiledProgram& program, FrameStore& frames, size_t shardCount);
+
+    // pin shard i to cpu i (modulo the cpu count)
+    void setPinning(bool enabled) { pin = enabled; }
+
+    // every shard records into a ring of its own, added on the next run()
+    void setTelemetry(Telemetry* sink) { telemetry = sink; }
+    // every shard adds its block durations to a latency table of its own, added on the next run()
+    void setLatency(LatencyRecorder* recorder) { latency = recorder; }
+
+    // runs ticks ticks on every shard and joins
+    void run(uint64_t ticks);
+
+    const ShardPlan& plan() const { return shardPlan; }
+    size_t channelCount() const { return channels.size(); }
+    // duration of every tick of one shard in the last run, in nanoseconds
+    const std::vector<uint32_t>& tickLatencies(size_t shard) const { return shards[shard].tickNanos; }
+};
+
+#endif // RUNTIME_SHARDED_H
@@ -0,0 +1,324 @@
+#include "snapshot.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "checksum.h"
+
+// deltas are kept per cache line, the unit frames are laid out in
+static constexpr size_t LINE = CACHE_LINE_SIZE;
+
+static size_t alignLine(size_t n){
+    return (n + LINE - 1) / LINE * LINE;
+}
+
+// eight words at a time instead of a memcmp call per line
+static inline bool lineDiffers(const uint8_t* a, const uint8_t* b){
+    uint64_t diff = 0;
+    for(size_t w = 0; w < LINE; w += sizeof(uint64_t)){
+        uint64_t x, y;
+        std::memcpy(&x, a + w, sizeof(x));
+        std::memcpy(&y, b + w, sizeof(y));
+        diff |= x ^ y;
+    }
+    return diff != 0;
+}
+
+static uint64_t nowNanos(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t layoutFingerprint(const CompiledProgram& program){
+    std::string key = std::to_string(program.fracBits) + ";" + std::to_string(program.totalFrameBytes) + ";";
+    for(size_t b = 0; b < program.blocks.size(); b++){
+        const CompiledBlock& block = program.blocks[b];
+        key += block.name + "@" + std::to_string(program.frameOffsets[b]) + "{";
+        for(const auto& slot : block.layout.slots){
+            key += slot.name + ":" + std::to_string(static_cast<int>(slot.type)) + ":"
+                 + std::to_string(slot.offset) + ":" + std::to_string(slot.size) + ",";
+        }
+        key += "}";
+    }
+    for(const auto& signal : program.signals){
+        key += signal.name + ":" + std::to_string(static_cast<int>(signal.type)) + ";";
+    }
+    return hashBytes(reinterpret_cast<const uint8_t*>(key.data()), key.size(), 0);
+}
+
+SnapshotStore::SnapshotStore(const CompiledProgram& program, size_t slots){
+    layout = layoutFingerprint(program);
+    // the same size FrameStore allocates: frames, then the bus on its own line
+    stateBytes = alignLine(program.totalFrameBytes) + program.busBytes();
+    lineCount = (stateBytes + LINE - 1) / LINE;
+    slotBytes = alignLine(sizeof(SnapshotRecord)) + alignLine(stateBytes);
+    slotCount = std::max<size_t>(slots, 1);
+    fullEvery = static_cast<unsigned>(std::min<size_t>(fullEvery, slotCount));
+    changedLines.resize(lineCount);
+
+    arenaBytes = alignLine(sizeof(SnapshotFileHeader)) + slotCount * slotBytes;
+    arena = static_cast<uint8_t*>(std::aligned_alloc(LINE, arenaBytes));
+    shadow = static_cast<uint8_t*>(std::aligned_alloc(LINE, std::max(alignLine(stateBytes), LINE)));
+    if(!arena || !shadow){
+        std::free(arena);
+        std::free(shadow);
+        throw std::bad_alloc();
+    }
+    reset();
+}
+
+SnapshotStore::~SnapshotStore(){
+    release();
+    std::free(shadow);
+}
+
+void SnapshotStore::release(){
+    if(mapped) munmap(arena, arenaBytes);
+    else std::free(arena);
+    arena = nullptr;
+    mapped = false;
+}
+
+void SnapshotStore::reset(){
+    std::memset(arena, 0, arenaBytes);
+    SnapshotFileHeader* head = header();
+    std::memcpy(head->magic, SNAPSHOT_MAGIC, sizeof(head->magic));
+    head->format = SNAPSHOT_FORMAT;
+    head->layout = layout;
+    head->stateBytes = stateBytes;
+    head->slotBytes = slotBytes;
+    head->slotCount = slotCount;
+    head->latest = 0;
+    std::memset(shadow, 0, alignLine(stateBytes));
+    sinceFull = 0;
+    backoff = 0;
+    skipDeltas = 0;
+}
+
+void SnapshotStore::setFullEvery(unsigned n){
+    // the chain of the latest version has to fit the ring
+    fullEvery = static_cast<unsigned>(std::min<size_t>(std::max(n, 1u), slotCount));
+}
+
+SnapshotRecord* SnapshotStore::record(uint64_t version){
+    return reinterpret_cast<SnapshotRecord*>(arena + alignLine(sizeof(SnapshotFileHeader)) + (version - 1) % slotCount * slotBytes);
+}
+
+const SnapshotRecord* SnapshotStore::record(uint64_t version) const{
+    return reinterpret_cast<const SnapshotRecord*>(arena + alignLine(sizeof(SnapshotFileHeader)) + (version - 1) % slotCount * slotBytes);
+}
+
+static uint8_t* payloadOf(SnapshotRecord* rec){
+    return reinterpret_cast<uint8_t*>(rec) + alignLine(sizeof(SnapshotRecord));
+}
+
+static const uint8_t* payloadOf(const SnapshotRecord* rec){
+    return reinterpret_cast<const uint8_t*>(rec) + alignLine(sizeof(SnapshotRecord));
+}
+
+uint64_t SnapshotStore::oldest() const{
+    uint64_t last = latest();
+    if(last == 0) return 0;
+    return last >= slotCount ? last - slotCount + 1 : 1;
+}
+
+const SnapshotRecord* SnapshotStore::info(uint64_t version) const{
+    if(version == 0 || version > latest() || version < oldest()) return nullptr;
+    const SnapshotRecord* rec = record(version);
+    return rec->version == version ? rec : nullptr;
+}
+
+uint64_t SnapshotStore::capture(const FrameStore& frames){
+    const uint8_t* state = frames.data();
+    uint64_t version = header()->latest + 1;
+    SnapshotRecord* rec = record(version);
+    // a crash from here on leaves a slot no version claims
+    rec->version = 0;
+    uint8_t* payload = payloadOf(rec);
+
+    // after a delta had to give up (most lines changed) the next ones do not scan at all,
+    // for twice as long every time it happens again
+    bool full = !delta || version == 1 || sinceFull + 1 >= fullEvery || skipDeltas > 0;
+    if(skipDeltas > 0) skipDeltas--;
+    uint32_t changed = 0;
+    size_t payloadBytes = 0;
+    if(!full){
+        // changed lines go to the front of the payload, their indices after the last one;
+        // a delta that would not be smaller than the state becomes a full snapshot
+        size_t limit = stateBytes / (LINE + sizeof(uint32_t));
+        for(size_t line = 0; line < lineCount; line++){
+            const uint8_t* now = state + line * LINE;
+            uint8_t* before = shadow + line * LINE;
+            if(!lineDiffers(now, before)) continue;
+            if(changed >= limit){
+                full = true;
+                backoff = std::min<unsigned>(backoff ? backoff * 2 : 1, fullEvery);
+                skipDeltas = backoff;
+                break;
+            }
+            std::memcpy(payload + static_cast<size_t>(changed) * LINE, now, LINE);
+            std::memcpy(before, now, LINE);
+            changedLines[changed++] = static_cast<uint32_t>(line);
+        }
+        if(!full){
+            std::memcpy(payload + static_cast<size_t>(changed) * LINE, changedLines.data(), changed * sizeof(uint32_t));
+            payloadBytes = static_cast<size_t>(changed) * (LINE + sizeof(uint32_t));
+            rec->base = version - 1;
+            sinceFull++;
+            backoff = 0;
+        }
+    }
+    if(full){
+        std::memcpy(payload, state, stateBytes);
+        if(delta) std::memcpy(shadow, state, stateBytes);
+        payloadBytes = stateBytes;
+        changed = static_cast<uint32_t>(lineCount);
+        rec->base = 0;
+        sinceFull = 0;
+    }
+
+    rec->payloadBytes = payloadBytes;
+    rec->changedLines = changed;
+    rec->capturedAt = nowNanos();
+    // in memory nothing can tear a record, a file may be left behind by a crash
+    rec->checksum = mapped ? hashBytes(payload, payloadBytes, version ^ rec->base) : 0;
+    rec->version = version;
+    header()->latest = version;
+    return version;
+}
+
+bool SnapshotStore::collectChain(uint64_t version, const SnapshotRecord** chain, size_t& length, std::string& error) const{
+    length = 0;
+    uint64_t v = version;
+    while(true){
+        const SnapshotRecord* rec = info(v);
+        if(!rec){
+            error = v == version ? "snapshot " + std::to_string(version) + " is not in the store"
+                                 : "snapshot " + std::to_string(v) + ", which " + std::to_string(version) + " is based on, was overwritten";
+            return false;
+        }
+        bool isFull = rec->base == 0;
+        size_t expected = isFull ? stateBytes : static_cast<size_t>(rec->changedLines) * (LINE + sizeof(uint32_t));
+        if(rec->payloadBytes != expected || rec->payloadBytes > slotBytes - alignLine(sizeof(SnapshotRecord))
+           || (!isFull && rec->base != v - 1)){
+            error = "snapshot " + std::to_string(v) + " is corrupt";
+            return false;
+        }
+        if(mapped && hashBytes(payloadOf(rec), rec->payloadBytes, v ^ rec->base) != rec->checksum){
+            error = "snapshot " + std::to_string(v) + " fails its checksum";
+            return false;
+        }
+        if(!isFull){
+            const uint32_t* indices = reinterpret_cast<const uint32_t*>(payloadOf(rec) + static_cast<size_t>(rec->changedLines) * LINE);
+            for(uint32_t i = 0; i < rec->changedLines; i++){
+                if(indices[i] >= lineCount){
+                    error = "snapshot " + std::to_string(v) + " is corrupt";
+                    return false;
+                }
+            }
+        }
+        chain[length++] = rec;
+        if(isFull) break;
+        if(length == slotCount){
+            error = "snapshot " + std::to_string(version) + " has no full snapshot in the store";
+            return false;
+        }
+        v = rec->base;
+    }
+    std::reverse(chain, chain + length);
+    return true;
+}
+
+bool SnapshotStore::rebuild(uint64_t version, uint8_t* state, std::string& error) const{
+    std::vector<const SnapshotRecord*> chain(slotCount);
+    size_t length;
+    if(!collectChain(version, chain.data(), length, error)) return false;
+
+    // nothing is written before the whole chain checked out
+    std::memcpy(state, payloadOf(chain[0]), stateBytes);
+    for(size_t c = 1; c < length; c++){
+        const uint8_t* lines = payloadOf(chain[c]);
+        const uint32_t* indices = reinterpret_cast<const uint32_t*>(lines + static_cast<size_t>(chain[c]->changedLines) * LINE);
+        for(uint32_t i = 0; i < chain[c]->changedLines; i++){
+            size_t at = static_cast<size_t>(indices[i]) * LINE;
+            std::memcpy(state + at, lines + static_cast<size_t>(i) * LINE, std::min(LINE, stateBytes - at));
+        }
+    }
+    return true;
+}
+
+bool SnapshotStore::restore(uint64_t version, FrameStore& frames, std::string& error) const{
+    if(frames.bytes() != stateBytes){
+        error = "the frames belong to another program";
+        return false;
+    }
+    return rebuild(version, frames.data(), error);
+}
+
+bool SnapshotStore::open(const std::string& path, std::string& error){
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd < 0){
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    bool reuse = false;
+    if(fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == arenaBytes){
+        SnapshotFileHeader head;
+        if(pread(fd, &head, sizeof(head), 0) == static_cast<ssize_t>(sizeof(head))){
+            reuse = std::memcmp(head.magic, SNAPSHOT_MAGIC, sizeof(head.magic)) == 0 && head.format == SNAPSHOT_FORMAT
+                    && head.layout == layout && head.stateBytes == stateBytes && head.slotBytes == slotBytes
+                    && head.slotCount == slotCount;
+        }
+    }
+    // a file of another program or ring size is started over
+    if(!reuse && (ftruncate(fd, 0) != 0 || ftruncate(fd, arenaBytes) != 0)){
+        error = "cannot size " + path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    void* m = mmap(nullptr, arenaBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(m == MAP_FAILED){
+        error = "cannot map " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    release();
+    arena = static_cast<uint8_t*>(m);
+    mapped = true;
+    if(!reuse){
+        reset();
+        return true;
+    }
+
+    // recovery: the newest version whose chain is intact becomes the latest,
+    // and the base of the next delta
+    sinceFull = fullEvery;
+    std::string ignored;
+    for(uint64_t v = header()->latest; v != 0 && v >= oldest(); v--){
+        if(rebuild(v, shadow, ignored)){
+            header()->latest = v;
+            return true;
+        }
+    }
+    reset();
+    return true;
+}
+
+bool SnapshotStore::sync(std::string& error){
+    if(!mapped) return true;
+    if(msync(arena, arenaBytes, MS_SYNC) != 0){
+        error = std::string("msync failed: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
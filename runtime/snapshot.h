@@ -0,0 +1,115 @@
+#ifndef RUNTIME_SNAPSHOT_H
+#define RUNTIME_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bytecode.h"
+#include "interpreter.h"
+
+// The state of a whole program is the FrameStore buffer: every block's frame and
+// the signal bus, one contiguous block of memory. A snapshot is a copy of it, either
+// full or as the cache lines that changed since the previous snapshot.
+
+constexpr char SNAPSHOT_MAGIC[4] = {'A', 'L', 'S', 'N'};
+constexpr uint32_t SNAPSHOT_FORMAT = 1;
+
+struct SnapshotFileHeader{
+    char magic[4];
+    uint32_t format;
+    uint64_t layout;        // fingerprint of the program's frame layout, see layoutFingerprint()
+    uint64_t stateBytes;    // FrameStore::bytes()
+    uint64_t slotBytes;     // one record plus the largest payload, cache line aligned
+    uint64_t slotCount;
+    uint64_t latest;        // last committed version, 0 for none
+};
+
+// One snapshot. A full one is the state as it is, a delta is a list of
+// changed line indices (uint32_t) followed by the 64 byte lines.
+struct SnapshotRecord{
+    uint64_t version;       // 0 while the slot is being written
+    uint64_t base;          // version this delta applies to, 0 for a full snapshot
+    uint64_t payloadBytes;
+    uint64_t checksum;      // of the payload, file backed stores only
+    uint64_t capturedAt;    // steady clock nanoseconds
+    uint32_t changedLines;  // lines in a delta, every line for a full one
+    uint32_t reserved;
+};
+
+// frame layout identity: block names, slots (name, type, offset, size), frame offsets,
+// signals and the fixed point format. A snapshot only restores into the layout it was taken from.
+uint64_t layoutFingerprint(const CompiledProgram& program);
+
+// Keeps the last slotCount snapshots of one program in a ring, in memory or in a
+// memory-mapped file (open()). Version v lives in slot (v - 1) % slotCount.
+//
+// capture() and restore() are called by the thread that runs the blocks, between ticks.
+// restore() checks the whole chain of the version (full snapshot and the deltas after it)
+// before it writes anything, so the frames get either the complete snapshot or stay as they were.
+class SnapshotStore{
+    private:
+    uint64_t layout = 0;
+    size_t stateBytes = 0;
+    size_t lineCount = 0;
+    size_t slotBytes = 0;
+    size_t slotCount = 0;
+
+    uint8_t* arena = nullptr;   // header followed by the slots
+    size_t arenaBytes = 0;
+    bool mapped = false;
+
+    // the state of the last snapshot, what the next delta is computed against
+    uint8_t* shadow = nullptr;
+    uint64_t sinceFull = 0;
+    unsigned backoff = 0;
+    unsigned skipDeltas = 0;
+    // line indices of the delta being captured
+    std::vector<uint32_t> changedLines;
+
+    bool delta = true;
+    unsigned fullEvery = 16;
+
+    SnapshotFileHeader* header() { return reinterpret_cast<SnapshotFileHeader*>(arena); }
+    const SnapshotFileHeader* header() const { return reinterpret_cast<const SnapshotFileHeader*>(arena); }
+    SnapshotRecord* record(uint64_t version);
+    const SnapshotRecord* record(uint64_t version) const;
+    void release();
+    void reset();
+    // checks the chain of version, oldest (the full snapshot) first into chain
+    bool collectChain(uint64_t version, const SnapshotRecord** chain, size_t& length, std::string& error) const;
+    bool rebuild(uint64_t version, uint8_t* state, std::string& error) const;
+
+    public:
+    explicit SnapshotStore(const CompiledProgram& program, size_t slots = 64);
+    ~SnapshotStore();
+    SnapshotStore(const SnapshotStore&) = delete;
+    SnapshotStore& operator=(const SnapshotStore&) = delete;
+
+    // delta encoding on (default) / off, and a full snapshot at least every n captures,
+    // which bounds the chain a restore has to apply (never more than the ring holds)
+    void setDelta(bool on) { delta = on; }
+    void setFullEvery(unsigned n);
+
+    // keeps the snapshots in path from now on. An existing file of the same program
+    // (and ring size) is reopened with its snapshots, a crashed writer's torn last
+    // record is found by its checksum and skipped; anything else starts a new file.
+    bool open(const std::string& path, std::string& error);
+    // flushes the mapped file to disk, capture() alone only reaches the page cache
+    bool sync(std::string& error);
+
+    // takes a snapshot of frames, returns its version (1, 2, ...)
+    uint64_t capture(const FrameStore& frames);
+    bool restore(uint64_t version, FrameStore& frames, std::string& error) const;
+
+    uint64_t latest() const { return header()->latest; }
+    // oldest version still in the ring (its chain may still reach past the ring, restore() says so)
+    uint64_t oldest() const;
+    // the record of a version still in the ring, nullptr otherwise
+    const SnapshotRecord* info(uint64_t version) const;
+    size_t bytes() const { return stateBytes; }
+    bool persistent() const { return mapped; }
+};
+
+#endif // RUNTIME_SNAPSHOT_H
@@ -0,0 +1,92 @@
+#ifndef RUNTIME_SPSC_RING_H
+#define RUNTIME_SPSC_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "../frameLayout/frameLayout.h"
+
+// Wait-free single producer / single consumer ring of fixed size messages.
+// The producer only writes tail and the consumer only writes head, each on its
+// own cache line, so neither side ever blocks or takes a lock: a full or empty
+// ring just makes beginWrite()/beginRead() return nullptr.
+class SpscRing{
+    private:
+    // each side also keeps the last index it saw of the other one, so it only
+    // touches the other side's cache line when the ring looks full / empty
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head{0}; // next message to read
+    uint64_t seenTail = 0;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail{0}; // next message to write
+    uint64_t seenHead = 0;
+    alignas(CACHE_LINE_SIZE) std::vector<uint32_t> storage;
+    size_t words = 0;    // words per message
+    size_t capacity = 0; // messages, a power of two
+
+    public:
+    SpscRing(size_t wordsPerMessage, size_t messages){
+        capacity = 1;
+        while(capacity < messages) capacity <<= 1;
+        words = wordsPerMessage ? wordsPerMessage : 1;
+        storage.assign(words * capacity, 0);
+    }
+
+    // producer side
+    uint32_t* beginWrite(){
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if(t - seenHead == capacity){
+            seenHead = head.load(std::memory_order_acquire);
+            if(t - seenHead == capacity) return nullptr;
+        }
+        return &storage[(t & (capacity - 1)) * words];
+    }
+    void commitWrite(){
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // consumer side
+    const uint32_t* beginRead(){
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if(h == seenTail){
+            seenTail = tail.load(std::memory_order_acquire);
+            if(h == seenTail) return nullptr;
+        }
+        return &storage[(h & (capacity - 1)) * words];
+    }
+    void commitRead(){
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // batched consumer side: up to max messages that are ready, as at most two
+    // contiguous runs (the second one when the batch wraps around the end of the storage),
+    // released together by commitRead(count)
+    size_t beginReadBatch(size_t max, const uint32_t*& first, size_t& firstCount, const uint32_t*& second){
+        uint64_t h = head.load(std::memory_order_relaxed);
+        seenTail = tail.load(std::memory_order_acquire);
+        size_t count = std::min<uint64_t>(seenTail - h, max);
+        size_t at = h & (capacity - 1);
+        firstCount = std::min(count, capacity - at);
+        first = &storage[at * words];
+        second = storage.data();
+        return count;
+    }
+    void commitRead(size_t count){
+        head.store(head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    size_t messageWords() const { return words; }
+};
+
+// Busy wait hint: spin on the pause instruction, yield the core now and then
+// so an oversubscribed machine still makes progress
+inline void cpuRelax(unsigned& spins){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+    if(++spins % 1024 == 0) std::this_thread::yield();
+}
+
+#endif // RUNTIME_SPSC_RING_H
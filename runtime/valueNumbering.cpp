@@ -0,0 +1,313 @@
+#include "valueNumbering.h"
+#include "bytecode.h"
+
+ValueNumbering::ValueNumbering(){
+    // nothing to initialize
+}
+
+const ValueUse* ValueNumbering::find(const ExpressionNode* expr) const{
+    if(uses.empty()) return nullptr;
+    auto it = uses.find(expr);
+    return it == uses.end() ? nullptr : &it->second;
+}
+
+size_t ValueNumbering::tempCount() const{
+    size_t count = 0;
+    for(const auto& entry : entries){
+        if(entry.refs > 0) count++;
+    }
+    return count;
+}
+
+uint32_t ValueNumbering::freshValue(){
+    return nextValue++;
+}
+
+void ValueNumbering::write(int slot){
+    if(slot < 0) return;
+    slotValue[slot] = freshValue();
+    writeLog.push_back(slot);
+}
+
+void ValueNumbering::numberBlock(const ControlNode* control, FrameLayout& frame){
+    layout = &frame;
+    nextValue = 0;
+    literals.clear();
+    available.clear();
+    availableLog.clear();
+    writeLog.clear();
+    entries.clear();
+    hits.clear();
+    reuses.clear();
+    uses.clear();
+    scopeParent.assign(1, -1);
+    scope = 0;
+
+    // whatever a slot holds when the block starts is one unknown value
+    slotValue.resize(frame.slots.size());
+    slotWritten.assign(frame.slots.size(), false);
+    for(auto& value : slotValue) value = freshValue();
+
+    numberStatements(control->statements);
+
+    placeTemps(frame);
+
+    for(const auto& reuse : reuses){
+        const Entry& entry = entries[reuse.second];
+        ValueUse use;
+        use.kind = ValueUse::REUSE;
+        use.temp = entry.temp;
+        use.type = entry.type;
+        use.def = entry.node;
+        uses[reuse.first] = use;
+    }
+    for(const auto& entry : entries){
+        if(entry.refs == 0) continue;
+        ValueUse use;
+        use.kind = ValueUse::DEFINE;
+        use.temp = entry.temp;
+        use.type = entry.type;
+        uses[entry.node] = use;
+    }
+    layout = nullptr;
+}
+
+void ValueNumbering::numberStatement(const StatementNode* statement){
+    if(!statement) return;
+
+    if(auto decl = dynamic_cast<const VarDeclNode*>(statement)){
+        // if body variables are zeroed every time the declaration runs
+        int slot = layout->slotOf(decl);
+        if(slot >= 0 && layout->slots[slot].scope > 0) write(slot);
+    }
+    else if(auto assign = dynamic_cast<const AssignmentNode*>(statement)){
+        // the right side still sees the old value of the target
+        TypeTag type;
+        if(assign->expression){
+            numberExpression(assign->expression.get(), type);
+        }
+        write(layout->slotOf(assign));
+    }
+}
+
+void ValueNumbering::numberStatements(const std::vector<std::unique_ptr<StatementNode>>& statements){
+    // if bodies from an explicit stack, one entry per open body,
+    // so a deep nesting cannot overflow the call stack
+    struct Body{
+        const std::vector<std::unique_ptr<StatementNode>>* statements;
+        size_t next;
+        int parent;             // scope around the body
+        size_t availableMark;   // logs when the body was entered
+        size_t writeMark;
+    };
+    std::vector<Body> bodies{{&statements, 0, -1, 0, 0}};
+    while(!bodies.empty()){
+        Body& body = bodies.back();
+        if(body.next < body.statements->size()){
+            const StatementNode* statement = (*body.statements)[body.next++].get();
+            auto ifnode = dynamic_cast<const IfNode*>(statement);
+            if(!ifnode){
+                numberStatement(statement);
+                continue;
+            }
+
+            // the condition always runs, what it computes stays available after the if
+            if(ifnode->condition){
+                TypeTag type;
+                for(const auto* side : {ifnode->condition->left.get(), ifnode->condition->right.get()}){
+                    if(!side) continue;
+                    numberExpression(side, type);
+                }
+            }
+
+            int parent = scope;
+            scope = scopeParent.size();
+            scopeParent.push_back(parent);
+            bodies.push_back({&ifnode->statements, 0, parent, availableLog.size(), writeLog.size()});
+            continue;
+        }
+
+        Body done = body;
+        bodies.pop_back();
+        if(bodies.empty()) break;
+
+        // the body may not have run: forget what it computed and
+        // give every slot it wrote a value no earlier expression has
+        for(size_t i = done.availableMark; i < availableLog.size(); i++){
+            available.erase(availableLog[i]);
+        }
+        availableLog.resize(done.availableMark);
+        // every slot once, so the log of an enclosing body does not grow with the nesting depth
+        std::vector<int> written(writeLog.begin() + done.writeMark, writeLog.end());
+        writeLog.resize(done.writeMark);
+        for(int slot : written){
+            if(slotWritten[slot]) continue;
+            slotWritten[slot] = true;
+            write(slot);
+        }
+        for(int slot : written) slotWritten[slot] = false;
+        scope = done.parent;
+    }
+}
+
+uint32_t ValueNumbering::numberFactor(const FactorNode* factor, TypeTag& type, const ExpressionNode*& nested){
+    type = TypeTag::TYPE_ERROR;
+    if(auto ident = dynamic_cast<const IdentifierNode*>(factor)){
+        int slot = layout->slotOf(ident);
+        if(slot < 0) return freshValue();
+        type = layout->slots[slot].type;
+        return slotValue[slot];
+    }
+    else if(auto lit = dynamic_cast<const LiteralNode*>(factor)){
+        uint32_t bits = 0;
+        switch(lit->literalType){
+            case TokenType::INT_LITERAL:
+                type = TypeTag::TYPE_INT;
+                bits = static_cast<uint32_t>(std::get<int>(lit->literalValue));
+                break;
+            case TokenType::FLOAT_LITERAL:
+                type = TypeTag::TYPE_FLOAT;
+                bits = static_cast<uint32_t>(floatBits(std::get<float>(lit->literalValue)));
+                break;
+            case TokenType::BOOL_LITERAL:
+                type = TypeTag::TYPE_BOOL;
+                bits = std::get<bool>(lit->literalValue) ? 1 : 0;
+                break;
+            default:
+                return freshValue();
+        }
+        uint64_t key = static_cast<uint64_t>(type) << 32 | bits;
+        auto it = literals.find(key);
+        if(it != literals.end()) return it->second;
+        uint32_t value = freshValue();
+        literals.emplace(key, value);
+        return value;
+    }
+    else if(auto paren = dynamic_cast<const ParenExpressionNode*>(factor)){
+        nested = paren->expression.get();
+    }
+    return freshValue();
+}
+
+int ValueNumbering::numberOperator(const ExpressionNode* expr, uint32_t& value, TypeTag& type,
+                                   uint32_t left, TypeTag leftT, uint32_t right, TypeTag rightT){
+    bool numeric = (leftT == TypeTag::TYPE_INT || leftT == TypeTag::TYPE_FLOAT)
+                && (rightT == TypeTag::TYPE_INT || rightT == TypeTag::TYPE_FLOAT);
+    if(!numeric){
+        // errors are reported by the compiler at every occurrence, never share them
+        value = freshValue();
+        type = TypeTag::TYPE_ERROR;
+        return -1;
+    }
+    type = leftT == TypeTag::TYPE_INT && rightT == TypeTag::TYPE_INT ? TypeTag::TYPE_INT : TypeTag::TYPE_FLOAT;
+
+    // a + b and b + a are the same value, int addition wraps and float addition commutes
+    bool minus = expr->op == TokenType::SYM_MINUS;
+    if(!minus && right < left) std::swap(left, right);
+    uint64_t key = static_cast<uint64_t>(minus) << 63 | static_cast<uint64_t>(left) << 32 | right;
+
+    auto it = available.find(key);
+    if(it != available.end()){
+        value = entries[it->second].value;
+        return it->second;
+    }
+
+    value = freshValue();
+    available.emplace(key, static_cast<int>(entries.size()));
+    availableLog.push_back(key);
+    entries.push_back(Entry{expr, value, type, scope});
+    return -1;
+}
+
+uint32_t ValueNumbering::numberExpression(const ExpressionNode* expr, TypeTag& type){
+    type = TypeTag::TYPE_ERROR;
+    if(!expr || !expr->left) return freshValue();
+
+    // same post order walk as Compiler::compileExpression:
+    // stage 0 numbers the left factor, 1 the right one, 2 the operator
+    struct Frame{
+        const ExpressionNode* expr;
+        int stage;
+        uint32_t left;
+        TypeTag leftT;
+        size_t hitMark; // hits below this node start here
+    };
+    std::vector<Frame> stack;
+    stack.push_back({expr, 0, 0, TypeTag::TYPE_ERROR, hits.size()});
+    uint32_t value = 0;
+
+    while(!stack.empty()){
+        Frame& frame = stack.back();
+        const FactorNode* factor = nullptr;
+        if(frame.stage == 0){
+            frame.stage = 1;
+            factor = frame.expr->left->factor.get();
+        }
+        else if(frame.stage == 1){
+            frame.left = value;
+            frame.leftT = type;
+            if(!frame.expr->right){
+                // a single term is the value of that term
+                stack.pop_back();
+                continue;
+            }
+            frame.stage = 2;
+            factor = frame.expr->right->factor.get();
+        }
+        else{
+            int entry = numberOperator(frame.expr, value, type, frame.left, frame.leftT, value, type);
+            if(entry >= 0){
+                // the compiler loads the whole node, nothing below it is compiled or reused
+                hits.resize(frame.hitMark);
+                hits.push_back({frame.expr, entry});
+            }
+            stack.pop_back();
+            continue;
+        }
+
+        const ExpressionNode* nested = nullptr;
+        value = numberFactor(factor, type, nested);
+        if(nested){
+            if(nested->left) stack.push_back({nested, 0, 0, TypeTag::TYPE_ERROR, hits.size()});
+            else type = TypeTag::TYPE_ERROR;
+        }
+    }
+
+    for(const auto& hit : hits){
+        entries[hit.second].refs++;
+        reuses.push_back(hit);
+    }
+    hits.clear();
+    return value;
+}
+
+void ValueNumbering::placeTemps(FrameLayout& frame){
+    // like the slots of if bodies: a body's temporaries come after those of
+    // every enclosing scope, sibling bodies start at the same offset
+    std::vector<uint32_t> bytes(scopeParent.size(), 0);
+    bool any = false;
+    for(const auto& entry : entries){
+        if(entry.refs == 0) continue;
+        bytes[entry.scope] += sizeof(uint32_t);
+        any = true;
+    }
+    if(!any) return;
+
+    std::vector<uint32_t> base(scopeParent.size(), 0);
+    std::vector<uint32_t> used(scopeParent.size(), 0);
+    uint32_t start = (frame.frameSize + sizeof(uint32_t) - 1) / sizeof(uint32_t) * sizeof(uint32_t);
+    uint32_t end = start;
+    // if bodies are numbered in the order they start, so parents come first
+    for(size_t s = 0; s < scopeParent.size(); s++){
+        base[s] = scopeParent[s] < 0 ? start : base[scopeParent[s]] + bytes[scopeParent[s]];
+        if(base[s] + bytes[s] > end) end = base[s] + bytes[s];
+    }
+    for(auto& entry : entries){
+        if(entry.refs == 0) continue;
+        entry.temp = base[entry.scope] + used[entry.scope];
+        used[entry.scope] += sizeof(uint32_t);
+    }
+
+    frame.frameSize = end;
+    frame.allocSize = (end + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
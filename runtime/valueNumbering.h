@@ -0,0 +1,88 @@
+#ifndef RUNTIME_VALUE_NUMBERING_H
+#define RUNTIME_VALUE_NUMBERING_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "../frameLayout/frameLayout.h"
+#include "../parser/ast.h"
+#include "../typeChecker/types.h"
+
+// What the compiler does with one binary ExpressionNode:
+// DEFINE computes it as usual and also keeps a copy in a temporary of the frame,
+// REUSE loads that temporary instead of computing the subtree again.
+struct ValueUse{
+    enum Kind{ DEFINE, REUSE };
+    Kind kind = DEFINE;
+    uint32_t temp = 0;                      // byte offset of the temporary in the frame
+    TypeTag type = TypeTag::TYPE_ERROR;     // TYPE_INT or TYPE_FLOAT
+    const ExpressionNode* def = nullptr;    // for REUSE, the node that computed the value
+};
+
+// Local value numbering over one control block.
+// Every identifier read gets the number of the last write to its slot,
+// every literal one number per value, and a + or - the number of
+// (op, left number, right number), so two structurally identical expressions
+// between writes to their operands get the same number.
+// A value computed in an if condition is available in the body and after the if,
+// a value computed in an if body only until the body ends.
+class ValueNumbering{
+    private:
+    // one distinct + or - value
+    struct Entry{
+        const ExpressionNode* node; // first node that computed it
+        uint32_t value;
+        TypeTag type;
+        int scope;                  // if body it was computed in, 0 is the block body
+        int refs = 0;               // reuses the compiler will really emit
+        uint32_t temp = 0;
+    };
+
+    const FrameLayout* layout = nullptr;
+    uint32_t nextValue = 0;
+
+    std::vector<uint32_t> slotValue;        // value number of the last write to every slot
+    std::unordered_map<uint64_t, uint32_t> literals;
+    std::unordered_map<uint64_t, int> available; // (op, left, right) -> entry
+    std::vector<uint64_t> availableLog;     // keys in the order they were added, popped per if body
+    std::vector<int> writeLog;              // slots written, in order
+    std::vector<bool> slotWritten;          // scratch for merging the writes of an if body
+
+    std::vector<Entry> entries;
+    std::vector<int> scopeParent;
+    int scope = 0;
+
+    // nodes of the current expression that hit an entry, and every reuse the compiler will emit
+    std::vector<std::pair<const ExpressionNode*, int>> hits;
+    std::vector<std::pair<const ExpressionNode*, int>> reuses;
+
+    std::unordered_map<const ExpressionNode*, ValueUse> uses;
+
+    uint32_t freshValue();
+    void write(int slot);
+
+    void numberStatements(const std::vector<std::unique_ptr<StatementNode>>& statements);
+    // declarations and assignments, numberStatements opens the if bodies
+    void numberStatement(const StatementNode* statement);
+    uint32_t numberExpression(const ExpressionNode* expr, TypeTag& type);
+    uint32_t numberFactor(const FactorNode* factor, TypeTag& type, const ExpressionNode*& nested);
+    // returns the entry the node hit, -1 if it computed a new value (or an error)
+    int numberOperator(const ExpressionNode* expr, uint32_t& value, TypeTag& type,
+                       uint32_t left, TypeTag leftT, uint32_t right, TypeTag rightT);
+    // places the temporaries behind the slots, sibling if bodies share bytes
+    void placeTemps(FrameLayout& layout);
+
+    public:
+    ValueNumbering();
+
+    // numbers the block and appends the temporaries it needs to the frame
+    void numberBlock(const ControlNode* control, FrameLayout& layout);
+
+    // nullptr when the expression is compiled as usual
+    const ValueUse* find(const ExpressionNode* expr) const;
+
+    size_t tempCount() const;
+};
+
+#endif // RUNTIME_VALUE_NUMBERING_H
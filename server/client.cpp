@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "protocol.h"
+
+// Command line client of the compile server, also measures request latency.
+
+static void usage(const char* prog){
+    std::cerr << "Usage: " << prog << " <socket> <-s|-p|-t|-l|-b> <file|-> [options]\n"
+              << "       " << prog << " <socket> --stats | --shutdown\n"
+              << "  <file>           the server reads the file itself\n"
+              << "  -                send the source from stdin inline\n"
+              << "  --inline         read <file> here and send its text inline\n"
+              << "  --bench <n>      send the request n times per client and print latency percentiles\n"
+              << "  --clients <c>    concurrent connections for --bench (default 1)\n";
+}
+
+static int connectTo(const std::string& path){
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(addr.sun_path)) return -1;
+    std::strcpy(addr.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) return -1;
+    if(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static double percentile(const std::vector<double>& sorted, double p){
+    if(sorted.empty()) return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5))];
+}
+
+int main(int argc, char* argv[]){
+    if(argc < 3){
+        usage(argv[0]);
+        return 1;
+    }
+    std::string socketPath = argv[1];
+    Request request;
+    std::string first = argv[2];
+    long bench = 0;
+    unsigned clients = 1;
+    bool sendInline = false;
+
+    if(first == "--stats" || first == "--shutdown"){
+        request.command = first.substr(2);
+        request.mode = "-";
+    }
+    else{
+        if(argc < 4){
+            usage(argv[0]);
+            return 1;
+        }
+        request.mode = first;
+        std::string file = argv[3];
+        for(int i = 4; i < argc; i++){
+            std::string arg = argv[i];
+            if(arg == "--bench" && i + 1 < argc) bench = std::atol(argv[++i]);
+            else if(arg == "--clients" && i + 1 < argc) clients = std::max(1, std::atoi(argv[++i]));
+            else if(arg == "--inline") sendInline = true;
+            else{
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        if(file == "-"){
+            std::stringstream buffer;
+            buffer << std::cin.rdbuf();
+            request.command = "source";
+            request.payload = buffer.str();
+        }
+        else if(sendInline){
+            std::ifstream in(file, std::ios::binary);
+            if(!in){
+                std::cerr << "ERROR :: FILE NOT FOUND :: " << file << "\n";
+                return 1;
+            }
+            std::stringstream buffer;
+            buffer << in.rdbuf();
+            request.command = "source";
+            request.payload = buffer.str();
+        }
+        else{
+            request.command = "path";
+            request.payload = file;
+        }
+    }
+
+    if(bench <= 0){
+        int fd = connectTo(socketPath);
+        if(fd < 0){
+            std::cerr << "ERROR :: cannot connect to " << socketPath << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+        std::string json;
+        bool ok = writeRequest(fd, request) && readResponse(fd, json);
+        close(fd);
+        if(!ok){
+            std::cerr << "ERROR :: no response from " << socketPath << "\n";
+            return 1;
+        }
+        std::cout << json << "\n";
+        return 0;
+    }
+
+    // every client keeps one connection open and sends its requests back to back
+    std::vector<std::vector<double>> perClient(clients);
+    std::vector<int> failed(clients, 0);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(unsigned c = 0; c < clients; c++){
+        threads.emplace_back([&, c](){
+            int fd = connectTo(socketPath);
+            if(fd < 0){
+                failed[c] = 1;
+                return;
+            }
+            std::string json;
+            for(long i = 0; i < bench; i++){
+                auto t0 = std::chrono::steady_clock::now();
+                if(!writeRequest(fd, request) || !readResponse(fd, json)){
+                    failed[c] = 1;
+                    break;
+                }
+                auto t1 = std::chrono::steady_clock::now();
+                perClient[c].push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+            }
+            close(fd);
+        });
+    }
+    for(auto& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> all;
+    for(const auto& samples : perClient) all.insert(all.end(), samples.begin(), samples.end());
+    std::sort(all.begin(), all.end());
+    if(std::count(failed.begin(), failed.end(), 1)){
+        std::cerr << "ERROR :: " << std::count(failed.begin(), failed.end(), 1) << " clients lost the connection\n";
+    }
+    std::cout << std::fixed << std::setprecision(1)
+              << all.size() << " requests, " << clients << " clients: " << all.size() / seconds << " req/s"
+              << ", p50 " << percentile(all, 0.5) << " us"
+              << ", p90 " << percentile(all, 0.9) << " us"
+              << ", p99 " << percentile(all, 0.99) << " us"
+              << ", max " << (all.empty() ? 0 : all.back()) << " us\n";
+    return 0;
+}
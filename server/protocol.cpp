@@ -0,0 +1,76 @@
+#include "protocol.h"
+#include <cerrno>
+#include <cstdlib>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// a request or response larger than this is refused instead of allocated
+constexpr size_t MAX_MESSAGE_BYTES = 1ull << 30;
+
+static bool readFully(int fd, char* data, size_t size){
+    while(size > 0){
+        ssize_t n = read(fd, data, size);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool writeFully(int fd, const char* data, size_t size){
+    while(size > 0){
+        // MSG_NOSIGNAL: a client that went away must not kill the server with SIGPIPE
+        ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+// header lines are short, read them a byte at a time
+static bool readLine(int fd, std::string& line){
+    line.clear();
+    char c;
+    while(true){
+        if(!readFully(fd, &c, 1)) return false;
+        if(c == '\n') return true;
+        line += c;
+        if(line.size() > 256) return false;
+    }
+}
+
+bool readRequest(int fd, Request& request){
+    std::string header;
+    if(!readLine(fd, header)) return false;
+    std::istringstream in(header);
+    size_t length = 0;
+    if(!(in >> request.command >> request.mode >> length)) return false;
+    if(length > MAX_MESSAGE_BYTES) return false;
+    request.payload.resize(length);
+    return readFully(fd, &request.payload[0], length);
+}
+
+bool writeRequest(int fd, const Request& request){
+    std::string header = request.command + " " + (request.mode.empty() ? "-" : request.mode) + " " +
+                         std::to_string(request.payload.size()) + "\n";
+    return writeFully(fd, header.data(), header.size()) &&
+           writeFully(fd, request.payload.data(), request.payload.size());
+}
+
+bool readResponse(int fd, std::string& json){
+    std::string header;
+    if(!readLine(fd, header)) return false;
+    size_t length = std::strtoull(header.c_str(), nullptr, 10);
+    if(length > MAX_MESSAGE_BYTES) return false;
+    json.resize(length);
+    return readFully(fd, &json[0], length);
+}
+
+bool writeResponse(int fd, const std::string& json){
+    std::string header = std::to_string(json.size()) + "\n";
+    return writeFully(fd, header.data(), header.size()) && writeFully(fd, json.data(), json.size());
+}
@@ -0,0 +1,29 @@
+#ifndef SERVER_PROTOCOL_H
+#define SERVER_PROTOCOL_H
+
+#include <string>
+
+// Wire format of the compile server, over a Unix stream socket.
+//
+// request:  "<command> <mode> <length>\n" followed by <length> payload bytes
+//   path    payload is the path of a file the server reads itself
+//   source  payload is the source text
+//   stats   no payload, returns the server counters and latency percentiles
+//   shutdown  no payload, stops the server after answering
+// mode is -s, -p, -t, -l or -b (anything for stats/shutdown)
+//
+// response: "<length>\n" followed by <length> bytes of JSON
+
+struct Request{
+    std::string command;
+    std::string mode;
+    std::string payload;
+};
+
+// blocking helpers, false on a closed socket or an error
+bool readRequest(int fd, Request& request);
+bool writeRequest(int fd, const Request& request);
+bool readResponse(int fd, std::string& json);
+bool writeResponse(int fd, const std::string& json);
+
+#endif // SERVER_PROTOCOL_H
@@ -0,0 +1,272 @@
+#include "server.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#include "../driver/driver.h"
+#include "../output/outputBuffer.h"
+
+// results kept between requests; the cache is simply dropped when it fills up
+constexpr size_t MAX_CACHE_ENTRIES = 4096;
+constexpr size_t LATENCY_WINDOW = 1 << 16;
+
+static uint64_t fnv1a(const std::string& s){
+    uint64_t h = 1469598103934665603ull;
+    for(unsigned char c : s){
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+namespace{
+// A "Line X, Col Y: message" line of the tool output taken apart
+struct Diagnostic{
+    int line = 0;
+    int col = 0;
+    std::string message;
+};
+}
+
+static std::vector<Diagnostic> parseDiagnostics(const std::string& text){
+    std::vector<Diagnostic> diagnostics;
+    std::istringstream in(text);
+    std::string line;
+    while(std::getline(in, line)){
+        Diagnostic d;
+        if(splitDiagnostic(line, d.line, d.col, d.message)) diagnostics.push_back(d);
+    }
+    return diagnostics;
+}
+
+// only ever removes a socket: a mistyped --serve path must not delete the file it names
+static bool isSocketFile(const std::string& path){
+    struct stat st;
+    return lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode);
+}
+
+CompileServer::CompileServer(const std::string& path, unsigned clients)
+    : socketPath(path), maxClients(std::max(1u, clients)){
+}
+
+CompileServer::~CompileServer(){
+    stop();
+}
+
+bool CompileServer::start(std::string& error){
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(socketPath.size() >= sizeof(addr.sun_path)){
+        error = "socket path too long: " + socketPath;
+        return false;
+    }
+    std::strcpy(addr.sun_path, socketPath.c_str());
+
+    // a stale socket file of a previous server would make bind fail,
+    // anything else at the path is not ours to remove
+    struct stat st;
+    if(lstat(socketPath.c_str(), &st) == 0){
+        if(!S_ISSOCK(st.st_mode)){
+            error = "cannot listen on " + socketPath + ": the path exists and is not a socket";
+            return false;
+        }
+        unlink(socketPath.c_str());
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listenFd < 0){
+        error = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+    if(bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listenFd, 64) < 0){
+        error = "cannot listen on " + socketPath + ": " + std::strerror(errno);
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    latencies.assign(LATENCY_WINDOW, 0);
+    return true;
+}
+
+void CompileServer::stop(){
+    if(stopping.exchange(true)) return;
+    // wakes up accept()
+    if(listenFd >= 0) shutdown(listenFd, SHUT_RDWR);
+
+    // idle clients wake up from read(), a response being written still goes out
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    for(int fd : clientFds) shutdown(fd, SHUT_RD);
+    clientDone.notify_all();
+}
+
+void CompileServer::run(){
+    while(!stopping){
+        {
+            std::unique_lock<std::mutex> lock(clientsMutex);
+            clientDone.wait(lock, [&]{ return activeClients < maxClients || stopping; });
+        }
+        int fd = accept(listenFd, nullptr, nullptr);
+        if(fd < 0){
+            if(errno == EINTR) continue;
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            activeClients++;
+            clientFds.push_back(fd);
+        }
+        std::thread(&CompileServer::serveClient, this, fd).detach();
+    }
+
+    // let the connections that are still open finish their request
+    {
+        std::unique_lock<std::mutex> lock(clientsMutex);
+        clientDone.wait(lock, [&]{ return activeClients == 0; });
+    }
+    close(listenFd);
+    listenFd = -1;
+    if(isSocketFile(socketPath)) unlink(socketPath.c_str());
+}
+
+void CompileServer::serveClient(int fd){
+    Request request;
+    while(!stopping && readRequest(fd, request)){
+        auto start = std::chrono::steady_clock::now();
+        bool hit = false;
+        std::string response = handle(request, hit);
+        auto end = std::chrono::steady_clock::now();
+        if(request.command == "path" || request.command == "source"){
+            recordLatency(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(), hit);
+        }
+        if(!writeResponse(fd, response)) break;
+        if(request.command == "shutdown"){
+            stop();
+            break;
+        }
+    }
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    clientFds.erase(std::find(clientFds.begin(), clientFds.end(), fd));
+    close(fd);
+    activeClients--;
+    clientDone.notify_all();
+}
+
+std::string CompileServer::handle(const Request& request, bool& hit){
+    if(request.command == "stats") return statsJson();
+    if(request.command == "shutdown") return "{\"status\": \"ok\"}";
+    if(request.command != "path" && request.command != "source"){
+        return "{\"status\": \"error\", \"message\": " + jsonString("unknown command " + request.command) + "}";
+    }
+    if(!isValidMode(request.mode)){
+        return "{\"status\": \"error\", \"message\": " + jsonString("invalid mode " + request.mode) + "}";
+    }
+
+    std::string key;
+    bool inline_ = request.command == "source";
+    if(inline_){
+        key = request.mode + " #" + std::to_string(fnv1a(request.payload)) + ":" + std::to_string(request.payload.size());
+    }
+    else{
+        struct stat st;
+        if(stat(request.payload.c_str(), &st) != 0){
+            return "{\"status\": \"error\", \"file\": " + jsonString(request.payload) +
+                   ", \"message\": \"file not found\"}";
+        }
+        // an unchanged file (same size and modification time) is not even read again
+        key = request.mode + " " + request.payload + ":" + std::to_string(st.st_size) + ":" +
+              std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec);
+    }
+
+    if(caching){
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = cache.find(key);
+        if(it != cache.end() && (!inline_ || it->second->source == request.payload)){
+            hit = true;
+            return it->second->response;
+        }
+    }
+
+    std::string source;
+    std::string file = inline_ ? "" : request.payload;
+    if(inline_) source = request.payload;
+    else if(!readSourceFile(file, source)){
+        return "{\"status\": \"error\", \"file\": " + jsonString(file) + ", \"message\": \"file not found\"}";
+    }
+
+    auto entry = std::make_shared<CacheEntry>();
+    entry->response = compile(request.mode, source, file);
+    if(inline_) entry->source = std::move(source);
+
+    if(!caching) return entry->response;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if(cache.size() >= MAX_CACHE_ENTRIES) cache.clear();
+    cache[key] = entry;
+    return entry->response;
+}
+
+std::string CompileServer::compile(const std::string& mode, const std::string& source, const std::string& file){
+    std::ostringstream out, err;
+    PhaseStats stats; // disabled
+    runMode(mode, source, out, err, stats);
+
+    std::string output = out.str();
+    std::string messages = err.str();
+    std::vector<Diagnostic> diagnostics = parseDiagnostics(output);
+    bool failed = !diagnostics.empty() || !messages.empty();
+
+    std::ostringstream json;
+    json << "{\"status\": \"" << (failed ? "error" : "ok") << "\"";
+    if(!file.empty()) json << ", \"file\": " << jsonString(file);
+    json << ", \"mode\": " << jsonString(mode) << ", \"diagnostics\": [";
+    for(size_t i = 0; i < diagnostics.size(); i++){
+        const Diagnostic& d = diagnostics[i];
+        json << (i ? ", " : "") << "{\"line\": " << d.line << ", \"col\": " << d.col
+             << ", \"severity\": \"error\", \"message\": " << jsonString(d.message) << "}";
+    }
+    json << "], \"stdout\": " << jsonString(output) << ", \"stderr\": " << jsonString(messages) << "}";
+    return json.str();
+}
+
+void CompileServer::recordLatency(uint32_t micros, bool hit){
+    std::lock_guard<std::mutex> lock(statsMutex);
+    latencies[latencyNext % LATENCY_WINDOW] = micros;
+    latencyNext++;
+    requests++;
+    if(hit) cacheHits++;
+}
+
+std::string CompileServer::statsJson(){
+    std::vector<uint32_t> sorted;
+    uint64_t total, hits;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        sorted.assign(latencies.begin(), latencies.begin() + std::min(latencyNext, LATENCY_WINDOW));
+        total = requests;
+        hits = cacheHits;
+    }
+    std::sort(sorted.begin(), sorted.end());
+    auto pct = [&](double p) -> uint32_t{
+        if(sorted.empty()) return 0;
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5))];
+    };
+    size_t entries;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        entries = cache.size();
+    }
+
+    std::ostringstream json;
+    json << "{\"status\": \"ok\", \"requests\": " << total << ", \"cache_hits\": " << hits
+         << ", \"cache_entries\": " << entries
+         << ", \"p50_us\": " << pct(0.5) << ", \"p90_us\": " << pct(0.9) << ", \"p99_us\": " << pct(0.99)
+         << ", \"max_us\": " << (sorted.empty() ? 0 : sorted.back()) << "}";
+    return json.str();
+}
@@ -0,0 +1,67 @@
+#ifndef SERVER_SERVER_H
+#define SERVER_SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "protocol.h"
+
+// Long lived compile server on a Unix domain socket (see protocol.h).
+// Every client connection gets its own thread, at most maxClients at a time.
+// Results are cached between requests: a path is answered from the cache while
+// its size and modification time did not change, an inline source while its
+// text is the same, so editors and hooks asking again pay almost nothing.
+class CompileServer{
+    private:
+    struct CacheEntry{
+        std::string source;    // inline sources keep their text to rule out hash collisions
+        std::string response;
+    };
+
+    std::string socketPath;
+    unsigned maxClients;
+    int listenFd = -1;
+    std::atomic<bool> stopping{false};
+    bool caching = true;
+
+    std::mutex clientsMutex;
+    std::condition_variable clientDone;
+    unsigned activeClients = 0;
+    std::vector<int> clientFds;
+
+    std::mutex cacheMutex;
+    std::unordered_map<std::string, std::shared_ptr<const CacheEntry>> cache;
+
+    // request service times in microseconds, the last LATENCY_WINDOW of them
+    std::mutex statsMutex;
+    std::vector<uint32_t> latencies;
+    size_t latencyNext = 0;
+    uint64_t requests = 0, cacheHits = 0;
+
+    void serveClient(int fd);
+    std::string handle(const Request& request, bool& hit);
+    std::string compile(const std::string& mode, const std::string& source, const std::string& file);
+    std::string statsJson();
+    void recordLatency(uint32_t micros, bool hit);
+
+    public:
+    CompileServer(const std::string& socketPath, unsigned maxClients);
+    ~CompileServer();
+
+    // binds and listens, false with a message when the socket cannot be created
+    bool start(std::string& error);
+    // without the cache every request compiles, to measure cold latency
+    void setCaching(bool enabled) { caching = enabled; }
+
+    // accepts clients until a shutdown request or stop()
+    void run();
+    void stop();
+};
+
+#endif // SERVER_SERVER_H
@@ -0,0 +1,110 @@
+#include "perfCounters.h"
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+const char* perfEventName(int event){
+    switch(event){
+        case PERF_CYCLES: return "cycles";
+        case PERF_INSTRUCTIONS: return "instructions";
+        case PERF_BRANCHES: return "branches";
+        case PERF_BRANCH_MISSES: return "branch_misses";
+        case PERF_LLC_REFERENCES: return "llc_references";
+        case PERF_LLC_MISSES: return "llc_misses";
+        default: return "unknown";
+    }
+}
+
+static double ratio(const PerfSample& s, int num, int den, double scale){
+    if(!s.has(num) || !s.has(den) || s.value[den] == 0) return -1;
+    return scale * s.value[num] / s.value[den];
+}
+
+double PerfSample::ipc() const{ return ratio(*this, PERF_INSTRUCTIONS, PERF_CYCLES, 1.0); }
+double PerfSample::branchMissRate() const{ return ratio(*this, PERF_BRANCH_MISSES, PERF_BRANCHES, 100.0); }
+double PerfSample::llcMissRate() const{ return ratio(*this, PERF_LLC_MISSES, PERF_LLC_REFERENCES, 100.0); }
+
+PerfCounters::PerfCounters(){
+    for(int e = 0; e < PERF_EVENT_COUNT; e++) fds[e] = -1;
+}
+
+PerfCounters::~PerfCounters(){
+    for(int e = 0; e < PERF_EVENT_COUNT; e++){
+        if(fds[e] >= 0) close(fds[e]);
+    }
+}
+
+static int openEvent(uint64_t config){
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    // user space only, that is all perf_event_paranoid 2 allows anyway
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // the kernel multiplexes when there are more events than counters, scale by these
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+bool PerfCounters::open(){
+    static const uint64_t configs[PERF_EVENT_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_REFERENCES,
+        PERF_COUNT_HW_CACHE_MISSES,
+    };
+
+    int firstErrno = 0;
+    for(int e = 0; e < PERF_EVENT_COUNT; e++){
+        fds[e] = openEvent(configs[e]);
+        if(fds[e] < 0 && !firstErrno) firstErrno = errno;
+        if(fds[e] >= 0) available = true;
+    }
+
+    if(!available){
+        reason = std::strerror(firstErrno);
+        if(firstErrno == EACCES || firstErrno == EPERM){
+            reason += " (check /proc/sys/kernel/perf_event_paranoid or the container seccomp profile)";
+        }
+        else if(firstErrno == ENOENT || firstErrno == EOPNOTSUPP || firstErrno == ENODEV){
+            reason += " (no hardware PMU, common in virtual machines)";
+        }
+        else if(firstErrno == ENOSYS){
+            reason += " (kernel built without perf events)";
+        }
+    }
+    return available;
+}
+
+void PerfCounters::start(){
+    for(int e = 0; e < PERF_EVENT_COUNT; e++){
+        if(fds[e] < 0) continue;
+        ioctl(fds[e], PERF_EVENT_IOC_RESET, 0);
+        ioctl(fds[e], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+PerfSample PerfCounters::stop(){
+    PerfSample sample;
+    for(int e = 0; e < PERF_EVENT_COUNT; e++){
+        if(fds[e] >= 0) ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+    }
+    for(int e = 0; e < PERF_EVENT_COUNT; e++){
+        if(fds[e] < 0) continue;
+        uint64_t data[3]; // value, time enabled, time running
+        if(read(fds[e], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) continue;
+        if(data[2] == 0) continue; // never got a hardware counter
+        double scale = data[2] < data[1] ? static_cast<double>(data[1]) / data[2] : 1.0;
+        sample.value[e] = static_cast<uint64_t>(data[0] * scale);
+        sample.valid[e] = true;
+    }
+    return sample;
+}
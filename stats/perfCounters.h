@@ -0,0 +1,58 @@
+#ifndef STATS_PERF_COUNTERS_H
+#define STATS_PERF_COUNTERS_H
+
+#include <cstdint>
+#include <string>
+
+// Hardware events counted around every phase
+enum PerfEvent{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCHES,
+    PERF_BRANCH_MISSES,
+    PERF_LLC_REFERENCES,
+    PERF_LLC_MISSES,
+    PERF_EVENT_COUNT
+};
+
+const char* perfEventName(int event);
+
+// Counter values of one measured interval
+// valid[e] is false when the event could not be opened or never ran
+struct PerfSample{
+    uint64_t value[PERF_EVENT_COUNT] = {};
+    bool valid[PERF_EVENT_COUNT] = {};
+
+    bool has(int e) const { return valid[e]; }
+    double ipc() const;             // instructions per cycle, -1 when unknown
+    double branchMissRate() const;  // branch misses per branch in percent, -1 when unknown
+    double llcMissRate() const;     // LLC misses per LLC reference in percent, -1 when unknown
+};
+
+// Per thread counters through Linux perf_event_open, user space only.
+// Containers often forbid perf_event_open (seccomp, perf_event_paranoid)
+// or virtualize away the PMU: open() then fails and says why, and single
+// events the CPU does not have are just left out of every sample.
+class PerfCounters{
+    private:
+    int fds[PERF_EVENT_COUNT];
+    bool available = false;
+    std::string reason;
+
+    public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // returns false when no counter at all could be opened
+    bool open();
+    bool isAvailable() const { return available; }
+    const std::string& unavailableReason() const { return reason; }
+
+    // resets and starts every counter / stops them and reads the values
+    void start();
+    PerfSample stop();
+};
+
+#endif // STATS_PERF_COUNTERS_H
@@ -0,0 +1,224 @@
+#include "phaseStats.h"
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <sys/resource.h>
+
+#include "../lexer/lexer.h"
+#include "../output/outputBuffer.h"
+
+std::atomic<bool> allocCounting{false};
+std::atomic<bool> allocHookInstalled{false};
+std::atomic<uint64_t> allocCount{0};
+std::atomic<uint64_t> allocBytes{0};
+
+static double clockMs(clockid_t clock){
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+double peakRssMb(){
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0; // KB on Linux
+}
+
+PhaseStats::PhaseStats(bool on) : enabled(on){
+    // the allocation hook only counts while somebody is listening
+    if(enabled) allocCounting.store(true, std::memory_order_relaxed);
+}
+
+bool PhaseStats::enableHardwareCounters(){
+    if(!enabled) return false;
+    countersWanted = true;
+    return perf.isAvailable() || perf.open();
+}
+
+void PhaseStats::begin(const std::string& name){
+    if(!enabled) return;
+    phase = name;
+    allocsStart = allocCount.load(std::memory_order_relaxed);
+    bytesStart = allocBytes.load(std::memory_order_relaxed);
+    cpuStart = clockMs(CLOCK_PROCESS_CPUTIME_ID);
+    wallStart = clockMs(CLOCK_MONOTONIC);
+    // counters start last and stop first so they see as little of us as possible
+    if(perf.isAvailable()) perf.start();
+}
+
+void PhaseStats::end(uint64_t tokens, uint64_t nodes){
+    if(!enabled) return;
+    PhaseRecord r;
+    if(perf.isAvailable()) r.counters = perf.stop();
+    r.wallMs = clockMs(CLOCK_MONOTONIC) - wallStart;
+    r.cpuMs = clockMs(CLOCK_PROCESS_CPUTIME_ID) - cpuStart;
+    r.allocs = allocCount.load(std::memory_order_relaxed) - allocsStart;
+    r.allocBytes = allocBytes.load(std::memory_order_relaxed) - bytesStart;
+    r.name = phase;
+    r.tokens = tokens;
+    r.nodes = nodes;
+    r.peakRssMb = peakRssMb();
+    records.push_back(r);
+}
+
+void PhaseStats::printTable(std::ostream& out) const{
+    bool counted = allocHookInstalled.load(std::memory_order_relaxed);
+    out << std::left << std::setw(11) << "phase"
+        << std::right << std::setw(11) << "wall ms"
+        << std::setw(11) << "cpu ms"
+        << std::setw(11) << "tokens"
+        << std::setw(11) << "nodes"
+        << std::setw(11) << "allocs"
+        << std::setw(12) << "alloc KB"
+        << std::setw(13) << "peak RSS MB" << "\n";
+
+    out << std::fixed << std::setprecision(3);
+    for(const auto& r : records){
+        out << std::left << std::setw(11) << r.name << std::right
+            << std::setw(11) << r.wallMs
+            << std::setw(11) << r.cpuMs
+            << std::setw(11) << r.tokens
+            << std::setw(11) << r.nodes;
+        if(counted){
+            out << std::setw(11) << r.allocs
+                << std::setw(12) << r.allocBytes / 1024.0;
+        }
+        else{
+            out << std::setw(11) << "n/a" << std::setw(12) << "n/a";
+        }
+        out << std::setw(13) << std::setprecision(1) << r.peakRssMb << std::setprecision(3) << "\n";
+    }
+    out << std::defaultfloat;
+
+    if(!countersWanted) return;
+    if(!perf.isAvailable()){
+        out << "hardware counters unavailable: " << perf.unavailableReason() << "\n";
+        return;
+    }
+
+    // unknown values and rates are printed as -
+    auto count = [&](const PerfSample& s, int e) -> std::string{
+        return s.has(e) ? std::to_string(s.value[e]) : "-";
+    };
+    auto rate = [&](double v) -> std::string{
+        if(v < 0) return "-";
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(2) << v;
+        return oss.str();
+    };
+    out << "\n" << std::left << std::setw(11) << "phase"
+        << std::right << std::setw(14) << "cycles"
+        << std::setw(14) << "instructions"
+        << std::setw(7) << "IPC"
+        << std::setw(14) << "branch miss"
+        << std::setw(9) << "miss %"
+        << std::setw(12) << "LLC miss"
+        << std::setw(9) << "miss %" << "\n";
+    for(const auto& r : records){
+        const PerfSample& c = r.counters;
+        out << std::left << std::setw(11) << r.name << std::right
+            << std::setw(14) << count(c, PERF_CYCLES)
+            << std::setw(14) << count(c, PERF_INSTRUCTIONS)
+            << std::setw(7) << rate(c.ipc())
+            << std::setw(14) << count(c, PERF_BRANCH_MISSES)
+            << std::setw(9) << rate(c.branchMissRate())
+            << std::setw(12) << count(c, PERF_LLC_MISSES)
+            << std::setw(9) << rate(c.llcMissRate()) << "\n";
+    }
+}
+
+void PhaseStats::printJson(std::ostream& out, const std::string& file) const{
+    bool counted = allocHookInstalled.load(std::memory_order_relaxed);
+    out << "{\"file\": " << jsonString(file) << ", \"phases\": [";
+    out << std::fixed << std::setprecision(3);
+    for(size_t i = 0; i < records.size(); i++){
+        const auto& r = records[i];
+        out << (i ? ", " : "")
+            << "{\"phase\": \"" << r.name << "\""
+            << ", \"wall_ms\": " << r.wallMs
+            << ", \"cpu_ms\": " << r.cpuMs
+            << ", \"tokens\": " << r.tokens
+            << ", \"nodes\": " << r.nodes;
+        if(counted){
+            out << ", \"allocs\": " << r.allocs
+                << ", \"alloc_bytes\": " << r.allocBytes;
+        }
+        else{
+            out << ", \"allocs\": null, \"alloc_bytes\": null";
+        }
+        out << ", \"peak_rss_mb\": " << r.peakRssMb;
+        if(countersWanted && perf.isAvailable()){
+            for(int e = 0; e < PERF_EVENT_COUNT; e++){
+                out << ", \"" << perfEventName(e) << "\": ";
+                if(r.counters.has(e)) out << r.counters.value[e];
+                else out << "null";
+            }
+            auto rate = [&](const char* key, double v){
+                out << ", \"" << key << "\": ";
+                if(v < 0) out << "null";
+                else out << v;
+            };
+            rate("ipc", r.counters.ipc());
+            rate("branch_miss_pct", r.counters.branchMissRate());
+            rate("llc_miss_pct", r.counters.llcMissRate());
+        }
+        out << "}";
+    }
+    out << "]";
+    if(countersWanted && !perf.isAvailable()){
+        out << ", \"counters_unavailable\": " << jsonString(perf.unavailableReason());
+    }
+    out << "}\n" << std::defaultfloat;
+}
+
+uint64_t countTokens(const std::string& source){
+    Lexer lexer(source);
+    uint64_t tokens = 0;
+    while(lexer.getNextToken().type != TokenType::EOF_TOKEN) tokens++;
+    return tokens;
+}
+
+uint64_t countAstNodes(const ProgramNode* program){
+    if(!program) return 0;
+    // explicit work list, a deeply nested program must not overflow the stack here
+    uint64_t nodes = 0;
+    std::vector<const ASTNode*> work{program};
+    auto pushExpression = [&](const ExpressionNode* expr){
+        if(expr) work.push_back(expr);
+    };
+    while(!work.empty()){
+        const ASTNode* node = work.back();
+        work.pop_back();
+        nodes++;
+
+        if(auto p = dynamic_cast<const ProgramNode*>(node)){
+            for(const auto& c : p->controlBlocks) work.push_back(c.get());
+        }
+        else if(auto c = dynamic_cast<const ControlNode*>(node)){
+            for(const auto& s : c->statements) work.push_back(s.get());
+        }
+        else if(auto a = dynamic_cast<const AssignmentNode*>(node)){
+            pushExpression(a->expression.get());
+        }
+        else if(auto i = dynamic_cast<const IfNode*>(node)){
+            if(i->condition) work.push_back(i->condition.get());
+            for(const auto& s : i->statements) work.push_back(s.get());
+        }
+        else if(auto cond = dynamic_cast<const ConditionNode*>(node)){
+            pushExpression(cond->left.get());
+            pushExpression(cond->right.get());
+        }
+        else if(auto e = dynamic_cast<const ExpressionNode*>(node)){
+            if(e->left) work.push_back(e->left.get());
+            if(e->right) work.push_back(e->right.get());
+        }
+        else if(auto t = dynamic_cast<const TermNode*>(node)){
+            if(t->factor) work.push_back(t->factor.get());
+        }
+        else if(auto paren = dynamic_cast<const ParenExpressionNode*>(node)){
+            pushExpression(paren->expression.get());
+        }
+        // declarations, identifiers and literals are leaves
+    }
+    return nodes;
+}
@@ -0,0 +1,81 @@
+#ifndef STATS_PHASE_STATS_H
+#define STATS_PHASE_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../parser/ast.h"
+#include "perfCounters.h"
+
+// Heap allocation counters, bumped by the operator new in allocCounter.cpp.
+// Only the executables that link allocCounter.o count anything; everywhere
+// else allocHookInstalled stays false and allocations are reported as n/a.
+extern std::atomic<bool> allocCounting;
+extern std::atomic<bool> allocHookInstalled;
+extern std::atomic<uint64_t> allocCount;
+extern std::atomic<uint64_t> allocBytes;
+
+// What one phase of the pipeline cost
+struct PhaseRecord{
+    std::string name;
+    double wallMs = 0;
+    double cpuMs = 0;
+    uint64_t tokens = 0;    // 0 when the phase does not produce tokens
+    uint64_t nodes = 0;     // 0 when the phase does not produce an AST
+    uint64_t allocs = 0;
+    uint64_t allocBytes = 0;
+    double peakRssMb = 0;   // process peak so far, measured when the phase ended
+    PerfSample counters;    // hardware counters, only filled with --perf
+};
+
+// Collects one PhaseRecord per phase.
+// A disabled PhaseStats returns from begin()/end() right away, so the
+// calls can stay in the code path of a normal run.
+class PhaseStats{
+    private:
+    bool enabled = false;
+    std::vector<PhaseRecord> records;
+
+    // hardware counters were asked for / could be opened
+    bool countersWanted = false;
+    PerfCounters perf;
+
+    // state of the phase that is running
+    std::string phase;
+    double wallStart = 0, cpuStart = 0;
+    uint64_t allocsStart = 0, bytesStart = 0;
+
+    public:
+    explicit PhaseStats(bool enabled = false);
+
+    bool isEnabled() const { return enabled; }
+
+    // also count cycles, instructions, branch and LLC misses of every phase;
+    // returns false (and the report says why) when the counters are unavailable
+    bool enableHardwareCounters();
+
+    void begin(const std::string& name);
+    // tokens / nodes are what the phase produced, if anything
+    void end(uint64_t tokens = 0, uint64_t nodes = 0);
+
+    const std::vector<PhaseRecord>& getRecords() const { return records; }
+
+    // the hardware counter table follows the phase table when counters were asked for
+    void printTable(std::ostream& out) const;
+    // {"file": "...", "phases": [{"phase": "lex", ...}, ...]}
+    void printJson(std::ostream& out, const std::string& file) const;
+};
+
+// Counts the tokens of a source buffer without keeping them
+uint64_t countTokens(const std::string& source);
+
+// Counts every node of an AST, the program node included
+uint64_t countAstNodes(const ProgramNode* program);
+
+// Peak resident set size of this process in MB
+double peakRssMb();
+
+#endif // STATS_PHASE_STATS_H
@@ -0,0 +1,39 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "programGenerator.h"
+
+// Deterministic AutoLang program generator
+int main(int argc, char* argv[]){
+    GeneratorOptions options;
+    std::string outPath;
+
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg == "-o" && i + 1 < argc){
+            outPath = argv[++i];
+        }
+        else if(!parseGeneratorFlag(options, i, argc, argv)){
+            std::cerr << "Usage: " << argv[0] << " [-o <file>] [options]\n";
+            printGeneratorFlags(std::cerr);
+            return 1;
+        }
+    }
+
+    ProgramGenerator generator(options);
+    if(outPath.empty()){
+        generator.generate(std::cout);
+    }
+    else{
+        std::ofstream out(outPath, std::ios::binary);
+        if(!out){
+            std::cerr << "ERROR :: cannot write " << outPath << "\n";
+            return 1;
+        }
+        generator.generate(out);
+    }
+    std::cerr << "generated " << generator.bytesWritten() << " bytes, "
+              << generator.errorsInjected() << " injected errors\n";
+    return 0;
+}
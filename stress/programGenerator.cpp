@@ -0,0 +1,258 @@
+#include "programGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+static const char* TYPE_NAMES[] = {"int", "float", "bool"};
+
+uint64_t parseSize(const std::string& text){
+    if(text.empty()) return 0;
+    char* end = nullptr;
+    double value = std::strtod(text.c_str(), &end);
+    switch(*end){
+        case 'k': case 'K': value *= 1024.0; break;
+        case 'm': case 'M': value *= 1024.0 * 1024.0; break;
+        case 'g': case 'G': value *= 1024.0 * 1024.0 * 1024.0; break;
+        default: break;
+    }
+    return static_cast<uint64_t>(value);
+}
+
+ProgramGenerator::ProgramGenerator(const GeneratorOptions& opts) : options(opts), rng(opts.seed){
+    options.varsPerBlock = std::max(3, options.varsPerBlock);
+    options.exprLength = std::max(1, options.exprLength);
+
+    // cumulative zipf weights over variable indexes: index 0 is the hottest name
+    double sum = 0.0;
+    for(int i = 0; i < options.varsPerBlock; i++){
+        sum += 1.0 / std::pow(i + 1, options.zipfS);
+        zipfCdf.push_back(sum);
+    }
+    for(auto& c : zipfCdf) c /= sum;
+}
+
+double ProgramGenerator::uniform(){
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+}
+
+int ProgramGenerator::pick(int n){
+    return std::uniform_int_distribution<int>(0, n - 1)(rng);
+}
+
+int ProgramGenerator::pickVar(){
+    if(!options.zipf) return pick(names.size());
+    double u = uniform();
+    int idx = std::lower_bound(zipfCdf.begin(), zipfCdf.end(), u) - zipfCdf.begin();
+    return std::min<int>(idx, names.size() - 1);
+}
+
+int ProgramGenerator::pickVarOfType(int type){
+    // a few draws from the distribution first, then fall back to a scan
+    for(int tries = 0; tries < 8; tries++){
+        int v = pickVar();
+        if(types[v] == type) return v;
+    }
+    for(size_t v = 0; v < names.size(); v++){
+        if(types[v] == type) return v;
+    }
+    return -1;
+}
+
+std::string ProgramGenerator::literal(int type){
+    switch(type){
+        case 0: return std::to_string(pick(1000));
+        case 1: return std::to_string(pick(500)) + "." + std::to_string(pick(100));
+        default: return pick(2) ? "true" : "false";
+    }
+}
+
+std::string ProgramGenerator::operand(int type){
+    int v = pickVarOfType(type);
+    if(v >= 0 && uniform() < 0.6) return names[v];
+    return literal(type);
+}
+
+std::string ProgramGenerator::expression(int type){
+    // bool values have no arithmetic, a bool expression is a single operand
+    if(type == 2) return operand(type);
+
+    std::string expr = operand(type);
+    std::string closing;
+    for(int t = 1; t < options.exprLength; t++){
+        expr += pick(2) ? " + " : " - ";
+        if(options.parenthesize && t + 1 < options.exprLength){
+            expr += "(" + operand(type);
+            closing += ")";
+        }
+        else{
+            expr += operand(type);
+        }
+    }
+    return expr + closing;
+}
+
+void ProgramGenerator::injectError(std::string& out, const std::string& indent){
+    injectedErrors++;
+    switch(pick(5)){
+        case 0: // missing semicolon
+            out += indent + "set " + names[0] + " " + literal(types[0]) + "\n";
+            break;
+        case 1: // undeclared identifier
+            out += indent + "set undeclared" + std::to_string(pick(100)) + " 1;\n";
+            break;
+        case 2: { // type mismatch: a bool into a number or a number into a bool
+            int v = pickVar();
+            out += indent + "set " + names[v] + " " + literal(types[v] == 2 ? 0 : 2) + ";\n";
+            break;
+        }
+        case 3: // unknown character
+            out += indent + "set " + names[0] + " @;\n";
+            break;
+        default: // dangling operator
+            out += indent + "set " + names[0] + " " + names[0] + " + ;\n";
+            break;
+    }
+}
+
+static std::string indentOf(int depth){
+    // indentation is capped so very deep nesting does not grow quadratically
+    return std::string(4 * std::min(depth + 1, 32), ' ');
+}
+
+bool ProgramGenerator::statementLine(std::string& out, int depth){
+    std::string indent = indentOf(depth);
+
+    if(options.errorDensity > 0.0 && uniform() < options.errorDensity){
+        injectError(out, indent);
+        return false;
+    }
+
+    if(depth < options.maxDepth && uniform() < options.ifChance){
+        int v = pickVar();
+        int type = types[v];
+        if(type == 2) out += indent + "if (" + names[v] + " == " + literal(2) + ") {\n";
+        else if(pick(2)) out += indent + "if (" + expression(type) + " > " + literal(type) + ") {\n";
+        else out += indent + "if (" + names[v] + " == " + expression(type) + ") {\n";
+        return true;
+    }
+
+    int v = pickVar();
+    out += indent + "set " + names[v] + " " + expression(types[v]) + ";\n";
+    return false;
+}
+
+void ProgramGenerator::statement(std::string& out, int depth){
+    // only the first statement of a body may nest again,
+    // so deep nesting grows the program linearly and not exponentially.
+    // The open ifs are kept on an explicit stack, deep nesting cannot overflow the call stack
+    struct Open{
+        int depth;
+        int rest; // statements of the body after the one that nests
+    };
+    std::vector<Open> open;
+    while(statementLine(out, depth)){
+        int body = 1 + pick(3);
+        open.push_back({depth, body - 1});
+        depth++;
+    }
+
+    // innermost first: the rest of each body never nests, then its closing brace
+    double saved = options.ifChance;
+    options.ifChance = 0.0;
+    while(!open.empty()){
+        Open o = open.back();
+        open.pop_back();
+        for(int s = 0; s < o.rest; s++) statementLine(out, o.depth + 1);
+        out += indentOf(o.depth) + "}\n";
+    }
+    options.ifChance = saved;
+}
+
+size_t ProgramGenerator::writeBlock(std::ostream& stream, uint64_t index){
+    std::string out;
+
+    for(int c = 0; c < options.commentLines; c++){
+        out += "# generated comment " + std::to_string(c) + " ----------------------------------------\n";
+    }
+
+    names.clear();
+    types.clear();
+    out += "control block" + std::to_string(index) + " {\n";
+    for(int v = 0; v < options.varsPerBlock; v++){
+        // every type is present at least once
+        int type = v < 3 ? v : pick(3);
+        names.push_back("v" + std::to_string(v));
+        types.push_back(type);
+        out += "    " + std::string(TYPE_NAMES[type]) + " " + names.back() + ";\n";
+    }
+    for(int s = 0; s < options.statementsPerBlock; s++){
+        statement(out, 0);
+    }
+    out += "}\n";
+
+    stream.write(out.data(), out.size());
+    written += out.size();
+    return out.size();
+}
+
+void ProgramGenerator::generate(std::ostream& out){
+    for(uint64_t b = 0; ; b++){
+        if(options.targetBytes > 0){
+            if(written >= options.targetBytes) break;
+        }
+        else if(b >= options.blocks){
+            break;
+        }
+        writeBlock(out, b);
+    }
+}
+
+std::string ProgramGenerator::generateString(){
+    std::ostringstream out;
+    generate(out);
+    return out.str();
+}
+
+bool parseGeneratorFlag(GeneratorOptions& options, int& i, int argc, char* argv[]){
+    std::string arg = argv[i];
+    if(i + 1 >= argc) return false;
+    std::string value = argv[i + 1];
+
+    if(arg == "--seed") options.seed = std::strtoull(value.c_str(), nullptr, 10);
+    else if(arg == "--blocks") options.blocks = std::strtoull(value.c_str(), nullptr, 10);
+    else if(arg == "--size") options.targetBytes = parseSize(value);
+    else if(arg == "--vars") options.varsPerBlock = std::atoi(value.c_str());
+    else if(arg == "--stmts") options.statementsPerBlock = std::atoi(value.c_str());
+    else if(arg == "--depth") options.maxDepth = std::atoi(value.c_str());
+    else if(arg == "--if-chance") options.ifChance = std::atof(value.c_str());
+    else if(arg == "--expr-len") options.exprLength = std::atoi(value.c_str());
+    else if(arg == "--parens") options.parenthesize = value == "1" || value == "true";
+    else if(arg == "--dist"){
+        if(value != "uniform" && value != "zipf") return false;
+        options.zipf = value == "zipf";
+    }
+    else if(arg == "--zipf-s") options.zipfS = std::atof(value.c_str());
+    else if(arg == "--comments") options.commentLines = std::atoi(value.c_str());
+    else if(arg == "--errors") options.errorDensity = std::atof(value.c_str());
+    else return false;
+
+    i++;
+    return true;
+}
+
+void printGeneratorFlags(std::ostream& out){
+    out << "  --seed <n>           random seed (default 1)\n"
+        << "  --blocks <n>         number of control blocks (default 16)\n"
+        << "  --size <bytes>       generate blocks until this size, accepts K/M/G\n"
+        << "  --vars <n>           variables per block (default 8)\n"
+        << "  --stmts <n>          statements per block (default 12)\n"
+        << "  --depth <n>          deepest if nesting (default 3)\n"
+        << "  --if-chance <p>      chance a statement opens an if (default 0.25)\n"
+        << "  --expr-len <n>       terms per expression (default 3)\n"
+        << "  --parens <0|1>       right nested parenthesized expressions\n"
+        << "  --dist <uniform|zipf> identifier distribution (default uniform)\n"
+        << "  --zipf-s <s>         zipf exponent (default 1.2)\n"
+        << "  --comments <n>       comment lines before every block\n"
+        << "  --errors <p>         chance per statement to inject an error (default 0)\n";
+}
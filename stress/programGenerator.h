@@ -0,0 +1,86 @@
+#ifndef STRESS_PROGRAM_GENERATOR_H
+#define STRESS_PROGRAM_GENERATOR_H
+
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Knobs of the synthetic program generator.
+// The same options and seed always produce the same bytes.
+struct GeneratorOptions{
+    uint64_t seed = 1;
+
+    // stop after this many blocks, or once this many bytes were written (0 = unused)
+    uint64_t blocks = 16;
+    uint64_t targetBytes = 0;
+
+    int varsPerBlock = 8;
+    int statementsPerBlock = 12;
+    int maxDepth = 3;          // deepest if nesting
+    double ifChance = 0.25;    // chance that a statement opens an if
+    int exprLength = 3;        // terms per expression
+    bool parenthesize = false; // wrap every term but the first in ( ), right nested
+
+    // identifier choice: uniform, or zipf with exponent zipfS (a few hot names)
+    bool zipf = false;
+    double zipfS = 1.2;
+
+    // comment lines before every block
+    int commentLines = 0;
+
+    // chance per statement to inject one deliberate error
+    double errorDensity = 0.0;
+};
+
+// Writes AutoLang programs to a stream, block by block, so arbitrarily large
+// programs never have to be held in memory.
+class ProgramGenerator{
+    private:
+    GeneratorOptions options;
+    std::mt19937_64 rng;
+    std::vector<double> zipfCdf;
+    uint64_t written = 0;
+    uint64_t injectedErrors = 0;
+
+    // variables of the block being generated
+    std::vector<std::string> names;
+    std::vector<int> types; // 0 int, 1 float, 2 bool
+
+    double uniform();
+    int pick(int n);
+    int pickVar();
+    int pickVarOfType(int type);
+    std::string literal(int type);
+    std::string operand(int type);
+    std::string expression(int type);
+    // one statement, an if with its whole body
+    void statement(std::string& out, int depth);
+    // one line: a set, an injected error, or the header of an if (returns true)
+    bool statementLine(std::string& out, int depth);
+    void injectError(std::string& out, const std::string& indent);
+
+    public:
+    explicit ProgramGenerator(const GeneratorOptions& options);
+
+    // writes the next control block, returns its size in bytes
+    size_t writeBlock(std::ostream& out, uint64_t index);
+
+    // writes the whole program described by the options
+    void generate(std::ostream& out);
+    std::string generateString();
+
+    uint64_t bytesWritten() const { return written; }
+    uint64_t errorsInjected() const { return injectedErrors; }
+};
+
+// Parses the generator command line flags shared by the generator and the
+// stress tool; returns false on an unknown flag or a bad value
+bool parseGeneratorFlag(GeneratorOptions& options, int& i, int argc, char* argv[]);
+void printGeneratorFlags(std::ostream& out);
+
+// "64K", "1M", "2G" -> bytes
+uint64_t parseSize(const std::string& text);
+
+#endif // STRESS_PROGRAM_GENERATOR_H
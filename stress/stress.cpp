@@ -0,0 +1,199 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "programGenerator.h"
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../parser/astPrinter/astPrinter.h"
+#include "../typeChecker/typechecker.h"
+#include "../runtime/compiler.h"
+
+// Runs the full pipeline over generated programs of growing size.
+// Every size runs in its own child process so the peak RSS reported by
+// wait4() belongs to that size alone, and a crash (for example a stack
+// overflow on deep nesting) is reported instead of ending the run.
+
+struct StressResult{
+    uint64_t bytes = 0;
+    uint64_t tokens = 0;
+    double lexMs = 0, parseMs = 0, checkMs = 0, compileMs = 0, printMs = 0;
+    // bytecode emitted, and what value numbering saved on top of that
+    uint64_t instructions = 0;
+    uint64_t removed = 0;
+};
+
+class NullBuffer : public std::streambuf{
+    protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+static double msSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static StressResult runPipeline(const GeneratorOptions& options){
+    StressResult r;
+    ProgramGenerator generator(options);
+    std::string source = generator.generateString();
+    r.bytes = source.size();
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        Lexer lexer(source);
+        while(lexer.getNextToken().type != TokenType::EOF_TOKEN) r.tokens++;
+    }
+    r.lexMs = msSince(start);
+
+    start = std::chrono::steady_clock::now();
+    Lexer lexer(source);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    r.parseMs = msSince(start);
+
+    NullBuffer nullBuffer;
+    std::streambuf* saved = std::cout.rdbuf(&nullBuffer);
+
+    start = std::chrono::steady_clock::now();
+    TypeChecker checker;
+    checker.checkProgram(program.get());
+    r.checkMs = msSince(start);
+
+    start = std::chrono::steady_clock::now();
+    Compiler compiler;
+    CompiledProgram compiled = compiler.compileProgram(program.get());
+    r.compileMs = msSince(start);
+    for(const auto& block : compiled.blocks){
+        r.instructions += block.code.size();
+        r.removed += block.removedInstructions;
+    }
+
+    start = std::chrono::steady_clock::now();
+    printProgram(program.get());
+    r.printMs = msSince(start);
+
+    std::cout.rdbuf(saved);
+    return r;
+}
+
+int main(int argc, char* argv[]){
+    GeneratorOptions options;
+    uint64_t minBytes = 1024;
+    uint64_t maxBytes = 64ull << 20;
+    uint64_t factor = 4;
+    std::string csvPath;
+
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--min" && hasValue) minBytes = parseSize(argv[++i]);
+        else if(arg == "--max" && hasValue) maxBytes = parseSize(argv[++i]);
+        else if(arg == "--factor" && hasValue) factor = std::max<uint64_t>(2, std::strtoull(argv[++i], nullptr, 10));
+        else if(arg == "--csv" && hasValue) csvPath = argv[++i];
+        else if(!parseGeneratorFlag(options, i, argc, argv)){
+            std::cerr << "Usage: " << argv[0] << " [--min 1K] [--max 64M] [--factor 4] [--csv <file>] [generator options]\n";
+            printGeneratorFlags(std::cerr);
+            return 1;
+        }
+    }
+
+    std::ofstream csv;
+    if(!csvPath.empty()){
+        csv.open(csvPath);
+        csv << "target_bytes,bytes,tokens,lex_ms,parse_ms,check_ms,compile_ms,print_ms,total_ms,instructions,cse_removed,peak_rss_kb,status\n";
+    }
+
+    std::cout << std::left << std::setw(12) << "size"
+              << std::setw(12) << "tokens"
+              << std::setw(10) << "lex ms"
+              << std::setw(10) << "parse ms"
+              << std::setw(10) << "check ms"
+              << std::setw(11) << "compile ms"
+              << std::setw(10) << "print ms"
+              << std::setw(10) << "MB/s"
+              << std::setw(8) << "cse %"
+              << "peak RSS MB\n";
+
+    for(uint64_t size = minBytes; size <= maxBytes; size *= factor){
+        int fds[2];
+        if(pipe(fds) != 0){
+            std::perror("pipe");
+            return 1;
+        }
+
+        pid_t pid = fork();
+        if(pid == 0){
+            close(fds[0]);
+            GeneratorOptions sized = options;
+            sized.targetBytes = size;
+            StressResult r = runPipeline(sized);
+            ssize_t ignored = write(fds[1], &r, sizeof(r));
+            (void)ignored;
+            _exit(0);
+        }
+        close(fds[1]);
+
+        StressResult r;
+        bool ok = read(fds[0], &r, sizeof(r)) == static_cast<ssize_t>(sizeof(r));
+        close(fds[0]);
+
+        int status = 0;
+        struct rusage usage;
+        std::memset(&usage, 0, sizeof(usage));
+        wait4(pid, &status, 0, &usage);
+
+        std::string outcome = "ok";
+        if(WIFSIGNALED(status)){
+            outcome = "crashed (signal " + std::to_string(WTERMSIG(status)) + ")";
+            ok = false;
+        }
+        else if(!ok){
+            outcome = "failed";
+        }
+
+        double total = r.lexMs + r.parseMs + r.checkMs + r.compileMs + r.printMs;
+        double rssMb = usage.ru_maxrss / 1024.0; // ru_maxrss is in KB on Linux
+        std::ostringstream label;
+        label << (size >= (1ull << 20) ? size / (1ull << 20) : size / 1024) << (size >= (1ull << 20) ? "M" : "K");
+
+        std::cout << std::left << std::setw(12) << label.str();
+        if(ok){
+            // the parse phase already includes lexing, so it is not counted twice
+            double pipelineMs = r.parseMs + r.checkMs + r.compileMs + r.printMs;
+            std::cout << std::setw(12) << r.tokens
+                      << std::fixed << std::setprecision(1)
+                      << std::setw(10) << r.lexMs
+                      << std::setw(10) << r.parseMs
+                      << std::setw(10) << r.checkMs
+                      << std::setw(11) << r.compileMs
+                      << std::setw(10) << r.printMs
+                      << std::setw(10) << (pipelineMs > 0 ? r.bytes / 1e3 / pipelineMs : 0.0)
+                      << std::setw(8) << (r.instructions ? 100.0 * r.removed / (r.instructions + r.removed) : 0.0)
+                      << rssMb << "\n" << std::defaultfloat;
+        }
+        else{
+            std::cout << outcome << ", peak RSS " << std::fixed << std::setprecision(1) << rssMb << " MB\n" << std::defaultfloat;
+        }
+
+        if(csv.is_open()){
+            csv << size << "," << r.bytes << "," << r.tokens << ","
+                << r.lexMs << "," << r.parseMs << "," << r.checkMs << ","
+                << r.compileMs << "," << r.printMs << "," << total << ","
+                << r.instructions << "," << r.removed << ","
+                << usage.ru_maxrss << "," << outcome << "\n";
+        }
+
+        if(size > maxBytes / factor) break;
+    }
+    return 0;
+}
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "telemetry.h"
+#include "../replay/trace.h"
+
+// Decodes an execution telemetry file (.alte) written by --telemetry,
+// either event by event or as per block and per site counts.
+
+static void usage(const char* prog){
+    std::cerr << "Usage: " << prog << " <trace.alte> [options]\n"
+              << "  --summary     runs and durations per block, counts per write and if\n"
+              << "  --limit <n>   print the first n events only\n";
+}
+
+struct Site{
+    TelemetrySiteDesc desc;
+    uint64_t count = 0;  // writes, or times the if ran
+    uint64_t taken = 0;
+    uint32_t last = 0;
+};
+
+struct BlockStats{
+    std::string name;
+    uint64_t runs = 0;
+    uint64_t timed = 0; // runs whose enter and exit were both recorded
+    uint64_t totalNanos = 0;
+    uint64_t maxNanos = 0;
+};
+
+static std::string formatValue(uint8_t type, uint32_t bits, int fracBits){
+    std::ostringstream out;
+    switch(static_cast<TypeTag>(type)){
+        case TypeTag::TYPE_INT: out << static_cast<int32_t>(bits); break;
+        case TypeTag::TYPE_FLOAT:
+            if(fracBits != FIXED_POINT_OFF) out << fixedToDouble(static_cast<int32_t>(bits), fracBits);
+            else out << bitsToFloat(static_cast<int32_t>(bits));
+            break;
+        case TypeTag::TYPE_BOOL: out << (bits ? "true" : "false"); break;
+        default: out << "0x" << std::hex << bits; break;
+    }
+    return out.str();
+}
+
+int main(int argc, char* argv[]){
+    if(argc < 2){
+        usage(argv[0]);
+        return 1;
+    }
+    std::string path = argv[1];
+    bool summary = false;
+    uint64_t limit = UINT64_MAX;
+    for(int i = 2; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg == "--summary") summary = true;
+        else if(arg == "--limit" && i + 1 < argc) limit = std::strtoull(argv[++i], nullptr, 10);
+        else{
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    MappedFile file;
+    std::string err;
+    if(!file.open(path, err)){
+        std::cerr << "ERROR :: " << err << "\n";
+        return 1;
+    }
+
+    TelemetryHeader header;
+    if(file.size() < sizeof(header)){
+        std::cerr << "ERROR :: " << path << " is not a telemetry file\n";
+        return 1;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    size_t tables = sizeof(header) + static_cast<size_t>(header.blocks) * sizeof(TelemetryBlockDesc)
+                  + static_cast<size_t>(header.sites) * sizeof(TelemetrySiteDesc);
+    if(std::memcmp(header.magic, TELEMETRY_MAGIC, sizeof(header.magic)) != 0
+       || header.version != TELEMETRY_VERSION || tables > header.dataOffset
+       || header.dataOffset > file.size() || header.dataBytes > file.size() - header.dataOffset){
+        std::cerr << "ERROR :: " << path << " is not a telemetry file or is truncated\n";
+        return 1;
+    }
+    if(header.fracBits != FIXED_POINT_OFF && (header.fracBits < 0 || header.fracBits > MAX_FRAC_BITS)){
+        std::cerr << "ERROR :: " << path << " has a bad fixed point format\n";
+        return 1;
+    }
+
+    const uint8_t* at = file.data() + sizeof(header);
+    std::vector<BlockStats> blocks(header.blocks);
+    for(auto& block : blocks){
+        TelemetryBlockDesc desc;
+        std::memcpy(&desc, at, sizeof(desc));
+        at += sizeof(desc);
+        block.name = std::string(desc.name, strnlen(desc.name, sizeof(desc.name)));
+    }
+    std::vector<Site> sites(header.sites);
+    std::unordered_map<uint64_t, size_t> siteAt;
+    for(size_t s = 0; s < sites.size(); s++){
+        std::memcpy(&sites[s].desc, at, sizeof(TelemetrySiteDesc));
+        at += sizeof(TelemetrySiteDesc);
+        // names and block indexes come from the file, the summary trusts neither
+        sites[s].desc.name[TELEMETRY_NAME_LEN] = '\0';
+        if(sites[s].desc.block >= header.blocks){
+            std::cerr << "ERROR :: site " << s << " of " << path << " names block " << sites[s].desc.block
+                      << ", the file has " << header.blocks << "\n";
+            return 1;
+        }
+        siteAt[static_cast<uint64_t>(sites[s].desc.block) << 32 | sites[s].desc.pc] = s;
+    }
+
+    std::cout << "telemetry: " << header.blocks << " blocks, " << header.sites << " sites, "
+              << header.events << " events, " << header.dropped << " dropped";
+    if(header.fracBits != FIXED_POINT_OFF) std::cout << ", fixed " << qFormatName(header.fracBits);
+    std::cout << "\n";
+
+    // clock ticks to nanoseconds since the trace was opened
+    double nanosPerTick = header.endClock > header.startClock
+        ? static_cast<double>(header.endNanos - header.startNanos) / (header.endClock - header.startClock) : 1.0;
+    auto nanosOf = [&](uint64_t clock){
+        return clock > header.startClock ? static_cast<uint64_t>((clock - header.startClock) * nanosPerTick) : 0;
+    };
+
+    // block each ring is running and when it entered it, for the duration printed at exit
+    std::vector<uint64_t> entered;
+    std::vector<uint32_t> running;
+    std::vector<uint64_t> lostSoFar;
+    uint64_t printed = 0;
+
+    const uint8_t* data = file.data() + header.dataOffset;
+    const uint8_t* end = data + header.dataBytes;
+    while(data + sizeof(TelemetryChunk) <= end){
+        TelemetryChunk chunk;
+        std::memcpy(&chunk, data, sizeof(chunk));
+        data += sizeof(chunk);
+        if(static_cast<size_t>(end - data) / sizeof(TelemetryEvent) < chunk.events){
+            std::cerr << "ERROR :: truncated chunk in " << path << "\n";
+            return 1;
+        }
+        if(chunk.ring >= entered.size()){
+            entered.resize(chunk.ring + 1, 0);
+            running.resize(chunk.ring + 1, UINT32_MAX);
+            lostSoFar.resize(chunk.ring + 1, 0);
+        }
+        // an exit right after a gap may belong to a lost enter
+        if(chunk.dropped > lostSoFar[chunk.ring]) running[chunk.ring] = UINT32_MAX;
+        if(!summary && chunk.dropped > lostSoFar[chunk.ring]){
+            std::cout << "ring " << chunk.ring << "  ... " << chunk.dropped - lostSoFar[chunk.ring] << " events dropped\n";
+        }
+        lostSoFar[chunk.ring] = chunk.dropped;
+
+        for(uint32_t e = 0; e < chunk.events; e++, data += sizeof(TelemetryEvent)){
+            TelemetryEvent event;
+            std::memcpy(&event, data, sizeof(event));
+            TelemetryKind kind = static_cast<TelemetryKind>(event.head >> 28);
+            uint32_t b = event.head & 0x0fffffff;
+            if(b >= blocks.size()) continue;
+            BlockStats& block = blocks[b];
+            if(!summary && printed == limit) return 0;
+            bool print = !summary;
+            if(print) printed++;
+
+            if(kind == TelemetryKind::BLOCK_ENTER || kind == TelemetryKind::BLOCK_EXIT){
+                uint64_t nanos = nanosOf(event.payload);
+                bool paired = false;
+                uint64_t took = 0;
+                if(kind == TelemetryKind::BLOCK_ENTER){
+                    entered[chunk.ring] = nanos;
+                    running[chunk.ring] = b;
+                    block.runs++;
+                }
+                else if(running[chunk.ring] == b){
+                    paired = true;
+                    took = nanos >= entered[chunk.ring] ? nanos - entered[chunk.ring] : 0;
+                    running[chunk.ring] = UINT32_MAX;
+                    block.timed++;
+                    block.totalNanos += took;
+                    block.maxNanos = std::max(block.maxNanos, took);
+                }
+                if(print){
+                    double ms = nanos / 1e6;
+                    std::cout << "ring " << chunk.ring << std::right << std::setw(16) << std::fixed << std::setprecision(6)
+                              << ms << " ms  " << std::defaultfloat
+                              << (kind == TelemetryKind::BLOCK_ENTER ? "enter " : "exit  ") << block.name;
+                    if(paired) std::cout << "  " << took << " ns";
+                    std::cout << "\n";
+                }
+                continue;
+            }
+
+            auto it = siteAt.find(static_cast<uint64_t>(b) << 32 | event.pc);
+            if(it == siteAt.end()) continue;
+            Site& site = sites[it->second];
+            uint32_t value = static_cast<uint32_t>(event.payload);
+            site.count++;
+            site.taken += value != 0;
+            site.last = value;
+            if(print){
+                std::cout << "ring " << chunk.ring << std::string(22, ' ') << block.name << ":" << site.desc.line << "  ";
+                if(kind == TelemetryKind::WRITE){
+                    std::cout << "set " << site.desc.name << " = " << formatValue(site.desc.type, value, header.fracBits) << "\n";
+                }
+                else{
+                    std::cout << "if " << (value ? "taken" : "skipped") << "\n";
+                }
+            }
+        }
+    }
+
+    if(!summary) return 0;
+
+    std::cout << "\n" << std::left << std::setw(24) << "block" << std::setw(12) << "runs"
+              << std::setw(14) << "mean ns" << "max ns\n";
+    for(const auto& block : blocks){
+        if(block.runs == 0) continue;
+        std::cout << std::left << std::setw(24) << block.name << std::setw(12) << block.runs
+                  << std::setw(14) << (block.timed ? block.totalNanos / block.timed : 0) << block.maxNanos << "\n";
+    }
+
+    std::cout << "\n" << std::left << std::setw(32) << "site" << std::setw(12) << "count"
+              << "taken / last value\n";
+    for(const auto& site : sites){
+        std::string where = blocks[site.desc.block].name + ":" + std::to_string(site.desc.line);
+        std::cout << std::left << std::setw(32) << where << std::setw(12) << site.count;
+        if(site.desc.kind == static_cast<uint8_t>(TelemetryKind::BRANCH)){
+            std::cout << "if taken " << site.taken;
+            if(site.count) std::cout << " (" << std::fixed << std::setprecision(1) << 100.0 * site.taken / site.count << "%)" << std::defaultfloat;
+        }
+        else{
+            std::cout << "set " << site.desc.name;
+            if(site.count) std::cout << " = " << formatValue(site.desc.type, site.last, header.fracBits);
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "latency.h"
+#include <algorithm>
+#include <iomanip>
+
+uint64_t latencyBucketLow(size_t bucket){
+    if(bucket < LATENCY_SUB_BUCKETS) return bucket;
+    size_t shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    return (LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS) << shift;
+}
+
+uint64_t latencyBucketHigh(size_t bucket){
+    if(bucket < LATENCY_SUB_BUCKETS) return bucket + 1;
+    size_t shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    return latencyBucketLow(bucket) + (uint64_t(1) << shift);
+}
+
+double telemetryNanosPerTick(){
+#if defined(__x86_64__) || defined(__i386__)
+    // the counter runs at a constant rate, a few ms against the steady clock pin it down to well under 1%
+    static const double nanosPerTick = []{
+        uint64_t startNanos = steadyNanos();
+        uint64_t startClock = telemetryClock();
+        uint64_t nanos;
+        while((nanos = steadyNanos()) - startNanos < 5000000){}
+        uint64_t clock = telemetryClock();
+        return clock > startClock ? static_cast<double>(nanos - startNanos) / (clock - startClock) : 1.0;
+    }();
+    return nanosPerTick;
+#else
+    return 1.0;
+#endif
+}
+
+LatencyRecorder::LatencyRecorder(const CompiledProgram& prog)
+    : program(prog), budgetTicks(prog.blocks.size(), UINT64_MAX){
+}
+
+void LatencyRecorder::setBudget(size_t block, uint64_t nanos){
+    budgetTicks[block] = nanos ? static_cast<uint64_t>(nanos / telemetryNanosPerTick()) : UINT64_MAX;
+}
+
+void LatencyRecorder::setBudget(uint64_t nanos){
+    for(size_t b = 0; b < budgetTicks.size(); b++) setBudget(b, nanos);
+}
+
+LatencyTable* LatencyRecorder::addTable(){
+    std::lock_guard<std::mutex> guard(addLock);
+    size_t count = tableCount.load(std::memory_order_relaxed);
+    if(count == MAX_TABLES) return nullptr;
+    tables[count].reset(new LatencyTable(program.blocks.size(), budgetTicks.data()));
+    tableCount.store(count + 1, std::memory_order_release);
+    return tables[count].get();
+}
+
+LatencyStats LatencyRecorder::stats(size_t block) const{
+    LatencyStats stats;
+    double nanosPerTick = telemetryNanosPerTick();
+    if(budgetTicks[block] != UINT64_MAX) stats.budget = budgetTicks[block] * nanosPerTick;
+
+    // the tables of every thread merged into one histogram
+    std::vector<uint64_t> buckets(LATENCY_BUCKETS, 0);
+    uint64_t total = 0, max = 0;
+    size_t count = tableCount.load(std::memory_order_acquire);
+    for(size_t t = 0; t < count; t++){
+        const BlockLatency& l = tables[t]->block(block);
+        stats.count += l.count.load(std::memory_order_relaxed);
+        stats.overruns += l.overruns.load(std::memory_order_relaxed);
+        total += l.total.load(std::memory_order_relaxed);
+        max = std::max(max, l.max.load(std::memory_order_relaxed));
+        for(size_t i = 0; i < LATENCY_BUCKETS; i++) buckets[i] += l.buckets[i].load(std::memory_order_relaxed);
+    }
+
+    // counters are read one by one while blocks may still run, rank against what the buckets hold
+    uint64_t inBuckets = 0;
+    for(uint64_t c : buckets) inBuckets += c;
+    if(inBuckets == 0) return stats;
+
+    auto percentile = [&](double p){
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * inBuckets + 0.999999));
+        uint64_t seen = 0;
+        for(size_t i = 0; i < LATENCY_BUCKETS; i++){
+            seen += buckets[i];
+            if(seen >= rank) return std::min(latencyBucketHigh(i) - 1, max) * nanosPerTick;
+        }
+        return max * nanosPerTick;
+    };
+    stats.mean = stats.count ? total * nanosPerTick / stats.count : 0;
+    stats.p50 = percentile(0.5);
+    stats.p99 = percentile(0.99);
+    stats.p999 = percentile(0.999);
+    stats.max = max * nanosPerTick;
+    return stats;
+}
+
+void LatencyRecorder::report(std::ostream& out) const{
+    out << std::left << std::setw(24) << "block" << std::setw(12) << "runs"
+        << std::setw(11) << "mean ns" << std::setw(11) << "p50 ns" << std::setw(11) << "p99 ns"
+        << std::setw(11) << "p99.9 ns" << std::setw(12) << "max ns" << "overruns\n";
+    for(size_t b = 0; b < program.blocks.size(); b++){
+        LatencyStats s = stats(b);
+        if(s.count == 0) continue;
+        out << std::left << std::fixed << std::setprecision(0)
+            << std::setw(24) << program.blocks[b].name << std::setw(12) << s.count
+            << std::setw(11) << s.mean << std::setw(11) << s.p50 << std::setw(11) << s.p99
+            << std::setw(11) << s.p999 << std::setw(12) << s.max;
+        if(s.budget > 0) out << s.overruns << " over " << s.budget << " ns";
+        else out << "-";
+        out << "\n" << std::defaultfloat;
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef TELEMETRY_LATENCY_H
+#define TELEMETRY_LATENCY_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../runtime/bytecode.h"
+#include "telemetry.h"
+
+// Per block execution latency histograms, see TELEMETRY.md section 5.
+//
+// Durations are kept in telemetryClock() ticks, in log-linear buckets (HDR histogram
+// layout): 32 linear sub-buckets per power of two, so a bucket is never wider than
+// 1/32 (about 3%) of the values in it. Values up to LATENCY_SUB_BUCKETS are exact.
+constexpr unsigned LATENCY_SUB_BITS = 5;
+constexpr uint64_t LATENCY_SUB_BUCKETS = 1u << LATENCY_SUB_BITS;
+// longer durations land in the last bucket, max() still has them exactly
+constexpr unsigned LATENCY_MAX_BITS = 36;
+constexpr size_t LATENCY_BUCKETS = (LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS;
+
+inline size_t latencyBucket(uint64_t ticks){
+    if(ticks < LATENCY_SUB_BUCKETS) return ticks;
+    if(ticks >> LATENCY_MAX_BITS) return LATENCY_BUCKETS - 1;
+    unsigned top = 63 - __builtin_clzll(ticks);
+    unsigned shift = top - LATENCY_SUB_BITS;
+    return (top - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS + ((ticks >> shift) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+// smallest value of a bucket and the first value past it
+uint64_t latencyBucketLow(size_t bucket);
+uint64_t latencyBucketHigh(size_t bucket);
+
+// nanoseconds per telemetryClock() tick, measured once (a few ms) on the first call
+double telemetryNanosPerTick();
+
+// The counters of one block on one thread. There is exactly one writer, the thread that
+// runs the block, so an update is a relaxed load and store, no locked instruction.
+// Readers on other threads see every counter whole, possibly a run behind another.
+struct alignas(CACHE_LINE_SIZE) BlockLatency{
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> overruns{0};
+    std::atomic<uint64_t> max{0};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> buckets[LATENCY_BUCKETS];
+
+    BlockLatency() { for(auto& b : buckets) b.store(0, std::memory_order_relaxed); }
+};
+
+// The histograms of every block for one thread that runs blocks.
+// Recording never locks or allocates.
+class LatencyTable{
+    private:
+    std::unique_ptr<BlockLatency[]> blocks;
+    // per block budget in ticks, owned by the LatencyRecorder
+    const uint64_t* budgets;
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t by = 1){
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    public:
+    LatencyTable(size_t blockCount, const uint64_t* budgetTicks)
+        : blocks(new BlockLatency[blockCount]), budgets(budgetTicks) {}
+
+    void record(uint32_t block, uint64_t ticks){
+        BlockLatency& l = blocks[block];
+        bump(l.count);
+        bump(l.total, ticks);
+        bump(l.buckets[latencyBucket(ticks)]);
+        if(ticks > l.max.load(std::memory_order_relaxed)) l.max.store(ticks, std::memory_order_relaxed);
+        if(ticks > budgets[block]) bump(l.overruns);
+    }
+
+    const BlockLatency& block(size_t b) const { return blocks[b]; }
+};
+
+// what a histogram says about one block, in nanoseconds
+struct LatencyStats{
+    uint64_t count = 0;
+    uint64_t overruns = 0;
+    double budget = 0;    // 0 when the block has none
+    double mean = 0;
+    double p50 = 0, p99 = 0, p999 = 0;
+    double max = 0;
+};
+
+// Owns one LatencyTable per thread that runs blocks and merges them on demand.
+// Percentiles are the upper end of the bucket the rank falls in (never above max),
+// so they err on the late side.
+class LatencyRecorder{
+    private:
+    static constexpr size_t MAX_TABLES = 256;
+
+    const CompiledProgram& program;
+    std::vector<uint64_t> budgetTicks;
+
+    std::mutex addLock;
+    std::unique_ptr<LatencyTable> tables[MAX_TABLES];
+    std::atomic<size_t> tableCount{0};
+
+    public:
+    explicit LatencyRecorder(const CompiledProgram& program);
+    LatencyRecorder(const LatencyRecorder&) = delete;
+    LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+    // a run longer than the budget counts as an overrun, 0 turns it off.
+    // Set budgets before blocks run.
+    void setBudget(size_t block, uint64_t nanos);
+    void setBudget(uint64_t nanos);
+
+    // one table per thread that runs blocks, call before its control loop starts;
+    // nullptr when MAX_TABLES threads already have one
+    LatencyTable* addTable();
+
+    // safe while blocks run
+    LatencyStats stats(size_t block) const;
+    // one line per block that ran: runs, mean, p50, p99, p99.9, max, overruns
+    void report(std::ostream& out) const;
+};
+
+#endif // TELEMETRY_LATENCY_H
@@ -0,0 +1,192 @@
+#include "telemetry.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// the file grows by at least this much whenever the mapping is full
+static constexpr size_t GROW_BYTES = 16u << 20;
+// events moved from one ring before looking at the next one
+static constexpr size_t CHUNK_EVENTS = 4096;
+
+Telemetry::Telemetry(const CompiledProgram& prog) : program(prog){
+    // nothing is created before open()
+}
+
+Telemetry::~Telemetry(){
+    std::string err;
+    close(err);
+}
+
+uint64_t Telemetry::dropped() const{
+    uint64_t total = 0;
+    size_t count = ringCount.load(std::memory_order_acquire);
+    for(size_t r = 0; r < count; r++) total += rings[r]->dropped();
+    return total;
+}
+
+bool Telemetry::reserve(size_t bytes){
+    if(used + bytes <= mapped) return true;
+    size_t size = std::max(mapped * 2, used + bytes + GROW_BYTES);
+    if(map) munmap(map, mapped);
+    map = nullptr;
+    if(ftruncate(fd, size) != 0) return false;
+    void* m = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(m == MAP_FAILED) return false;
+    map = static_cast<uint8_t*>(m);
+    mapped = size;
+    return true;
+}
+
+static void copyName(char* dst, const std::string& name){
+    std::memset(dst, 0, TELEMETRY_NAME_LEN + 1);
+    std::memcpy(dst, name.data(), std::min(name.size(), TELEMETRY_NAME_LEN));
+}
+
+bool Telemetry::open(const std::string& path, std::string& err){
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0){
+        err = "cannot create '" + path + "': " + std::strerror(errno);
+        return false;
+    }
+
+    size_t siteCount = 0;
+    for(const auto& block : program.blocks) siteCount += block.sites.size();
+    size_t tables = sizeof(TelemetryHeader) + program.blocks.size() * sizeof(TelemetryBlockDesc)
+                  + siteCount * sizeof(TelemetrySiteDesc);
+    size_t dataOffset = (tables + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    if(!reserve(dataOffset)){
+        err = "cannot map '" + path + "': " + std::strerror(errno);
+        return false;
+    }
+    std::memset(map, 0, dataOffset);
+
+    TelemetryHeader header{};
+    std::memcpy(header.magic, TELEMETRY_MAGIC, sizeof(header.magic));
+    header.version = TELEMETRY_VERSION;
+    header.blocks = program.blocks.size();
+    header.sites = siteCount;
+    header.fracBits = program.fracBits;
+    header.dataOffset = dataOffset;
+    header.startClock = telemetryClock();
+    header.startNanos = steadyNanos();
+    std::memcpy(map, &header, sizeof(header));
+
+    uint8_t* at = map + sizeof(header);
+    for(const auto& block : program.blocks){
+        TelemetryBlockDesc desc;
+        copyName(desc.name, block.name);
+        std::memcpy(at, &desc, sizeof(desc));
+        at += sizeof(desc);
+    }
+    for(size_t b = 0; b < program.blocks.size(); b++){
+        const CompiledBlock& block = program.blocks[b];
+        for(const auto& site : block.sites){
+            TelemetrySiteDesc desc{};
+            desc.block = b;
+            desc.pc = site.pc;
+            desc.line = site.line;
+            if(site.slot < 0){
+                desc.kind = static_cast<uint8_t>(TelemetryKind::BRANCH);
+                copyName(desc.name, "");
+            }
+            else{
+                const FrameSlot& slot = block.layout.slots[site.slot];
+                desc.kind = static_cast<uint8_t>(TelemetryKind::WRITE);
+                desc.type = static_cast<uint8_t>(slot.type);
+                copyName(desc.name, slot.name);
+            }
+            std::memcpy(at, &desc, sizeof(desc));
+            at += sizeof(desc);
+        }
+    }
+    used = dataOffset;
+    eventCount = 0;
+
+    running.store(true, std::memory_order_release);
+    drainer = std::thread(&Telemetry::drainLoop, this);
+    return true;
+}
+
+TelemetryRing* Telemetry::addRing(){
+    std::lock_guard<std::mutex> guard(addLock);
+    size_t count = ringCount.load(std::memory_order_relaxed);
+    if(count == MAX_RINGS) return nullptr;
+    rings[count] = std::make_unique<TelemetryRing>(ringEvents);
+    ringCount.store(count + 1, std::memory_order_release);
+    return rings[count].get();
+}
+
+size_t Telemetry::drainOnce(){
+    size_t moved = 0;
+    size_t count = ringCount.load(std::memory_order_acquire);
+    for(size_t r = 0; r < count; r++){
+        SpscRing& ring = rings[r]->messages();
+        const uint32_t* first;
+        const uint32_t* second;
+        size_t firstCount;
+        size_t batch = ring.beginReadBatch(CHUNK_EVENTS, first, firstCount, second);
+        if(batch == 0 || writeFailed) continue;
+        if(!reserve(sizeof(TelemetryChunk) + batch * sizeof(TelemetryEvent))){
+            // out of disk: the producers just see full rings from now on
+            writeFailed = true;
+            continue;
+        }
+
+        TelemetryChunk chunk{};
+        chunk.ring = r;
+        chunk.events = batch;
+        size_t chunkAt = used;
+        used += sizeof(chunk);
+        std::memcpy(map + used, first, firstCount * sizeof(TelemetryEvent));
+        used += firstCount * sizeof(TelemetryEvent);
+        std::memcpy(map + used, second, (batch - firstCount) * sizeof(TelemetryEvent));
+        used += (batch - firstCount) * sizeof(TelemetryEvent);
+        ring.commitRead(batch);
+        chunk.dropped = rings[r]->dropped();
+        std::memcpy(map + chunkAt, &chunk, sizeof(chunk));
+        moved += chunk.events;
+    }
+    eventCount += moved;
+    return moved;
+}
+
+void Telemetry::drainLoop(){
+    while(running.load(std::memory_order_acquire)){
+        // the drainer is allowed to sleep, the control loops never wait for it
+        if(drainOnce() == 0) std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+bool Telemetry::close(std::string& err){
+    if(fd < 0) return true;
+    if(drainer.joinable()){
+        running.store(false, std::memory_order_release);
+        drainer.join();
+        // whatever the producers recorded before close()
+        while(drainOnce() > 0) {}
+    }
+    bool failed = writeFailed || !map;
+
+    if(map){
+        TelemetryHeader header;
+        std::memcpy(&header, map, sizeof(header));
+        header.dataBytes = used - header.dataOffset;
+        header.events = eventCount;
+        header.dropped = dropped();
+        header.endClock = telemetryClock();
+        header.endNanos = steadyNanos();
+        std::memcpy(map, &header, sizeof(header));
+        munmap(map, mapped);
+        map = nullptr;
+    }
+    if(ftruncate(fd, used) != 0) failed = true;
+    if(failed) err = "cannot write telemetry, the trace file could not grow";
+    ::close(fd);
+    fd = -1;
+    mapped = used = 0;
+    writeFailed = false;
+    return !failed;
+}
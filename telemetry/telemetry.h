@@ -0,0 +1,172 @@
+#ifndef TELEMETRY_TELEMETRY_H
+#define TELEMETRY_TELEMETRY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../runtime/bytecode.h"
+#include "../runtime/spscRing.h"
+
+// Execution telemetry (.alte), see TELEMETRY.md
+// header (TelemetryHeader), one TelemetryBlockDesc per block, one TelemetrySiteDesc
+// per variable write and if of the program, then from header.dataOffset (cache line
+// aligned) chunks: a TelemetryChunk followed by chunk.events TelemetryEvents of one ring
+constexpr char TELEMETRY_MAGIC[4] = {'A', 'L', 'T', 'E'};
+constexpr uint32_t TELEMETRY_VERSION = 1;
+constexpr size_t TELEMETRY_NAME_LEN = 47;
+
+enum class TelemetryKind : uint32_t{
+    BLOCK_ENTER = 1, // payload: telemetryClock()
+    BLOCK_EXIT = 2,  // payload: telemetryClock()
+    WRITE = 3,       // payload: the 4 bytes stored
+    BRANCH = 4       // payload: 1 when the if body runs, 0 when it is skipped
+};
+
+// 16 bytes, 4 words of a ring message
+struct TelemetryEvent{
+    uint32_t head;    // kind << 28 | block
+    uint32_t pc;      // the STORE or the jump of the if, 0 for enter and exit
+    uint64_t payload;
+};
+
+struct TelemetryHeader{
+    char magic[4];
+    uint32_t version;
+    uint32_t blocks;
+    uint32_t sites;
+    int32_t fracBits;     // CompiledProgram::fracBits, to print fixed point writes
+    uint32_t dataOffset;
+    uint64_t dataBytes;
+    uint64_t events;
+    uint64_t dropped;     // events lost to full rings
+    // telemetryClock() and steady clock nanoseconds when the trace was opened and closed,
+    // event times are interpolated between the two
+    uint64_t startClock, startNanos;
+    uint64_t endClock, endNanos;
+};
+
+struct TelemetryBlockDesc{
+    char name[TELEMETRY_NAME_LEN + 1];
+};
+
+struct TelemetrySiteDesc{
+    uint32_t block;
+    uint32_t pc;
+    int32_t line;
+    uint8_t kind;   // TelemetryKind::WRITE or BRANCH
+    uint8_t type;   // TypeTag of the variable written
+    uint16_t unused;
+    char name[TELEMETRY_NAME_LEN + 1]; // variable written, empty for an if
+};
+
+struct TelemetryChunk{
+    uint32_t ring;
+    uint32_t events;
+    uint64_t dropped; // events the ring lost so far
+};
+
+inline uint64_t steadyNanos(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// timestamp of block entry and exit: the time stamp counter where there is one,
+// reading it costs a few ns where the steady clock costs tens
+inline uint64_t telemetryClock(){
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return steadyNanos();
+#endif
+}
+
+// The producer side, owned by one thread running blocks.
+// Recording never blocks, locks or allocates: when the drainer fell behind
+// and the ring is full the event is counted as dropped instead.
+class TelemetryRing{
+    private:
+    SpscRing ring;
+    std::atomic<uint64_t> lost{0};
+
+    public:
+    explicit TelemetryRing(size_t events) : ring(sizeof(TelemetryEvent) / sizeof(uint32_t), events) {}
+
+    void record(TelemetryKind kind, uint32_t block, uint32_t pc, uint64_t payload){
+        uint32_t* msg = ring.beginWrite();
+        if(!msg){
+            lost.store(lost.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        msg[0] = static_cast<uint32_t>(kind) << 28 | block;
+        msg[1] = pc;
+        msg[2] = static_cast<uint32_t>(payload);
+        msg[3] = static_cast<uint32_t>(payload >> 32);
+        ring.commitWrite();
+    }
+
+    void enter(uint32_t block) { record(TelemetryKind::BLOCK_ENTER, block, 0, telemetryClock()); }
+    void exit(uint32_t block) { record(TelemetryKind::BLOCK_EXIT, block, 0, telemetryClock()); }
+
+    // consumer side, only the drainer
+    SpscRing& messages() { return ring; }
+    uint64_t dropped() const { return lost.load(std::memory_order_relaxed); }
+};
+
+// Owns the rings and the drainer thread that moves their events
+// into a memory mapped .alte file.
+class Telemetry{
+    private:
+    static constexpr size_t MAX_RINGS = 256;
+
+    const CompiledProgram& program;
+    size_t ringEvents = 1 << 16;
+
+    std::mutex addLock;
+    std::unique_ptr<TelemetryRing> rings[MAX_RINGS];
+    std::atomic<size_t> ringCount{0};
+
+    // the mapping of the output file
+    int fd = -1;
+    uint8_t* map = nullptr;
+    size_t mapped = 0;
+    size_t used = 0;
+
+    std::thread drainer;
+    std::atomic<bool> running{false};
+    uint64_t eventCount = 0;
+    bool writeFailed = false; // the file could not grow, nothing is drained any more
+
+    bool reserve(size_t bytes);
+    void drainLoop();
+    // moves what the rings hold into the file, returns the number of events moved
+    size_t drainOnce();
+
+    public:
+    explicit Telemetry(const CompiledProgram& program);
+    ~Telemetry();
+    Telemetry(const Telemetry&) = delete;
+    Telemetry& operator=(const Telemetry&) = delete;
+
+    // events per ring, for rings added afterwards
+    void setRingEvents(size_t events) { ringEvents = events; }
+
+    // creates the file, writes the block and site tables and starts the drainer
+    bool open(const std::string& path, std::string& err);
+
+    // one ring per thread that runs blocks, call before its control loop starts
+    TelemetryRing* addRing();
+
+    // stops the drainer after the rings are empty and finishes the file
+    bool close(std::string& err);
+
+    uint64_t events() const { return eventCount; }
+    uint64_t dropped() const;
+};
+
+#endif // TELEMETRY_TELEMETRY_H
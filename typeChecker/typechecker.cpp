@@ -51,12 +51,12 @@ bool TypeChecker::isNumeric(TypeTag t){
     return false;
 }
 
-void TypeChecker::inferTerm(const TermNode* term){
+TypeTag TypeChecker::inferTerm(const TermNode* term, const ExpressionNode*& nested){
     if(!term || !term->factor) return TypeTag::TYPE_ERROR;
-    return inferFactor(term->factor.get());
+    return inferFactor(term->factor.get(), nested);
 }
 
-TypeTag TypeChecker::inferFactor(const FactorNode* factor){
+TypeTag TypeChecker::inferFactor(const FactorNode* factor, const ExpressionNode*& nested){
     if(!factor) return TypeTag::TYPE_ERROR;
 
     // FactorNode:= IDENTIFIER | literal | "(" expression ")" 
@@ -85,13 +85,14 @@ TypeTag TypeChecker::inferFactor(const FactorNode* factor){
         }
     }
 
-    // lastly ParenExpression
-    else if(auto paren = dynamic_cast<const ParenLiteral *>(factor)){
+    // lastly ParenExpression, inferExpression picks it up from nested
+    else if(auto paren = dynamic_cast<const ParenExpressionNode *>(factor)){
         if(!paren->expression){
             reportError(0,0,"Empty parentheses expression");
             return TypeTag::TYPE_ERROR;
         }
-        return inferExpression(paren->expression.get());
+        nested = paren->expression.get();
+        return TypeTag::TYPE_ERROR;
     }
 
     // if none of these, throw error
@@ -101,19 +102,7 @@ TypeTag TypeChecker::inferFactor(const FactorNode* factor){
     }
 }
 
-// Now its time to implement the inferExpression part
-TypeTag TypeChecker::inferExpression(const ExpressionNode* expression){
-    // we check leftTerm then rightTerm the for operators
-    if(!expression) return TypeTag::TYPE_ERROR;
-
-    // left type
-    TypeTag leftT = inferTerm(expression->left.get());
-    
-    // Ex: set cat 1
-    if(!expression->right) return leftT;
-
-    TypeTag rightT = inferTerm(expression->right.get());
-
+TypeTag TypeChecker::combineTerms(const ExpressionNode* expression, TypeTag leftT, TypeTag rightT){
     // no side should be an Error
     if(leftT == TypeTag::TYPE_ERROR || rightT == TypeTag::TYPE_ERROR){
         return TypeTag::TYPE_ERROR; // overall error
@@ -139,8 +128,54 @@ TypeTag TypeChecker::inferExpression(const ExpressionNode* expression){
     // otherwise we throw error
     reportError(expression->line, expression->col, "Unexpected operator in expression");
     return TypeTag::TYPE_ERROR;
+}
 
+// Now its time to implement the inferExpression part
+TypeTag TypeChecker::inferExpression(const ExpressionNode* expression){
+    // we check leftTerm then rightTerm the for operators
+    if(!expression) return TypeTag::TYPE_ERROR;
 
+    // Parenthesized sub expressions (and every a + b + ... chain, which the parser
+    // nests to the left) are walked with an explicit stack instead of recursion.
+    // stage 0: infer left, 1: infer right, 2: combine both.
+    // The type of the last finished term or expression is in result.
+    struct Frame{
+        const ExpressionNode* expr;
+        int stage;
+        TypeTag leftT;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({expression, 0, TypeTag::TYPE_ERROR});
+    TypeTag result = TypeTag::TYPE_ERROR;
+
+    while(!stack.empty()){
+        Frame& frame = stack.back();
+        const TermNode* term = nullptr;
+        if(frame.stage == 0){
+            frame.stage = 1;
+            term = frame.expr->left.get();
+        }
+        else if(frame.stage == 1){
+            frame.leftT = result;
+            // Ex: set cat 1
+            if(!frame.expr->right){
+                stack.pop_back();
+                continue;
+            }
+            frame.stage = 2;
+            term = frame.expr->right.get();
+        }
+        else{
+            result = combineTerms(frame.expr, frame.leftT, result);
+            stack.pop_back();
+            continue;
+        }
+
+        const ExpressionNode* nested = nullptr;
+        result = inferTerm(term, nested);
+        if(nested) stack.push_back({nested, 0, TypeTag::TYPE_ERROR});
+    }
+    return result;
 }
 
 void TypeChecker::checkAssignment(const AssignmentNode* assign){
@@ -225,7 +260,7 @@ void TypeChecker::checkAssignment(const AssignmentNode* assign){
 }
 
 void TypeChecker::checkIf(const IfNode* ifnode){
-    std::cout << "Its ifNode \n";
+    // std::cout << "Its ifNode \n";
 }
 
 void TypeChecker::checkVarDecl(const VarDeclNode* decl){
@@ -32,9 +32,12 @@ class TypeChecker{
     void checkIf(const IfNode* node);
 
     // inference : returns inferred type or TYPE_ERROR
+    // inferExpression never recurses, a parenthesized factor only hands
+    // its expression back in nested for the caller's work stack
     TypeTag inferExpression(const ExpressionNode* expr);
-    TypeTag inferTerm(const TermNode* term);
-    TypeTag inferFactor(const FactorNode* factor);
+    TypeTag inferTerm(const TermNode* term, const ExpressionNode*& nested);
+    TypeTag inferFactor(const FactorNode* factor, const ExpressionNode*& nested);
+    TypeTag combineTerms(const ExpressionNode* expr, TypeTag leftT, TypeTag rightT);
 
     // helpers for binary ops
     bool isNumeric(TypeTag t);
@@ -12,7 +12,7 @@ inline const char* typeTagToString(TypeTag t){
     switch(t){
         case TypeTag::TYPE_INT: return "int";
         case TypeTag::TYPE_FLOAT: return "float";
-        case TypeTag::TYPE_BOOL: return "int";
+        case TypeTag::TYPE_BOOL: return "bool";
         default: return "error";
     }
 }
@@ -0,0 +1,366 @@
+#include "xref.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <numeric>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+
+// the records are read in place, their layout is part of the format
+static_assert(sizeof(XrefHeader) == 96, "XrefHeader layout changed");
+static_assert(sizeof(XrefName) == 24, "XrefName layout changed");
+static_assert(sizeof(XrefControl) == 16, "XrefControl layout changed");
+static_assert(sizeof(XrefIf) == 16, "XrefIf layout changed");
+static_assert(sizeof(XrefSite) == 20, "XrefSite layout changed");
+
+// every table starts on an 8 byte boundary
+static constexpr size_t XREF_ALIGN = 8;
+
+static size_t alignUp(size_t value){
+    return (value + XREF_ALIGN - 1) / XREF_ALIGN * XREF_ALIGN;
+}
+
+// ---- building ----
+
+void XrefBuilder::add(const std::string& name, int line, int col, XrefKind kind){
+    // statements outside a control block are parse errors, they have no site
+    if(control == XREF_NONE) return;
+    auto it = nameId.find(name);
+    if(it == nameId.end()){
+        it = nameId.emplace(name, static_cast<uint32_t>(names.size())).first;
+        names.push_back(name);
+    }
+    Site s;
+    s.name = it->second;
+    s.site.control = control;
+    s.site.ifNode = openIfs.empty() ? XREF_NONE : openIfs.back();
+    s.site.line = static_cast<uint32_t>(line);
+    s.site.col = static_cast<uint32_t>(col);
+    s.site.kind = kind;
+    s.site.flags = inCondition && kind == XrefKind::READ ? XREF_IN_CONDITION : 0;
+    s.site.reserved = 0;
+    sites.push_back(s);
+}
+
+void XrefBuilder::enterControl(const std::string& name, int line){
+    control = static_cast<uint32_t>(controls.size());
+    controls.emplace_back(name, static_cast<uint32_t>(line));
+    openIfs.clear();
+    inCondition = false;
+}
+
+void XrefBuilder::leaveControl(){
+    control = XREF_NONE;
+    openIfs.clear();
+    inCondition = false;
+}
+
+void XrefBuilder::enterIf(int line, int col){
+    if(control == XREF_NONE) return;
+    XrefIf node;
+    node.control = control;
+    node.parent = openIfs.empty() ? XREF_NONE : openIfs.back();
+    node.line = static_cast<uint32_t>(line);
+    node.col = static_cast<uint32_t>(col);
+    openIfs.push_back(static_cast<uint32_t>(ifs.size()));
+    ifs.push_back(node);
+    inCondition = true;
+}
+
+void XrefBuilder::enterIfBody(){
+    inCondition = false;
+}
+
+void XrefBuilder::leaveIf(){
+    if(!openIfs.empty()) openIfs.pop_back();
+    inCondition = false;
+}
+
+void XrefBuilder::serialize(std::vector<uint8_t>& out) const{
+    // names in byte order; the sites of a name keep their source order (a counting sort)
+    std::vector<uint32_t> order(names.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){ return names[a] < names[b]; });
+    std::vector<uint32_t> rank(names.size());
+    for(uint32_t r = 0; r < order.size(); r++) rank[order[r]] = r;
+
+    std::vector<uint64_t> first(names.size() + 1, 0);
+    for(const auto& s : sites) first[rank[s.name] + 1]++;
+    for(size_t r = 0; r < names.size(); r++) first[r + 1] += first[r];
+
+    XrefHeader head{};
+    std::memcpy(head.magic, XREF_MAGIC, sizeof(head.magic));
+    head.version = XREF_VERSION;
+    head.nameCount = names.size();
+    head.controlCount = controls.size();
+    head.ifCount = ifs.size();
+    head.siteCount = sites.size();
+
+    uint64_t stringBytes = 0;
+    for(const auto& n : names) stringBytes += n.size();
+    for(const auto& c : controls) stringBytes += c.first.size();
+
+    head.names = alignUp(sizeof(XrefHeader));
+    head.controls = alignUp(head.names + names.size() * sizeof(XrefName));
+    head.ifs = alignUp(head.controls + controls.size() * sizeof(XrefControl));
+    head.sites = alignUp(head.ifs + ifs.size() * sizeof(XrefIf));
+    head.strings = alignUp(head.sites + sites.size() * sizeof(XrefSite));
+    head.stringBytes = stringBytes;
+    head.fileSize = head.strings + stringBytes;
+
+    out.assign(head.fileSize, 0);
+    std::memcpy(out.data(), &head, sizeof(head));
+
+    uint64_t stringAt = 0;
+    char* strings = reinterpret_cast<char*>(out.data() + head.strings);
+    auto addString = [&](const std::string& s){
+        uint64_t at = stringAt;
+        std::memcpy(strings + at, s.data(), s.size());
+        stringAt += s.size();
+        return at;
+    };
+
+    for(uint32_t r = 0; r < order.size(); r++){
+        XrefName entry{};
+        entry.string = addString(names[order[r]]);
+        entry.length = static_cast<uint32_t>(names[order[r]].size());
+        entry.firstSite = first[r];
+        entry.siteCount = static_cast<uint32_t>(first[r + 1] - first[r]);
+        std::memcpy(out.data() + head.names + r * sizeof(XrefName), &entry, sizeof(entry));
+    }
+    for(size_t c = 0; c < controls.size(); c++){
+        XrefControl entry{};
+        entry.string = addString(controls[c].first);
+        entry.length = static_cast<uint32_t>(controls[c].first.size());
+        entry.line = controls[c].second;
+        std::memcpy(out.data() + head.controls + c * sizeof(XrefControl), &entry, sizeof(entry));
+    }
+    if(!ifs.empty()) std::memcpy(out.data() + head.ifs, ifs.data(), ifs.size() * sizeof(XrefIf));
+
+    std::vector<uint64_t> next(first.begin(), first.end() - 1);
+    XrefSite* siteOut = reinterpret_cast<XrefSite*>(out.data() + head.sites);
+    for(const auto& s : sites) siteOut[next[rank[s.name]]++] = s.site;
+}
+
+bool XrefBuilder::save(const std::string& path, std::string& error) const{
+    std::vector<uint8_t> bytes;
+    serialize(bytes);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if(!out){
+        error = "cannot create " + path;
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    if(!out){
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+static bool parseWithXref(const std::string& source, XrefBuilder& builder, std::vector<std::string>& errors){
+    Lexer lexer(source);
+    Parser parser(lexer);
+    parser.setXref(&builder);
+    auto program = parser.parseProgram();
+    errors = lexer.getErrors();
+    for(const auto& err : parser.getErrors()) errors.push_back(err);
+    return errors.empty();
+}
+
+bool buildXref(const std::string& source, std::vector<uint8_t>& out, std::vector<std::string>& errors){
+    XrefBuilder builder;
+    if(!parseWithXref(source, builder, errors)) return false;
+    builder.serialize(out);
+    return true;
+}
+
+bool buildXref(const std::string& source, const std::string& path, std::vector<std::string>& errors){
+    XrefBuilder builder;
+    if(!parseWithXref(source, builder, errors)) return false;
+    std::string error;
+    if(!builder.save(path, error)){
+        errors.push_back(error);
+        return false;
+    }
+    return true;
+}
+
+// ---- reading ----
+
+XrefIndex::~XrefIndex(){
+    close();
+}
+
+void XrefIndex::close(){
+    if(map) munmap(map, size);
+    map = nullptr;
+    base = nullptr;
+    size = 0;
+    head = nullptr;
+}
+
+bool XrefIndex::open(const std::string& path, std::string& error){
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(XrefHeader))){
+        error = path + " is too small to be a cross-reference index";
+        ::close(fd);
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(st.st_size);
+    // not populated: a lookup only touches the pages of the binary search and of its sites
+    void* m = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(m == MAP_FAILED){
+        error = "cannot map " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    if(!attach(static_cast<const uint8_t*>(m), bytes, error)){
+        munmap(m, bytes);
+        error = path + ": " + error;
+        return false;
+    }
+    map = m;
+    return true;
+}
+
+bool XrefIndex::attach(const uint8_t* data, size_t bytes, std::string& error){
+    close();
+    base = data;
+    size = bytes;
+    if(!validate(error)){
+        base = nullptr;
+        size = 0;
+        head = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool XrefIndex::validate(std::string& error){
+    if(size < sizeof(XrefHeader)){
+        error = "too small to be a cross-reference index";
+        return false;
+    }
+    const XrefHeader* h = reinterpret_cast<const XrefHeader*>(base);
+    if(std::memcmp(h->magic, XREF_MAGIC, sizeof(h->magic)) != 0){
+        error = "not a cross-reference index";
+        return false;
+    }
+    if(h->version != XREF_VERSION){
+        error = "index version " + std::to_string(h->version) + ", expected " + std::to_string(XREF_VERSION);
+        return false;
+    }
+    if(h->fileSize != size){
+        error = "index is " + std::to_string(size) + " bytes, its header says " + std::to_string(h->fileSize);
+        return false;
+    }
+    auto inside = [&](uint64_t offset, uint64_t count, size_t record){
+        return offset % XREF_ALIGN == 0 && offset <= size && count <= (size - offset) / record;
+    };
+    if(!inside(h->names, h->nameCount, sizeof(XrefName)) || !inside(h->controls, h->controlCount, sizeof(XrefControl))
+       || !inside(h->ifs, h->ifCount, sizeof(XrefIf)) || !inside(h->sites, h->siteCount, sizeof(XrefSite))
+       || h->strings > size || h->stringBytes > size - h->strings){
+        error = "a table of the index is outside the file";
+        return false;
+    }
+    if(h->controlCount >= XREF_NONE || h->ifCount >= XREF_NONE){
+        error = "too many control blocks or ifs";
+        return false;
+    }
+    head = h;
+    nameTable = reinterpret_cast<const XrefName*>(base + h->names);
+    controlTable = reinterpret_cast<const XrefControl*>(base + h->controls);
+    ifTable = reinterpret_cast<const XrefIf*>(base + h->ifs);
+    siteTable = reinterpret_cast<const XrefSite*>(base + h->sites);
+    strings = reinterpret_cast<const char*>(base + h->strings);
+    return true;
+}
+
+std::string XrefIndex::name(size_t index) const{
+    const XrefName& n = nameTable[index];
+    if(n.string > head->stringBytes || n.length > head->stringBytes - n.string) return "?";
+    return std::string(strings + n.string, n.length);
+}
+
+std::string XrefIndex::controlName(uint32_t control) const{
+    if(control >= head->controlCount) return "?";
+    const XrefControl& c = controlTable[control];
+    if(c.string > head->stringBytes || c.length > head->stringBytes - c.string) return "?";
+    return std::string(strings + c.string, c.length);
+}
+
+bool XrefIndex::lookup(const std::string& identifier, const XrefSite*& sites, size_t& count, std::string& error) const{
+    sites = nullptr;
+    count = 0;
+    size_t lo = 0, hi = head->nameCount;
+    while(lo < hi){
+        size_t mid = lo + (hi - lo) / 2;
+        const XrefName& n = nameTable[mid];
+        if(n.string > head->stringBytes || n.length > head->stringBytes - n.string){
+            error = "name " + std::to_string(mid) + " is outside the strings";
+            return false;
+        }
+        // byte order, the order the names were sorted in
+        size_t common = std::min<size_t>(n.length, identifier.size());
+        int cmp = std::memcmp(strings + n.string, identifier.data(), common);
+        if(cmp == 0) cmp = n.length < identifier.size() ? -1 : n.length > identifier.size() ? 1 : 0;
+        if(cmp < 0) lo = mid + 1;
+        else if(cmp > 0) hi = mid;
+        else{
+            if(n.firstSite > head->siteCount || n.siteCount > head->siteCount - n.firstSite){
+                error = "sites of '" + identifier + "' are outside the site table";
+                return false;
+            }
+            // every if a site points at, and the ifs around it, must be in the table;
+            // a parent is always created before its children, which also rules out cycles
+            for(size_t s = 0; s < n.siteCount; s++){
+                const XrefSite& site = siteTable[n.firstSite + s];
+                if(site.control >= head->controlCount || site.kind < XrefKind::DECLARATION || site.kind > XrefKind::WRITE){
+                    error = "site " + std::to_string(n.firstSite + s) + " is corrupt";
+                    return false;
+                }
+                for(uint32_t id = site.ifNode; id != XREF_NONE; id = ifTable[id].parent){
+                    if(id >= head->ifCount || (ifTable[id].parent != XREF_NONE && ifTable[id].parent >= id)){
+                        error = "if " + std::to_string(id) + " is corrupt";
+                        return false;
+                    }
+                }
+            }
+            sites = siteTable + n.firstSite;
+            count = n.siteCount;
+            return true;
+        }
+    }
+    return true;
+}
+
+void printXrefSite(const XrefIndex& index, const XrefSite& site, std::ostream& out){
+    std::string where = index.controlName(site.control) + ":" + std::to_string(site.line) + ":" + std::to_string(site.col);
+    const char* kind = site.kind == XrefKind::DECLARATION ? "declaration" : site.kind == XrefKind::WRITE ? "write" : "read";
+    out << "  " << where << std::string(where.size() < 28 ? 28 - where.size() : 1, ' ') << kind;
+
+    std::vector<uint32_t> chain;
+    for(uint32_t id = site.ifNode; id != XREF_NONE; id = index.ifNode(id).parent) chain.push_back(id);
+    if(!chain.empty()){
+        out << std::string(13 - std::string(kind).size(), ' ') << "in ";
+        for(size_t i = chain.size(); i-- > 0;){
+            const XrefIf& node = index.ifNode(chain[i]);
+            out << "if " << node.line << ":" << node.col << (i ? " > " : "");
+        }
+        if(site.flags & XREF_IN_CONDITION) out << " (condition)";
+    }
+    out << "\n";
+}
@@ -0,0 +1,167 @@
+#ifndef XREF_XREF_H
+#define XREF_XREF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Cross-reference index (".alx", see XREF.md): for every identifier of a program its
+// declarations, reads and writes, each with the control block and the if it sits in.
+// The parser fills an XrefBuilder while it parses; the saved file is sorted by name
+// and read in place, a lookup is a binary search over the name table.
+
+constexpr char XREF_MAGIC[4] = {'A', 'L', 'X', 'R'};
+constexpr uint32_t XREF_VERSION = 1;
+// no if around a site / no if around an if
+constexpr uint32_t XREF_NONE = UINT32_MAX;
+
+enum class XrefKind : uint8_t{
+    DECLARATION = 1,
+    READ = 2,
+    WRITE = 3
+};
+
+// XrefSite::flags
+constexpr uint8_t XREF_IN_CONDITION = 1; // a read in the condition of XrefSite::ifNode
+
+struct XrefHeader{
+    char magic[4];
+    uint32_t version;
+    uint64_t fileSize;
+    uint64_t nameCount, controlCount, ifCount, siteCount;
+    // file offsets of the tables, in this order
+    uint64_t names;       // XrefName, sorted by name
+    uint64_t controls;    // XrefControl
+    uint64_t ifs;         // XrefIf
+    uint64_t sites;       // XrefSite, grouped by name, in source order inside a name
+    uint64_t strings;     // names of identifiers and control blocks, not terminated
+    uint64_t stringBytes;
+};
+
+struct XrefName{
+    uint64_t string;      // offset into the strings
+    uint64_t firstSite;
+    uint32_t length;
+    uint32_t siteCount;
+};
+
+struct XrefControl{
+    uint64_t string;
+    uint32_t length;
+    uint32_t line;
+};
+
+struct XrefIf{
+    uint32_t control;
+    uint32_t parent;      // enclosing if, XREF_NONE at the top of the block
+    uint32_t line;
+    uint32_t col;
+};
+
+struct XrefSite{
+    uint32_t control;
+    uint32_t ifNode;      // innermost if around the site (or whose condition it is in), XREF_NONE for none
+    uint32_t line;
+    uint32_t col;
+    XrefKind kind;
+    uint8_t flags;
+    uint16_t reserved;
+};
+
+// Collects the sites while a Parser runs (Parser::setXref()). The parser calls the
+// hooks in source order; everything else happens in serialize().
+class XrefBuilder{
+    private:
+    struct Site{
+        uint32_t name;
+        XrefSite site;
+    };
+
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> nameId;
+    std::vector<std::pair<std::string, uint32_t>> controls; // name, line
+    std::vector<XrefIf> ifs;
+    std::vector<Site> sites;
+
+    uint32_t control = XREF_NONE;
+    std::vector<uint32_t> openIfs;
+    bool inCondition = false;
+
+    void add(const std::string& name, int line, int col, XrefKind kind);
+
+    public:
+    // parser hooks
+    void enterControl(const std::string& name, int line);
+    void leaveControl();
+    // the condition of an if is parsed between enterIf() and enterIfBody()
+    void enterIf(int line, int col);
+    void enterIfBody();
+    void leaveIf();
+    void declare(const std::string& name, int line, int col) { add(name, line, col, XrefKind::DECLARATION); }
+    void write(const std::string& name, int line, int col) { add(name, line, col, XrefKind::WRITE); }
+    void read(const std::string& name, int line, int col) { add(name, line, col, XrefKind::READ); }
+
+    size_t siteCount() const { return sites.size(); }
+
+    // lays the index out as a .alx file
+    void serialize(std::vector<uint8_t>& out) const;
+    bool save(const std::string& path, std::string& error) const;
+};
+
+// Lexes and parses source with an XrefBuilder attached and saves the index,
+// what `autolangparser <file> <mode> --xref=<file.alx>` does
+bool buildXref(const std::string& source, const std::string& path, std::vector<std::string>& errors);
+// the same, keeping the index in out
+bool buildXref(const std::string& source, std::vector<uint8_t>& out, std::vector<std::string>& errors);
+
+// A read only index: mapped from a file or attached to bytes the caller keeps alive.
+// Opening only checks the header and that the tables are inside the file, so it costs
+// the same for any size; a lookup checks the records it returns.
+class XrefIndex{
+    private:
+    const uint8_t* base = nullptr;
+    size_t size = 0;
+    void* map = nullptr;
+
+    const XrefHeader* head = nullptr;
+    const XrefName* nameTable = nullptr;
+    const XrefControl* controlTable = nullptr;
+    const XrefIf* ifTable = nullptr;
+    const XrefSite* siteTable = nullptr;
+    const char* strings = nullptr;
+
+    bool validate(std::string& error);
+
+    public:
+    XrefIndex() = default;
+    ~XrefIndex();
+    XrefIndex(const XrefIndex&) = delete;
+    XrefIndex& operator=(const XrefIndex&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+    bool attach(const uint8_t* data, size_t bytes, std::string& error);
+    void close();
+    bool isOpen() const { return head != nullptr; }
+
+    size_t nameCount() const { return head->nameCount; }
+    size_t siteCount() const { return head->siteCount; }
+    size_t fileBytes() const { return size; }
+    std::string name(size_t index) const;
+
+    // sites of an identifier, sites = nullptr and count = 0 when it never appears;
+    // false when the index is corrupt at that name
+    bool lookup(const std::string& identifier, const XrefSite*& sites, size_t& count, std::string& error) const;
+
+    std::string controlName(uint32_t control) const;
+    int controlLine(uint32_t control) const { return controlTable[control].line; }
+    const XrefIf& ifNode(uint32_t id) const { return ifTable[id]; }
+};
+
+// one line per site: block:line:col, kind, and the ifs around it outermost first,
+// "brake:12:17  read  in if 10:5 > if 11:9 (condition)"
+void printXrefSite(const XrefIndex& index, const XrefSite& site, std::ostream& out);
+
+#endif // XREF_XREF_H